@@ -0,0 +1,232 @@
+#include "AnimationCompression.h"
+
+#include <Urho3D/Math/MathDefs.h>
+
+#include <algorithm> // for std::min(), std::max()
+#include <cmath> // for std::abs(), std::asin(), std::sqrt()
+
+using Urho3D::Clamp;
+using Urho3D::Quaternion;
+using Urho3D::Vector3;
+
+static const unsigned VALUES_PER_KEY = 4;
+static const float MAX_QUANTIZED = 65535.0f;
+// the first two rotation components keep 15 bits, the top bits of both hold the index
+// of the dropped largest component
+static const float MAX_QUANTIZED_15 = 32767.0f;
+// the three smallest components of a unit quaternion lie within +-1/sqrt(2)
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+
+static uint16_t quantizeUnit(float value, float maxQuantized)
+{
+    return static_cast<uint16_t>(Clamp(value, 0.0f, 1.0f) * maxQuantized + 0.5f);
+}
+
+static uint16_t quantizeTime(float time, float duration)
+{
+    return duration > 0.0f ? quantizeUnit(time / duration, MAX_QUANTIZED) : 0;
+}
+
+static Vector3 lerpVector(const Vector3 &a, const Vector3 &b, float t)
+{
+    return a + (b - a) * t;
+}
+
+static float vectorError(const Vector3 &a, const Vector3 &b)
+{
+    const Vector3 d = a - b;
+    return std::max(std::abs(d.x_), std::max(std::abs(d.y_), std::abs(d.z_)));
+}
+
+static Quaternion nlerpRotation(const Quaternion &a, const Quaternion &b, float t)
+{
+    return a.Nlerp(b, t, true);
+}
+
+// the angle between two rotations, from the chord rather than the dot product, which
+// loses the small angles the tolerance is about to float rounding
+static float rotationError(const Quaternion &a, const Quaternion &b)
+{
+    const float sign = a.DotProduct(b) < 0.0f ? -1.0f : 1.0f;
+    const float dw = a.w_ - sign * b.w_;
+    const float dx = a.x_ - sign * b.x_;
+    const float dy = a.y_ - sign * b.y_;
+    const float dz = a.z_ - sign * b.z_;
+    const float chord = std::sqrt(dw * dw + dx * dx + dy * dy + dz * dz);
+    return 4.0f * std::asin(std::min(chord * 0.5f, 1.0f));
+}
+
+// indices of the keys to keep: each segment is extended from the last kept key for as
+// long as interpolating across it reproduces every key in between
+template <class Key, class Interpolate, class Error>
+static std::vector<unsigned> reduceKeys(const std::vector<Key> &keys, float tolerance, Interpolate interpolate, Error error)
+{
+    std::vector<unsigned> kept;
+    const unsigned numKeys = static_cast<unsigned>(keys.size());
+    if (!numKeys)
+        return kept;
+    kept.push_back(0);
+    bool constant = true;
+    for (unsigned i = 1; i < numKeys && constant; ++i)
+        constant = error(keys[i].value_, keys[0].value_) <= tolerance;
+    if (constant)
+        return kept;
+
+    unsigned anchor = 0;
+    for (unsigned end = 2; end < numKeys; ++end)
+    {
+        const float span = keys[end].time_ - keys[anchor].time_;
+        bool fits = true;
+        for (unsigned i = anchor + 1; i < end && fits; ++i)
+        {
+            const float t = span > 0.0f ? (keys[i].time_ - keys[anchor].time_) / span : 0.0f;
+            fits = error(interpolate(keys[anchor].value_, keys[end].value_, t), keys[i].value_) <= tolerance;
+        }
+        if (!fits)
+        {
+            anchor = end - 1;
+            kept.push_back(anchor);
+        }
+    }
+    kept.push_back(numKeys - 1);
+    return kept;
+}
+
+static uint16_t * allocateKeys(unsigned numKeys, CookedScene::Storage &storage)
+{
+    return reinterpret_cast<uint16_t*>(CookedScene::Allocate(storage, numKeys * COMPRESSED_KEY_SIZE));
+}
+
+void CompressVectorChannel(const std::vector<VectorKey> &keys, float duration, float tolerance, CookedScene::Storage &storage, CookedAnimationChannel &channel)
+{
+    channel = CookedAnimationChannel();
+    const std::vector<unsigned> kept = reduceKeys(keys, tolerance, lerpVector, vectorError);
+    if (kept.empty())
+        return;
+    Vector3 min = keys[kept.front()].value_;
+    Vector3 max = min;
+    for (const unsigned i : kept)
+    {
+        const Vector3 &value = keys[i].value_;
+        min = Vector3(std::min(min.x_, value.x_), std::min(min.y_, value.y_), std::min(min.z_, value.z_));
+        max = Vector3(std::max(max.x_, value.x_), std::max(max.y_, value.y_), std::max(max.z_, value.z_));
+    }
+    channel.min_ = min;
+    channel.range_ = max - min;
+    const Vector3 &range = channel.range_;
+
+    uint16_t * const data = allocateKeys(static_cast<unsigned>(kept.size()), storage);
+    uint16_t *dest = data;
+    for (const unsigned i : kept)
+    {
+        const Vector3 &value = keys[i].value_;
+        *dest++ = quantizeTime(keys[i].time_, duration);
+        *dest++ = range.x_ > 0.0f ? quantizeUnit((value.x_ - min.x_) / range.x_, MAX_QUANTIZED) : 0;
+        *dest++ = range.y_ > 0.0f ? quantizeUnit((value.y_ - min.y_) / range.y_, MAX_QUANTIZED) : 0;
+        *dest++ = range.z_ > 0.0f ? quantizeUnit((value.z_ - min.z_) / range.z_, MAX_QUANTIZED) : 0;
+    }
+    channel.numKeys_ = static_cast<unsigned>(kept.size());
+    channel.keys_ = data;
+}
+
+// smallest three: the largest component is dropped (made positive by negating the whole
+// quaternion, which is the same rotation) and rebuilt from the unit length on unpacking
+static void packRotation(const Quaternion &rotation, uint16_t *dest)
+{
+    const float components[4] = {rotation.w_, rotation.x_, rotation.y_, rotation.z_};
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+        if (std::abs(components[i]) > std::abs(components[largest]))
+            largest = i;
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    float rest[3];
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+        if (i != largest)
+            rest[j++] = components[i] * sign / SMALLEST_THREE_RANGE * 0.5f + 0.5f;
+    dest[0] = static_cast<uint16_t>(quantizeUnit(rest[0], MAX_QUANTIZED_15) | ((largest >> 1) << 15));
+    dest[1] = static_cast<uint16_t>(quantizeUnit(rest[1], MAX_QUANTIZED_15) | ((largest & 1) << 15));
+    dest[2] = quantizeUnit(rest[2], MAX_QUANTIZED);
+}
+
+static Quaternion unpackRotation(const uint16_t *src)
+{
+    const unsigned largest = ((src[0] >> 15) << 1) | (src[1] >> 15);
+    const float rest[3] =
+    {
+        ((src[0] & 0x7fff) / MAX_QUANTIZED_15 * 2.0f - 1.0f) * SMALLEST_THREE_RANGE,
+        ((src[1] & 0x7fff) / MAX_QUANTIZED_15 * 2.0f - 1.0f) * SMALLEST_THREE_RANGE,
+        (src[2] / MAX_QUANTIZED * 2.0f - 1.0f) * SMALLEST_THREE_RANGE
+    };
+    float components[4];
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+        components[i] = (i == largest) ? 0.0f : rest[j++];
+    components[largest] = std::sqrt(std::max(1.0f - rest[0] * rest[0] - rest[1] * rest[1] - rest[2] * rest[2], 0.0f));
+    return Quaternion(components[0], components[1], components[2], components[3]);
+}
+
+void CompressRotationChannel(const std::vector<RotationKey> &keys, float duration, float tolerance, CookedScene::Storage &storage, CookedAnimationChannel &channel)
+{
+    channel = CookedAnimationChannel();
+    std::vector<RotationKey> normalized(keys);
+    for (RotationKey &key : normalized)
+        key.value_.Normalize();
+    const std::vector<unsigned> kept = reduceKeys(normalized, tolerance, nlerpRotation, rotationError);
+    if (kept.empty())
+        return;
+
+    uint16_t * const data = allocateKeys(static_cast<unsigned>(kept.size()), storage);
+    uint16_t *dest = data;
+    for (const unsigned i : kept)
+    {
+        *dest++ = quantizeTime(normalized[i].time_, duration);
+        packRotation(normalized[i].value_, dest);
+        dest += 3;
+    }
+    channel.numKeys_ = static_cast<unsigned>(kept.size());
+    channel.keys_ = data;
+}
+
+// the key at or before time and how far time is towards the next one
+static unsigned findKey(const CookedAnimationChannel &channel, float time, float duration, unsigned &cursor, float &t)
+{
+    const float keyTime = duration > 0.0f ? time / duration * MAX_QUANTIZED : 0.0f;
+    const uint16_t * const keys = channel.keys_;
+    // looped or jumped back
+    if (cursor >= channel.numKeys_ || keys[cursor * VALUES_PER_KEY] > keyTime)
+        cursor = 0;
+    while (cursor + 1 < channel.numKeys_ && keys[(cursor + 1) * VALUES_PER_KEY] <= keyTime)
+        ++cursor;
+    t = 0.0f;
+    if (cursor + 1 < channel.numKeys_)
+    {
+        const float start = keys[cursor * VALUES_PER_KEY];
+        const float span = keys[(cursor + 1) * VALUES_PER_KEY] - start;
+        if (span > 0.0f)
+            t = Clamp((keyTime - start) / span, 0.0f, 1.0f);
+    }
+    return cursor;
+}
+
+static Vector3 unpackVector(const CookedAnimationChannel &channel, unsigned key)
+{
+    const uint16_t * const src = channel.keys_ + key * VALUES_PER_KEY + 1;
+    return channel.min_ + channel.range_ * Vector3(src[0] / MAX_QUANTIZED, src[1] / MAX_QUANTIZED, src[2] / MAX_QUANTIZED);
+}
+
+Vector3 SampleVectorChannel(const CookedAnimationChannel &channel, float time, float duration, unsigned &cursor)
+{
+    float t;
+    const unsigned key = findKey(channel, time, duration, cursor, t);
+    const Vector3 value = unpackVector(channel, key);
+    return t > 0.0f ? lerpVector(value, unpackVector(channel, key + 1), t) : value;
+}
+
+Quaternion SampleRotationChannel(const CookedAnimationChannel &channel, float time, float duration, unsigned &cursor)
+{
+    float t;
+    const unsigned key = findKey(channel, time, duration, cursor, t);
+    const Quaternion value = unpackRotation(channel.keys_ + key * VALUES_PER_KEY + 1);
+    return t > 0.0f ? nlerpRotation(value, unpackRotation(channel.keys_ + (key + 1) * VALUES_PER_KEY + 1), t) : value;
+}
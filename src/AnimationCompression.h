@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CookedScene.h"
+
+#include <cstddef>
+#include <vector>
+
+// a source key as the importers deliver them, sorted by time (in seconds)
+struct VectorKey
+{
+    float time_;
+    Urho3D::Vector3 value_;
+};
+
+struct RotationKey
+{
+    float time_;
+    Urho3D::Quaternion value_;
+};
+
+// bytes per key of a compressed channel: time and three value components, 16 bits each
+static const std::size_t COMPRESSED_KEY_SIZE = 4 * sizeof(uint16_t);
+// what Urho3D's Animation resource would keep per keyframe of a track (time, position,
+// rotation and scale as floats), for comparing against
+static const std::size_t RAW_KEY_SIZE = sizeof(float) + 10 * sizeof(float);
+
+// drops every key that interpolating between the kept ones reproduces within tolerance
+// (lerp for translations and scales, in units; nlerp for rotations, in radians), a
+// constant channel keeps a single key; the kept values are then quantized to 16 bits,
+// translations and scales over their range, rotations as their three smallest
+// components; thread-safe as long as every concurrent call gets its own storage
+void CompressVectorChannel(const std::vector<VectorKey> &keys, float duration, float tolerance, CookedScene::Storage &storage, CookedAnimationChannel &channel);
+void CompressRotationChannel(const std::vector<RotationKey> &keys, float duration, float tolerance, CookedScene::Storage &storage, CookedAnimationChannel &channel);
+
+// the value at time (0 to duration) of a channel with keys, holding the first and last
+// keys beyond them; cursor is the key the previous sample of the channel ended at, so
+// playing forward only ever steps ahead instead of searching, start it at 0
+Urho3D::Vector3 SampleVectorChannel(const CookedAnimationChannel &channel, float time, float duration, unsigned &cursor);
+Urho3D::Quaternion SampleRotationChannel(const CookedAnimationChannel &channel, float time, float duration, unsigned &cursor);
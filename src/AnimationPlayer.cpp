@@ -0,0 +1,158 @@
+#include "AnimationPlayer.h"
+#include "AnimationCompression.h"
+#include "CookedScene.h"
+
+#include <Urho3D/Scene/Node.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+#include <cmath> // for std::fmod()
+
+using Urho3D::Node;
+using Urho3D::Quaternion;
+using Urho3D::Vector3;
+using Urho3D::VariantMap;
+using Urho3D::E_SCENEUPDATE;
+
+AnimationPlayer::AnimationPlayer(Urho3D::Context *context) :
+    Urho3D::Component(context),
+    speed_(1.0f)
+{
+}
+
+AnimationPlayer::~AnimationPlayer()
+{
+}
+
+void AnimationPlayer::SetAnimations(std::shared_ptr<const CookedScene> scene, Node *root)
+{
+    scene_ = std::move(scene);
+    states_.clear();
+    if (!scene_)
+        return;
+    states_.reserve(scene_->animations_.size());
+    for (const CookedAnimation &animation : scene_->animations_)
+    {
+        State state;
+        state.animation_ = &animation;
+        state.time_ = 0.0f;
+        state.playing_ = false;
+        state.loop_ = false;
+        for (const CookedAnimationTrack &track : animation.tracks_)
+        {
+            Node * const node = root ? root->GetChild(track.nodeName_.c_str(), true) : nullptr;
+            if (node)
+                state.targets_.push_back(Target{Urho3D::WeakPtr<Node>(node), &track, {0, 0, 0}});
+        }
+        states_.push_back(std::move(state));
+    }
+}
+
+void AnimationPlayer::Restart(unsigned index, bool loop)
+{
+    State &state = states_[index];
+    state.time_ = 0.0f;
+    state.playing_ = true;
+    state.loop_ = loop;
+    for (Target &target : state.targets_)
+        target.cursors_[0] = target.cursors_[1] = target.cursors_[2] = 0;
+}
+
+bool AnimationPlayer::Play(const std::string &name, bool loop)
+{
+    for (unsigned i = 0; i < states_.size(); ++i)
+    {
+        if (states_[i].animation_->name_ == name)
+        {
+            Restart(i, loop);
+            return true;
+        }
+    }
+    return false;
+}
+
+void AnimationPlayer::PlayAll(bool loop)
+{
+    for (unsigned i = 0; i < states_.size(); ++i)
+        Restart(i, loop);
+}
+
+void AnimationPlayer::Stop(const std::string &name)
+{
+    for (State &state : states_)
+        if (state.animation_->name_ == name)
+            state.playing_ = false;
+}
+
+void AnimationPlayer::StopAll()
+{
+    for (State &state : states_)
+        state.playing_ = false;
+}
+
+unsigned AnimationPlayer::GetNumPlaying() const
+{
+    unsigned count = 0;
+    for (const State &state : states_)
+        count += state.playing_ ? 1 : 0;
+    return count;
+}
+
+unsigned AnimationPlayer::GetNumTargets() const
+{
+    unsigned count = 0;
+    for (const State &state : states_)
+        if (state.playing_)
+            count += static_cast<unsigned>(state.targets_.size());
+    return count;
+}
+
+void AnimationPlayer::OnSceneSet(Urho3D::Scene *scene)
+{
+    if (scene)
+        SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(AnimationPlayer, HandleSceneUpdate));
+    else
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+}
+
+void AnimationPlayer::HandleSceneUpdate(Urho3D::StringHash eventType, VariantMap &eventData)
+{
+    using namespace Urho3D::SceneUpdate;
+    if (!IsEnabledEffective())
+        return;
+    const float timeStep = eventData[P_TIMESTEP].GetFloat() * speed_;
+    for (State &state : states_)
+    {
+        if (!state.playing_)
+            continue;
+        const float duration = state.animation_->duration_;
+        state.time_ += timeStep;
+        if (state.time_ >= duration)
+        {
+            if (state.loop_ && duration > 0.0f)
+                state.time_ = std::fmod(state.time_, duration);
+            else
+            {
+                // the last pose is still applied below
+                state.time_ = duration;
+                state.playing_ = false;
+            }
+        }
+
+        for (Target &target : state.targets_)
+        {
+            Node * const node = target.node_;
+            if (!node)
+                continue;
+            const CookedAnimationTrack &track = *target.track_;
+            // one transform change per node, instead of one per channel
+            const Vector3 position = track.position_.numKeys_ ?
+                SampleVectorChannel(track.position_, state.time_, duration, target.cursors_[0]) : node->GetPosition();
+            const Quaternion rotation = track.rotation_.numKeys_ ?
+                SampleRotationChannel(track.rotation_, state.time_, duration, target.cursors_[1]) : node->GetRotation();
+            const Vector3 scale = track.scale_.numKeys_ ?
+                SampleVectorChannel(track.scale_, state.time_, duration, target.cursors_[2]) : node->GetScale();
+            node->SetTransform(position, rotation, scale);
+        }
+    }
+}
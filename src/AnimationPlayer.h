@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Core/Variant.h>
+#include <Urho3D/Scene/Component.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// forward declarations
+namespace Urho3D {
+
+class Node;
+class Scene;
+class StringHash;
+
+} // namespace Urho3D
+
+struct CookedAnimation;
+struct CookedAnimationTrack;
+struct CookedScene;
+
+// plays the compressed animations of a cooked scene on the nodes they were made for:
+// every scene update each playing animation samples its tracks straight from the
+// quantized keys (see AnimationCompression.h) and sets the transforms of the target
+// nodes, which in turn move the bones of the AnimatedModels skinned to them
+class AnimationPlayer : public Urho3D::Component
+{
+    URHO3D_OBJECT(AnimationPlayer, Urho3D::Component);
+public:
+    explicit AnimationPlayer(Urho3D::Context *context);
+    ~AnimationPlayer() override;
+
+    // the tracks' nodes are looked up by name below root, tracks without one are
+    // skipped; the animations point into the scene, so the player keeps it alive
+    void SetAnimations(std::shared_ptr<const CookedScene> scene, Urho3D::Node *root);
+    // (re)starts from the beginning, false if there is no animation of that name
+    bool Play(const std::string &name, bool loop = true);
+    void PlayAll(bool loop = true);
+    void Stop(const std::string &name);
+    void StopAll();
+    void SetSpeed(float speed) {speed_ = speed;}
+
+    unsigned GetNumAnimations() const {return static_cast<unsigned>(states_.size());}
+    unsigned GetNumPlaying() const;
+    unsigned GetNumTargets() const; // nodes moved by the playing animations
+protected:
+    void OnSceneSet(Urho3D::Scene *scene) override;
+    void HandleSceneUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData);
+    void Restart(unsigned index, bool loop);
+
+    struct Target
+    {
+        Urho3D::WeakPtr<Urho3D::Node> node_;
+        const CookedAnimationTrack *track_;
+        unsigned cursors_[3]; // of the position, rotation and scale channels
+    };
+    struct State
+    {
+        const CookedAnimation *animation_;
+        std::vector<Target> targets_;
+        float time_;
+        bool playing_;
+        bool loop_;
+    };
+    std::shared_ptr<const CookedScene> scene_;
+    std::vector<State> states_;
+    float speed_;
+};
@@ -0,0 +1,139 @@
+#include "AsyncSceneLoader.h"
+#include "CookedScene.h"
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Scene/Node.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <chrono>
+
+using Urho3D::Node;
+using Urho3D::Scene;
+using Urho3D::PhysicsWorld;
+using Urho3D::VariantMap;
+using Urho3D::E_UPDATE;
+
+// share of the progress bar given to the background part, which can't report finer steps
+static const float COOK_PROGRESS = 0.1f;
+
+AsyncSceneLoader::AsyncSceneLoader(Urho3D::Context *context) :
+    Urho3D::Object(context),
+    maxNodesPerFrame_(0),
+    maxMillisecondsPerFrame_(4.0f),
+    physicsWasEnabled_(true),
+    loading_(false)
+{
+}
+
+AsyncSceneLoader::~AsyncSceneLoader()
+{
+    // the background thread writes into scene_, so it has to finish first
+    if (cookFuture_.valid())
+        cookFuture_.wait();
+}
+
+void AsyncSceneLoader::Load(const std::string &filename, Urho3D::Node *parentNode, const SceneLoaderOptions &options)
+{
+    if (loading_)
+    {
+        URHO3D_LOGWARNINGF("Ignoring request to load '%s', still loading '%s'", filename.c_str(), filename_.c_str());
+        return;
+    }
+    filename_ = filename;
+    parentNode_ = parentNode;
+    options_ = options;
+    loading_ = true;
+
+    // keep bodies from falling through a half-built level
+    Scene * const scene = parentNode->GetScene();
+    physicsWorld_ = scene ? scene->GetComponent<PhysicsWorld>() : nullptr;
+    if (physicsWorld_)
+    {
+        physicsWasEnabled_ = physicsWorld_->IsUpdateEnabled();
+        physicsWorld_->SetUpdateEnabled(false);
+    }
+
+    scene_ = std::make_shared<CookedScene>();
+    std::shared_ptr<CookedScene> cookedScene = scene_;
+    const std::string cookFilename = filename_;
+    const SceneLoaderOptions cookOptions = options_;
+    cookFuture_ = std::async(std::launch::async, [cookedScene, cookFilename, cookOptions]()
+    {
+        return cookSceneWithAssimp(cookFilename, cookOptions, *cookedScene);
+    });
+
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(AsyncSceneLoader, HandleUpdate));
+}
+
+void AsyncSceneLoader::SetBudget(unsigned maxNodesPerFrame, float maxMillisecondsPerFrame)
+{
+    maxNodesPerFrame_ = maxNodesPerFrame;
+    maxMillisecondsPerFrame_ = maxMillisecondsPerFrame;
+}
+
+float AsyncSceneLoader::GetProgress() const
+{
+    if (!loading_)
+        return 1.0f;
+    if (!instantiator_)
+        return 0.0f;
+    return COOK_PROGRESS + (1.0f - COOK_PROGRESS) * instantiator_->GetProgress();
+}
+
+void AsyncSceneLoader::HandleUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData)
+{
+    if (!parentNode_)
+    {
+        URHO3D_LOGWARNINGF("Target node of '%s' was removed while loading", filename_.c_str());
+        Finish(false);
+        return;
+    }
+
+    if (!instantiator_)
+    {
+        if (cookFuture_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if (progressCallback_)
+                progressCallback_(GetProgress());
+            return;
+        }
+        if (!cookFuture_.get())
+        {
+            Finish(false);
+            return;
+        }
+        instantiator_.reset(new SceneInstantiator(scene_, parentNode_, options_, context_));
+    }
+
+    // a budget of 0 for both would block, so fall back to one node per frame
+    const unsigned maxNodes = (maxNodesPerFrame_ == 0 && maxMillisecondsPerFrame_ <= 0.0f) ? 1 : maxNodesPerFrame_;
+    const bool finished = instantiator_->Step(maxNodes, maxMillisecondsPerFrame_);
+    if (progressCallback_)
+        progressCallback_(GetProgress());
+    if (finished)
+        Finish(true);
+}
+
+void AsyncSceneLoader::Finish(bool success)
+{
+    UnsubscribeFromEvent(E_UPDATE);
+    Node * const parentNode = parentNode_;
+    instantiator_.reset();
+    loadedScene_ = success ? scene_ : nullptr;
+    scene_.reset();
+    loading_ = false;
+    if (physicsWorld_)
+        physicsWorld_->SetUpdateEnabled(physicsWasEnabled_);
+    if (success)
+        URHO3D_LOGINFOF("Scene '%s' is live", filename_.c_str());
+    else
+        URHO3D_LOGERRORF("Failed to load scene '%s'", filename_.c_str());
+
+    using namespace LevelLive;
+    VariantMap &eventData = GetEventDataMap();
+    eventData[P_NODE] = parentNode;
+    eventData[P_SUCCESS] = success;
+    SendEvent(E_LEVELLIVE, eventData);
+}
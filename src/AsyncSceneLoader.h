@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Variant.h>
+
+#include "SceneLoader.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+// forward declarations
+namespace Urho3D {
+
+class Node;
+class PhysicsWorld;
+class StringHash;
+
+} // namespace Urho3D
+
+// sent once an AsyncSceneLoader has created everything and physics runs again
+URHO3D_EVENT(E_LEVELLIVE, LevelLive)
+{
+    URHO3D_PARAM(P_NODE, Node); // Node pointer the scene was loaded into
+    URHO3D_PARAM(P_SUCCESS, Success); // bool
+}
+
+// loads a scene without freezing the window: Assimp parsing and mesh conversion
+// happen on a background thread, then the nodes are created on the main thread
+// a limited amount per frame; physics is paused until the level is complete
+class AsyncSceneLoader : public Urho3D::Object
+{
+    URHO3D_OBJECT(AsyncSceneLoader, Urho3D::Object);
+public:
+    typedef std::function<void(float progress)> ProgressCallback;
+
+    explicit AsyncSceneLoader(Urho3D::Context *context);
+    ~AsyncSceneLoader();
+
+    void Load(const std::string &filename, Urho3D::Node *parentNode, const SceneLoaderOptions &options = SceneLoaderOptions());
+    // per frame limits for the main thread part, 0 for no limit
+    void SetBudget(unsigned maxNodesPerFrame, float maxMillisecondsPerFrame);
+    // called every frame while loading, with progress going from 0.0 to 1.0
+    void SetProgressCallback(const ProgressCallback &callback) {progressCallback_ = callback;}
+    bool IsLoading() const {return loading_;}
+    float GetProgress() const;
+    const std::string & GetFilename() const {return filename_;}
+    // what the last successful load was built from, for SceneHotReloader
+    std::shared_ptr<const CookedScene> GetLoadedScene() const {return loadedScene_;}
+protected:
+    void HandleUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData);
+    void Finish(bool success);
+
+    std::string filename_;
+    Urho3D::WeakPtr<Urho3D::Node> parentNode_;
+    Urho3D::WeakPtr<Urho3D::PhysicsWorld> physicsWorld_;
+    SceneLoaderOptions options_;
+    std::shared_ptr<CookedScene> scene_;
+    std::shared_ptr<const CookedScene> loadedScene_;
+    std::future<bool> cookFuture_;
+    std::unique_ptr<SceneInstantiator> instantiator_;
+    ProgressCallback progressCallback_;
+    unsigned maxNodesPerFrame_;
+    float maxMillisecondsPerFrame_;
+    bool physicsWasEnabled_;
+    bool loading_;
+};
@@ -1,6 +1,6 @@
 #include "Ball.h"
 #include "CreateMaterial.h"
-#include "CreatePrimitives.h"
+#include "PrimitiveCache.h"
 #include "globals.h"
 
 #include <Urho3D/Graphics/Material.h>
@@ -15,8 +15,6 @@ using Urho3D::StaticModel;
 using Urho3D::RigidBody;
 using Urho3D::CollisionShape;
 
-Urho3D::SharedPtr<Urho3D::Model> Ball::sphereModel_;
-
 static const float BALL_DIAMETER = BALL_RADIUS*2.0;
 
 Ball::Ball(Urho3D::Scene *scene, const Urho3D::Vector3 &pos, const Urho3D::Vector3 &vel, const Urho3D::Color &color) :
@@ -26,13 +24,9 @@ Ball::Ball(Urho3D::Scene *scene, const Urho3D::Vector3 &pos, const Urho3D::Vecto
     // node_->SetScale(Vector3(1.0f, 1.0f, 1.0f));
     node_->SetPosition(pos);
 
-    // possibly create and cache the model
-    if (!sphereModel_)
-        sphereModel_ = CreateSphereModel(scene->GetContext()); // TODO support multiple contexts!
-
-    // use the model
+    // the model is shared by all balls
     StaticModel * const sm = node_->CreateComponent<StaticModel>();
-    sm->SetModel(sphereModel_);
+    sm->SetModel(PrimitiveCache::Get(scene->GetContext())->GetSphere(BALL_RADIUS));
     sm->SetMaterial(CreateMaterial(scene->GetContext(), color));
     sm->SetCastShadows(true);
 
@@ -5,7 +5,6 @@
 // Urho3D forward declarations
 namespace Urho3D {
 
-class Model;
 class Node;
 class Scene;
 class Vector3;
@@ -22,5 +21,4 @@ public:
     const Urho3D::Node * GetNode() const {return node_;}
 protected:
     Urho3D::Node *node_;
-    static Urho3D::SharedPtr<Urho3D::Model> sphereModel_;
 };
@@ -0,0 +1,260 @@
+#include "BvhCache.h"
+#include "CacheIO.h"
+#include "CookedScene.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "PhysicsMesh.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Geometry.h>
+#include <Urho3D/Graphics/IndexBuffer.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/CollisionShape.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btOptimizedBvh.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btTriangleInfoMap.h>
+#include <Urho3D/ThirdParty/Bullet/LinearMath/btAlignedAllocator.h>
+
+#include <cstring>
+#include <unordered_set>
+
+using Urho3D::BoundingBox;
+using Urho3D::Context;
+using Urho3D::Geometry;
+using Urho3D::IndexBuffer;
+using Urho3D::Model;
+using Urho3D::SharedPtr;
+using Urho3D::TriangleMeshData;
+using Urho3D::Vector3;
+using Urho3D::VertexBuffer;
+
+// file layout: header, then per mesh its hash, the serialized btOptimizedBvh and the
+// edge info records; the BVHs contain pointers and btScalars, so the header records
+// their sizes and files from other builds are rejected
+static const char BVH_CACHE_MAGIC[4] = {'R', 'B', 'V', 'H'};
+static const uint32_t BVH_CACHE_VERSION = 1; // bump whenever the layout below changes
+// btTriangleInfoMap entry: triangle key, flags and the three edge angles
+static const std::size_t EDGE_INFO_SIZE = 2 * sizeof(int32_t) + 3 * sizeof(btScalar);
+
+uint64_t HashTriangleMesh(const CookedMesh &mesh)
+{
+    uint64_t hash = HashBytes(&mesh.vertexSize_, sizeof(mesh.vertexSize_));
+    hash = HashBytes(mesh.vertexData_, static_cast<std::size_t>(mesh.vertexCount_) * mesh.vertexSize_, hash);
+    return HashBytes(mesh.indexData_, static_cast<std::size_t>(mesh.indexCount_) * (mesh.largeIndices_ ? 4 : 2), hash);
+}
+
+BvhCache::BvhCache()
+{
+}
+
+BvhCache::~BvhCache()
+{
+}
+
+bool BvhCache::Load(const std::string &filename)
+{
+    entries_.clear();
+    file_.reset();
+
+    // deSerializeInPlace() writes the BVH object over its header
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(filename, true))
+        return false;
+
+    CacheReader reader(file->GetData(), file->GetSize());
+    char magic[4];
+    for (char &c : magic)
+        c = reader.Read<char>();
+    const uint32_t version = reader.Read<uint32_t>();
+    const uint32_t scalarSize = reader.Read<uint32_t>();
+    const uint32_t pointerSize = reader.Read<uint32_t>();
+    if (!reader.IsOk() || std::memcmp(magic, BVH_CACHE_MAGIC, sizeof(magic)) != 0)
+    {
+        URHO3D_LOGWARNINGF("Ignoring BVH cache '%s': not a BVH cache file", filename.c_str());
+        return false;
+    }
+    if (version != BVH_CACHE_VERSION || scalarSize != sizeof(btScalar) || pointerSize != sizeof(void*))
+    {
+        URHO3D_LOGINFOF("BVH cache '%s' is from a different build", filename.c_str());
+        return false;
+    }
+
+    const uint32_t count = reader.ReadCount(sizeof(uint64_t) + 2 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count && reader.IsOk(); ++i)
+    {
+        const uint64_t meshHash = reader.Read<uint64_t>();
+        const uint32_t bvhSize = reader.Read<uint32_t>();
+        const unsigned char * const bvhData = reader.ReadBlob(bvhSize);
+        const uint32_t edgeInfoCount = reader.ReadCount(EDGE_INFO_SIZE);
+        const unsigned char * const edgeInfo = reader.ReadBlob(edgeInfoCount * EDGE_INFO_SIZE);
+        if (!reader.IsOk())
+            break;
+        unsigned char * const writableBvhData = file->GetWritableData() + (bvhData - file->GetData());
+        btOptimizedBvh * const bvh = btOptimizedBvh::deSerializeInPlace(writableBvhData, bvhSize, false);
+        if (!bvh)
+        {
+            URHO3D_LOGWARNINGF("Ignoring BVH cache '%s': corrupt BVH", filename.c_str());
+            entries_.clear();
+            return false;
+        }
+        entries_[meshHash] = Entry{bvh, edgeInfo, edgeInfoCount};
+    }
+    if (!reader.IsOk() || !reader.AtEnd())
+    {
+        URHO3D_LOGWARNINGF("Ignoring BVH cache '%s': truncated or corrupt", filename.c_str());
+        entries_.clear();
+        return false;
+    }
+
+    file_ = file;
+    return true;
+}
+
+// the edge info records of a cache entry, for btBvhTriangleMeshShape::setTriangleInfoMap()
+static btTriangleInfoMap * readTriangleInfoMap(const unsigned char *edgeInfo, unsigned edgeInfoCount)
+{
+    btTriangleInfoMap * const infoMap = new btTriangleInfoMap();
+    CacheReader reader(edgeInfo, edgeInfoCount * EDGE_INFO_SIZE);
+    for (unsigned i = 0; i < edgeInfoCount; ++i)
+    {
+        const int32_t key = reader.Read<int32_t>();
+        btTriangleInfo info;
+        info.m_flags = reader.Read<int32_t>();
+        info.m_edgeV0V1Angle = reader.Read<btScalar>();
+        info.m_edgeV1V2Angle = reader.Read<btScalar>();
+        info.m_edgeV2V0Angle = reader.Read<btScalar>();
+        infoMap->insert(btHashInt(key), info);
+    }
+    return infoMap;
+}
+
+bool BvhCache::CreateTriangleMesh(CustomTriangleMeshData &data, uint64_t meshHash, const CookedMesh &mesh, Model *model) const
+{
+    const auto it = entries_.find(meshHash);
+    if (it == entries_.end())
+        return false;
+    const Entry &entry = it->second;
+
+    data.SetTriangles(model, mesh);
+    data.CreateShape(entry.bvh_, readTriangleInfoMap(entry.edgeInfo_, entry.edgeInfoCount_), file_);
+    return true;
+}
+
+bool BvhCache::CreateTriangleMesh(CustomTriangleMeshData &data, uint64_t meshHash, std::shared_ptr<const PhysicsMesh> mesh) const
+{
+    const auto it = entries_.find(meshHash);
+    if (it == entries_.end())
+        return false;
+    const Entry &entry = it->second;
+
+    data.SetTriangles(std::move(mesh));
+    data.CreateShape(entry.bvh_, readTriangleInfoMap(entry.edgeInfo_, entry.edgeInfoCount_), file_);
+    return true;
+}
+
+static bool writeBvh(CacheWriter &writer, uint64_t meshHash, const btOptimizedBvh *bvh)
+{
+    const unsigned bvhSize = bvh->calculateSerializeBufferSize();
+    // serialize() wants the same alignment as the mapping gives deSerializeInPlace()
+    void * const bvhData = btAlignedAlloc(bvhSize, BLOB_ALIGNMENT);
+    const bool ok = bvh->serialize(bvhData, bvhSize, false);
+    writer.Write<uint64_t>(meshHash);
+    writer.Write<uint32_t>(bvhSize);
+    writer.WriteBlob(static_cast<const unsigned char*>(bvhData), bvhSize);
+    btAlignedFree(bvhData);
+    return ok;
+}
+
+bool BvhCache::Save(const std::string &filename, const std::vector<std::pair<uint64_t, TriangleMeshData*>> &meshes, const BvhCache *keep)
+{
+    std::vector<std::pair<uint64_t, const Entry*>> kept;
+    if (keep)
+    {
+        std::unordered_set<uint64_t> saved;
+        for (const std::pair<uint64_t, TriangleMeshData*> &mesh : meshes)
+            saved.insert(mesh.first);
+        for (const auto &entry : keep->entries_)
+            if (!saved.count(entry.first))
+                kept.emplace_back(entry.first, &entry.second);
+    }
+
+    CacheWriter writer;
+    for (const char c : BVH_CACHE_MAGIC)
+        writer.Write(c);
+    writer.Write<uint32_t>(BVH_CACHE_VERSION);
+    writer.Write<uint32_t>(sizeof(btScalar));
+    writer.Write<uint32_t>(sizeof(void*));
+    writer.Write<uint32_t>(static_cast<uint32_t>(meshes.size() + kept.size()));
+
+    for (const std::pair<uint64_t, TriangleMeshData*> &mesh : meshes)
+    {
+#ifdef USING_RBFX
+        btBvhTriangleMeshShape * const shape = mesh.second->shape_.get();
+#else // U3D
+        btBvhTriangleMeshShape * const shape = mesh.second->shape_.Get();
+#endif // USING_RBFX
+        if (!writeBvh(writer, mesh.first, shape->getOptimizedBvh()))
+            return false;
+
+        CacheWriter edgeInfo;
+        const btTriangleInfoMap * const infoMap = shape->getTriangleInfoMap();
+        const int edgeInfoCount = infoMap ? infoMap->size() : 0;
+        for (int i = 0; i < edgeInfoCount; ++i)
+        {
+            const btTriangleInfo * const info = infoMap->getAtIndex(i);
+            edgeInfo.Write<int32_t>(infoMap->getKeyAtIndex(i).getUid1());
+            edgeInfo.Write<int32_t>(info->m_flags);
+            edgeInfo.Write<btScalar>(info->m_edgeV0V1Angle);
+            edgeInfo.Write<btScalar>(info->m_edgeV1V2Angle);
+            edgeInfo.Write<btScalar>(info->m_edgeV2V0Angle);
+        }
+        writer.Write<uint32_t>(static_cast<uint32_t>(edgeInfoCount));
+        writer.WriteBlob(edgeInfo.GetData().data(), edgeInfo.GetData().size());
+    }
+    // the edge info records are still in the file layout
+    for (const std::pair<uint64_t, const Entry*> &entry : kept)
+    {
+        if (!writeBvh(writer, entry.first, entry.second->bvh_))
+            return false;
+        writer.Write<uint32_t>(entry.second->edgeInfoCount_);
+        writer.WriteBlob(entry.second->edgeInfo_, entry.second->edgeInfoCount_ * EDGE_INFO_SIZE);
+    }
+
+    return WriteFileAtomically(filename, writer.GetData());
+}
+
+SharedPtr<Model> BvhCache::CreatePlaceholderModel(Context *context)
+{
+    static const float vertices[9] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f};
+    static const uint16_t indices[3] = {0, 1, 2};
+
+    SharedPtr<Model> model(new Model(context));
+    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
+    SharedPtr<IndexBuffer> ib(new IndexBuffer(context));
+    SharedPtr<Geometry> geom(new Geometry(context));
+
+    // TriangleMeshData reads the shadow data
+    vb->SetShadowed(true);
+    ib->SetShadowed(true);
+    vb->SetSize(3, Urho3D::MASK_POSITION);
+    ib->SetSize(3, false);
+#ifdef USING_RBFX
+    vb->Update(vertices);
+    ib->Update(indices);
+#else // U3D
+    vb->SetData(vertices);
+    ib->SetData(indices);
+#endif // USING_RBFX
+
+    geom->SetVertexBuffer(0, vb);
+    geom->SetIndexBuffer(ib);
+    geom->SetDrawRange(Urho3D::TRIANGLE_LIST, 0, 3);
+
+    model->SetNumGeometries(1);
+    model->SetGeometry(0, 0, geom);
+    model->SetBoundingBox(BoundingBox(Vector3::ZERO, Vector3(1.0f, 0.0f, 1.0f)));
+    return model;
+}
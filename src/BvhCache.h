@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Urho3D forward declarations
+namespace Urho3D {
+
+class Context;
+class Model;
+struct TriangleMeshData;
+
+} // namespace Urho3D
+
+// forward declarations
+class MappedFile;
+class btOptimizedBvh;
+struct CookedMesh;
+struct CustomTriangleMeshData;
+struct PhysicsMesh;
+
+// appended to the source filename to get the triangle mesh BVH cache filename
+static const char * const BVH_CACHE_EXTENSION = ".bvh";
+
+// the cache entries are only valid for the exact vertex and index data they were built from
+uint64_t HashTriangleMesh(const CookedMesh &mesh);
+
+// Bullet's quantized BVHs and internal edge info of the triangle-mesh colliders, so they
+// aren't rebuilt on every launch; the file is mapped copy-on-write and the BVH nodes are
+// used right where they are (btOptimizedBvh::deSerializeInPlace()), so only the pages
+// of the BVH headers get copied
+class BvhCache
+{
+public:
+    BvhCache();
+    ~BvhCache();
+
+    // files written by a different cache version or Bullet build are ignored
+    bool Load(const std::string &filename);
+    unsigned GetNumEntries() const {return static_cast<unsigned>(entries_.size());}
+    // fills in data for a Model loaded from mesh, false if there is no BVH for meshHash;
+    // several threads may fill in different data at once, as long as model is only
+    // used by the calling one (data has to be constructed on the main thread, see
+    // CustomTriangleMeshData)
+    bool CreateTriangleMesh(CustomTriangleMeshData &data, uint64_t meshHash, const CookedMesh &mesh, Urho3D::Model *model) const;
+    // same for a physics mesh, whose key comes from HashPhysicsMesh()
+    bool CreateTriangleMesh(CustomTriangleMeshData &data, uint64_t meshHash, std::shared_ptr<const PhysicsMesh> mesh) const;
+
+    // writes the BVHs of meshes, plus the entries of keep that aren't among them, for a
+    // cache shared by several parts of a level (see PartitionStreamingCells()), which
+    // then only drops stale entries when the whole level is saved
+    static bool Save(const std::string &filename, const std::vector<std::pair<uint64_t, Urho3D::TriangleMeshData*>> &meshes, const BvhCache *keep = nullptr);
+    // TriangleMeshData can only be constructed by building a BVH, so the cached ones
+    // start out from this one triangle model and then swap in the real mesh (see
+    // CustomTriangleMeshData)
+    static Urho3D::SharedPtr<Urho3D::Model> CreatePlaceholderModel(Urho3D::Context *context);
+protected:
+    struct Entry
+    {
+        btOptimizedBvh *bvh_; // inside the mapping
+        const unsigned char *edgeInfo_;
+        unsigned edgeInfoCount_;
+    };
+    std::shared_ptr<MappedFile> file_;
+    std::unordered_map<uint64_t, Entry> entries_;
+};
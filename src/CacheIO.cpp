@@ -0,0 +1,28 @@
+#include "CacheIO.h"
+
+#include <cstdio> // for std::rename(), std::remove()
+#include <fstream>
+
+bool WriteFileAtomically(const std::string &filename, const std::vector<unsigned char> &data)
+{
+    const std::string tempFilename = filename + ".tmp";
+    {
+        std::ofstream out(tempFilename, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!out)
+        {
+            out.close();
+            std::remove(tempFilename.c_str());
+            return false;
+        }
+    }
+    std::remove(filename.c_str()); // std::rename() won't replace an existing file on Windows
+    if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+    return true;
+}
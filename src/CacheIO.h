@@ -0,0 +1,146 @@
+#pragma once
+
+#include <Urho3D/Math/Matrix3x4.h>
+#include <Urho3D/Math/Quaternion.h>
+#include <Urho3D/Math/Vector3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// helpers for the binary cache files written next to the source assets; blobs are
+// aligned relative to the start of the file, which a memory mapping keeps aligned
+
+static const std::size_t BLOB_ALIGNMENT = 16;
+
+class CacheWriter
+{
+public:
+    template <typename T>
+    void Write(const T &value)
+    {
+        const unsigned char * const bytes = reinterpret_cast<const unsigned char*>(&value);
+        data_.insert(data_.end(), bytes, bytes + sizeof(T));
+    }
+    void WriteString(const std::string &str)
+    {
+        Write<uint32_t>(static_cast<uint32_t>(str.size()));
+        data_.insert(data_.end(), str.begin(), str.end());
+    }
+    void WriteVector3(const Urho3D::Vector3 &v)
+    {
+        Write(v.x_);
+        Write(v.y_);
+        Write(v.z_);
+    }
+    void WriteQuaternion(const Urho3D::Quaternion &q)
+    {
+        Write(q.w_);
+        Write(q.x_);
+        Write(q.y_);
+        Write(q.z_);
+    }
+    void WriteMatrix3x4(const Urho3D::Matrix3x4 &m)
+    {
+        const float * const values = &m.m00_;
+        for (unsigned i = 0; i < 12; ++i)
+            Write(values[i]);
+    }
+    void WriteBlob(const unsigned char *blob, std::size_t size)
+    {
+        data_.resize((data_.size() + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1), 0);
+        data_.insert(data_.end(), blob, blob + size);
+    }
+    const std::vector<unsigned char> & GetData() const {return data_;}
+protected:
+    std::vector<unsigned char> data_;
+};
+
+class CacheReader
+{
+public:
+    CacheReader(const unsigned char *data, std::size_t size) :
+        data_(data),
+        size_(size),
+        pos_(0),
+        ok_(true)
+    {
+    }
+    template <typename T>
+    T Read()
+    {
+        T value{};
+        if (!Check(sizeof(T)))
+            return value;
+        std::memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+    std::string ReadString()
+    {
+        const uint32_t length = Read<uint32_t>();
+        if (!Check(length))
+            return std::string();
+        std::string str(reinterpret_cast<const char*>(data_ + pos_), length);
+        pos_ += length;
+        return str;
+    }
+    Urho3D::Vector3 ReadVector3()
+    {
+        const float x = Read<float>();
+        const float y = Read<float>();
+        const float z = Read<float>();
+        return Urho3D::Vector3(x, y, z);
+    }
+    Urho3D::Quaternion ReadQuaternion()
+    {
+        const float w = Read<float>();
+        const float x = Read<float>();
+        const float y = Read<float>();
+        const float z = Read<float>();
+        return Urho3D::Quaternion(w, x, y, z);
+    }
+    Urho3D::Matrix3x4 ReadMatrix3x4()
+    {
+        Urho3D::Matrix3x4 m;
+        float * const values = &m.m00_;
+        for (unsigned i = 0; i < 12; ++i)
+            values[i] = Read<float>();
+        return m;
+    }
+    const unsigned char * ReadBlob(std::size_t size)
+    {
+        pos_ = (pos_ + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+        if (!Check(size))
+            return nullptr;
+        const unsigned char * const blob = data_ + pos_;
+        pos_ += size;
+        return blob;
+    }
+    // element count of a following array, rejected if the array can't fit in the rest of the data
+    uint32_t ReadCount(std::size_t minElementSize)
+    {
+        const uint32_t count = Read<uint32_t>();
+        if (ok_ && static_cast<uint64_t>(count) * minElementSize > size_ - pos_)
+            ok_ = false;
+        return ok_ ? count : 0;
+    }
+    bool IsOk() const {return ok_;}
+    bool AtEnd() const {return pos_ == size_;}
+protected:
+    bool Check(std::size_t size)
+    {
+        if (!ok_ || pos_ > size_ || size > size_ - pos_)
+            ok_ = false;
+        return ok_;
+    }
+    const unsigned char *data_;
+    std::size_t size_;
+    std::size_t pos_;
+    bool ok_;
+};
+
+// writes to a temporary file first and renames it, so a crash never leaves a half-written file behind
+bool WriteFileAtomically(const std::string &filename, const std::vector<unsigned char> &data);
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <Urho3D/Graphics/GraphicsDefs.h>
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Math/Color.h>
+#include <Urho3D/Math/Matrix3x4.h>
+#include <Urho3D/Math/Quaternion.h>
+#include <Urho3D/Math/Vector3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// forward declaration
+class MappedFile;
+
+// options that change the cooked output, part of the scene cache key
+struct CookSettings
+{
+    bool nativeGltf_ = false; // glTF files were read without Assimp, see SceneLoaderOptions
+    bool importTextures_ = false; // see SceneLoaderOptions
+    unsigned maxHullVertices_ = 0; // 0 keeps the full render geometry for convex hull colliders
+    bool shrinkHulls_ = false;
+    unsigned lodLevels_ = 0; // simplified levels below the full mesh, glTF extras can override this per node
+    float lodReduction_ = 0.5f; // triangle count of each level relative to the previous one
+    float lodDistance_ = 0.0f; // of the first simplified level, doubling for each further one
+    float animationTolerance_ = 0.001f; // see SceneLoaderOptions
+    bool flattenStaticNodes_ = false; // see SceneLoaderOptions
+};
+
+// everything the scene loader needs to build nodes, with no reference back to
+// Assimp, so it can be written to and read back from the binary scene cache
+
+struct CookedMesh
+{
+    unsigned vertexMask_ = 0; // Urho3D vertex element mask, only the attributes the source mesh has
+    unsigned vertexSize_ = 0; // in bytes
+    unsigned vertexCount_ = 0;
+    unsigned indexCount_ = 0;
+    bool largeIndices_ = false; // 32-bit indices, only used for meshes with 65536+ vertices
+    unsigned materialIndex_ = NO_MATERIAL;
+    Urho3D::BoundingBox boundingBox_;
+    // owned by the CookedScene, either heap storage or the memory-mapped cache file
+    const unsigned char *vertexData_ = nullptr;
+    const unsigned char *indexData_ = nullptr;
+    // reduced convex hull as xyz floats, only cooked for meshes of dynamic bodies
+    // with a hull vertex budget; owned like the vertex data
+    unsigned hullVertexCount_ = 0;
+    const float *hullVertexData_ = nullptr;
+    // simplified index buffers into the same vertex data, drawn from distance_ on
+    struct Lod
+    {
+        float distance_ = 0.0f;
+        unsigned indexCount_ = 0;
+        const unsigned char *indexData_ = nullptr; // same index size as the full mesh
+    };
+    std::vector<Lod> lods_;
+    // skinned meshes have 4 blend weights and indices into bones_ per vertex (after the
+    // tangent), and are drawn by an AnimatedModel moved by the bones' nodes
+    struct Bone
+    {
+        std::string name_; // of the node driving the bone
+        unsigned parent_ = 0; // index of the nearest ancestor that is a bone too, its own for roots
+        Urho3D::Matrix3x4 offsetMatrix_ = Urho3D::Matrix3x4::IDENTITY; // mesh space to bone space
+        Urho3D::BoundingBox boundingBox_; // in bone space, of the vertices the bone mostly moves
+    };
+    std::vector<Bone> bones_; // empty for static meshes
+
+    static const unsigned NO_MATERIAL = 0xffffffff;
+    // one skinning palette per draw call, meshes with more bones are left static
+    static const unsigned MAX_BONES = 64;
+};
+
+struct CookedMaterial
+{
+    // glTF alphaMode, only used by textured materials
+    enum AlphaMode
+    {
+        ALPHA_OPAQUE,
+        ALPHA_MASK,
+        ALPHA_BLEND
+    };
+    Urho3D::Color diffuseColor_ = Urho3D::Color::WHITE;
+    unsigned diffuseTexture_ = NO_TEXTURE; // index into CookedScene::textures_, the base color texture
+    unsigned normalTexture_ = NO_TEXTURE; // same, the tangent space normal map, linear data
+    AlphaMode alphaMode_ = ALPHA_OPAQUE;
+
+    static const unsigned NO_TEXTURE = 0xffffffff;
+};
+
+// an embedded image, block-compressed with its full mip chain (see TextureCompression.h)
+struct CookedTexture
+{
+    unsigned format_ = 0; // TextureBlockFormat
+    unsigned width_ = 0;
+    unsigned height_ = 0;
+    uint64_t hash_ = 0; // of the source image, the key of the texture cache
+    struct Level
+    {
+        unsigned width_ = 0;
+        unsigned height_ = 0;
+        std::size_t size_ = 0;
+        const unsigned char *data_ = nullptr; // owned like the vertex data
+    };
+    std::vector<Level> levels_; // largest first, down to 1x1
+};
+
+// primitive collision shape from KHR_physics_rigid_bodies + KHR_implicit_shapes
+struct CookedCollider
+{
+    enum Shape
+    {
+        SHAPE_BOX,
+        SHAPE_SPHERE,
+        SHAPE_CAPSULE,
+        SHAPE_CYLINDER
+    };
+    Shape shape_ = SHAPE_BOX;
+    // as passed to CollisionShape: box extents, sphere diameter in x, or (diameter, total height) for capsules and cylinders
+    Urho3D::Vector3 size_ = Urho3D::Vector3::ONE;
+    // offset from the node owning the rigid body, non-zero for compound parts on descendant nodes
+    Urho3D::Vector3 position_ = Urho3D::Vector3::ZERO;
+    Urho3D::Quaternion rotation_ = Urho3D::Quaternion::IDENTITY;
+};
+
+// one copy of a node's meshes from EXT_mesh_gpu_instancing, relative to the node
+struct CookedInstance
+{
+    Urho3D::Vector3 position_ = Urho3D::Vector3::ZERO;
+    Urho3D::Quaternion rotation_ = Urho3D::Quaternion::IDENTITY;
+    Urho3D::Vector3 scale_ = Urho3D::Vector3::ONE;
+};
+
+struct CookedNode
+{
+    std::string name_;
+    int parent_ = -1; // index into CookedScene::nodes_, -1 for the root
+    Urho3D::Vector3 position_ = Urho3D::Vector3::ZERO;
+    Urho3D::Quaternion rotation_ = Urho3D::Quaternion::IDENTITY;
+    Urho3D::Vector3 scale_ = Urho3D::Vector3::ONE;
+    float mass_ = 0.0f; // KHR_physics_rigid_bodies motion.mass, 0.0 means a static body
+    std::string gameObjectType_; // "GameObjectType" extra, empty if none
+    std::string streamingCell_; // "StreamingCell" extra, empty if none (see PartitionStreamingCells())
+    std::vector<unsigned> meshes_; // indices into CookedScene::meshes_
+    // primitive colliders replace the mesh colliders, including those of descendants merged into this body
+    std::vector<CookedCollider> colliders_;
+    bool partOfParentBody_ = false; // collider was merged into an ancestor's rigid body, so no body of its own
+    // when set, the meshes are drawn (and collide) once per instance instead of at the node itself
+    std::vector<CookedInstance> instances_;
+    bool animated_ = false; // an animation track moves the node, so it and its descendants are never static
+};
+
+// one animated property of a node, keyframe-reduced and quantized (see AnimationCompression.h)
+struct CookedAnimationChannel
+{
+    unsigned numKeys_ = 0; // 0 when the property isn't animated
+    // translations and scales: the per-component range the 16-bit values are mapped onto
+    Urho3D::Vector3 min_ = Urho3D::Vector3::ZERO;
+    Urho3D::Vector3 range_ = Urho3D::Vector3::ZERO;
+    // 4 values per key: the time as a fraction of the animation's duration, then the
+    // three value components; owned like the vertex data
+    const uint16_t *keys_ = nullptr;
+};
+
+struct CookedAnimationTrack
+{
+    std::string nodeName_;
+    CookedAnimationChannel position_;
+    CookedAnimationChannel rotation_;
+    CookedAnimationChannel scale_;
+};
+
+struct CookedAnimation
+{
+    std::string name_;
+    float duration_ = 0.0f; // in seconds
+    std::vector<CookedAnimationTrack> tracks_;
+};
+
+struct CookedLight
+{
+    std::string name_;
+    Urho3D::LightType type_ = Urho3D::LIGHT_POINT;
+    Urho3D::Vector3 position_ = Urho3D::Vector3::ZERO;
+    float fov_ = 0.0f; // in degrees, spot lights only
+    float attenuationConstant_ = 0.0f;
+    float attenuationLinear_ = 0.0f;
+    float attenuationQuadratic_ = 0.0f;
+    float range_ = 50.0f; // KHR_lights_punctual "range", or where the attenuated intensity becomes negligible
+};
+
+struct CookedScene
+{
+    typedef std::vector<std::unique_ptr<unsigned char[]>> Storage;
+
+    // returns memory that stays valid (and in place) for as long as the storage, use
+    // a separate Storage per thread when cooking in parallel and adopt it afterwards
+    static unsigned char * Allocate(Storage &storage, std::size_t size)
+    {
+        storage.emplace_back(new unsigned char[size]);
+        return storage.back().get();
+    }
+    unsigned char * Allocate(std::size_t size) {return Allocate(storage_, size);}
+    void AdoptStorage(Storage &storage)
+    {
+        for (std::unique_ptr<unsigned char[]> &block : storage)
+            storage_.push_back(std::move(block));
+        storage.clear();
+    }
+
+    std::vector<CookedMesh> meshes_;
+    std::vector<CookedMaterial> materials_;
+    std::vector<CookedTexture> textures_;
+    std::vector<CookedNode> nodes_; // depth-first order, parents always precede their children
+    int staticRoot_ = -1; // the node the static nodes were flattened under (see FlattenStaticNodes()), -1 if none
+    std::vector<CookedLight> lights_;
+    std::vector<CookedAnimation> animations_;
+    std::string sourceFilename_; // for the caches next to it, not stored in the scene cache
+
+    Storage storage_;
+    std::shared_ptr<MappedFile> mappedFile_; // set when loaded from the scene cache
+    std::shared_ptr<const CookedScene> source_; // keeps the mesh data alive for scenes that point into another one
+    std::vector<unsigned> sourceMeshes_; // the index in source_ of each mesh, see SharedSceneModels
+};
@@ -8,7 +8,13 @@ namespace Urho3D {
 class Context;
 class Material;
 class Color;
+class Texture;
 
 } // namespace Urho3D
 
+// returns a shared Material from the MaterialCache, so it must not be modified
 Urho3D::SharedPtr<Urho3D::Material> CreateMaterial(Urho3D::Context *context, const Urho3D::Color &color);
+// same with a diffuse texture and optionally a normal map, drawn with the named textured
+// technique, which has to be a DiffNormal one when there is a normal map
+Urho3D::SharedPtr<Urho3D::Material> CreateMaterial(Urho3D::Context *context, const Urho3D::Color &color, Urho3D::Texture *texture,
+    Urho3D::Texture *normalTexture = nullptr, const char *technique = "Techniques/Diff.xml");
@@ -1,18 +1,18 @@
 #include "CreatePrimitives.h"
-#include "VectorShim.h"
+#include "MeshOptimize.h"
 
 #include <Urho3D/Graphics/Geometry.h>
 #include <Urho3D/Graphics/IndexBuffer.h>
 #include <Urho3D/Graphics/Model.h>
 #include <Urho3D/Graphics/VertexBuffer.h>
-#include <Urho3D/Math/Sphere.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/BoundingBox.h>
 #include <Urho3D/Math/MathDefs.h>
 
+#include <algorithm> // for std::max()
 #include <cstdint>
-
-#ifdef M_PI
-#undef M_PI
-#endif
+#include <cstring>
+#include <vector>
 
 using Urho3D::BoundingBox;
 using Urho3D::Context;
@@ -22,401 +22,341 @@ using Urho3D::IndexBuffer;
 using Urho3D::MASK_NORMAL;
 using Urho3D::MASK_POSITION;
 using Urho3D::Model;
-using Urho3D::M_PI;
 using Urho3D::SharedPtr;
 using Urho3D::Sin;
-using Urho3D::Sphere;
 using Urho3D::TRIANGLE_LIST;
 using Urho3D::Vector3;
 using Urho3D::VertexBuffer;
 
-Urho3D::SharedPtr<Model> CreateSphereModel(Urho3D::Context *context, float radius, int stacks, int slices)
-{
-    SharedPtr<Model> model(new Model(context));
-    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
-    SharedPtr<IndexBuffer> ib(new IndexBuffer(context));
-    SharedPtr<Geometry> geom(new Geometry(context));
+static const unsigned FLOATS_PER_VERTEX = 6; // position and normal
 
-    // Enable CPU-side data for physics
-    vb->SetShadowed(true);
-    ib->SetShadowed(true);
+namespace {
 
-    // Calculate vertices, normals, and texture coordinates
-    ea::vector<Vector3> vertices;
-    ea::vector<Vector3> normals;
-    // PODVector<Vector2> texCoords;
-    for (int stack = 0; stack <= stacks; ++stack)
+// sines and cosines of segments + 1 evenly spaced angles from 0 to sweep degrees,
+// computed once per shape instead of once per vertex; a full circle ends exactly
+// where it started, so there is no crack along the seam
+struct AngleTable
+{
+    AngleTable(int segments, float sweep) :
+        cos_(segments + 1),
+        sin_(segments + 1)
     {
-        const float phi = static_cast<float>(stack) * 180.0f / stacks;
-        const float sinPhi = Sin(phi);
-        const float cosPhi = Cos(phi);
-        // const float v = static_cast<float>(stack) / stacks; // Texture V coordinate
-
-        for (int slice = 0; slice <= slices; ++slice)
+        for (int i = 0; i <= segments; ++i)
         {
-            const float theta = static_cast<float>(slice) * 360.0f / slices;
-            // const float u = static_cast<float>(slice) / slices; // Texture U coordinate
-            Vector3 vertex = Vector3(sinPhi * Cos(theta), cosPhi, sinPhi * Sin(theta)) * radius;
-            vertices.push_back(vertex);
-            normals.push_back(vertex.Normalized());
-            // texCoords.push_back(Vector2(u, 1.0f - v)); // Flip V for correct orientation
+            const float angle = sweep * i / segments;
+            cos_[i] = Cos(angle);
+            sin_[i] = Sin(angle);
         }
-    }
-
-    // Vertex buffer (position, normal, texcoord)
-    unsigned vertexCount = vertices.size();
-    vb->SetSize(vertexCount, MASK_POSITION | MASK_NORMAL, false); // Static buffer
-    ea::vector<float> vertexData;
-    for (unsigned i = 0; i < vertexCount; ++i)
-    {
-        vertexData.push_back(vertices[i].x_);
-        vertexData.push_back(vertices[i].y_);
-        vertexData.push_back(vertices[i].z_);
-        vertexData.push_back(normals[i].x_);
-        vertexData.push_back(normals[i].y_);
-        vertexData.push_back(normals[i].z_);
-        //vertexData.push_back(texCoords[i].x_);
-        //vertexData.push_back(texCoords[i].y_);
-    }
-#ifdef USING_RBFX
-    vb->Update(vertexData.data());
-#else // USING_RBFX
-    vb->SetData(vertexData.data());
-#endif // USING_RBFX
-
-    // Index buffer (counterclockwise winding)
-    ea::vector<uint16_t> indices;
-    for (uint16_t stack = 0; stack < stacks; ++stack)
-    {
-        const uint16_t topRow = stack * (slices + 1);
-        const uint16_t bottomRow = (stack + 1) * (slices + 1);
-
-        for (uint16_t slice = 0; slice < slices; ++slice)
+        if (sweep == 360.0f)
         {
-            // First triangle (counterclockwise)
-            indices.push_back(topRow + slice);
-            indices.push_back(topRow + slice + 1);
-            indices.push_back(bottomRow + slice);
-
-            // Second triangle (counterclockwise)
-            indices.push_back(topRow + slice + 1);
-            indices.push_back(bottomRow + slice + 1);
-            indices.push_back(bottomRow + slice);
+            cos_[segments] = cos_[0];
+            sin_[segments] = sin_[0];
         }
     }
 
-    const unsigned indexCount = indices.size();
-    ib->SetSize(indexCount, false, false); // 16-bit indices, static
-#ifdef USING_RBFX
-    ib->Update(indices.data());
-#else // USING_RBFX
-    ib->SetData(indices.data());
-#endif // USING_RBFX
-
-    geom->SetVertexBuffer(0, vb);
-    geom->SetIndexBuffer(ib);
-    geom->SetDrawRange(TRIANGLE_LIST, 0, indexCount);
-
-    model->SetNumGeometries(1);
-    model->SetGeometry(0, 0, geom);
-
-    // Set bounding box
-    BoundingBox bb;
-    bb.Define(Sphere(Vector3::ZERO, radius));
-    model->SetBoundingBox(bb);
-
-    return model;
-}
+    std::vector<float> cos_;
+    std::vector<float> sin_;
+};
 
-Urho3D::SharedPtr<Urho3D::Model> CreateCapsuleModel(Urho3D::Context *context, float radius, float height, int rings, int segments)
+// writes the vertices straight into the locked vertex buffer, the indices into memory
+// reserved up front, which is reordered for the vertex cache before it is uploaded
+class PrimitiveWriter
 {
-    SharedPtr<Model> model(new Model(context));
-    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
-    SharedPtr<IndexBuffer> ib(new IndexBuffer(context));
-    SharedPtr<Geometry> geom(new Geometry(context));
-
-    // Enable CPU-side data for physics
-    vb->SetShadowed(true);
-    ib->SetShadowed(true);
-
-    // Calculate vertices and normals
-    ea::vector<Vector3> vertices;
-    ea::vector<Vector3> normals;
-    const float halfHeight = height * 0.5f;
-
-    // Bottom hemisphere
-    for (int ring = 0; ring <= rings; ++ring)
+public:
+    PrimitiveWriter(float *vertices, std::vector<unsigned> &indices) :
+        vertices_(vertices),
+        indices_(indices),
+        numVertices_(0)
     {
-        const float theta = 90.0f * (float(ring) / rings);
-        const float y = -radius * Cos(theta) - halfHeight;
-        const float r = radius * Sin(theta);
-
-        for (int seg = 0; seg <= segments; ++seg)
-        {
-            const float phi = 360.0f * float(seg) / segments;
-            const float x = r * Cos(phi);
-            const float z = r * Sin(phi);
-            Vector3 pos(x, y, z);
-            vertices.push_back(pos);
-            normals.push_back(Vector3(x, y + halfHeight, z).Normalized());
-        }
     }
 
-    // Cylinder
-    for (int i = 0; i <= 1; ++i)
+    unsigned AddVertex(const Vector3 &position, const Vector3 &normal)
     {
-        const float y = (i == 0 ? -halfHeight : halfHeight);
-        for (int seg = 0; seg <= segments; ++seg)
-        {
-            const float phi = 360.0f * float(seg) / segments;
-            const float x = radius * Cos(phi);
-            const float z = radius * Sin(phi);
-            Vector3 pos(x, y, z);
-            vertices.push_back(pos);
-            normals.push_back(Vector3(x, 0.0f, z).Normalized());
-        }
+        float * const vertex = vertices_ + numVertices_ * FLOATS_PER_VERTEX;
+        vertex[0] = position.x_;
+        vertex[1] = position.y_;
+        vertex[2] = position.z_;
+        vertex[3] = normal.x_;
+        vertex[4] = normal.y_;
+        vertex[5] = normal.z_;
+        return numVertices_++;
     }
-
-    // Top hemisphere
-    for (int ring = 0; ring <= rings; ++ring)
+    // front faces have (b - a) x (c - a) pointing out, as Urho3D's are clockwise
+    void AddTriangle(unsigned a, unsigned b, unsigned c)
     {
-        const float theta = 90.0f * (float(ring) / rings);
-        const float y = radius * Cos(theta) + halfHeight;
-        const float r = radius * Sin(theta);
-
-        for (int seg = 0; seg <= segments; ++seg)
-        {
-            const float phi = 360.0f * float(seg) / segments;
-            const float x = r * Cos(phi);
-            const float z = r * Sin(phi);
-            Vector3 pos(x, y, z);
-            vertices.push_back(pos);
-            normals.push_back(Vector3(x, y - halfHeight, z).Normalized());
-        }
+        indices_.push_back(a);
+        indices_.push_back(b);
+        indices_.push_back(c);
     }
-
-    // Vertex buffer (position, normal)
-    unsigned vertexCount = vertices.size();
-    vb->SetSize(vertexCount, MASK_POSITION | MASK_NORMAL, false); // Static buffer
-    ea::vector<float> vertexData;
-    for (unsigned i = 0; i < vertexCount; ++i)
+    // a b c and b d c, so a to b and a to c are the edges the winding goes by
+    void AddQuad(unsigned a, unsigned b, unsigned c, unsigned d)
     {
-        vertexData.push_back(vertices[i].x_);
-        vertexData.push_back(vertices[i].y_);
-        vertexData.push_back(vertices[i].z_);
-        vertexData.push_back(normals[i].x_);
-        vertexData.push_back(normals[i].y_);
-        vertexData.push_back(normals[i].z_);
+        AddTriangle(a, b, c);
+        AddTriangle(b, d, c);
     }
-#ifdef USING_RBFX
-    vb->Update(vertexData.data());
-#else // USING_RBFX
-    vb->SetData(vertexData.data());
-#endif // USING_RBFX
-
-    // Index buffer
-    ea::vector<uint16_t> indices;
-    const unsigned ringVerts = segments + 1;
-
-    // Bottom hemisphere indices
-    for (uint16_t ring = 0; ring < rings; ++ring)
+    // the quads between rows + 1 rows of columns + 1 vertices each, starting at first,
+    // with the angle of the columns growing around the Y axis and the rows going down
+    void AddGrid(unsigned first, int rows, int columns)
     {
-        for (uint16_t seg = 0; seg < segments; ++seg)
+        const unsigned rowVertices = columns + 1;
+        for (int row = 0; row < rows; ++row)
         {
-            const uint16_t i0 = ring * ringVerts + seg;
-            const uint16_t i1 = (ring + 1) * ringVerts + seg;
-            const uint16_t i2 = i0 + 1;
-            const uint16_t i3 = i1 + 1;
-
-            // Counterclockwise triangles
-            indices.push_back(i0);
-            indices.push_back(i1);
-            indices.push_back(i2);
-            indices.push_back(i2);
-            indices.push_back(i1);
-            indices.push_back(i3);
+            for (int column = 0; column < columns; ++column)
+            {
+                const unsigned a = first + row * rowVertices + column;
+                AddQuad(a, a + 1, a + rowVertices, a + rowVertices + 1);
+            }
         }
     }
-
-    // Cylinder indices
-    uint16_t base = (rings + 1) * ringVerts;
-    for (uint16_t seg = 0; seg < segments; ++seg)
+    unsigned GetNumVertices() const {return numVertices_;}
+protected:
+    float *vertices_;
+    std::vector<unsigned> &indices_;
+    unsigned numVertices_;
+};
+
+} // namespace
+
+// fills a new model through write(), which has to add exactly numVertices and numIndices
+template <class Write>
+static SharedPtr<Model> createPrimitiveModel(Context *context, const char *name, unsigned numVertices, unsigned numIndices, const BoundingBox &boundingBox, Write write)
+{
+    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
+    vb->SetSize(numVertices, MASK_POSITION | MASK_NORMAL, false); // static buffer
+    float * const vertexData = static_cast<float*>(vb->Lock(0, numVertices, true));
+    if (!vertexData)
     {
-        const uint16_t i0 = base + seg;
-        const uint16_t i1 = base + ringVerts + seg;
-        const uint16_t i2 = i0 + 1;
-        const uint16_t i3 = i1 + 1;
-
-        // Counterclockwise triangles
-        indices.push_back(i0);
-        indices.push_back(i1);
-        indices.push_back(i2);
-        indices.push_back(i2);
-        indices.push_back(i1);
-        indices.push_back(i3);
+        URHO3D_LOGERRORF("Failed to lock the vertex buffer of a %s mesh", name);
+        return SharedPtr<Model>();
     }
-
-    // Top hemisphere indices
-    base += 2 * ringVerts;
-    for (uint16_t ring = 0; ring < rings; ++ring)
+    std::vector<unsigned> indices;
+    indices.reserve(numIndices);
+    PrimitiveWriter writer(vertexData, indices);
+    write(writer);
+    vb->Unlock();
+
+    // same triangle order as the imported meshes get (see MeshOptimize.h); the vertices
+    // are written row by row in the order the triangles use them, which suits the vertex
+    // fetch already, and convex shapes have no overdraw to sort against
+    indices = OptimizeVertexCache(indices, numVertices);
+
+    // 16-bit indices address up to 65536 vertices, a finely tessellated shape needs more
+    const bool largeIndices = numVertices > 0x10000;
+    SharedPtr<IndexBuffer> ib(new IndexBuffer(context));
+    ib->SetSize(numIndices, largeIndices, false); // static buffer
+    void * const indexData = ib->Lock(0, numIndices, true);
+    if (!indexData)
     {
-        for (uint16_t seg = 0; seg < segments; ++seg)
-        {
-            const uint16_t i0 = base + ring * ringVerts + seg;
-            const uint16_t i1 = base + (ring + 1) * ringVerts + seg;
-            const uint16_t i2 = i0 + 1;
-            const uint16_t i3 = i1 + 1;
-
-            // Counterclockwise triangles (flipped for correct orientation)
-            indices.push_back(i0);
-            indices.push_back(i2);
-            indices.push_back(i1);
-            indices.push_back(i2);
-            indices.push_back(i3);
-            indices.push_back(i1);
-        }
+        URHO3D_LOGERRORF("Failed to lock the index buffer of a %s mesh", name);
+        return SharedPtr<Model>();
     }
+    if (largeIndices)
+        std::memcpy(indexData, indices.data(), numIndices * sizeof(uint32_t));
+    else
+    {
+        uint16_t * const shortIndices = static_cast<uint16_t*>(indexData);
+        for (unsigned i = 0; i < numIndices; ++i)
+            shortIndices[i] = static_cast<uint16_t>(indices[i]);
+    }
+    ib->Unlock();
 
-    const unsigned indexCount = indices.size();
-    ib->SetSize(indexCount, false, false); // 16-bit indices, static
-#ifdef USING_RBFX
-    ib->Update(indices.data());
-#else // USING_RBFX
-    ib->SetData(indices.data());
-#endif // USING_RBFX
-
+    SharedPtr<Geometry> geom(new Geometry(context));
     geom->SetVertexBuffer(0, vb);
     geom->SetIndexBuffer(ib);
-    geom->SetDrawRange(TRIANGLE_LIST, 0, indexCount);
+    geom->SetDrawRange(TRIANGLE_LIST, 0, numIndices);
 
+    SharedPtr<Model> model(new Model(context));
     model->SetNumGeometries(1);
     model->SetGeometry(0, 0, geom);
-
-    // Set bounding box
-    BoundingBox bb;
-    bb.Define(Vector3(-radius, -halfHeight - radius, -radius), Vector3(radius, halfHeight + radius, radius));
-    model->SetBoundingBox(bb);
-
+    model->SetBoundingBox(boundingBox);
+    URHO3D_LOGDEBUGF("%s mesh: %u vertices, %u triangles, %u-bit indices", name, numVertices, numIndices / 3, largeIndices ? 32 : 16);
     return model;
 }
 
-/*{
-    using namespace Ogre;
-    ManualObject* capsule = sceneMgr->createManualObject(name);
-    capsule->begin("BaseWhiteNoLighting", RenderOperation::OT_TRIANGLE_LIST);
-
-    const float PI = 3.14159265358979323846f;
-    float halfHeight = height * 0.5f;
-
-    // ---------- VERTEX PHASE ----------
-    std::vector<Vector3> positions;
-    std::vector<Vector3> normals;
-
-    // Bottom hemisphere
-    for (int ring = 0; ring <= rings; ++ring)
+Urho3D::SharedPtr<Model> CreateSphereModel(Urho3D::Context *context, float radius, int stacks, int slices)
+{
+    stacks = std::max(stacks, 2);
+    slices = std::max(slices, 3);
+    const unsigned numVertices = (stacks + 1) * (slices + 1);
+    const unsigned numIndices = stacks * slices * 6;
+    const BoundingBox boundingBox(Vector3(-radius, -radius, -radius), Vector3(radius, radius, radius));
+    return createPrimitiveModel(context, "Sphere", numVertices, numIndices, boundingBox, [&](PrimitiveWriter &writer)
     {
-        float theta = (PI / 2.0f) * (float(ring) / rings);  // 0 to PI/2
-        float y = -radius * std::cos(theta) - halfHeight;
-        float r = radius * std::sin(theta);
-
-        for (int seg = 0; seg <= segments; ++seg)
+        // from the north pole down
+        const AngleTable phis(stacks, 180.0f);
+        const AngleTable thetas(slices, 360.0f);
+        for (int stack = 0; stack <= stacks; ++stack)
         {
-            float phi = 2.0f * PI * float(seg) / segments;
-            float x = r * std::cos(phi);
-            float z = r * std::sin(phi);
-            Vector3 pos(x, y, z);
-            positions.push_back(pos);
-            normals.push_back((Vector3(x, y + halfHeight, z)).normalisedCopy());
+            for (int slice = 0; slice <= slices; ++slice)
+            {
+                const Vector3 normal(phis.sin_[stack] * thetas.cos_[slice], phis.cos_[stack], phis.sin_[stack] * thetas.sin_[slice]);
+                writer.AddVertex(normal * radius, normal);
+            }
         }
-    }
+        writer.AddGrid(0, stacks, slices);
+    });
+}
 
-    // Cylinder
-    for (int i = 0; i <= 1; ++i)
+Urho3D::SharedPtr<Urho3D::Model> CreateCapsuleModel(Urho3D::Context *context, float radius, float height, int rings, int segments)
+{
+    rings = std::max(rings, 1);
+    segments = std::max(segments, 3);
+    const float halfHeight = height * 0.5f;
+    // the last row of the top hemisphere and the first of the bottom one have the same
+    // horizontal normals, so the cylinder is just the quads between them
+    const unsigned numVertices = 2 * (rings + 1) * (segments + 1);
+    const unsigned numIndices = (2 * rings + 1) * segments * 6;
+    const BoundingBox boundingBox(Vector3(-radius, -halfHeight - radius, -radius), Vector3(radius, halfHeight + radius, radius));
+    return createPrimitiveModel(context, "Capsule", numVertices, numIndices, boundingBox, [&](PrimitiveWriter &writer)
     {
-        float y = (i == 0 ? -halfHeight : halfHeight);
-        for (int seg = 0; seg <= segments; ++seg)
+        const AngleTable phis(rings, 90.0f);
+        const AngleTable thetas(segments, 360.0f);
+        for (int hemisphere = 0; hemisphere < 2; ++hemisphere)
         {
-            float phi = 2.0f * PI * float(seg) / segments;
-            float x = radius * std::cos(phi);
-            float z = radius * std::sin(phi);
-            Vector3 pos(x, y, z);
-            positions.push_back(pos);
-            normals.push_back(Vector3(x, 0, z).normalisedCopy());
+            const float centerY = hemisphere ? -halfHeight : halfHeight;
+            for (int ring = 0; ring <= rings; ++ring)
+            {
+                // the top one from its pole down to the equator, the bottom one onwards from there
+                const int phi = hemisphere ? rings - ring : ring;
+                const float y = hemisphere ? -phis.cos_[phi] : phis.cos_[phi];
+                for (int segment = 0; segment <= segments; ++segment)
+                {
+                    const Vector3 normal(phis.sin_[phi] * thetas.cos_[segment], y, phis.sin_[phi] * thetas.sin_[segment]);
+                    writer.AddVertex(Vector3(0.0f, centerY, 0.0f) + normal * radius, normal);
+                }
+            }
         }
-    }
+        writer.AddGrid(0, 2 * rings + 1, segments);
+    });
+}
 
-    // Top hemisphere
-    for (int ring = 0; ring <= rings; ++ring)
+Urho3D::SharedPtr<Urho3D::Model> CreateBoxModel(Urho3D::Context *context, const Urho3D::Vector3 &size)
+{
+    const Vector3 halfSize = size * 0.5f;
+    // per face its normal and two edge directions with u x v = normal
+    static const Vector3 faces[6][3] =
     {
-        float theta = (PI / 2.0f) * (float(ring) / rings);  // 0 to PI/2
-        float y = radius * std::cos(theta) + halfHeight;
-        float r = radius * std::sin(theta);
-
-        for (int seg = 0; seg <= segments; ++seg)
+        {Vector3::RIGHT, Vector3::UP, Vector3::FORWARD},
+        {Vector3::LEFT, Vector3::FORWARD, Vector3::UP},
+        {Vector3::UP, Vector3::FORWARD, Vector3::RIGHT},
+        {Vector3::DOWN, Vector3::RIGHT, Vector3::FORWARD},
+        {Vector3::FORWARD, Vector3::RIGHT, Vector3::UP},
+        {Vector3::BACK, Vector3::UP, Vector3::RIGHT}
+    };
+    return createPrimitiveModel(context, "Box", 24, 36, BoundingBox(-halfSize, halfSize), [&](PrimitiveWriter &writer)
+    {
+        for (const Vector3 (&face)[3] : faces)
         {
-            float phi = 2.0f * PI * float(seg) / segments;
-            float x = r * std::cos(phi);
-            float z = r * std::sin(phi);
-            Vector3 pos(x, y, z);
-            positions.push_back(pos);
-            normals.push_back((Vector3(x, y - halfHeight, z)).normalisedCopy());
+            const Vector3 center = face[0] * halfSize;
+            const Vector3 u = face[1] * halfSize;
+            const Vector3 v = face[2] * halfSize;
+            const unsigned first = writer.AddVertex(center - u - v, face[0]);
+            writer.AddVertex(center + u - v, face[0]);
+            writer.AddVertex(center - u + v, face[0]);
+            writer.AddVertex(center + u + v, face[0]);
+            writer.AddQuad(first, first + 1, first + 2, first + 3);
         }
-    }
+    });
+}
 
-    // Add vertices
-    for (size_t i = 0; i < positions.size(); ++i)
+// a flat disc facing up or down, its rim taken from the angle table
+static void addDisc(PrimitiveWriter &writer, const AngleTable &thetas, int segments, float radius, float y, bool up)
+{
+    const Vector3 normal = up ? Vector3::UP : Vector3::DOWN;
+    const unsigned center = writer.AddVertex(Vector3(0.0f, y, 0.0f), normal);
+    for (int segment = 0; segment <= segments; ++segment)
+        writer.AddVertex(Vector3(thetas.cos_[segment] * radius, y, thetas.sin_[segment] * radius), normal);
+    for (int segment = 0; segment < segments; ++segment)
     {
-        capsule->position(positions[i]);
-        capsule->normal(normals[i]);
+        const unsigned rim = center + 1 + segment;
+        if (up)
+            writer.AddTriangle(center, rim + 1, rim);
+        else
+            writer.AddTriangle(center, rim, rim + 1);
     }
+}
 
-    // ---------- INDEX PHASE ----------
-    int ringVerts = segments + 1;
-
-    // Bottom hemisphere indices
-    for (int ring = 0; ring < rings; ++ring)
+Urho3D::SharedPtr<Urho3D::Model> CreateCylinderModel(Urho3D::Context *context, float radius, float height, int segments)
+{
+    segments = std::max(segments, 3);
+    const float halfHeight = height * 0.5f;
+    const unsigned numVertices = 2 * (segments + 1) + 2 * (segments + 2);
+    const unsigned numIndices = segments * 6 + 2 * segments * 3;
+    const BoundingBox boundingBox(Vector3(-radius, -halfHeight, -radius), Vector3(radius, halfHeight, radius));
+    return createPrimitiveModel(context, "Cylinder", numVertices, numIndices, boundingBox, [&](PrimitiveWriter &writer)
     {
-        for (int seg = 0; seg < segments; ++seg)
+        const AngleTable thetas(segments, 360.0f);
+        addDisc(writer, thetas, segments, radius, halfHeight, true);
+        const unsigned side = writer.GetNumVertices();
+        for (int row = 0; row < 2; ++row)
         {
-            int i0 = ring * ringVerts + seg;
-            int i1 = (ring + 1) * ringVerts + seg;
-            int i2 = i0 + 1;
-            int i3 = i1 + 1;
-
-            capsule->triangle(i0, i1, i2);
-            capsule->triangle(i2, i1, i3);
+            const float y = row ? -halfHeight : halfHeight;
+            for (int segment = 0; segment <= segments; ++segment)
+            {
+                const Vector3 normal(thetas.cos_[segment], 0.0f, thetas.sin_[segment]);
+                writer.AddVertex(Vector3(normal.x_ * radius, y, normal.z_ * radius), normal);
+            }
         }
-    }
+        writer.AddGrid(side, 1, segments);
+        addDisc(writer, thetas, segments, radius, -halfHeight, false);
+    });
+}
 
-    int base = (rings + 1) * ringVerts;
-    // Cylinder indices
-    for (int seg = 0; seg < segments; ++seg)
+Urho3D::SharedPtr<Urho3D::Model> CreateConeModel(Urho3D::Context *context, float radius, float height, int segments)
+{
+    segments = std::max(segments, 3);
+    const float halfHeight = height * 0.5f;
+    // one apex vertex per segment, each with the normal halfway around it
+    const unsigned numVertices = segments + (segments + 1) + (segments + 2);
+    const unsigned numIndices = segments * 3 + segments * 3;
+    const BoundingBox boundingBox(Vector3(-radius, -halfHeight, -radius), Vector3(radius, halfHeight, radius));
+    return createPrimitiveModel(context, "Cone", numVertices, numIndices, boundingBox, [&](PrimitiveWriter &writer)
     {
-        int i0 = base + seg;
-        int i1 = base + ringVerts + seg;
-        int i2 = i0 + 1;
-        int i3 = i1 + 1;
-
-        capsule->triangle(i0, i1, i2);
-        capsule->triangle(i2, i1, i3);
-    }
+        const AngleTable thetas(segments, 360.0f);
+        const AngleTable halfThetas(2 * segments, 360.0f);
+        // the side's normals lean up by the slope, as (height, radius) is to the side's (radius, -height)
+        const auto sideNormal = [&](float cosTheta, float sinTheta)
+        {
+            return Vector3(cosTheta * height, radius, sinTheta * height).Normalized();
+        };
+        const unsigned apex = writer.GetNumVertices();
+        for (int segment = 0; segment < segments; ++segment)
+            writer.AddVertex(Vector3(0.0f, halfHeight, 0.0f), sideNormal(halfThetas.cos_[2 * segment + 1], halfThetas.sin_[2 * segment + 1]));
+        const unsigned rim = writer.GetNumVertices();
+        for (int segment = 0; segment <= segments; ++segment)
+        {
+            const Vector3 position(thetas.cos_[segment] * radius, -halfHeight, thetas.sin_[segment] * radius);
+            writer.AddVertex(position, sideNormal(thetas.cos_[segment], thetas.sin_[segment]));
+        }
+        for (int segment = 0; segment < segments; ++segment)
+            writer.AddTriangle(apex + segment, rim + segment + 1, rim + segment);
+        addDisc(writer, thetas, segments, radius, -halfHeight, false);
+    });
+}
 
-    base += 2 * ringVerts;
-    // Top hemisphere indices
-    for (int ring = 0; ring < rings; ++ring)
+Urho3D::SharedPtr<Urho3D::Model> CreateTorusModel(Urho3D::Context *context, float majorRadius, float minorRadius, int rings, int segments)
+{
+    rings = std::max(rings, 3);
+    segments = std::max(segments, 3);
+    const unsigned numVertices = (segments + 1) * (rings + 1);
+    const unsigned numIndices = segments * rings * 6;
+    const float outer = majorRadius + minorRadius;
+    const BoundingBox boundingBox(Vector3(-outer, -minorRadius, -outer), Vector3(outer, minorRadius, outer));
+    return createPrimitiveModel(context, "Torus", numVertices, numIndices, boundingBox, [&](PrimitiveWriter &writer)
     {
-        for (int seg = 0; seg < segments; ++seg)
+        // one row per step around the tube, from its outer equator over the bottom, so
+        // the rows go down where the outside faces
+        const AngleTable phis(segments, 360.0f);
+        const AngleTable thetas(rings, 360.0f);
+        for (int segment = 0; segment <= segments; ++segment)
         {
-            int i0 = base + ring * ringVerts + seg;
-            int i1 = base + (ring + 1) * ringVerts + seg;
-            int i2 = i0 + 1;
-            int i3 = i1 + 1;
-
-            capsule->triangle(i0, i2, i1);
-            capsule->triangle(i2, i3, i1);
+            for (int ring = 0; ring <= rings; ++ring)
+            {
+                const Vector3 normal(phis.cos_[segment] * thetas.cos_[ring], -phis.sin_[segment], phis.cos_[segment] * thetas.sin_[ring]);
+                const Vector3 center(thetas.cos_[ring] * majorRadius, 0.0f, thetas.sin_[ring] * majorRadius);
+                writer.AddVertex(center + normal * minorRadius, normal);
+            }
         }
-    }
-
-    capsule->end();
-    capsule->convertToMesh(name);
-}*/
+        writer.AddGrid(0, segments, rings);
+    });
+}
@@ -7,8 +7,20 @@ namespace Urho3D {
 
 class Context;
 class Model;
+class Vector3;
 
 } // namespace Urho3D
 
+// each call creates a new model centred on the origin with the Y axis up, with positions
+// and normals written straight into the vertex buffer and 32-bit indices only when 16
+// bits can't address every vertex; use PrimitiveCache to share models of the same
+// parameters instead
 Urho3D::SharedPtr<Urho3D::Model> CreateSphereModel(Urho3D::Context *context, float radius = 0.25f, int stacks = 16, int slices = 16);
+// height is that of the cylinder between the hemispheres
 Urho3D::SharedPtr<Urho3D::Model> CreateCapsuleModel(Urho3D::Context *context, float radius, float height, int rings = 16, int segments = 16);
+Urho3D::SharedPtr<Urho3D::Model> CreateBoxModel(Urho3D::Context *context, const Urho3D::Vector3 &size);
+Urho3D::SharedPtr<Urho3D::Model> CreateCylinderModel(Urho3D::Context *context, float radius, float height, int segments = 16);
+// the apex points up
+Urho3D::SharedPtr<Urho3D::Model> CreateConeModel(Urho3D::Context *context, float radius, float height, int segments = 16);
+// the ring lies in the XZ plane, rings divide it and segments the tube around it
+Urho3D::SharedPtr<Urho3D::Model> CreateTorusModel(Urho3D::Context *context, float majorRadius, float minorRadius, int rings = 24, int segments = 12);
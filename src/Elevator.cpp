@@ -55,6 +55,7 @@ Elevator::Elevator(Urho3D::Node *node) :
     SubscribeToEvent(world, E_PHYSICSPRESTEP, URHO3D_HANDLER(Elevator, HandlePhysicsPreStep));
     // SubscribeToEvent(world, E_PHYSICSPOSTSTEP, URHO3D_HANDLER(Elevator, HandlePhysicsPostStep));
     SubscribeToEvent(node_, E_NODECOLLISIONSTART, URHO3D_HANDLER(Elevator, HandleNodeCollisionStart));
+    node_->SetVar("GameObjectPtr", static_cast<void*>(this)); // so a hot reload removing the node can delete this
 }
 
 Elevator::~Elevator()
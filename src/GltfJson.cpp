@@ -0,0 +1,460 @@
+#include "GltfJson.h"
+#include "Json.h"
+#include "MappedFile.h"
+#include "MeshoptDecode.h"
+#include "ParallelFor.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <algorithm> // for std::max()
+#include <cctype> // for std::isxdigit()
+#include <cstdint>
+#include <cstring>
+
+// see the "GLB File Format Specification" section of the glTF 2.0 spec
+static const uint32_t GLB_MAGIC = 0x46546c67; // "glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004e4942; // "BIN\0"
+static const std::size_t GLB_HEADER_SIZE = 12;
+static const std::size_t GLB_CHUNK_HEADER_SIZE = 8;
+
+static uint32_t readUint32(const unsigned char *data)
+{
+    // GLB is little endian
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+        (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+bool ReadGltfJson(const std::string &filename, JsonValue &json)
+{
+    MappedFile file;
+    if (!file.Open(filename))
+        return false;
+    const unsigned char *data = file.GetData();
+    std::size_t size = file.GetSize();
+
+    if (size >= GLB_HEADER_SIZE && readUint32(data) == GLB_MAGIC)
+    {
+        // the JSON chunk must come first
+        if (size < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE || readUint32(data + GLB_HEADER_SIZE + 4) != GLB_CHUNK_JSON)
+        {
+            URHO3D_LOGWARNINGF("'%s' has no JSON chunk", filename.c_str());
+            return false;
+        }
+        const std::size_t chunkSize = readUint32(data + GLB_HEADER_SIZE);
+        if (chunkSize > size - GLB_HEADER_SIZE - GLB_CHUNK_HEADER_SIZE)
+        {
+            URHO3D_LOGWARNINGF("'%s' is truncated", filename.c_str());
+            return false;
+        }
+        data += GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE;
+        size = chunkSize;
+    }
+
+    else if (size >= 3 && std::memcmp(data, "\xef\xbb\xbf", 3) == 0)
+    {
+        // skip the UTF-8 byte order mark some exporters write into .gltf files
+        data += 3;
+        size -= 3;
+    }
+
+    std::string error;
+    if (!json.Parse(reinterpret_cast<const char*>(data), size, &error))
+    {
+        URHO3D_LOGWARNINGF("Failed to parse the glTF JSON of '%s': %s", filename.c_str(), error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// the BIN chunk follows the JSON chunk, whose size is padded to 4 bytes
+static bool findGlbBinChunk(const unsigned char *data, std::size_t size, const unsigned char *&chunk, std::size_t &chunkSize)
+{
+    if (size < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE || readUint32(data) != GLB_MAGIC)
+        return false;
+    const std::size_t jsonSize = readUint32(data + GLB_HEADER_SIZE);
+    const std::size_t offset = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE + ((jsonSize + 3) & ~static_cast<std::size_t>(3));
+    if (offset > size || size - offset < GLB_CHUNK_HEADER_SIZE || readUint32(data + offset + 4) != GLB_CHUNK_BIN)
+        return false;
+    chunkSize = readUint32(data + offset);
+    if (chunkSize > size - offset - GLB_CHUNK_HEADER_SIZE)
+        return false;
+    chunk = data + offset + GLB_CHUNK_HEADER_SIZE;
+    return true;
+}
+
+static int base64Value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+' || c == '-')
+        return 62;
+    if (c == '/' || c == '_')
+        return 63;
+    return -1;
+}
+
+static std::vector<unsigned char> decodeBase64(const char *text, std::size_t length)
+{
+    std::vector<unsigned char> result;
+    result.reserve(length / 4 * 3);
+    unsigned bits = 0;
+    int numBits = 0;
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        const int value = base64Value(text[i]);
+        if (value < 0)
+            continue; // padding and line breaks
+        bits = (bits << 6) | static_cast<unsigned>(value);
+        numBits += 6;
+        if (numBits >= 8)
+        {
+            numBits -= 8;
+            result.push_back(static_cast<unsigned char>(bits >> numBits));
+        }
+    }
+    return result;
+}
+
+// relative URIs may have percent-encoded characters, e.g. spaces
+static std::string decodeUriPath(const std::string &uri)
+{
+    std::string result;
+    for (std::size_t i = 0; i < uri.size(); ++i)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+        {
+            result += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            result += uri[i];
+    }
+    return result;
+}
+
+void GltfBuffers::Load(const std::string &filename, const JsonValue &gltf)
+{
+    const JsonValue &buffers = gltf["buffers"];
+    buffers_.assign(buffers.Size(), Buffer());
+    files_.clear();
+    decoded_.clear();
+    decodedViews_.clear();
+    const std::size_t slash = filename.find_last_of("/\\");
+    const std::string directory = (slash == std::string::npos) ? std::string() : filename.substr(0, slash + 1);
+
+    for (std::size_t i = 0; i < buffers.Size(); ++i)
+    {
+        const std::string &uri = buffers[i]["uri"].GetString();
+        Buffer &buffer = buffers_[i];
+        if (uri.empty())
+        {
+            // only the first buffer may refer to the BIN chunk of a .glb
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+            if (i == 0 && file->Open(filename) && findGlbBinChunk(file->GetData(), file->GetSize(), buffer.data_, buffer.size_))
+                files_.push_back(file);
+        }
+        else if (uri.compare(0, 5, "data:") == 0)
+        {
+            const std::size_t comma = uri.find(',');
+            if (comma != std::string::npos && uri.rfind(";base64", comma) != std::string::npos)
+            {
+                decoded_.push_back(decodeBase64(uri.data() + comma + 1, uri.size() - comma - 1));
+                buffer.data_ = decoded_.back().data();
+                buffer.size_ = decoded_.back().size();
+            }
+        }
+        else
+        {
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+            if (file->Open(directory + decodeUriPath(uri)))
+            {
+                buffer.data_ = file->GetData();
+                buffer.size_ = file->GetSize();
+                files_.push_back(file);
+            }
+        }
+
+        const std::size_t byteLength = static_cast<std::size_t>(buffers[i]["byteLength"].GetNumber());
+        if (!buffer.data_ || buffer.size_ < byteLength)
+        {
+            // the fallback for readers without EXT_meshopt_compression may be left out
+            if (!buffers[i]["extensions"]["EXT_meshopt_compression"]["fallback"].GetBool())
+                URHO3D_LOGWARNINGF("Can't load buffer %u of '%s'", static_cast<unsigned>(i), filename.c_str());
+            buffer = Buffer();
+        }
+    }
+}
+
+static unsigned getNumComponents(const std::string &type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4" || type == "MAT2")
+        return 4;
+    if (type == "MAT3")
+        return 9;
+    if (type == "MAT4")
+        return 16;
+    return 0;
+}
+
+// glTF componentType values
+enum GltfComponentType
+{
+    COMPONENT_BYTE = 5120,
+    COMPONENT_UNSIGNED_BYTE = 5121,
+    COMPONENT_SHORT = 5122,
+    COMPONENT_UNSIGNED_SHORT = 5123,
+    COMPONENT_UNSIGNED_INT = 5125,
+    COMPONENT_FLOAT = 5126
+};
+
+static unsigned getComponentSize(int componentType)
+{
+    switch (componentType)
+    {
+    case COMPONENT_BYTE:
+    case COMPONENT_UNSIGNED_BYTE:
+        return 1;
+    case COMPONENT_SHORT:
+    case COMPONENT_UNSIGNED_SHORT:
+        return 2;
+    case COMPONENT_UNSIGNED_INT:
+    case COMPONENT_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+template <typename T>
+static T readComponent(const unsigned char *src)
+{
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+static float readFloatComponent(const unsigned char *src, int componentType, bool normalized)
+{
+    switch (componentType)
+    {
+    case COMPONENT_BYTE:
+    {
+        const float value = readComponent<int8_t>(src);
+        return normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case COMPONENT_UNSIGNED_BYTE:
+        return readComponent<uint8_t>(src) / (normalized ? 255.0f : 1.0f);
+    case COMPONENT_SHORT:
+    {
+        const float value = readComponent<int16_t>(src);
+        return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    case COMPONENT_UNSIGNED_SHORT:
+        return readComponent<uint16_t>(src) / (normalized ? 65535.0f : 1.0f);
+    case COMPONENT_UNSIGNED_INT:
+        return static_cast<float>(readComponent<uint32_t>(src));
+    default:
+        return readComponent<float>(src);
+    }
+}
+
+bool GltfBuffers::GetAccessor(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, View &result) const
+{
+    const JsonValue &accessor = gltf["accessors"][accessorIndex];
+    result.componentType_ = accessor["componentType"].GetInt();
+    result.componentSize_ = getComponentSize(result.componentType_);
+    if (!accessor.IsObject() || accessor.Contains("sparse") || !result.componentSize_ || getNumComponents(accessor["type"].GetString()) != numComponents)
+        return false;
+    result.count_ = static_cast<std::size_t>(accessor["count"].GetNumber());
+    result.normalized_ = accessor["normalized"].GetBool();
+    result.data_ = nullptr;
+    result.stride_ = result.componentSize_ * numComponents;
+    // without a buffer view every element is zero
+    if (!accessor.Contains("bufferView") || !result.count_)
+        return true;
+
+    const std::size_t viewIndex = static_cast<std::size_t>(accessor["bufferView"].GetInt());
+    const unsigned char *viewData;
+    std::size_t viewLength;
+    if (!GetBufferView(gltf, viewIndex, viewData, viewLength))
+        return false;
+    const std::size_t elementSize = result.stride_;
+    result.stride_ = std::max(static_cast<std::size_t>(gltf["bufferViews"][viewIndex]["byteStride"].GetNumber()), elementSize);
+    const std::size_t offset = static_cast<std::size_t>(accessor["byteOffset"].GetNumber());
+    // (count - 1) * stride + elementSize <= viewLength - offset, without overflowing
+    if (offset > viewLength || elementSize > viewLength - offset ||
+        result.count_ - 1 > (viewLength - offset - elementSize) / result.stride_)
+        return false;
+    result.data_ = viewData + offset;
+    return true;
+}
+
+float GltfBuffers::View::Get(std::size_t element, unsigned component) const
+{
+    return readFloatComponent(data_ + element * stride_ + component * componentSize_, componentType_, normalized_);
+}
+
+bool GltfBuffers::GetView(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, View &view) const
+{
+    return GetAccessor(gltf, accessorIndex, numComponents, view) && view.data_;
+}
+
+bool GltfBuffers::GetFloatView(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, View &view) const
+{
+    return GetView(gltf, accessorIndex, numComponents, view) && view.componentType_ == COMPONENT_FLOAT;
+}
+
+bool GltfBuffers::GetBufferView(const JsonValue &gltf, std::size_t viewIndex, const unsigned char *&data, std::size_t &size) const
+{
+    if (viewIndex < decodedViews_.size() && decodedViews_[viewIndex].compressed_)
+    {
+        const DecodedView &decoded = decodedViews_[viewIndex];
+        data = decoded.data_.data();
+        size = decoded.data_.size();
+        return decoded.valid_;
+    }
+    const JsonValue &view = gltf["bufferViews"][viewIndex];
+    const std::size_t bufferIndex = static_cast<std::size_t>(view["buffer"].GetInt(-1));
+    if (!view.IsObject() || bufferIndex >= buffers_.size())
+        return false;
+    const Buffer &buffer = buffers_[bufferIndex];
+    const std::size_t viewOffset = static_cast<std::size_t>(view["byteOffset"].GetNumber());
+    const std::size_t viewLength = static_cast<std::size_t>(view["byteLength"].GetNumber());
+    if (!buffer.data_ || viewOffset > buffer.size_ || viewLength > buffer.size_ - viewOffset)
+        return false;
+    data = buffer.data_ + viewOffset;
+    size = viewLength;
+    return true;
+}
+
+static MeshoptFilter getMeshoptFilter(const std::string &filter)
+{
+    if (filter == "OCTAHEDRAL")
+        return MESHOPT_FILTER_OCTAHEDRAL;
+    if (filter == "QUATERNION")
+        return MESHOPT_FILTER_QUATERNION;
+    if (filter == "EXPONENTIAL")
+        return MESHOPT_FILTER_EXPONENTIAL;
+    return MESHOPT_FILTER_NONE;
+}
+
+// see the EXT_meshopt_compression spec: vertex strides are multiples of 4 up to 256,
+// index strides 2 or 4
+static bool isValidMeshoptStride(const std::string &mode, std::size_t stride)
+{
+    if (mode == "ATTRIBUTES")
+        return stride && stride % 4 == 0 && stride <= 256;
+    if (mode == "TRIANGLES" || mode == "INDICES")
+        return stride == 2 || stride == 4;
+    return false;
+}
+
+GltfBuffers::DecodeStats GltfBuffers::DecodeCompressedViews(const JsonValue &gltf, unsigned numThreads)
+{
+    const JsonValue &views = gltf["bufferViews"];
+    decodedViews_.assign(views.Size(), DecodedView());
+    std::vector<std::size_t> compressedViews;
+    for (std::size_t i = 0; i < views.Size(); ++i)
+    {
+        if (views[i]["extensions"].Contains("EXT_meshopt_compression"))
+        {
+            decodedViews_[i].compressed_ = true;
+            compressedViews.push_back(i);
+        }
+    }
+
+    std::vector<std::size_t> compressedSizes(compressedViews.size(), 0);
+    ParallelFor(compressedViews.size(), [&](std::size_t i)
+    {
+        const std::size_t viewIndex = compressedViews[i];
+        const JsonValue &compression = views[viewIndex]["extensions"]["EXT_meshopt_compression"];
+        DecodedView &decoded = decodedViews_[viewIndex];
+        const std::size_t bufferIndex = static_cast<std::size_t>(compression["buffer"].GetInt(-1));
+        const std::size_t offset = static_cast<std::size_t>(compression["byteOffset"].GetNumber());
+        const std::size_t length = static_cast<std::size_t>(compression["byteLength"].GetNumber());
+        const std::size_t count = static_cast<std::size_t>(compression["count"].GetNumber());
+        const std::size_t stride = static_cast<std::size_t>(compression["byteStride"].GetNumber());
+        const std::string &mode = compression["mode"].GetString();
+        if (bufferIndex >= buffers_.size() || !buffers_[bufferIndex].data_ || offset > buffers_[bufferIndex].size_ ||
+            length > buffers_[bufferIndex].size_ - offset || !isValidMeshoptStride(mode, stride))
+            return;
+        // the decoded data fills the view exactly, checked before allocating it for a
+        // count that is bogus or doesn't fit in memory at all
+        const std::size_t viewLength = static_cast<std::size_t>(views[viewIndex]["byteLength"].GetNumber());
+        if (count > viewLength / stride || count * stride != viewLength)
+            return;
+        const unsigned char * const source = buffers_[bufferIndex].data_ + offset;
+        compressedSizes[i] = length;
+        decoded.data_.resize(count * stride);
+        if (mode == "ATTRIBUTES")
+        {
+            decoded.valid_ = DecodeMeshoptVertices(decoded.data_.data(), count, stride, source, length) &&
+                UnfilterMeshopt(getMeshoptFilter(compression["filter"].GetString()), decoded.data_.data(), count, stride);
+        }
+        else if (mode == "TRIANGLES")
+            decoded.valid_ = DecodeMeshoptTriangles(decoded.data_.data(), count, stride, source, length);
+        else if (mode == "INDICES")
+            decoded.valid_ = DecodeMeshoptIndices(decoded.data_.data(), count, stride, source, length);
+    }, numThreads);
+
+    DecodeStats stats;
+    for (std::size_t i = 0; i < compressedViews.size(); ++i)
+    {
+        const DecodedView &decoded = decodedViews_[compressedViews[i]];
+        if (!decoded.valid_)
+        {
+            URHO3D_LOGWARNINGF("Can't decode the EXT_meshopt_compression data of buffer view %u", static_cast<unsigned>(compressedViews[i]));
+            continue;
+        }
+        ++stats.numViews_;
+        stats.compressedBytes_ += compressedSizes[i];
+        stats.decodedBytes_ += decoded.data_.size();
+    }
+    return stats;
+}
+
+bool GltfBuffers::ReadFloats(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, std::vector<float> &values) const
+{
+    View accessor;
+    if (!GetAccessor(gltf, accessorIndex, numComponents, accessor))
+        return false;
+    values.assign(accessor.count_ * numComponents, 0.0f);
+    if (!accessor.data_)
+        return true;
+    for (std::size_t i = 0; i < accessor.count_; ++i)
+        for (unsigned j = 0; j < numComponents; ++j)
+            values[i * numComponents + j] = accessor.Get(i, j);
+    return true;
+}
+
+bool GltfBuffers::ReadIndices(const JsonValue &gltf, std::size_t accessorIndex, std::vector<unsigned> &indices) const
+{
+    View accessor;
+    if (!GetAccessor(gltf, accessorIndex, 1, accessor) || accessor.componentType_ == COMPONENT_FLOAT || accessor.componentType_ == COMPONENT_BYTE || accessor.componentType_ == COMPONENT_SHORT)
+        return false;
+    indices.assign(accessor.count_, 0);
+    if (!accessor.data_)
+        return true;
+    for (std::size_t i = 0; i < accessor.count_; ++i)
+    {
+        const unsigned char * const src = accessor.data_ + i * accessor.stride_;
+        if (accessor.componentType_ == COMPONENT_UNSIGNED_BYTE)
+            indices[i] = readComponent<uint8_t>(src);
+        else if (accessor.componentType_ == COMPONENT_UNSIGNED_SHORT)
+            indices[i] = readComponent<uint16_t>(src);
+        else
+            indices[i] = readComponent<uint32_t>(src);
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// forward declarations
+class JsonValue;
+class MappedFile;
+
+// reads the JSON part of a .gltf file, or the JSON chunk of a binary .glb file
+bool ReadGltfJson(const std::string &filename, JsonValue &json);
+
+// the binary buffers of a glTF file: the BIN chunk of a .glb, external files next to
+// it and base64 data URIs; files are mapped, only data URIs and buffer views compressed
+// with EXT_meshopt_compression get decoded into memory
+class GltfBuffers
+{
+public:
+    // buffers that fail to load are left empty, so only accessors into them fail
+    void Load(const std::string &filename, const JsonValue &gltf);
+
+    struct DecodeStats
+    {
+        unsigned numViews_ = 0;
+        std::size_t compressedBytes_ = 0;
+        std::size_t decodedBytes_ = 0;
+    };
+    // decodes the EXT_meshopt_compression buffer views after Load(), one job per view on
+    // up to numThreads threads (0 for one per hardware thread); from then on accessors
+    // and GetBufferView() see the decoded data, views that fail to decode are unreadable
+    DecodeStats DecodeCompressedViews(const JsonValue &gltf, unsigned numThreads = 1);
+
+    // the elements of an accessor as numComponents floats each, integer components are
+    // converted (normalized ones as the glTF spec says); false for sparse accessors,
+    // other component counts and data outside the buffers
+    bool ReadFloats(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, std::vector<float> &values) const;
+    // unsigned integer scalars, e.g. the indices of a primitive
+    bool ReadIndices(const JsonValue &gltf, std::size_t accessorIndex, std::vector<unsigned> &indices) const;
+
+    // the elements of an accessor right where they are in the (mapped or decoded) buffer
+    struct View
+    {
+        const unsigned char *data_ = nullptr;
+        std::size_t stride_ = 0; // in bytes
+        std::size_t count_ = 0;
+        int componentType_ = 0; // a glTF componentType
+        unsigned componentSize_ = 0;
+        bool normalized_ = false;
+
+        // converts integer components like ReadFloats() does
+        float Get(std::size_t element, unsigned component) const;
+    };
+    // false for sparse accessors and those without a buffer view, then ReadFloats() is
+    // the way; the components may be of any type, e.g. with KHR_mesh_quantization
+    bool GetView(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, View &view) const;
+    // only succeeds for float components
+    bool GetFloatView(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, View &view) const;
+    // the raw bytes of a buffer view, e.g. an image embedded in a .glb
+    bool GetBufferView(const JsonValue &gltf, std::size_t viewIndex, const unsigned char *&data, std::size_t &size) const;
+protected:
+    // leaves the data null for accessors without a buffer view
+    bool GetAccessor(const JsonValue &gltf, std::size_t accessorIndex, unsigned numComponents, View &accessor) const;
+
+    struct Buffer
+    {
+        const unsigned char *data_ = nullptr;
+        std::size_t size_ = 0;
+    };
+    std::vector<Buffer> buffers_;
+    std::vector<std::shared_ptr<MappedFile>> files_;
+    std::vector<std::vector<unsigned char>> decoded_;
+    // per buffer view, the decoded data of compressed ones
+    struct DecodedView
+    {
+        bool compressed_ = false;
+        bool valid_ = false;
+        std::vector<unsigned char> data_;
+    };
+    std::vector<DecodedView> decodedViews_;
+};
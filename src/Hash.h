@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+static const uint64_t HASH_SEED = 0xcbf29ce484222325ull; // FNV-1a 64-bit offset basis
+
+// FNV-1a over raw bytes, pass a previous result as the seed to hash several blocks
+inline uint64_t HashBytes(const void *data, std::size_t size, uint64_t seed = HASH_SEED)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull; // FNV-1a 64-bit prime
+    }
+    return hash;
+}
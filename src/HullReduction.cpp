@@ -0,0 +1,92 @@
+#include "HullReduction.h"
+
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/ThirdParty/Bullet/LinearMath/btConvexHullComputer.h>
+
+#include <algorithm> // for std::max(), std::min()
+#include <cmath> // for std::sqrt(), std::ceil()
+#include <cstdint>
+#include <unordered_map>
+
+using Urho3D::BoundingBox;
+using Urho3D::Vector3;
+
+// the shrink is limited to this fraction of the distance from the centre to the closest face
+static const float HULL_SHRINK_CLAMP = 0.25f;
+
+static std::vector<Vector3> computeHull(const std::vector<Vector3> &points, float shrink)
+{
+    std::vector<Vector3> hull;
+    if (points.empty())
+        return hull;
+    btConvexHullComputer computer;
+    // shrinking fails for flat or tiny hulls, keep those at full size
+    if (computer.compute(&points[0].x_, sizeof(Vector3), static_cast<int>(points.size()), shrink, HULL_SHRINK_CLAMP) < 0.0f)
+        computer.compute(&points[0].x_, sizeof(Vector3), static_cast<int>(points.size()), 0.0f, 0.0f);
+    hull.reserve(computer.vertices.size());
+    for (int i = 0; i < computer.vertices.size(); ++i)
+    {
+        const btVector3 &v = computer.vertices[i];
+        hull.push_back(Vector3(v.x(), v.y(), v.z()));
+    }
+    return hull;
+}
+
+// keeps one point per occupied grid cell, the one farthest from the centre, so
+// the hull stays around the original instead of shrinking like averaging would
+static std::vector<Vector3> clusterPoints(const std::vector<Vector3> &points, const Vector3 &center, const BoundingBox &box, unsigned cellsPerAxis)
+{
+    const Vector3 size = box.Size();
+    const float cellSize = std::max(std::max(size.x_, size.y_), size.z_) / cellsPerAxis; // cubic cells
+    if (cellSize <= 0.0f)
+        return points;
+    const auto cellCoordinate = [cellSize, cellsPerAxis](float offset)
+    {
+        return std::min(static_cast<uint64_t>(std::max(offset / cellSize, 0.0f)), static_cast<uint64_t>(cellsPerAxis - 1));
+    };
+
+    std::vector<Vector3> result;
+    std::unordered_map<uint64_t, std::size_t> cells; // cell key to index into result
+    for (const Vector3 &point : points)
+    {
+        const Vector3 offset = point - box.min_;
+        const uint64_t key = (cellCoordinate(offset.x_) * cellsPerAxis + cellCoordinate(offset.y_)) * cellsPerAxis + cellCoordinate(offset.z_);
+        const auto inserted = cells.emplace(key, result.size());
+        if (inserted.second)
+            result.push_back(point);
+        else if ((point - center).LengthSquared() > (result[inserted.first->second] - center).LengthSquared())
+            result[inserted.first->second] = point;
+    }
+    return result;
+}
+
+std::vector<Vector3> ReduceConvexHull(const std::vector<Vector3> &points, unsigned maxVertices, float shrink)
+{
+    const std::vector<Vector3> exactHull = computeHull(points, 0.0f);
+    std::vector<Vector3> hull = exactHull;
+    if (maxVertices && hull.size() > maxVertices)
+    {
+        maxVertices = std::max(maxVertices, MIN_HULL_VERTICES);
+        BoundingBox box;
+        Vector3 center = Vector3::ZERO;
+        for (const Vector3 &point : exactHull)
+        {
+            box.Merge(point);
+            center += point;
+        }
+        center /= static_cast<float>(exactHull.size());
+
+        // a hull touches roughly 6 * cells^2 cells, so start a bit above the budget and
+        // coarsen from there; two cells per axis leave at most 8 points, which always fits
+        unsigned cellsPerAxis = std::max(2u, static_cast<unsigned>(std::ceil(std::sqrt(static_cast<float>(maxVertices)))));
+        for (; cellsPerAxis >= 2; --cellsPerAxis)
+        {
+            hull = computeHull(clusterPoints(exactHull, center, box, cellsPerAxis), 0.0f);
+            if (hull.size() <= maxVertices)
+                break;
+        }
+    }
+    if (shrink > 0.0f)
+        hull = computeHull(hull, shrink);
+    return hull;
+}
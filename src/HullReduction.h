@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Urho3D/Math/Vector3.h>
+
+#include <vector>
+
+// budgets below this can't always be met, smaller ones are raised to it
+static const unsigned MIN_HULL_VERTICES = 8;
+
+// convex hull of the points with at most maxVertices corners (0 for no limit):
+// the exact hull is computed first, then its corners are merged by vertex
+// clustering on ever coarser grids until the hull of what's left fits; with a
+// non-zero shrink the faces are moved inwards by that much, so a collision
+// margin of the same size puts the surface back where it was
+std::vector<Urho3D::Vector3> ReduceConvexHull(const std::vector<Urho3D::Vector3> &points, unsigned maxVertices, float shrink);
@@ -0,0 +1,248 @@
+// headless scene import benchmark: loads a scene with loadSceneWithAssimp() a number of
+// times and prints the wall time and heap allocations of every loading stage as JSON,
+//     import-benchmark <scene.glb> [runs] [--cache] [--assimp]
+// the scene and BVH caches are off unless --cache is given, so by default every run
+// reads the source file; glTF files are read natively unless --assimp is given
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/LogStream.hpp>
+
+#include "LoadProfile.h"
+#include "SceneLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace Urho3D;
+
+// counts every operator new in the process, the array and nothrow versions forward to
+// this one; plain malloc() calls (e.g. by Bullet's allocator) aren't counted
+static std::atomic<uint64_t> allocationCount(0);
+
+static uint64_t getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+void * operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void * const p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Assimp only logs the names of its post-processing steps, so they are timed from the
+// log: "<Name>Process begin" starts a step, which lasts until its "finished" message,
+// the next step or the end of the pipeline; everything before the pipeline is parsing
+class PostProcessTimer : public Assimp::LogStream
+{
+public:
+    explicit PostProcessTimer(LoadProfile &profile) :
+        profile_(profile),
+        allocations_(0)
+    {
+    }
+    void write(const char *message) override
+    {
+        if (std::strstr(message, "Load "))
+            Begin("assimp_read/parse");
+        else if (std::strstr(message, "Entering post processing pipeline") || std::strstr(message, "Leaving post processing pipeline"))
+            End();
+        else if (const char * const begin = std::strstr(message, "Process begin"))
+        {
+            const char *name = begin;
+            while (name > message && std::isalnum(static_cast<unsigned char>(name[-1])))
+                --name;
+            Begin("assimp_read/" + std::string(name, begin));
+        }
+        else if (std::strstr(message, "Process finished"))
+            End();
+    }
+protected:
+    void Begin(const std::string &stage)
+    {
+        End();
+        stage_ = stage;
+        allocations_ = profile_.GetAllocations();
+        start_ = std::chrono::steady_clock::now();
+    }
+    void End()
+    {
+        if (stage_.empty())
+            return;
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+        const uint64_t allocations = profile_.GetAllocations() - allocations_;
+        profile_.Add(stage_, elapsed.count(), allocations);
+        stage_.clear();
+    }
+
+    LoadProfile &profile_;
+    std::string stage_; // empty between steps
+    uint64_t allocations_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+static std::string escapeJson(const std::string &text)
+{
+    std::string result;
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+class ImportBenchmark : public Application
+{
+    URHO3D_OBJECT(ImportBenchmark, Application)
+
+public:
+    ImportBenchmark(Context *context) :
+        Application(context),
+        runs_(5),
+        useCaches_(false),
+        useAssimp_(false),
+        flattenStaticNodes_(false),
+        numNodes_(0)
+    {
+    }
+
+    virtual void Setup() override
+    {
+        engineParameters_[EP_HEADLESS] = true;
+        engineParameters_[EP_LOG_LEVEL] = LOG_WARNING; // keep stdout for the JSON
+    }
+
+    virtual void Start() override
+    {
+        for (const auto &argument : GetArguments())
+        {
+#ifdef USING_RBFX
+            const std::string arg = argument.c_str();
+#else // USING_RBFX
+            const std::string arg = argument.CString();
+#endif // USING_RBFX
+            if (arg == "--cache")
+                useCaches_ = true;
+            else if (arg == "--assimp")
+                useAssimp_ = true;
+            else if (arg == "--flatten")
+                flattenStaticNodes_ = true;
+            else if (filename_.empty())
+                filename_ = arg;
+            else
+                runs_ = std::max(std::atoi(arg.c_str()), 1);
+        }
+        if (filename_.empty())
+        {
+            std::fprintf(stderr, "usage: import-benchmark <scene.glb> [runs] [--cache] [--assimp] [--flatten]\n");
+            ErrorExit();
+            return;
+        }
+
+        profile_.SetAllocationCounter(getAllocationCount);
+        Assimp::DefaultLogger::create(nullptr, Assimp::Logger::DEBUGGING, 0);
+        Assimp::DefaultLogger::get()->attachStream(new PostProcessTimer(profile_)); // the logger deletes it
+
+        SceneLoaderOptions options;
+        options.useSceneCache_ = useCaches_;
+        options.useBvhCache_ = useCaches_;
+        options.nativeGltf_ = !useAssimp_;
+        options.flattenStaticNodes_ = flattenStaticNodes_;
+        options.profile_ = &profile_;
+        std::vector<double> totals;
+        for (int run = 0; run < runs_; ++run)
+        {
+            SharedPtr<Scene> scene(new Scene(context_));
+            scene->CreateComponent<Octree>();
+            scene->CreateComponent<PhysicsWorld>();
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            loadSceneWithAssimp(filename_, scene, context_, options);
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            totals.push_back(elapsed.count());
+            numNodes_ = scene->GetNumChildren(true);
+        }
+        Assimp::DefaultLogger::kill();
+
+        PrintReport(totals);
+        engine_->Exit();
+    }
+
+protected:
+    void PrintReport(const std::vector<double> &totals) const
+    {
+        double sum = 0.0;
+        for (const double total : totals)
+            sum += total;
+        std::printf("{\n");
+        std::printf("  \"file\": \"%s\",\n", escapeJson(filename_).c_str());
+        std::printf("  \"runs\": %d,\n", runs_);
+        std::printf("  \"caches\": %s,\n", useCaches_ ? "true" : "false");
+        std::printf("  \"reader\": \"%s\",\n", useAssimp_ ? "assimp" : "native");
+        std::printf("  \"flatten\": %s,\n", flattenStaticNodes_ ? "true" : "false");
+        std::printf("  \"nodes\": %u,\n", numNodes_);
+        std::printf("  \"total_ms\": {\"min\": %.3f, \"mean\": %.3f, \"max\": %.3f},\n",
+            *std::min_element(totals.begin(), totals.end()), sum / runs_, *std::max_element(totals.begin(), totals.end()));
+        std::printf("  \"stages\": [\n");
+        // per run averages; a stage named like another one plus "/..." ran inside that one;
+        // stages that process data (e.g. gltf_read/meshopt_decode) add their throughput
+        const std::vector<LoadProfile::Stage> stages = profile_.GetStages();
+        for (std::size_t i = 0; i < stages.size(); ++i)
+        {
+            const LoadProfile::Stage &stage = stages[i];
+            std::string throughput;
+            if (stage.bytes_)
+            {
+                char text[96];
+                std::snprintf(text, sizeof(text), ", \"bytes\": %.0f, \"mb_per_s\": %.1f", static_cast<double>(stage.bytes_) / runs_,
+                    static_cast<double>(stage.bytes_) / std::max(stage.milliseconds_, 0.001) / 1000.0);
+                throughput = text;
+            }
+            std::printf("    {\"name\": \"%s\", \"calls\": %.1f, \"ms\": %.3f, \"allocations\": %.1f%s}%s\n",
+                escapeJson(stage.name_).c_str(), static_cast<double>(stage.calls_) / runs_, stage.milliseconds_ / runs_,
+                static_cast<double>(stage.allocations_) / runs_, throughput.c_str(), (i + 1 < stages.size()) ? "," : "");
+        }
+        std::printf("  ]\n");
+        std::printf("}\n");
+    }
+
+    std::string filename_;
+    int runs_;
+    bool useCaches_;
+    bool useAssimp_;
+    bool flattenStaticNodes_;
+    unsigned numNodes_; // in the scene of the last run
+    LoadProfile profile_;
+};
+
+URHO3D_DEFINE_APPLICATION_MAIN(ImportBenchmark);
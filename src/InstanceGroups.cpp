@@ -0,0 +1,65 @@
+#include "InstanceGroups.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <algorithm> // for std::min()
+#include <cmath> // for std::floor()
+#include <map>
+#include <utility>
+
+using Urho3D::BoundingBox;
+using Urho3D::Matrix3x4;
+using Urho3D::Vector3;
+
+std::vector<bool> FindInstancedNodes(const CookedScene &scene, const std::vector<bool> &candidates, unsigned minInstances)
+{
+    std::map<std::vector<unsigned>, unsigned> meshUsers;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+        if (candidates[i] && !scene.nodes_[i].meshes_.empty())
+            ++meshUsers[scene.nodes_[i].meshes_];
+
+    std::vector<bool> instanced(scene.nodes_.size(), false);
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+        if (candidates[i] && !scene.nodes_[i].meshes_.empty())
+            instanced[i] = meshUsers[scene.nodes_[i].meshes_] >= std::max(minInstances, 2u);
+    return instanced;
+}
+
+std::vector<InstanceGroup> FindInstanceGroups(const CookedScene &scene, const std::vector<bool> &instancedNodes, const std::vector<Matrix3x4> &nodeTransforms, unsigned cellsPerAxis)
+{
+    BoundingBox sceneBox;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+        if (instancedNodes[i])
+            sceneBox.Merge(nodeTransforms[i].Translation());
+    if (!sceneBox.Defined())
+        return std::vector<InstanceGroup>();
+    cellsPerAxis = std::max(cellsPerAxis, 1u);
+    const Vector3 sceneSize = sceneBox.Size();
+    const float cellSize = std::max(std::max(sceneSize.x_, sceneSize.z_) / cellsPerAxis, 1e-3f);
+    const auto cellCoordinate = [cellsPerAxis, cellSize](float offset)
+    {
+        return std::min(static_cast<unsigned>(std::max(std::floor(offset / cellSize), 0.0f)), cellsPerAxis - 1);
+    };
+
+    // keyed by mesh and cell
+    std::map<std::pair<unsigned, unsigned>, std::vector<unsigned>> groupNodes;
+    unsigned numNodes = 0;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        if (!instancedNodes[i])
+            continue;
+        const Vector3 position = nodeTransforms[i].Translation();
+        const unsigned cell = cellCoordinate(position.z_ - sceneBox.min_.z_) * cellsPerAxis + cellCoordinate(position.x_ - sceneBox.min_.x_);
+        for (const unsigned meshIndex : scene.nodes_[i].meshes_)
+            groupNodes[std::make_pair(meshIndex, cell)].push_back(static_cast<unsigned>(i));
+        ++numNodes;
+    }
+
+    std::vector<InstanceGroup> groups;
+    groups.reserve(groupNodes.size());
+    for (auto &entry : groupNodes)
+        groups.push_back(InstanceGroup{entry.first.first, std::move(entry.second)});
+    URHO3D_LOGINFOF("Instancing %u nodes with repeated meshes in %u groups (%ux%u cells of %.1f units)",
+        numNodes, static_cast<unsigned>(groups.size()), cellsPerAxis, cellsPerAxis, cellSize);
+    return groups;
+}
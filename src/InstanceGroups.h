@@ -0,0 +1,22 @@
+#pragma once
+
+#include "CookedScene.h"
+
+#include <Urho3D/Math/Matrix3x4.h>
+
+#include <vector>
+
+// one mesh drawn at many nodes with hardware instancing
+struct InstanceGroup
+{
+    unsigned meshIndex_;
+    std::vector<unsigned> nodes_; // indices into CookedScene::nodes_
+};
+
+// which of the flagged nodes use exactly the same meshes as at least minInstances - 1 others
+std::vector<bool> FindInstancedNodes(const CookedScene &scene, const std::vector<bool> &candidates, unsigned minInstances);
+
+// one group per mesh of the instanced nodes and grid cell, the grid divides the longer
+// horizontal side of the instanced node positions into cellsPerAxis cells (as in
+// BatchStaticMeshes()) so each group can still be culled on its own
+std::vector<InstanceGroup> FindInstanceGroups(const CookedScene &scene, const std::vector<bool> &instancedNodes, const std::vector<Urho3D::Matrix3x4> &nodeTransforms, unsigned cellsPerAxis);
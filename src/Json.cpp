@@ -0,0 +1,277 @@
+#include "Json.h"
+
+#include <cstdlib> // for std::strtod()
+#include <cstring>
+
+const JsonValue JsonValue::EMPTY;
+
+// recursive descent parser, following RFC 8259
+class JsonParser
+{
+public:
+    JsonParser(const char *data, std::size_t size) :
+        pos_(data),
+        end_(data + size),
+        depth_(0)
+    {
+    }
+    bool ParseDocument(JsonValue &value)
+    {
+        if (!ParseValue(value))
+            return false;
+        SkipWhitespace();
+        return pos_ == end_ || Fail("trailing characters after the document");
+    }
+    const std::string & GetError() const {return error_;}
+protected:
+    static const unsigned MAX_DEPTH = 256;
+
+    bool Fail(const char *message)
+    {
+        if (error_.empty())
+            error_ = message;
+        return false;
+    }
+    void SkipWhitespace()
+    {
+        while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r'))
+            ++pos_;
+    }
+    bool Match(const char *literal)
+    {
+        const std::size_t length = std::strlen(literal);
+        if (static_cast<std::size_t>(end_ - pos_) < length || std::memcmp(pos_, literal, length) != 0)
+            return false;
+        pos_ += length;
+        return true;
+    }
+    bool ParseValue(JsonValue &value)
+    {
+        SkipWhitespace();
+        if (pos_ == end_)
+            return Fail("unexpected end of input");
+        switch (*pos_)
+        {
+        case '{':
+            return ParseObject(value);
+        case '[':
+            return ParseArray(value);
+        case '"':
+            value.type_ = JsonValue::TYPE_STRING;
+            return ParseString(value.string_);
+        case 't':
+        case 'f':
+            value.type_ = JsonValue::TYPE_BOOL;
+            value.bool_ = *pos_ == 't';
+            return Match(value.bool_ ? "true" : "false") || Fail("invalid literal");
+        case 'n':
+            value.type_ = JsonValue::TYPE_NULL;
+            return Match("null") || Fail("invalid literal");
+        default:
+            return ParseNumber(value);
+        }
+    }
+    bool ParseObject(JsonValue &value)
+    {
+        if (++depth_ > MAX_DEPTH)
+            return Fail("nested too deeply");
+        value.type_ = JsonValue::TYPE_OBJECT;
+        ++pos_; // '{'
+        SkipWhitespace();
+        if (pos_ != end_ && *pos_ == '}')
+        {
+            ++pos_;
+            --depth_;
+            return true;
+        }
+        for (;;)
+        {
+            SkipWhitespace();
+            std::string key;
+            if (pos_ == end_ || *pos_ != '"' || !ParseString(key))
+                return Fail("expected an object key");
+            SkipWhitespace();
+            if (pos_ == end_ || *pos_++ != ':')
+                return Fail("expected ':'");
+            if (!ParseValue(value.members_[key]))
+                return false;
+            SkipWhitespace();
+            if (pos_ == end_)
+                return Fail("unterminated object");
+            const char c = *pos_++;
+            if (c == '}')
+                break;
+            if (c != ',')
+                return Fail("expected ',' or '}'");
+        }
+        --depth_;
+        return true;
+    }
+    bool ParseArray(JsonValue &value)
+    {
+        if (++depth_ > MAX_DEPTH)
+            return Fail("nested too deeply");
+        value.type_ = JsonValue::TYPE_ARRAY;
+        ++pos_; // '['
+        SkipWhitespace();
+        if (pos_ != end_ && *pos_ == ']')
+        {
+            ++pos_;
+            --depth_;
+            return true;
+        }
+        for (;;)
+        {
+            value.elements_.emplace_back();
+            if (!ParseValue(value.elements_.back()))
+                return false;
+            SkipWhitespace();
+            if (pos_ == end_)
+                return Fail("unterminated array");
+            const char c = *pos_++;
+            if (c == ']')
+                break;
+            if (c != ',')
+                return Fail("expected ',' or ']'");
+        }
+        --depth_;
+        return true;
+    }
+    bool ParseHex4(unsigned &codePoint)
+    {
+        if (end_ - pos_ < 4)
+            return Fail("truncated \\u escape");
+        codePoint = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const char c = *pos_++;
+            codePoint <<= 4;
+            if (c >= '0' && c <= '9')
+                codePoint |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                codePoint |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                codePoint |= c - 'A' + 10;
+            else
+                return Fail("invalid \\u escape");
+        }
+        return true;
+    }
+    static void AppendUtf8(std::string &str, unsigned codePoint)
+    {
+        if (codePoint < 0x80)
+            str += static_cast<char>(codePoint);
+        else if (codePoint < 0x800)
+        {
+            str += static_cast<char>(0xc0 | (codePoint >> 6));
+            str += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else if (codePoint < 0x10000)
+        {
+            str += static_cast<char>(0xe0 | (codePoint >> 12));
+            str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+        else
+        {
+            str += static_cast<char>(0xf0 | (codePoint >> 18));
+            str += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+            str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (codePoint & 0x3f));
+        }
+    }
+    bool ParseString(std::string &str)
+    {
+        ++pos_; // '"'
+        for (;;)
+        {
+            if (pos_ == end_)
+                return Fail("unterminated string");
+            const char c = *pos_++;
+            if (c == '"')
+                return true;
+            if (c != '\\')
+            {
+                str += c;
+                continue;
+            }
+            if (pos_ == end_)
+                return Fail("unterminated string");
+            switch (*pos_++)
+            {
+            case '"': str += '"'; break;
+            case '\\': str += '\\'; break;
+            case '/': str += '/'; break;
+            case 'b': str += '\b'; break;
+            case 'f': str += '\f'; break;
+            case 'n': str += '\n'; break;
+            case 'r': str += '\r'; break;
+            case 't': str += '\t'; break;
+            case 'u':
+            {
+                unsigned codePoint;
+                if (!ParseHex4(codePoint))
+                    return false;
+                // combine UTF-16 surrogate pairs
+                if (codePoint >= 0xd800 && codePoint < 0xdc00 && Match("\\u"))
+                {
+                    unsigned low;
+                    if (!ParseHex4(low))
+                        return false;
+                    if (low >= 0xdc00 && low < 0xe000)
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                }
+                AppendUtf8(str, codePoint);
+                break;
+            }
+            default:
+                return Fail("invalid escape sequence");
+            }
+        }
+    }
+    bool ParseNumber(JsonValue &value)
+    {
+        // strtod() needs a terminated string, and numbers are short
+        const char *numberEnd = pos_;
+        while (numberEnd != end_ && std::strchr("+-0123456789.eE", *numberEnd))
+            ++numberEnd;
+        const std::string text(pos_, numberEnd);
+        if (text.empty())
+            return Fail("unexpected character");
+        char *parsedEnd = nullptr;
+        value.type_ = JsonValue::TYPE_NUMBER;
+        value.number_ = std::strtod(text.c_str(), &parsedEnd);
+        if (parsedEnd != text.c_str() + text.size())
+            return Fail("invalid number");
+        pos_ = numberEnd;
+        return true;
+    }
+
+    const char *pos_;
+    const char *end_;
+    unsigned depth_;
+    std::string error_;
+};
+
+bool JsonValue::Parse(const char *data, std::size_t size, std::string *error)
+{
+    *this = JsonValue();
+    JsonParser parser(data, size);
+    if (parser.ParseDocument(*this))
+        return true;
+    if (error)
+        *error = parser.GetError();
+    *this = JsonValue();
+    return false;
+}
+
+const JsonValue & JsonValue::operator[](std::size_t index) const
+{
+    return index < elements_.size() ? elements_[index] : EMPTY;
+}
+
+const JsonValue & JsonValue::operator[](const std::string &key) const
+{
+    const std::map<std::string, JsonValue>::const_iterator it = members_.find(key);
+    return it != members_.end() ? it->second : EMPTY;
+}
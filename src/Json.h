@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// minimal read-only JSON document, used for the glTF parts Assimp doesn't expose;
+// unlike Urho3D's JSONFile it needs no Context, so it can be used while cooking on
+// a background thread
+class JsonValue
+{
+public:
+    enum Type
+    {
+        TYPE_NULL,
+        TYPE_BOOL,
+        TYPE_NUMBER,
+        TYPE_STRING,
+        TYPE_ARRAY,
+        TYPE_OBJECT
+    };
+
+    JsonValue() : type_(TYPE_NULL), bool_(false), number_(0.0) {}
+
+    // returns false and leaves a message in error on malformed input
+    bool Parse(const char *data, std::size_t size, std::string *error = nullptr);
+
+    Type GetType() const {return type_;}
+    bool IsNull() const {return type_ == TYPE_NULL;}
+    bool IsNumber() const {return type_ == TYPE_NUMBER;}
+    bool IsString() const {return type_ == TYPE_STRING;}
+    bool IsArray() const {return type_ == TYPE_ARRAY;}
+    bool IsObject() const {return type_ == TYPE_OBJECT;}
+
+    bool GetBool(bool defaultValue = false) const {return type_ == TYPE_BOOL ? bool_ : defaultValue;}
+    double GetNumber(double defaultValue = 0.0) const {return type_ == TYPE_NUMBER ? number_ : defaultValue;}
+    float GetFloat(float defaultValue = 0.0f) const {return type_ == TYPE_NUMBER ? static_cast<float>(number_) : defaultValue;}
+    int GetInt(int defaultValue = 0) const {return type_ == TYPE_NUMBER ? static_cast<int>(number_) : defaultValue;}
+    const std::string & GetString() const {return string_;}
+
+    // arrays and objects, missing entries return a null value
+    std::size_t Size() const {return type_ == TYPE_OBJECT ? members_.size() : elements_.size();}
+    const JsonValue & operator[](std::size_t index) const;
+    const JsonValue & operator[](const std::string &key) const;
+    bool Contains(const std::string &key) const {return members_.count(key) != 0;}
+    const std::vector<JsonValue> & GetElements() const {return elements_;}
+    const std::map<std::string, JsonValue> & GetMembers() const {return members_;}
+
+    static const JsonValue EMPTY;
+protected:
+    friend class JsonParser;
+
+    Type type_;
+    bool bool_;
+    double number_;
+    std::string string_;
+    std::vector<JsonValue> elements_;
+    std::map<std::string, JsonValue> members_;
+};
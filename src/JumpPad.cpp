@@ -25,6 +25,7 @@ JumpPad::JumpPad(Urho3D::Node *node) :
     bulletBody->setUserIndex(PhysicsUserIndex::JumpPad);
 
     SubscribeToEvent(node_, E_NODECOLLISIONSTART, URHO3D_HANDLER(JumpPad, HandleNodeCollision));
+    node_->SetVar("GameObjectPtr", static_cast<void*>(this)); // so a hot reload removing the node can delete this
 }
 
 JumpPad::~JumpPad()
@@ -0,0 +1,37 @@
+#include "LoadProfile.h"
+
+void LoadProfile::Add(const std::string &name, double milliseconds, uint64_t allocations, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // there are only a few dozen stages
+    for (Stage &stage : stages_)
+    {
+        if (stage.name_ == name)
+        {
+            ++stage.calls_;
+            stage.milliseconds_ += milliseconds;
+            stage.allocations_ += allocations;
+            stage.bytes_ += bytes;
+            return;
+        }
+    }
+    Stage stage;
+    stage.name_ = name;
+    stage.calls_ = 1;
+    stage.milliseconds_ = milliseconds;
+    stage.allocations_ = allocations;
+    stage.bytes_ = bytes;
+    stages_.push_back(stage);
+}
+
+std::vector<LoadProfile::Stage> LoadProfile::GetStages() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stages_;
+}
+
+void LoadProfile::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_.clear();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// wall time and heap allocations of every scene loading stage, collected when
+// SceneLoaderOptions::profile_ points to one (see ImportBenchmark.cpp); stages may
+// be timed from several threads at once
+class LoadProfile
+{
+public:
+    struct Stage
+    {
+        std::string name_; // "group/stage", or "outer/inner" for a stage that runs inside another
+        unsigned calls_ = 0;
+        double milliseconds_ = 0.0;
+        uint64_t allocations_ = 0;
+        uint64_t bytes_ = 0; // processed, for stages that report a throughput
+    };
+    typedef uint64_t (*AllocationCounter)();
+
+    // allocations can only be counted by replacing the global operator new, which
+    // only the benchmark does; without a counter they stay 0
+    void SetAllocationCounter(AllocationCounter counter) {allocationCounter_ = counter;}
+    uint64_t GetAllocations() const {return allocationCounter_ ? allocationCounter_() : 0;}
+
+    // adds to the stage of that name, stages are kept in the order they first ran
+    void Add(const std::string &name, double milliseconds, uint64_t allocations, uint64_t bytes = 0);
+    std::vector<Stage> GetStages() const;
+    void Clear();
+protected:
+    AllocationCounter allocationCounter_ = nullptr;
+    mutable std::mutex mutex_;
+    std::vector<Stage> stages_;
+};
+
+// times the rest of the enclosing scope as one stage, does nothing without a profile;
+// allocations are counted process wide, so they include other threads' meanwhile
+class LoadProfileScope
+{
+public:
+    LoadProfileScope(LoadProfile *profile, const char *name) :
+        profile_(profile),
+        name_(name),
+        allocations_(profile ? profile->GetAllocations() : 0),
+        bytes_(0),
+        start_(std::chrono::steady_clock::now())
+    {
+    }
+    ~LoadProfileScope()
+    {
+        if (!profile_)
+            return;
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+        const uint64_t allocations = profile_->GetAllocations() - allocations_;
+        profile_->Add(name_, elapsed.count(), allocations, bytes_);
+    }
+    // the amount of data the stage went through, e.g. decoded bytes
+    void SetBytes(uint64_t bytes) {bytes_ = bytes;}
+    LoadProfileScope(const LoadProfileScope &) = delete;
+    LoadProfileScope & operator=(const LoadProfileScope &) = delete;
+protected:
+    LoadProfile *profile_;
+    const char *name_;
+    uint64_t allocations_;
+    uint64_t bytes_;
+    std::chrono::steady_clock::time_point start_;
+};
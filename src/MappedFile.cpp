@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else // POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+MappedFile::MappedFile() :
+    data_(nullptr),
+    size_(0),
+    writable_(false)
+#ifdef _WIN32
+    , fileHandle_(INVALID_HANDLE_VALUE),
+    mappingHandle_(nullptr)
+#endif // _WIN32
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string &filename, bool writable)
+{
+    Close();
+#ifdef _WIN32
+    fileHandle_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle_ == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle_, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+    mappingHandle_ = CreateFileMappingA(fileHandle_, nullptr, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle_)
+    {
+        Close();
+        return false;
+    }
+    data_ = static_cast<unsigned char*>(MapViewOfFile(mappingHandle_, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+    {
+        Close();
+        return false;
+    }
+    size_ = static_cast<std::size_t>(fileSize.QuadPart);
+#else // POSIX
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    void * const mapping = mmap(nullptr, static_cast<std::size_t>(st.st_size), writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED)
+        return false;
+    data_ = static_cast<unsigned char*>(mapping);
+    size_ = static_cast<std::size_t>(st.st_size);
+#endif // _WIN32
+    writable_ = writable;
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mappingHandle_)
+        CloseHandle(mappingHandle_);
+    if (fileHandle_ != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle_);
+    mappingHandle_ = nullptr;
+    fileHandle_ = INVALID_HANDLE_VALUE;
+#else // POSIX
+    if (data_)
+        munmap(data_, size_);
+#endif // _WIN32
+    data_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    // a writable mapping is private copy-on-write: changes only ever reach this process' copy of the touched pages
+    bool Open(const std::string &filename, bool writable = false);
+    void Close();
+    bool IsOpen() const {return data_ != nullptr;}
+    const unsigned char * GetData() const {return data_;}
+    unsigned char * GetWritableData() const {return writable_ ? data_ : nullptr;}
+    std::size_t GetSize() const {return size_;}
+protected:
+    unsigned char *data_;
+    std::size_t size_;
+    bool writable_;
+#ifdef _WIN32
+    void *fileHandle_;
+    void *mappingHandle_;
+#endif // _WIN32
+};
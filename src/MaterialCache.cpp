@@ -0,0 +1,103 @@
+#include "MaterialCache.h"
+
+#ifdef USING_RBFX
+#include <Urho3D/RenderPipeline/ShaderConsts.h>
+#endif // USING_RBFX
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/Graphics/Texture.h>
+
+#include <cstdio> // for std::snprintf()
+#include <functional> // for std::hash
+
+using Urho3D::SharedPtr;
+using Urho3D::Context;
+using Urho3D::Material;
+using Urho3D::Technique;
+using Urho3D::Texture;
+using Urho3D::Color;
+using Urho3D::CullMode;
+#ifdef USING_RBFX
+using Urho3D::ShaderConsts::Material_MatDiffColor;
+#endif
+
+std::size_t MaterialCache::KeyHash::operator()(const Key &key) const
+{
+    std::size_t hash = std::hash<const void*>()(key.technique_);
+    hash = hash * 31 + std::hash<const void*>()(key.texture_);
+    hash = hash * 31 + std::hash<const void*>()(key.normalTexture_);
+    hash = hash * 31 + key.color_;
+    hash = hash * 31 + static_cast<std::size_t>(key.shadowCullMode_);
+    return hash;
+}
+
+MaterialCache::MaterialCache(Context *context) :
+    Urho3D::Object(context),
+    hits_(0),
+    misses_(0)
+{
+}
+
+MaterialCache::~MaterialCache()
+{
+}
+
+MaterialCache * MaterialCache::Get(Context *context)
+{
+    MaterialCache *materialCache = context->GetSubsystem<MaterialCache>();
+    if (!materialCache)
+    {
+        materialCache = new MaterialCache(context);
+        context->RegisterSubsystem(materialCache);
+    }
+    return materialCache;
+}
+
+SharedPtr<Material> MaterialCache::GetMaterial(Technique *technique, const Color &color, CullMode shadowCullMode)
+{
+    return GetMaterial(technique, nullptr, nullptr, color, shadowCullMode);
+}
+
+SharedPtr<Material> MaterialCache::GetMaterial(Technique *technique, Texture *texture, Texture *normalTexture, const Color &color, CullMode shadowCullMode)
+{
+    const Key key{technique, texture, normalTexture, color.ToUInt(), shadowCullMode};
+    SharedPtr<Material> &mat = materials_[key];
+    if (mat)
+    {
+        ++hits_;
+        return mat;
+    }
+    ++misses_;
+
+    // use the quantized color, so the result doesn't depend on which caller came first
+    Color quantizedColor;
+    quantizedColor.FromUInt(key.color_);
+    mat = new Material(context_);
+    mat->SetTechnique(0, technique);
+#ifdef USING_RBFX
+    mat->SetShaderParameter(Material_MatDiffColor, quantizedColor);
+#else // USING_RBFX
+    mat->SetShaderParameter("MatDiffColor", quantizedColor);
+#endif // USING_RBFX
+    if (texture)
+        mat->SetTexture(Urho3D::TU_DIFFUSE, texture);
+    if (normalTexture)
+        mat->SetTexture(Urho3D::TU_NORMAL, normalTexture);
+    mat->SetShadowCullMode(shadowCullMode);
+    return mat;
+}
+
+void MaterialCache::Clear()
+{
+    materials_.clear();
+    hits_ = 0;
+    misses_ = 0;
+}
+
+std::string MaterialCache::GetStatsText() const
+{
+    char text[128];
+    std::snprintf(text, sizeof(text), "%u unique, %u hits, %u misses", GetNumMaterials(), hits_, misses_);
+    return text;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Graphics/GraphicsDefs.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+// Urho3D forward declarations
+namespace Urho3D {
+
+class Color;
+class Material;
+class Technique;
+class Texture;
+
+} // namespace Urho3D
+
+// shares one Material per technique, diffuse and normal texture, color (quantized to 8 bits per
+// channel) and shadow cull mode so identical looking objects can be batched by the renderer;
+// one per Context, registered as a subsystem on first use
+class MaterialCache : public Urho3D::Object
+{
+    URHO3D_OBJECT(MaterialCache, Urho3D::Object);
+public:
+    explicit MaterialCache(Urho3D::Context *context);
+    ~MaterialCache() override;
+
+    static MaterialCache * Get(Urho3D::Context *context);
+
+    // the returned material is shared, so it must not be modified
+    Urho3D::SharedPtr<Urho3D::Material> GetMaterial(Urho3D::Technique *technique, const Urho3D::Color &color, Urho3D::CullMode shadowCullMode);
+    Urho3D::SharedPtr<Urho3D::Material> GetMaterial(Urho3D::Technique *technique, Urho3D::Texture *texture, Urho3D::Texture *normalTexture,
+        const Urho3D::Color &color, Urho3D::CullMode shadowCullMode);
+    void Clear();
+
+    unsigned GetNumMaterials() const {return static_cast<unsigned>(materials_.size());}
+    unsigned GetNumHits() const {return hits_;}
+    unsigned GetNumMisses() const {return misses_;}
+    std::string GetStatsText() const;
+protected:
+    struct Key
+    {
+        Urho3D::Technique *technique_; // kept alive by the cached material
+        Urho3D::Texture *texture_; // same, null for none
+        Urho3D::Texture *normalTexture_; // same
+        unsigned color_; // Color::ToUInt()
+        Urho3D::CullMode shadowCullMode_;
+        bool operator==(const Key &other) const
+        {
+            return technique_ == other.technique_ && texture_ == other.texture_ && normalTexture_ == other.normalTexture_ && color_ == other.color_ && shadowCullMode_ == other.shadowCullMode_;
+        }
+    };
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const;
+    };
+    std::unordered_map<Key, Urho3D::SharedPtr<Urho3D::Material>, KeyHash> materials_;
+    unsigned hits_;
+    unsigned misses_;
+};
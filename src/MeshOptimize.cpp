@@ -0,0 +1,250 @@
+#include "MeshOptimize.h"
+
+#include <algorithm> // for std::stable_sort()
+#include <cstddef>
+
+using Urho3D::Vector3;
+
+static const unsigned NO_VERTEX = 0xffffffff;
+
+// simulates a FIFO cache with one time stamp per vertex: a vertex is cached while
+// fewer than cacheSize others were loaded after it; returns whether v was a miss
+static bool touchVertex(unsigned v, std::vector<unsigned> &cacheTime, unsigned &time, unsigned cacheSize)
+{
+    if (time - cacheTime[v] <= cacheSize)
+        return false;
+    cacheTime[v] = time++;
+    return true;
+}
+
+// forgets everything in the simulated cache
+static void flushCache(unsigned &time, unsigned cacheSize)
+{
+    time += cacheSize + 1;
+}
+
+float MeasureAcmr(const std::vector<unsigned> &indices, unsigned vertexCount, unsigned cacheSize)
+{
+    if (indices.size() < 3)
+        return 0.0f;
+    std::vector<unsigned> cacheTime(vertexCount, 0);
+    unsigned time = cacheSize + 1;
+    unsigned misses = 0;
+    for (const unsigned index : indices)
+        misses += touchVertex(index, cacheTime, time, cacheSize);
+    return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+std::vector<unsigned> OptimizeVertexCache(const std::vector<unsigned> &indices, unsigned vertexCount, std::vector<unsigned> *clusters)
+{
+    if (clusters)
+        clusters->clear();
+
+    // triangles around each vertex, and how many of them are still to be emitted
+    std::vector<unsigned> liveTriangles(vertexCount, 0);
+    for (const unsigned index : indices)
+        ++liveTriangles[index];
+    std::vector<unsigned> triangleOffsets(vertexCount + 1, 0);
+    for (unsigned v = 0; v < vertexCount; ++v)
+        triangleOffsets[v + 1] = triangleOffsets[v] + liveTriangles[v];
+    std::vector<unsigned> vertexTriangles(indices.size());
+    std::vector<unsigned> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); ++i)
+        vertexTriangles[fill[indices[i]]++] = static_cast<unsigned>(i / 3);
+
+    std::vector<unsigned> result;
+    result.reserve(indices.size());
+    std::vector<bool> emitted(indices.size() / 3, false);
+    std::vector<unsigned> cacheTime(vertexCount, 0);
+    unsigned time = VERTEX_CACHE_SIZE + 1;
+    std::vector<unsigned> deadEnds; // recently used vertices, to continue from after a dead end
+    std::vector<unsigned> candidates;
+    unsigned nextScanned = 0; // where to look for unused vertices once deadEnds runs dry
+    unsigned fanVertex = vertexCount ? 0 : NO_VERTEX;
+    bool clusterStart = true;
+    while (fanVertex != NO_VERTEX)
+    {
+        // emit every remaining triangle around the fan vertex
+        candidates.clear();
+        for (unsigned i = triangleOffsets[fanVertex]; i < triangleOffsets[fanVertex + 1]; ++i)
+        {
+            const unsigned triangle = vertexTriangles[i];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+            if (clusterStart && clusters)
+                clusters->push_back(static_cast<unsigned>(result.size() / 3));
+            clusterStart = false;
+            for (unsigned k = 0; k < 3; ++k)
+            {
+                const unsigned v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                touchVertex(v, cacheTime, time, VERTEX_CACHE_SIZE);
+            }
+        }
+
+        // continue with the vertex that entered the cache earliest but will still be in
+        // it after its own triangles are emitted, or with any vertex with triangles left
+        unsigned best = NO_VERTEX;
+        int bestPriority = -1;
+        for (const unsigned v : candidates)
+        {
+            if (!liveTriangles[v])
+                continue;
+            const unsigned age = time - cacheTime[v];
+            const int priority = (age + 2 * liveTriangles[v] <= VERTEX_CACHE_SIZE) ? static_cast<int>(age) : 0;
+            if (priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+        if (best == NO_VERTEX)
+        {
+            // dead end, the next triangles won't share the cache with the previous ones
+            clusterStart = true;
+            while (best == NO_VERTEX && !deadEnds.empty())
+            {
+                if (liveTriangles[deadEnds.back()])
+                    best = deadEnds.back();
+                deadEnds.pop_back();
+            }
+            for (; best == NO_VERTEX && nextScanned < vertexCount; ++nextScanned)
+                if (liveTriangles[nextScanned])
+                    best = nextScanned;
+        }
+        fanVertex = best;
+    }
+    return result;
+}
+
+std::vector<unsigned> OptimizeOverdraw(const std::vector<Vector3> &positions, const std::vector<unsigned> &indices,
+    const std::vector<unsigned> &clusters, float threshold)
+{
+    const unsigned numTriangles = static_cast<unsigned>(indices.size() / 3);
+    if (clusters.empty() || !numTriangles)
+        return indices;
+
+    // split each cluster where the part so far already reaches nearly the cache
+    // efficiency of the whole cluster, starting over with an empty cache each time
+    std::vector<unsigned> starts;
+    std::vector<unsigned> cacheTime(positions.size(), 0);
+    unsigned time = VERTEX_CACHE_SIZE + 1;
+    for (std::size_t c = 0; c < clusters.size(); ++c)
+    {
+        const unsigned start = clusters[c];
+        const unsigned end = (c + 1 < clusters.size()) ? clusters[c + 1] : numTriangles;
+        flushCache(time, VERTEX_CACHE_SIZE);
+        unsigned clusterMisses = 0;
+        for (unsigned i = start * 3; i < end * 3; ++i)
+            clusterMisses += touchVertex(indices[i], cacheTime, time, VERTEX_CACHE_SIZE);
+        const float maxMissesPerTriangle = threshold * clusterMisses / (end - start);
+
+        flushCache(time, VERTEX_CACHE_SIZE);
+        starts.push_back(start);
+        unsigned runStart = start;
+        unsigned runMisses = 0;
+        for (unsigned triangle = start; triangle + 1 < end; ++triangle)
+        {
+            for (unsigned k = 0; k < 3; ++k)
+                runMisses += touchVertex(indices[triangle * 3 + k], cacheTime, time, VERTEX_CACHE_SIZE);
+            if (runMisses <= maxMissesPerTriangle * (triangle + 1 - runStart))
+            {
+                runStart = triangle + 1;
+                runMisses = 0;
+                starts.push_back(runStart);
+                flushCache(time, VERTEX_CACHE_SIZE);
+            }
+        }
+    }
+
+    // area weighted centroid and normal of each cluster
+    struct Cluster
+    {
+        unsigned start_;
+        unsigned end_;
+        Vector3 centroid_;
+        Vector3 normal_;
+        float area_;
+        float sortKey_;
+    };
+    std::vector<Cluster> sorted(starts.size());
+    Vector3 meshCentroid = Vector3::ZERO;
+    float meshArea = 0.0f;
+    for (std::size_t c = 0; c < starts.size(); ++c)
+    {
+        Cluster &cluster = sorted[c];
+        cluster.start_ = starts[c];
+        cluster.end_ = (c + 1 < starts.size()) ? starts[c + 1] : numTriangles;
+        cluster.centroid_ = Vector3::ZERO;
+        cluster.normal_ = Vector3::ZERO;
+        cluster.area_ = 0.0f;
+        for (unsigned triangle = cluster.start_; triangle < cluster.end_; ++triangle)
+        {
+            const Vector3 &p0 = positions[indices[triangle * 3 + 0]];
+            const Vector3 &p1 = positions[indices[triangle * 3 + 1]];
+            const Vector3 &p2 = positions[indices[triangle * 3 + 2]];
+            const Vector3 cross = (p1 - p0).CrossProduct(p2 - p0);
+            const float area = cross.Length() * 0.5f;
+            cluster.centroid_ += (p0 + p1 + p2) * (area / 3.0f);
+            cluster.normal_ += cross;
+            cluster.area_ += area;
+        }
+        meshCentroid += cluster.centroid_;
+        meshArea += cluster.area_;
+        if (cluster.area_ > 0.0f)
+            cluster.centroid_ /= cluster.area_;
+    }
+    if (meshArea <= 0.0f)
+        return indices;
+    meshCentroid /= meshArea;
+
+    // clusters far out along their own normal come first
+    for (Cluster &cluster : sorted)
+        cluster.sortKey_ = (cluster.centroid_ - meshCentroid).DotProduct(cluster.normal_.Normalized());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b)
+    {
+        return a.sortKey_ > b.sortKey_;
+    });
+
+    std::vector<unsigned> result;
+    result.reserve(indices.size());
+    for (const Cluster &cluster : sorted)
+        result.insert(result.end(), indices.begin() + cluster.start_ * 3, indices.begin() + cluster.end_ * 3);
+    return result;
+}
+
+void OptimizeVertexFetch(std::vector<unsigned> &indices, unsigned vertexCount, std::vector<unsigned> &vertexOrder)
+{
+    std::vector<unsigned> remap(vertexCount, NO_VERTEX);
+    vertexOrder.clear();
+    for (unsigned &index : indices)
+    {
+        if (remap[index] == NO_VERTEX)
+        {
+            remap[index] = static_cast<unsigned>(vertexOrder.size());
+            vertexOrder.push_back(index);
+        }
+        index = remap[index];
+    }
+}
+
+MeshOptimizeStats OptimizeMesh(const std::vector<Vector3> &positions, std::vector<unsigned> &indices, std::vector<unsigned> &vertexOrder)
+{
+    const unsigned vertexCount = static_cast<unsigned>(positions.size());
+    MeshOptimizeStats stats;
+    stats.acmrBefore_ = MeasureAcmr(indices, vertexCount);
+    std::vector<unsigned> clusters;
+    std::vector<unsigned> optimized = OptimizeOverdraw(positions, OptimizeVertexCache(indices, vertexCount, &clusters), clusters);
+    stats.acmrAfter_ = MeasureAcmr(optimized, vertexCount);
+    // already well ordered input is left as it is
+    if (stats.acmrAfter_ < stats.acmrBefore_)
+        indices.swap(optimized);
+    else
+        stats.acmrAfter_ = stats.acmrBefore_;
+    OptimizeVertexFetch(indices, vertexCount, vertexOrder);
+    return stats;
+}
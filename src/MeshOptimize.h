@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Urho3D/Math/Vector3.h>
+
+#include <vector>
+
+// post-transform vertex cache size the orderings are tuned for and ACMR is measured with
+static const unsigned VERTEX_CACHE_SIZE = 16;
+
+// ACMR (average cache miss ratio) of a triangle list on a FIFO vertex cache: vertex
+// shader runs per triangle, from 3.0 (no reuse) down to about 0.5 for large grids
+float MeasureAcmr(const std::vector<unsigned> &indices, unsigned vertexCount, unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// reorders the triangles for the post-transform cache with Tipsify (Sander, Nehab and
+// Barczak 2007); clusters receives the first triangle of each run that started after
+// a dead end, which the overdraw pass may reorder without hurting the cache much
+std::vector<unsigned> OptimizeVertexCache(const std::vector<unsigned> &indices, unsigned vertexCount, std::vector<unsigned> *clusters = nullptr);
+
+// reorders those clusters (split further where that keeps the ACMR within threshold
+// of the cluster's) so outward facing ones on the hull of the mesh come first; these
+// tend to hide the rest from every direction, so no view has to be known
+std::vector<unsigned> OptimizeOverdraw(const std::vector<Urho3D::Vector3> &positions, const std::vector<unsigned> &indices,
+    const std::vector<unsigned> &clusters, float threshold = 1.05f);
+
+// renumbers the vertices in the order the triangles first use them, so the vertex
+// fetches walk through memory; vertexOrder receives the old index of each new vertex,
+// unused vertices are dropped
+void OptimizeVertexFetch(std::vector<unsigned> &indices, unsigned vertexCount, std::vector<unsigned> &vertexOrder);
+
+struct MeshOptimizeStats
+{
+    float acmrBefore_ = 0.0f;
+    float acmrAfter_ = 0.0f;
+};
+
+// all three passes in order, the vertex data has to be rearranged by vertexOrder
+MeshOptimizeStats OptimizeMesh(const std::vector<Urho3D::Vector3> &positions, std::vector<unsigned> &indices, std::vector<unsigned> &vertexOrder);
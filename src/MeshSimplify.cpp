@@ -0,0 +1,198 @@
+#include "MeshSimplify.h"
+
+#include <algorithm> // for std::sort(), std::fill()
+#include <cstdint>
+#include <unordered_map>
+
+using Urho3D::Vector3;
+
+// triangles around a collapsed vertex may turn by at most about 75 degrees
+static const float MIN_NORMAL_COS = 0.25f;
+
+namespace {
+
+// symmetric 4x4 matrix of the summed squared distances to a set of planes
+struct Quadric
+{
+    double a2_ = 0, ab_ = 0, ac_ = 0, ad_ = 0, b2_ = 0, bc_ = 0, bd_ = 0, c2_ = 0, cd_ = 0, d2_ = 0;
+
+    void AddPlane(double a, double b, double c, double d, double weight)
+    {
+        a2_ += weight * a * a; ab_ += weight * a * b; ac_ += weight * a * c; ad_ += weight * a * d;
+        b2_ += weight * b * b; bc_ += weight * b * c; bd_ += weight * b * d;
+        c2_ += weight * c * c; cd_ += weight * c * d;
+        d2_ += weight * d * d;
+    }
+    void Add(const Quadric &q)
+    {
+        a2_ += q.a2_; ab_ += q.ab_; ac_ += q.ac_; ad_ += q.ad_;
+        b2_ += q.b2_; bc_ += q.bc_; bd_ += q.bd_;
+        c2_ += q.c2_; cd_ += q.cd_;
+        d2_ += q.d2_;
+    }
+    double Error(const Vector3 &p) const
+    {
+        const double x = p.x_, y = p.y_, z = p.z_;
+        return a2_ * x * x + 2 * ab_ * x * y + 2 * ac_ * x * z + 2 * ad_ * x
+            + b2_ * y * y + 2 * bc_ * y * z + 2 * bd_ * y
+            + c2_ * z * z + 2 * cd_ * z
+            + d2_;
+    }
+};
+
+struct Collapse
+{
+    unsigned from_;
+    unsigned to_;
+    double error_;
+};
+
+} // namespace
+
+static uint64_t edgeKey(unsigned a, unsigned b)
+{
+    return (a < b) ? (static_cast<uint64_t>(a) << 32 | b) : (static_cast<uint64_t>(b) << 32 | a);
+}
+
+// whether moving vertex "from" onto "to" would flip or squash any of the other triangles around it
+static bool collapseFlips(const std::vector<Vector3> &positions, const std::vector<unsigned> &indices,
+    const std::vector<unsigned> &triangleOffsets, const std::vector<unsigned> &vertexTriangles, unsigned from, unsigned to)
+{
+    for (unsigned i = triangleOffsets[from]; i < triangleOffsets[from + 1]; ++i)
+    {
+        const unsigned *triangle = &indices[vertexTriangles[i] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            continue; // collapses away
+        Vector3 before[3];
+        Vector3 after[3];
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            before[j] = positions[triangle[j]];
+            after[j] = (triangle[j] == from) ? positions[to] : before[j];
+        }
+        const Vector3 normalBefore = (before[1] - before[0]).CrossProduct(before[2] - before[0]);
+        const Vector3 normalAfter = (after[1] - after[0]).CrossProduct(after[2] - after[0]);
+        if (normalBefore.DotProduct(normalAfter) <= MIN_NORMAL_COS * normalBefore.Length() * normalAfter.Length())
+            return true;
+    }
+    return false;
+}
+
+std::vector<unsigned> SimplifyMesh(const std::vector<Vector3> &positions, const std::vector<unsigned> &indices, std::size_t targetIndexCount)
+{
+    const unsigned numVertices = static_cast<unsigned>(positions.size());
+    std::vector<unsigned> result = indices;
+
+    // each vertex starts with the planes of its triangles, weighted by area
+    std::vector<Quadric> quadrics(numVertices);
+    std::unordered_map<uint64_t, unsigned> edgeUses;
+    for (std::size_t i = 0; i + 2 < result.size(); i += 3)
+    {
+        const Vector3 &p0 = positions[result[i]];
+        Vector3 normal = (positions[result[i + 1]] - p0).CrossProduct(positions[result[i + 2]] - p0);
+        const float doubleArea = normal.Length();
+        if (doubleArea > 0.0f)
+        {
+            normal /= doubleArea;
+            const double d = -normal.DotProduct(p0);
+            for (unsigned j = 0; j < 3; ++j)
+                quadrics[result[i + j]].AddPlane(normal.x_, normal.y_, normal.z_, d, doubleArea * 0.5);
+        }
+        for (unsigned j = 0; j < 3; ++j)
+            ++edgeUses[edgeKey(result[i + j], result[i + (j + 1) % 3])];
+    }
+    std::vector<bool> locked(numVertices, false);
+    for (const auto &edge : edgeUses)
+    {
+        if (edge.second == 1)
+        {
+            locked[static_cast<unsigned>(edge.first >> 32)] = true;
+            locked[static_cast<unsigned>(edge.first & 0xffffffff)] = true;
+        }
+    }
+
+    // a pass collapses the cheapest edges that don't share a neighborhood with
+    // an earlier collapse of the same pass, then the index buffer is rebuilt
+    std::vector<unsigned> triangleOffsets;
+    std::vector<unsigned> vertexTriangles;
+    std::vector<Collapse> collapses;
+    std::vector<unsigned> remap(numVertices);
+    std::vector<bool> touched(numVertices);
+    while (result.size() > targetIndexCount)
+    {
+        const unsigned numTriangles = static_cast<unsigned>(result.size() / 3);
+        triangleOffsets.assign(numVertices + 1, 0);
+        for (const unsigned index : result)
+            ++triangleOffsets[index + 1];
+        for (unsigned i = 0; i < numVertices; ++i)
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        vertexTriangles.resize(result.size());
+        std::vector<unsigned> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (unsigned t = 0; t < numTriangles; ++t)
+            for (unsigned j = 0; j < 3; ++j)
+                vertexTriangles[fill[result[t * 3 + j]]++] = t;
+
+        // every interior edge shows up in two triangles with opposite winding, take it once
+        collapses.clear();
+        for (unsigned t = 0; t < numTriangles; ++t)
+        {
+            for (unsigned j = 0; j < 3; ++j)
+            {
+                const unsigned a = result[t * 3 + j];
+                const unsigned b = result[t * 3 + (j + 1) % 3];
+                if (a >= b)
+                    continue;
+                Quadric q = quadrics[a];
+                q.Add(quadrics[b]);
+                if (!locked[a])
+                    collapses.push_back(Collapse{a, b, q.Error(positions[b])});
+                if (!locked[b])
+                    collapses.push_back(Collapse{b, a, q.Error(positions[a])});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) {return x.error_ < y.error_;});
+
+        for (unsigned i = 0; i < numVertices; ++i)
+            remap[i] = i;
+        std::fill(touched.begin(), touched.end(), false);
+        const std::size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        std::size_t removed = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (touched[collapse.from_] || touched[collapse.to_])
+                continue;
+            if (collapseFlips(positions, result, triangleOffsets, vertexTriangles, collapse.from_, collapse.to_))
+                continue;
+            remap[collapse.from_] = collapse.to_;
+            quadrics[collapse.to_].Add(quadrics[collapse.from_]);
+            // the whole neighborhood changes shape, so leave it alone for the rest of this pass
+            for (unsigned i = triangleOffsets[collapse.from_]; i < triangleOffsets[collapse.from_ + 1]; ++i)
+            {
+                const unsigned *triangle = &result[vertexTriangles[i] * 3];
+                for (unsigned j = 0; j < 3; ++j)
+                    touched[triangle[j]] = true;
+                if (triangle[0] == collapse.to_ || triangle[1] == collapse.to_ || triangle[2] == collapse.to_)
+                    ++removed;
+            }
+            if (removed >= trianglesToRemove)
+                break;
+        }
+        if (!removed)
+            break;
+
+        std::size_t numIndices = 0;
+        for (std::size_t i = 0; i + 2 < result.size(); i += 3)
+        {
+            const unsigned a = remap[result[i]];
+            const unsigned b = remap[result[i + 1]];
+            const unsigned c = remap[result[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            result[numIndices++] = a;
+            result[numIndices++] = b;
+            result[numIndices++] = c;
+        }
+        result.resize(numIndices);
+    }
+    return result;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Urho3D/Math/Vector3.h>
+
+#include <cstddef>
+#include <vector>
+
+// quadric error metric edge collapse for triangle lists; vertices only ever collapse
+// onto other existing vertices, so the result indexes the same vertex data and every
+// attribute (normals, UVs, tangents) is kept exactly; edges used by only one triangle
+// never move, which keeps open borders as well as UV and normal seams (whose vertices
+// are split) intact; returns targetIndexCount indices or fewer, or more if the mesh
+// can't be simplified that far without folding triangles over
+std::vector<unsigned> SimplifyMesh(const std::vector<Urho3D::Vector3> &positions, const std::vector<unsigned> &indices, std::size_t targetIndexCount);
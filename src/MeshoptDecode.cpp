@@ -0,0 +1,460 @@
+#include "MeshoptDecode.h"
+
+#include <algorithm> // for std::min(), std::max()
+#include <cmath> // for std::abs(), std::sqrt()
+#include <cstdint>
+#include <cstring> // for std::memcpy(), std::memset()
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHOPT_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+
+// the high nibble of the first byte, the low one is the format version (only 0 so far
+// for the vertices, 0 and 1 for the indices)
+static const unsigned char VERTEX_HEADER = 0xa0;
+static const unsigned char TRIANGLES_HEADER = 0xe0;
+static const unsigned char INDICES_HEADER = 0xd0;
+
+// the elements are encoded in blocks of at most 8 KiB and 256 elements, each block as
+// one stream per byte of the element, which holds the deltas to the previous element
+// in groups of 16
+static const std::size_t VERTEX_BLOCK_SIZE = 8192;
+static const std::size_t VERTEX_BLOCK_MAX_ELEMENTS = 256;
+static const std::size_t BYTE_GROUP_SIZE = 16;
+// a group takes at most this many bytes, so checking for it once per group makes every
+// read inside safe; the tail after the last block always leaves that much
+static const std::size_t BYTE_GROUP_DECODE_LIMIT = 24;
+static const std::size_t VERTEX_TAIL_MIN_SIZE = 32;
+
+// unpacks 16 values of 0, 2, 4 or 8 bits each; in the 2 and 4-bit encodings a value of
+// all ones escapes to a full byte, stored after the packed values in the same order
+static const unsigned char * decodeBytesGroup(const unsigned char *data, unsigned char *dest, unsigned bitsLog2)
+{
+    if (bitsLog2 == 0)
+    {
+        std::memset(dest, 0, BYTE_GROUP_SIZE);
+        return data;
+    }
+    if (bitsLog2 == 3)
+    {
+        std::memcpy(dest, data, BYTE_GROUP_SIZE);
+        return data + BYTE_GROUP_SIZE;
+    }
+    const unsigned bits = 1u << bitsLog2;
+    const unsigned escape = (1u << bits) - 1;
+    const unsigned char *extra = data + BYTE_GROUP_SIZE * bits / 8;
+
+#ifdef MESHOPT_DECODE_SSE2
+    // every packed byte is repeated once per value it holds, each copy masked to its own
+    // bits and shifted down; the masked bits never cross into the neighbouring byte
+    __m128i values;
+    if (bits == 2)
+    {
+        uint32_t packed;
+        std::memcpy(&packed, data, sizeof(packed));
+        __m128i x = _mm_cvtsi32_si128(static_cast<int>(packed));
+        x = _mm_unpacklo_epi8(x, x);
+        x = _mm_unpacklo_epi16(x, x);
+        values = _mm_or_si128(
+            _mm_or_si128(_mm_srli_epi16(_mm_and_si128(x, _mm_set1_epi32(0x000000c0)), 6), _mm_srli_epi16(_mm_and_si128(x, _mm_set1_epi32(0x00003000)), 4)),
+            _mm_or_si128(_mm_srli_epi16(_mm_and_si128(x, _mm_set1_epi32(0x000c0000)), 2), _mm_and_si128(x, _mm_set1_epi32(0x03000000))));
+    }
+    else
+    {
+        __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+        x = _mm_unpacklo_epi8(x, x);
+        values = _mm_or_si128(_mm_srli_epi16(_mm_and_si128(x, _mm_set1_epi16(0x00f0)), 4), _mm_and_si128(x, _mm_set1_epi16(0x0f00)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), values);
+    const unsigned escapes = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(values, _mm_set1_epi8(static_cast<char>(escape)))));
+    for (unsigned i = 0; escapes >> i; ++i)
+        if (escapes & (1u << i))
+            dest[i] = *extra++;
+#else // scalar
+    for (std::size_t i = 0; i < BYTE_GROUP_SIZE; ++i)
+    {
+        // the first value is in the high bits
+        const unsigned shift = 8 - bits - (i * bits) % 8;
+        const unsigned value = (data[i * bits / 8] >> shift) & escape;
+        dest[i] = (value == escape) ? *extra++ : static_cast<unsigned char>(value);
+    }
+#endif // MESHOPT_DECODE_SSE2
+    return extra;
+}
+
+// one byte stream of a block: 2 bits per group telling its encoding, then the groups
+static const unsigned char * decodeBytes(const unsigned char *data, const unsigned char *end, unsigned char *dest, std::size_t size)
+{
+    const std::size_t numGroups = size / BYTE_GROUP_SIZE;
+    const std::size_t headerSize = (numGroups + 3) / 4;
+    if (static_cast<std::size_t>(end - data) < headerSize)
+        return nullptr;
+    const unsigned char * const header = data;
+    data += headerSize;
+    for (std::size_t i = 0; i < numGroups; ++i)
+    {
+        if (static_cast<std::size_t>(end - data) < BYTE_GROUP_DECODE_LIMIT)
+            return nullptr;
+        const unsigned bitsLog2 = (header[i / 4] >> ((i % 4) * 2)) & 3;
+        data = decodeBytesGroup(data, dest + i * BYTE_GROUP_SIZE, bitsLog2);
+    }
+    return data;
+}
+
+// turns the zigzag encoded deltas of one byte of the elements back into that byte,
+// starting from its value in the previous element
+static void undoDeltas(const unsigned char *deltas, std::size_t count, unsigned char previous, unsigned char *dest, std::size_t stride)
+{
+#ifdef MESHOPT_DECODE_SSE2
+    // 16 elements at a time: unzigzag, then a prefix sum in four shifted adds; deltas
+    // is padded to whole groups, so the loads stay inside it
+    __m128i last = _mm_set1_epi8(static_cast<char>(previous));
+    for (std::size_t i = 0; i < count; i += BYTE_GROUP_SIZE)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(deltas + i));
+        const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+        v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f)), sign);
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi8(v, last);
+        unsigned char values[BYTE_GROUP_SIZE];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values), v);
+        const std::size_t n = std::min(BYTE_GROUP_SIZE, count - i);
+        for (std::size_t j = 0; j < n; ++j)
+            dest[(i + j) * stride] = values[j];
+        last = _mm_set1_epi8(static_cast<char>(values[BYTE_GROUP_SIZE - 1]));
+    }
+#else // scalar
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const unsigned delta = deltas[i];
+        previous = static_cast<unsigned char>(previous + ((delta >> 1) ^ (0u - (delta & 1))));
+        dest[i * stride] = previous;
+    }
+#endif // MESHOPT_DECODE_SSE2
+}
+
+static const unsigned char * decodeVertexBlock(const unsigned char *data, const unsigned char *end, unsigned char *dest,
+    std::size_t count, std::size_t stride, unsigned char *lastVertex)
+{
+    unsigned char deltas[VERTEX_BLOCK_MAX_ELEMENTS];
+    const std::size_t alignedCount = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+    for (std::size_t k = 0; k < stride; ++k)
+    {
+        data = decodeBytes(data, end, deltas, alignedCount);
+        if (!data)
+            return nullptr;
+        undoDeltas(deltas, count, lastVertex[k], dest + k, stride);
+    }
+    std::memcpy(lastVertex, dest + (count - 1) * stride, stride);
+    return data;
+}
+
+bool DecodeMeshoptVertices(unsigned char *dest, std::size_t count, std::size_t stride, const unsigned char *src, std::size_t size)
+{
+    if (!stride || stride > 256 || stride % 4 || size < 1 + stride || src[0] != VERTEX_HEADER)
+        return false;
+    const unsigned char *data = src + 1;
+    const unsigned char * const end = src + size;
+    // the deltas of the first block are relative to the tail, which ends with the first element
+    unsigned char lastVertex[256];
+    std::memcpy(lastVertex, end - stride, stride);
+
+    const std::size_t blockSize = std::min((VERTEX_BLOCK_SIZE / stride) & ~(BYTE_GROUP_SIZE - 1), VERTEX_BLOCK_MAX_ELEMENTS);
+    for (std::size_t first = 0; first < count; first += blockSize)
+    {
+        data = decodeVertexBlock(data, end, dest + first * stride, std::min(blockSize, count - first), stride, lastVertex);
+        if (!data)
+            return false;
+    }
+    return static_cast<std::size_t>(end - data) == std::max(stride, VERTEX_TAIL_MIN_SIZE);
+}
+
+static void writeIndex(unsigned char *dest, std::size_t i, std::size_t indexSize, unsigned value)
+{
+    if (indexSize == 2)
+    {
+        const uint16_t index = static_cast<uint16_t>(value);
+        std::memcpy(dest + i * 2, &index, 2);
+    }
+    else
+    {
+        const uint32_t index = value;
+        std::memcpy(dest + i * 4, &index, 4);
+    }
+}
+
+// 7 bits per byte, low ones first, the high bit set on all but the last byte
+static unsigned decodeVByte(const unsigned char *&data)
+{
+    const unsigned char lead = *data++;
+    if (lead < 128)
+        return lead;
+    unsigned result = lead & 127;
+    unsigned shift = 7;
+    for (int i = 0; i < 4; ++i)
+    {
+        const unsigned char group = *data++;
+        result |= static_cast<unsigned>(group & 127) << shift;
+        shift += 7;
+        if (group < 128)
+            break;
+    }
+    return result;
+}
+
+static unsigned decodeIndex(const unsigned char *&data, unsigned last)
+{
+    const unsigned v = decodeVByte(data);
+    return last + ((v >> 1) ^ (0u - (v & 1)));
+}
+
+// the triangle codec refers back to recent vertices and edges through two FIFOs of 16
+struct IndexFifos
+{
+    unsigned vertices_[16];
+    unsigned edges_[16][2];
+    std::size_t vertexOffset_ = 0;
+    std::size_t edgeOffset_ = 0;
+
+    IndexFifos()
+    {
+        std::memset(vertices_, 0xff, sizeof(vertices_));
+        std::memset(edges_, 0xff, sizeof(edges_));
+    }
+    void PushVertex(unsigned v, bool advance = true)
+    {
+        vertices_[vertexOffset_] = v;
+        vertexOffset_ = (vertexOffset_ + (advance ? 1 : 0)) & 15;
+    }
+    void PushEdge(unsigned a, unsigned b)
+    {
+        edges_[edgeOffset_][0] = a;
+        edges_[edgeOffset_][1] = b;
+        edgeOffset_ = (edgeOffset_ + 1) & 15;
+    }
+};
+
+bool DecodeMeshoptTriangles(unsigned char *dest, std::size_t count, std::size_t indexSize, const unsigned char *src, std::size_t size)
+{
+    // at least the header, a code byte per triangle and the 16 byte table at the end
+    if (count % 3 || (indexSize != 2 && indexSize != 4) || size < 1 + count / 3 + 16 || (src[0] & 0xf0) != TRIANGLES_HEADER)
+        return false;
+    const int version = src[0] & 0x0f;
+    if (version > 1)
+        return false;
+
+    IndexFifos fifos;
+    unsigned next = 0;
+    unsigned last = 0;
+    // version 1 uses the edge codes 13 and 14 for last -1 and +1
+    const int fecMax = version >= 1 ? 13 : 15;
+    const unsigned char *code = src + 1;
+    const unsigned char *data = code + count / 3;
+    // a triangle reads at most 16 bytes, which the table guarantees as long as it starts before it
+    const unsigned char * const dataSafeEnd = src + size - 16;
+    const unsigned char * const codeAuxTable = dataSafeEnd;
+
+    for (std::size_t i = 0; i < count; i += 3)
+    {
+        if (data > dataSafeEnd)
+            return false;
+        const unsigned char codeTri = *code++;
+        if (codeTri < 0xf0)
+        {
+            // an edge from the FIFO and a third vertex: the next new one, one from the
+            // vertex FIFO or a delta encoded free index
+            const int fe = codeTri >> 4;
+            const unsigned a = fifos.edges_[(fifos.edgeOffset_ - 1 - fe) & 15][0];
+            const unsigned b = fifos.edges_[(fifos.edgeOffset_ - 1 - fe) & 15][1];
+            const int fec = codeTri & 15;
+            unsigned c;
+            bool advance = true;
+            if (fec < fecMax)
+            {
+                c = (fec == 0) ? next : fifos.vertices_[(fifos.vertexOffset_ - 1 - fec) & 15];
+                advance = fec == 0;
+                next += advance ? 1 : 0;
+            }
+            else
+                last = c = (fec != 15) ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+            writeIndex(dest, i, indexSize, a);
+            writeIndex(dest, i + 1, indexSize, b);
+            writeIndex(dest, i + 2, indexSize, c);
+            fifos.PushVertex(c, advance);
+            fifos.PushEdge(c, b);
+            fifos.PushEdge(a, c);
+        }
+        else
+        {
+            // three vertices not from an edge, their codes in the table or the next byte
+            int fea;
+            int feb;
+            int fec;
+            if (codeTri < 0xfe)
+            {
+                const unsigned char codeAux = codeAuxTable[codeTri & 15];
+                fea = 0;
+                feb = codeAux >> 4;
+                fec = codeAux & 15;
+            }
+            else
+            {
+                const unsigned char codeAux = *data++;
+                // a zero byte (rather than a table entry) restarts the new vertices
+                if (codeAux == 0)
+                    next = 0;
+                fea = (codeTri == 0xfe) ? 0 : 15;
+                feb = codeAux >> 4;
+                fec = codeAux & 15;
+            }
+            // all three are read from the FIFO before any is pushed, like the encoder does
+            unsigned a = (fea == 0) ? next++ : 0;
+            unsigned b = (feb == 0) ? next++ : fifos.vertices_[(fifos.vertexOffset_ - feb) & 15];
+            unsigned c = (fec == 0) ? next++ : fifos.vertices_[(fifos.vertexOffset_ - fec) & 15];
+            if (fea == 15)
+                last = a = decodeIndex(data, last);
+            if (feb == 15)
+                last = b = decodeIndex(data, last);
+            if (fec == 15)
+                last = c = decodeIndex(data, last);
+            writeIndex(dest, i, indexSize, a);
+            writeIndex(dest, i + 1, indexSize, b);
+            writeIndex(dest, i + 2, indexSize, c);
+            fifos.PushVertex(a);
+            fifos.PushVertex(b, feb == 0 || feb == 15);
+            fifos.PushVertex(c, fec == 0 || fec == 15);
+            fifos.PushEdge(b, a);
+            fifos.PushEdge(c, b);
+            fifos.PushEdge(a, c);
+        }
+    }
+    // all the data has to be used up, right up to the table
+    return data == dataSafeEnd;
+}
+
+bool DecodeMeshoptIndices(unsigned char *dest, std::size_t count, std::size_t indexSize, const unsigned char *src, std::size_t size)
+{
+    // at least the header, a byte per index and a 4 byte tail
+    if ((indexSize != 2 && indexSize != 4) || size < 1 + count + 4 || (src[0] & 0xf0) != INDICES_HEADER || (src[0] & 0x0f) > 1)
+        return false;
+    const unsigned char *data = src + 1;
+    // an index reads at most 5 bytes, which the tail guarantees
+    const unsigned char * const dataSafeEnd = src + size - 4;
+    // every index is a zigzag delta to one of two baselines, picked by its lowest bit
+    unsigned last[2] = {0, 0};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (data >= dataSafeEnd)
+            return false;
+        unsigned v = decodeVByte(data);
+        const unsigned baseline = v & 1;
+        v >>= 1;
+        last[baseline] += (v >> 1) ^ (0u - (v & 1));
+        writeIndex(dest, i, indexSize, last[baseline]);
+    }
+    return data == dataSafeEnd;
+}
+
+static int roundToInt(float value)
+{
+    return static_cast<int>(value + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// x and y of the octahedral projection, z holding the scale of 1; the fourth component
+// is left as it is (e.g. the sign of a tangent)
+template <typename T>
+static void unfilterOctahedral(unsigned char *data, std::size_t count)
+{
+    const float maxValue = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        T v[4];
+        std::memcpy(v, data + i * sizeof(v), sizeof(v));
+        float x = v[0];
+        float y = v[1];
+        const float z = v[2] - std::abs(x) - std::abs(y);
+        // fold the lower hemisphere back
+        const float t = std::min(z, 0.0f);
+        x += (x >= 0.0f) ? t : -t;
+        y += (y >= 0.0f) ? t : -t;
+        const float scale = maxValue / std::sqrt(x * x + y * y + z * z);
+        v[0] = static_cast<T>(roundToInt(x * scale));
+        v[1] = static_cast<T>(roundToInt(y * scale));
+        v[2] = static_cast<T>(roundToInt(z * scale));
+        std::memcpy(data + i * sizeof(v), v, sizeof(v));
+    }
+}
+
+// the three smallest components scaled by the number in the upper bits of the fourth,
+// whose 2 low bits are the index of the largest one
+static void unfilterQuaternion(unsigned char *data, std::size_t count)
+{
+    const float range = 1.0f / std::sqrt(2.0f);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int16_t v[4];
+        std::memcpy(v, data + i * sizeof(v), sizeof(v));
+        const float scale = range / static_cast<float>(v[3] | 3);
+        const float x = v[0] * scale;
+        const float y = v[1] * scale;
+        const float z = v[2] * scale;
+        const float w = std::sqrt(std::max(1.0f - x * x - y * y - z * z, 0.0f));
+        const int largest = v[3] & 3;
+        int16_t result[4];
+        result[(largest + 1) & 3] = static_cast<int16_t>(roundToInt(x * 32767.0f));
+        result[(largest + 2) & 3] = static_cast<int16_t>(roundToInt(y * 32767.0f));
+        result[(largest + 3) & 3] = static_cast<int16_t>(roundToInt(z * 32767.0f));
+        result[largest] = static_cast<int16_t>(roundToInt(w * 32767.0f));
+        std::memcpy(data + i * sizeof(result), result, sizeof(result));
+    }
+}
+
+// a signed 24-bit mantissa and an 8-bit exponent per float
+static void unfilterExponential(unsigned char *data, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        uint32_t v;
+        std::memcpy(&v, data + i * 4, 4);
+        const int mantissa = static_cast<int32_t>(v << 8) >> 8;
+        const int exponent = static_cast<int32_t>(v) >> 24;
+        // 2^exponent built from its bits, which is ldexp() without the call
+        const uint32_t powerBits = static_cast<uint32_t>(exponent + 127) << 23;
+        float power;
+        std::memcpy(&power, &powerBits, 4);
+        const float value = power * static_cast<float>(mantissa);
+        std::memcpy(data + i * 4, &value, 4);
+    }
+}
+
+bool UnfilterMeshopt(MeshoptFilter filter, unsigned char *data, std::size_t count, std::size_t stride)
+{
+    switch (filter)
+    {
+    case MESHOPT_FILTER_NONE:
+        return true;
+    case MESHOPT_FILTER_OCTAHEDRAL:
+        if (stride == 4)
+            unfilterOctahedral<int8_t>(data, count);
+        else if (stride == 8)
+            unfilterOctahedral<int16_t>(data, count);
+        else
+            return false;
+        return true;
+    case MESHOPT_FILTER_QUATERNION:
+        if (stride != 8)
+            return false;
+        unfilterQuaternion(data, count);
+        return true;
+    case MESHOPT_FILTER_EXPONENTIAL:
+        if (stride % 4)
+            return false;
+        unfilterExponential(data, count * stride / 4);
+        return true;
+    }
+    return false;
+}
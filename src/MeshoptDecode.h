@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// decoders for the buffer views of glTF files compressed with EXT_meshopt_compression (the
+// formats are described in the extension's spec); they return false on malformed data,
+// which may leave dest partly written, and never read outside of src
+
+// "ATTRIBUTES" mode: count elements of stride bytes each (a multiple of 4, at most 256);
+// the byte groups are unpacked with SSE2 where available
+bool DecodeMeshoptVertices(unsigned char *dest, std::size_t count, std::size_t stride, const unsigned char *src, std::size_t size);
+// "TRIANGLES" mode: count indices (a multiple of 3) of indexSize bytes each, 2 or 4
+bool DecodeMeshoptTriangles(unsigned char *dest, std::size_t count, std::size_t indexSize, const unsigned char *src, std::size_t size);
+// "INDICES" mode: count indices of indexSize bytes each, in any order
+bool DecodeMeshoptIndices(unsigned char *dest, std::size_t count, std::size_t indexSize, const unsigned char *src, std::size_t size);
+
+enum MeshoptFilter
+{
+    MESHOPT_FILTER_NONE,
+    MESHOPT_FILTER_OCTAHEDRAL, // unit vectors as 2 of 4 signed 8 or 16-bit components
+    MESHOPT_FILTER_QUATERNION, // rotations as 3 of 4 signed 16-bit components
+    MESHOPT_FILTER_EXPONENTIAL // floats as a shared exponent and 24-bit mantissas
+};
+
+// undoes the filter of decoded "ATTRIBUTES" data in place, false when the stride
+// doesn't fit the filter
+bool UnfilterMeshopt(MeshoptFilter filter, unsigned char *data, std::size_t count, std::size_t stride);
@@ -0,0 +1,308 @@
+#include "NodeLabels.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Geometry.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/Math/Frustum.h>
+#include <Urho3D/Math/Sphere.h>
+#include <Urho3D/Scene/Node.h>
+#include <Urho3D/UI/Font.h>
+#include <Urho3D/UI/FontFace.h>
+
+#include <algorithm> // for std::max(), std::min(), std::remove_if()
+#include <cmath> // for std::sqrt()
+#include <cstring>
+
+using Urho3D::Camera;
+using Urho3D::Color;
+using Urho3D::Context;
+using Urho3D::Font;
+using Urho3D::FontFace;
+using Urho3D::FontGlyph;
+using Urho3D::FrameInfo;
+using Urho3D::Geometry;
+using Urho3D::Material;
+using Urho3D::Matrix3x4;
+using Urho3D::Node;
+using Urho3D::Pass;
+using Urho3D::Quaternion;
+using Urho3D::SharedPtr;
+using Urho3D::SourceBatch;
+using Urho3D::Sphere;
+using Urho3D::Technique;
+using Urho3D::Texture;
+using Urho3D::UpdateGeometryType;
+using Urho3D::Vector3;
+using Urho3D::VertexBuffer;
+
+// what the Text shaders expect: position, color and texture coordinates
+#ifdef USING_RBFX
+static const Urho3D::VertexMaskFlags LABEL_VERTEX_MASK = Urho3D::MASK_POSITION | Urho3D::MASK_COLOR | Urho3D::MASK_TEXCOORD1;
+#else // U3D
+static const unsigned LABEL_VERTEX_MASK = Urho3D::MASK_POSITION | Urho3D::MASK_COLOR | Urho3D::MASK_TEXCOORD1;
+#endif // USING_RBFX
+static const unsigned LABEL_VERTEX_SIZE = 3 * sizeof(float) + sizeof(unsigned) + 2 * sizeof(float);
+
+// next code point of a UTF-8 string, invalid sequences come out byte by byte
+static unsigned decodeUtf8(const std::string &text, std::size_t &pos)
+{
+    const unsigned char lead = static_cast<unsigned char>(text[pos++]);
+    const unsigned numContinuation = (lead >= 0xf0) ? 3 : (lead >= 0xe0) ? 2 : (lead >= 0xc0) ? 1 : 0;
+    if (pos + numContinuation > text.size())
+        return lead;
+    unsigned codePoint = lead & (0x3f >> numContinuation);
+    for (unsigned i = 0; i < numContinuation; ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(text[pos + i]);
+        if ((c & 0xc0) != 0x80)
+            return lead;
+        codePoint = (codePoint << 6) | (c & 0x3f);
+    }
+    pos += numContinuation;
+    return codePoint;
+}
+
+static void writeLabelVertex(unsigned char *&dest, const Vector3 &position, unsigned color, float u, float v)
+{
+    const float values[3] = {position.x_, position.y_, position.z_};
+    std::memcpy(dest, values, sizeof(values));
+    std::memcpy(dest + sizeof(values), &color, sizeof(color));
+    const float uv[2] = {u, v};
+    std::memcpy(dest + sizeof(values) + sizeof(color), uv, sizeof(uv));
+    dest += LABEL_VERTEX_SIZE;
+}
+
+NodeLabels::NodeLabels(Context *context) :
+    Drawable(context, Urho3D::DRAWABLE_GEOMETRY),
+    fontSize_(24.0f),
+    maxDistance_(100.0f),
+    numVisibleLabels_(0)
+{
+}
+
+NodeLabels::~NodeLabels() = default;
+
+void NodeLabels::SetFont(Font *font, float fontSize)
+{
+    RemoveAllLabels();
+    font_ = font;
+    fontSize_ = fontSize;
+    if (!font_)
+        return;
+
+    // same setup as Text3D's default material
+    technique_ = new Technique(context_);
+    Pass * const pass = technique_->CreatePass("alpha");
+    pass->SetVertexShader("Text");
+    pass->SetPixelShader("Text");
+    pass->SetPixelShaderDefines(font_->IsSDFFont() ? "SIGNED_DISTANCE_FIELD" : "ALPHAMAP");
+    pass->SetBlendMode(Urho3D::BLEND_ALPHA);
+    pass->SetDepthWrite(false);
+}
+
+void NodeLabels::AddPage(Texture *texture)
+{
+    Page page;
+    page.vertexBuffer_ = new VertexBuffer(context_);
+    page.geometry_ = new Geometry(context_);
+    page.geometry_->SetVertexBuffer(0, page.vertexBuffer_);
+    page.material_ = new Material(context_);
+    page.material_->SetTechnique(0, technique_);
+    page.material_->SetCullMode(Urho3D::CULL_NONE);
+    page.material_->SetTexture(Urho3D::TU_DIFFUSE, texture);
+    pages_.push_back(page);
+
+#ifdef USING_RBFX
+    batches_.resize(pages_.size());
+#else // U3D
+    batches_.Resize(pages_.size());
+#endif // USING_RBFX
+    SourceBatch &batch = batches_[pages_.size() - 1];
+    batch.geometry_ = page.geometry_;
+    batch.material_ = page.material_;
+    batch.worldTransform_ = &Matrix3x4::IDENTITY; // the quads are built in world space
+}
+
+void NodeLabels::AddLabel(Node *node, const std::string &text, const Vector3 &offset, const Color &color)
+{
+    FontFace * const face = font_ ? font_->GetFace(fontSize_) : nullptr;
+    if (!node || !face)
+        return;
+
+    Label label;
+    label.node_ = node;
+    label.offset_ = offset;
+    label.color_ = color.ToUInt();
+    label.firstGlyph_ = static_cast<unsigned>(glyphs_.size());
+
+    // lay out one line of glyphs in pixels, then center it on the anchor
+    float x = 0.0f;
+    unsigned previous = 0;
+    for (std::size_t pos = 0; pos < text.size();)
+    {
+        const unsigned c = decodeUtf8(text, pos);
+        const FontGlyph * const fontGlyph = face->GetGlyph(c);
+        if (!fontGlyph)
+            continue;
+        if (previous)
+            x += static_cast<float>(face->GetKerning(previous, c));
+        previous = c;
+        if (fontGlyph->width_ > 0 && fontGlyph->height_ > 0)
+        {
+            Texture * const texture = face->GetTextures()[fontGlyph->page_];
+            while (pages_.size() <= fontGlyph->page_)
+                AddPage(face->GetTextures()[pages_.size()]);
+            const float invWidth = 1.0f / texture->GetWidth();
+            const float invHeight = 1.0f / texture->GetHeight();
+            Glyph glyph;
+            glyph.left_ = x + fontGlyph->offsetX_;
+            glyph.right_ = glyph.left_ + fontGlyph->width_;
+            glyph.top_ = -static_cast<float>(fontGlyph->offsetY_);
+            glyph.bottom_ = glyph.top_ - fontGlyph->height_;
+            glyph.u0_ = fontGlyph->x_ * invWidth;
+            glyph.v0_ = fontGlyph->y_ * invHeight;
+            glyph.u1_ = (fontGlyph->x_ + fontGlyph->texWidth_) * invWidth;
+            glyph.v1_ = (fontGlyph->y_ + fontGlyph->texHeight_) * invHeight;
+            glyph.page_ = fontGlyph->page_;
+            glyphs_.push_back(glyph);
+        }
+        x += fontGlyph->advanceX_;
+    }
+    label.numGlyphs_ = static_cast<unsigned>(glyphs_.size()) - label.firstGlyph_;
+    if (!label.numGlyphs_)
+        return;
+
+    const float halfWidth = x * 0.5f;
+    const float halfHeight = static_cast<float>(face->GetRowHeight()) * 0.5f;
+    for (unsigned i = label.firstGlyph_; i < glyphs_.size(); ++i)
+    {
+        Glyph &glyph = glyphs_[i];
+        glyph.left_ -= halfWidth;
+        glyph.right_ -= halfWidth;
+        glyph.top_ += halfHeight;
+        glyph.bottom_ += halfHeight;
+    }
+    label.radius_ = std::sqrt(halfWidth * halfWidth + halfHeight * halfHeight);
+    labels_.push_back(label);
+}
+
+void NodeLabels::RemoveAllLabels()
+{
+    labels_.clear();
+    glyphs_.clear();
+    for (Page &page : pages_)
+        page.vertexData_.clear();
+}
+
+void NodeLabels::UpdateBatches(const FrameInfo &frame)
+{
+    // sorted as a single transparent object
+    distance_ = frame.camera_->GetDistance(node_->GetWorldPosition());
+    for (SourceBatch &batch : batches_)
+    {
+        batch.distance_ = distance_;
+        batch.worldTransform_ = &Matrix3x4::IDENTITY;
+    }
+}
+
+void NodeLabels::UpdateGeometry(const FrameInfo &frame)
+{
+    Camera * const camera = frame.camera_;
+    if (!camera || !camera->GetNode())
+        return;
+    const Vector3 cameraPosition = camera->GetNode()->GetWorldPosition();
+    const Quaternion cameraRotation = camera->GetNode()->GetWorldRotation();
+    const Vector3 right = cameraRotation * Vector3::RIGHT;
+    const Vector3 up = cameraRotation * Vector3::UP;
+    const Vector3 forward = cameraRotation * Vector3::FORWARD;
+    const bool orthographic = camera->IsOrthographic();
+    // world size of one font pixel at depth 1 (or anywhere for orthographic cameras), so labels keep their screen size
+    const float pixelSize = 2.0f * camera->GetHalfViewSize() / std::max(frame.viewSize_.y_, 1);
+    const float maxDistanceSquared = maxDistance_ * maxDistance_;
+
+    for (Page &page : pages_)
+        page.vertexData_.clear();
+    numVisibleLabels_ = 0;
+    bool haveExpired = false;
+    for (const Label &label : labels_)
+    {
+        if (!label.node_)
+        {
+            haveExpired = true;
+            continue;
+        }
+        const Vector3 anchor = label.node_->LocalToWorld(label.offset_);
+        const Vector3 toAnchor = anchor - cameraPosition;
+        if (maxDistance_ > 0.0f && toAnchor.LengthSquared() > maxDistanceSquared)
+            continue;
+        const float depth = toAnchor.DotProduct(forward);
+        if (!orthographic && depth <= camera->GetNearClip())
+            continue;
+        const float scale = orthographic ? pixelSize : pixelSize * depth;
+        if (camera->GetFrustum().IsInsideFast(Sphere(anchor, label.radius_ * scale)) == Urho3D::OUTSIDE)
+            continue;
+
+        ++numVisibleLabels_;
+        const Vector3 scaledRight = right * scale;
+        const Vector3 scaledUp = up * scale;
+        for (unsigned i = label.firstGlyph_; i < label.firstGlyph_ + label.numGlyphs_; ++i)
+        {
+            const Glyph &glyph = glyphs_[i];
+            std::vector<unsigned char> &vertexData = pages_[glyph.page_].vertexData_;
+            const std::size_t start = vertexData.size();
+            vertexData.resize(start + 6 * LABEL_VERTEX_SIZE);
+            unsigned char *dest = vertexData.data() + start;
+            const Vector3 topLeft = anchor + scaledRight * glyph.left_ + scaledUp * glyph.top_;
+            const Vector3 topRight = anchor + scaledRight * glyph.right_ + scaledUp * glyph.top_;
+            const Vector3 bottomLeft = anchor + scaledRight * glyph.left_ + scaledUp * glyph.bottom_;
+            const Vector3 bottomRight = anchor + scaledRight * glyph.right_ + scaledUp * glyph.bottom_;
+            writeLabelVertex(dest, topLeft, label.color_, glyph.u0_, glyph.v0_);
+            writeLabelVertex(dest, topRight, label.color_, glyph.u1_, glyph.v0_);
+            writeLabelVertex(dest, bottomRight, label.color_, glyph.u1_, glyph.v1_);
+            writeLabelVertex(dest, topLeft, label.color_, glyph.u0_, glyph.v0_);
+            writeLabelVertex(dest, bottomRight, label.color_, glyph.u1_, glyph.v1_);
+            writeLabelVertex(dest, bottomLeft, label.color_, glyph.u0_, glyph.v1_);
+        }
+    }
+    // the glyphs of removed labels stay behind until RemoveAllLabels()
+    if (haveExpired)
+        labels_.erase(std::remove_if(labels_.begin(), labels_.end(), [](const Label &label) {return !label.node_;}), labels_.end());
+
+    for (Page &page : pages_)
+    {
+        const unsigned numVertices = static_cast<unsigned>(page.vertexData_.size() / LABEL_VERTEX_SIZE);
+        if (numVertices > page.vertexBuffer_->GetVertexCount())
+        {
+            // grow in steps so panning the camera doesn't reallocate every frame
+            unsigned capacity = std::max(page.vertexBuffer_->GetVertexCount(), 6u * 64u);
+            while (capacity < numVertices)
+                capacity *= 2;
+            page.vertexBuffer_->SetSize(capacity, LABEL_VERTEX_MASK, true);
+        }
+        if (numVertices)
+        {
+#ifdef USING_RBFX
+            page.vertexBuffer_->UpdateRange(page.vertexData_.data(), 0, numVertices, true);
+#else // U3D
+            page.vertexBuffer_->SetDataRange(page.vertexData_.data(), 0, numVertices, true);
+#endif // USING_RBFX
+        }
+        page.geometry_->SetDrawRange(Urho3D::TRIANGLE_LIST, 0, 0, 0, numVertices);
+    }
+}
+
+UpdateGeometryType NodeLabels::GetUpdateGeometryType()
+{
+    return labels_.empty() ? Urho3D::UPDATE_NONE : Urho3D::UPDATE_MAIN_THREAD;
+}
+
+void NodeLabels::OnWorldBoundingBoxUpdate()
+{
+    // labels follow their nodes anywhere in the scene and are culled one by one, so
+    // like Skybox the set as a whole is never culled
+    worldBoundingBox_.Define(-Urho3D::M_LARGE_VALUE, Urho3D::M_LARGE_VALUE);
+}
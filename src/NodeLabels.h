@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Math/Color.h>
+#include <Urho3D/Math/Vector3.h>
+
+#include <string>
+#include <vector>
+
+// Urho3D forward declarations
+namespace Urho3D {
+
+class Font;
+class Geometry;
+class Material;
+class Node;
+class Technique;
+class Texture;
+class VertexBuffer;
+
+} // namespace Urho3D
+
+// draws the name labels of many nodes as one component instead of a child node and
+// a Text3D each: the glyphs of all labels share one dynamic vertex buffer per font
+// texture page, and every frame only the labels inside the view frustum and within
+// the maximum distance are rebuilt as camera facing, fixed screen size quads; labels
+// follow their nodes and are dropped once the node is gone
+class NodeLabels : public Urho3D::Drawable
+{
+    URHO3D_OBJECT(NodeLabels, Urho3D::Drawable);
+public:
+    explicit NodeLabels(Urho3D::Context *context);
+    ~NodeLabels() override;
+
+    // removes all labels, since their glyphs depend on the font
+    void SetFont(Urho3D::Font *font, float fontSize);
+    void SetMaxDistance(float maxDistance) {maxDistance_ = maxDistance;} // 0 for no limit
+    // offset is in the node's local space
+    void AddLabel(Urho3D::Node *node, const std::string &text, const Urho3D::Vector3 &offset, const Urho3D::Color &color = Urho3D::Color::WHITE);
+    void RemoveAllLabels();
+
+    unsigned GetNumLabels() const {return static_cast<unsigned>(labels_.size());}
+    unsigned GetNumVisibleLabels() const {return numVisibleLabels_;}
+
+    void UpdateBatches(const Urho3D::FrameInfo &frame) override;
+    void UpdateGeometry(const Urho3D::FrameInfo &frame) override;
+    Urho3D::UpdateGeometryType GetUpdateGeometryType() override;
+protected:
+    void OnWorldBoundingBoxUpdate() override;
+
+    // in font pixels around the label's anchor, y up
+    struct Glyph
+    {
+        float left_, top_, right_, bottom_;
+        float u0_, v0_, u1_, v1_;
+        unsigned page_;
+    };
+    struct Label
+    {
+        Urho3D::WeakPtr<Urho3D::Node> node_;
+        Urho3D::Vector3 offset_;
+        unsigned color_; // Color::ToUInt()
+        unsigned firstGlyph_; // into glyphs_
+        unsigned numGlyphs_;
+        float radius_; // in font pixels, for frustum culling
+    };
+    // one per font texture page, each drawn as a separate batch
+    struct Page
+    {
+        Urho3D::SharedPtr<Urho3D::Geometry> geometry_;
+        Urho3D::SharedPtr<Urho3D::VertexBuffer> vertexBuffer_;
+        Urho3D::SharedPtr<Urho3D::Material> material_;
+        std::vector<unsigned char> vertexData_;
+    };
+    void AddPage(Urho3D::Texture *texture);
+
+    Urho3D::SharedPtr<Urho3D::Font> font_;
+    Urho3D::SharedPtr<Urho3D::Technique> technique_;
+    float fontSize_;
+    float maxDistance_;
+    std::vector<Label> labels_;
+    std::vector<Glyph> glyphs_;
+    std::vector<Page> pages_;
+    unsigned numVisibleLabels_;
+};
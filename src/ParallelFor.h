@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// calls func(i) for every i in [0, count) using up to maxThreads threads (0 for
+// one per hardware thread) including the calling one, and returns once all are
+// done; indices are handed out one at a time so uneven job sizes balance out
+template <typename Func>
+void ParallelFor(std::size_t count, Func &&func, unsigned maxThreads = 0)
+{
+    std::size_t numThreads = maxThreads ? maxThreads : std::thread::hardware_concurrency();
+    numThreads = std::min(std::max<std::size_t>(numThreads, 1), count);
+    if (numThreads <= 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    const auto worker = [&]()
+    {
+        for (std::size_t i = next++; i < count; i = next++)
+            func(i);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (std::size_t i = 1; i < numThreads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+}
@@ -0,0 +1,223 @@
+#include "PhysicsMesh.h"
+#include "CookedScene.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <Urho3D/Graphics/Geometry.h>
+#include <Urho3D/Graphics/IndexBuffer.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionDispatch/btInternalEdgeUtility.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btOptimizedBvh.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h>
+#include <Urho3D/ThirdParty/Bullet/BulletCollision/CollisionShapes/btTriangleInfoMap.h>
+
+#include <cmath> // for std::floor()
+#include <cstring>
+#include <unordered_map>
+
+using Urho3D::BoundingBox;
+using Urho3D::Geometry;
+using Urho3D::Model;
+using Urho3D::SharedPtr;
+using Urho3D::TriangleMeshData;
+using Urho3D::Vector3;
+
+namespace {
+
+// grid cell, or the exact bit pattern when welding only joins duplicates
+struct WeldKey
+{
+    int32_t x_, y_, z_;
+    bool operator==(const WeldKey &other) const {return x_ == other.x_ && y_ == other.y_ && z_ == other.z_;}
+};
+
+struct WeldKeyHash
+{
+    std::size_t operator()(const WeldKey &key) const {return static_cast<std::size_t>(HashBytes(&key, sizeof(key)));}
+};
+
+} // namespace
+
+static WeldKey getWeldKey(const Vector3 &position, float weldDistance)
+{
+    WeldKey key;
+    if (weldDistance > 0.0f)
+    {
+        key.x_ = static_cast<int32_t>(std::floor(position.x_ / weldDistance));
+        key.y_ = static_cast<int32_t>(std::floor(position.y_ / weldDistance));
+        key.z_ = static_cast<int32_t>(std::floor(position.z_ / weldDistance));
+    }
+    else
+    {
+        std::memcpy(&key.x_, &position.x_, sizeof(float));
+        std::memcpy(&key.y_, &position.y_, sizeof(float));
+        std::memcpy(&key.z_, &position.z_, sizeof(float));
+    }
+    return key;
+}
+
+const unsigned char * PhysicsMesh::GetIndexData() const
+{
+    if (HasLargeIndices())
+        return reinterpret_cast<const unsigned char*>(largeIndices_.data());
+    return reinterpret_cast<const unsigned char*>(smallIndices_.data());
+}
+
+std::size_t PhysicsMesh::GetMemoryUse() const
+{
+    return positions_.size() * sizeof(Vector3) + smallIndices_.size() * sizeof(uint16_t) + largeIndices_.size() * sizeof(uint32_t);
+}
+
+std::shared_ptr<PhysicsMesh> CreatePhysicsMesh(const CookedMesh &mesh, float weldDistance)
+{
+    std::shared_ptr<PhysicsMesh> result = std::make_shared<PhysicsMesh>();
+    std::vector<unsigned> remap(mesh.vertexCount_);
+    std::unordered_map<WeldKey, unsigned, WeldKeyHash> welded;
+    welded.reserve(mesh.vertexCount_);
+    for (unsigned i = 0; i < mesh.vertexCount_; ++i)
+    {
+        Vector3 position;
+        std::memcpy(&position, mesh.vertexData_ + static_cast<std::size_t>(i) * mesh.vertexSize_, sizeof(Vector3)); // position always comes first
+        const auto inserted = welded.emplace(getWeldKey(position, weldDistance), static_cast<unsigned>(result->positions_.size()));
+        if (inserted.second)
+        {
+            result->positions_.push_back(position);
+            result->boundingBox_.Merge(position);
+        }
+        remap[i] = inserted.first->second;
+    }
+
+    std::vector<unsigned> indices;
+    indices.reserve(mesh.indexCount_);
+    for (unsigned i = 0; i + 2 < mesh.indexCount_; i += 3)
+    {
+        unsigned triangle[3];
+        for (unsigned k = 0; k < 3; ++k)
+        {
+            if (mesh.largeIndices_)
+            {
+                uint32_t index;
+                std::memcpy(&index, mesh.indexData_ + (i + k) * 4, 4);
+                triangle[k] = remap[index];
+            }
+            else
+            {
+                uint16_t index;
+                std::memcpy(&index, mesh.indexData_ + (i + k) * 2, 2);
+                triangle[k] = remap[index];
+            }
+        }
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+            continue;
+        indices.insert(indices.end(), triangle, triangle + 3);
+    }
+    result->triangleCount_ = static_cast<unsigned>(indices.size() / 3);
+    if (result->positions_.size() > 0xffff)
+        result->largeIndices_.assign(indices.begin(), indices.end());
+    else
+        result->smallIndices_.assign(indices.begin(), indices.end());
+    return result;
+}
+
+uint64_t HashPhysicsMesh(const PhysicsMesh &mesh)
+{
+    uint64_t hash = HashBytes(mesh.positions_.data(), mesh.positions_.size() * sizeof(Vector3));
+    hash = HashBytes(mesh.smallIndices_.data(), mesh.smallIndices_.size() * sizeof(uint16_t), hash);
+    return HashBytes(mesh.largeIndices_.data(), mesh.largeIndices_.size() * sizeof(uint32_t), hash);
+}
+
+CustomTriangleMeshData::CustomTriangleMeshData(Model *placeholder) :
+    TriangleMeshData(placeholder, 0)
+{
+}
+
+CustomTriangleMeshData::~CustomTriangleMeshData()
+{
+    // the shape points to the triangles and maybe a BVH in the mapped file
+#ifdef USING_RBFX
+    shape_.reset();
+#else // U3D
+    shape_.Reset();
+#endif // USING_RBFX
+}
+
+void CustomTriangleMeshData::SetTriangles(Model *model, const CookedMesh &mesh)
+{
+    Geometry * const geometry = model->GetGeometry(0, 0);
+    vertexBuffer_ = geometry->GetVertexBuffer(0);
+    indexBuffer_ = geometry->GetIndexBuffer();
+    boundingBox_ = mesh.boundingBox_;
+
+    // same single part as Urho3D's own mesh interface would describe
+    btIndexedMesh part;
+    const int indexSize = mesh.largeIndices_ ? 4 : 2;
+    part.m_numTriangles = static_cast<int>(mesh.indexCount_ / 3);
+    part.m_triangleIndexBase = indexBuffer_->GetShadowData();
+    part.m_triangleIndexStride = 3 * indexSize;
+    part.m_numVertices = static_cast<int>(mesh.vertexCount_);
+    part.m_vertexBase = vertexBuffer_->GetShadowData(); // position always comes first
+    part.m_vertexStride = static_cast<int>(mesh.vertexSize_);
+    part.m_indexType = mesh.largeIndices_ ? PHY_INTEGER : PHY_SHORT;
+    part.m_vertexType = PHY_FLOAT;
+    triangles_.reset(new btTriangleIndexVertexArray());
+    triangles_->addIndexedMesh(part, part.m_indexType);
+}
+
+void CustomTriangleMeshData::SetTriangles(std::shared_ptr<const PhysicsMesh> mesh)
+{
+    physicsMesh_ = std::move(mesh);
+    boundingBox_ = physicsMesh_->boundingBox_;
+
+    btIndexedMesh part;
+    const bool largeIndices = physicsMesh_->HasLargeIndices();
+    part.m_numTriangles = static_cast<int>(physicsMesh_->triangleCount_);
+    part.m_triangleIndexBase = physicsMesh_->GetIndexData();
+    part.m_triangleIndexStride = 3 * (largeIndices ? 4 : 2);
+    part.m_numVertices = static_cast<int>(physicsMesh_->positions_.size());
+    part.m_vertexBase = reinterpret_cast<const unsigned char*>(physicsMesh_->positions_.data());
+    part.m_vertexStride = sizeof(Vector3);
+    part.m_indexType = largeIndices ? PHY_INTEGER : PHY_SHORT;
+    part.m_vertexType = PHY_FLOAT;
+    triangles_.reset(new btTriangleIndexVertexArray());
+    triangles_->addIndexedMesh(part, part.m_indexType);
+}
+
+void CustomTriangleMeshData::CreateShape(btOptimizedBvh *bvh, btTriangleInfoMap *infoMap, std::shared_ptr<MappedFile> file)
+{
+    file_ = std::move(file);
+    // otherwise the shape constructor scans every triangle for its bounds
+    triangles_->setPremadeAabb(btVector3(boundingBox_.min_.x_, boundingBox_.min_.y_, boundingBox_.min_.z_),
+        btVector3(boundingBox_.max_.x_, boundingBox_.max_.y_, boundingBox_.max_.z_));
+
+    btBvhTriangleMeshShape *shape;
+    if (bvh)
+    {
+        shape = new btBvhTriangleMeshShape(triangles_.get(), bvh->isQuantized(), false);
+        shape->setOptimizedBvh(bvh);
+    }
+    else
+    {
+        // as Urho3D builds its own
+        shape = new btBvhTriangleMeshShape(triangles_.get(), true, true);
+        infoMap = new btTriangleInfoMap();
+        btGenerateInternalEdgeInfo(shape, infoMap);
+    }
+    shape->setTriangleInfoMap(infoMap);
+
+    // replacing the placeholder's shape before its info map, which that shape still points to
+#ifdef USING_RBFX
+    shape_.reset(shape);
+    infoMap_.reset(infoMap);
+#else // U3D
+    shape_.Reset(shape);
+    infoMap_.Reset(infoMap);
+#endif // USING_RBFX
+}
+
+void CreatePhysicsTriangleMesh(CustomTriangleMeshData &data, std::shared_ptr<const PhysicsMesh> mesh)
+{
+    data.SetTriangles(std::move(mesh));
+    data.CreateShape(nullptr, nullptr, nullptr);
+}
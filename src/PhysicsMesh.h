@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Math/Vector3.h>
+#include <Urho3D/Physics/CollisionShape.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Urho3D forward declarations
+namespace Urho3D {
+
+class IndexBuffer;
+class Model;
+class VertexBuffer;
+
+} // namespace Urho3D
+
+// forward declarations
+class MappedFile;
+class btOptimizedBvh;
+class btTriangleIndexVertexArray;
+struct btTriangleInfoMap;
+struct CookedMesh;
+
+// what a triangle-mesh collider needs of a cooked mesh: positions only, with the
+// vertices split for normal and UV seams joined again, and 16-bit indices whenever
+// the welded mesh allows; Bullet only reads float positions, so those stay floats
+struct PhysicsMesh
+{
+    std::vector<Urho3D::Vector3> positions_;
+    std::vector<uint16_t> smallIndices_; // either these
+    std::vector<uint32_t> largeIndices_; // or these
+    unsigned triangleCount_ = 0;
+    Urho3D::BoundingBox boundingBox_;
+
+    bool HasLargeIndices() const {return !largeIndices_.empty();}
+    const unsigned char * GetIndexData() const;
+    std::size_t GetMemoryUse() const;
+};
+
+// vertices in the same cell of a weldDistance grid become one (0 only joins exact
+// duplicates), triangles that collapse on the way are dropped
+std::shared_ptr<PhysicsMesh> CreatePhysicsMesh(const CookedMesh &mesh, float weldDistance = 0.0f);
+// BVH cache key, see BvhCache
+uint64_t HashPhysicsMesh(const PhysicsMesh &mesh);
+
+// a TriangleMeshData over other triangles than a Model's own shadow data: Urho3D only
+// builds these from Models, so it starts out from a one triangle placeholder (see
+// BvhCache::CreatePlaceholderModel()) and gets the real Bullet shape afterwards;
+// that copies the placeholder's shared shadow data handles, whose reference counts
+// aren't atomic, so construct on the main thread and fill in on a worker
+struct CustomTriangleMeshData : public Urho3D::TriangleMeshData
+{
+    explicit CustomTriangleMeshData(Urho3D::Model *placeholder);
+    ~CustomTriangleMeshData() override;
+
+    // the triangles, kept alive along with the shape: the shadow data of a Model loaded
+    // from mesh, or a physics mesh
+    void SetTriangles(Urho3D::Model *model, const CookedMesh &mesh);
+    void SetTriangles(std::shared_ptr<const PhysicsMesh> mesh);
+    // with a BVH and edge info from the cache in file, or builds both when bvh is null
+    void CreateShape(btOptimizedBvh *bvh, btTriangleInfoMap *infoMap, std::shared_ptr<MappedFile> file);
+protected:
+    Urho3D::SharedPtr<Urho3D::VertexBuffer> vertexBuffer_;
+    Urho3D::SharedPtr<Urho3D::IndexBuffer> indexBuffer_;
+    std::shared_ptr<const PhysicsMesh> physicsMesh_;
+    std::unique_ptr<btTriangleIndexVertexArray> triangles_;
+    Urho3D::BoundingBox boundingBox_;
+    std::shared_ptr<MappedFile> file_;
+};
+
+// fills in data for a physics mesh with a freshly built BVH
+void CreatePhysicsTriangleMesh(CustomTriangleMeshData &data, std::shared_ptr<const PhysicsMesh> mesh);
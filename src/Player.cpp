@@ -1,7 +1,7 @@
 #include "Player.h"
 #include "Ladder.h"
 #include "CreateMaterial.h"
-#include "CreatePrimitives.h"
+#include "PrimitiveCache.h"
 #include "globals.h"
 
 #include <Urho3D/Core/Timer.h>
@@ -31,8 +31,6 @@ using Urho3D::OUTSIDE;
 using Urho3D::E_NODECOLLISIONSTART;
 namespace NodeCollisionStart = Urho3D::NodeCollisionStart;
 
-Urho3D::SharedPtr<Urho3D::Model> Player::cylinderModel_;
-
 Player::Player(Urho3D::Scene *scene, const Urho3D::Vector3 &pos) :
     Urho3D::Object(scene->GetContext()),
     node_(nullptr),
@@ -44,13 +42,9 @@ Player::Player(Urho3D::Scene *scene, const Urho3D::Vector3 &pos) :
     node_ = scene->CreateChild("Player");
     node_->SetPosition(pos);
 
-    // possibly create and cache the model
-    if (!cylinderModel_)
-        cylinderModel_ = CreateCapsuleModel(scene->GetContext(), PLAYER_RADIUS, PLAYER_HEIGHT-2.0*PLAYER_RADIUS); // TODO support multiple contexts!
-
-    // use the model
+    // the model is shared by all players
     StaticModel * const sm = node_->CreateComponent<StaticModel>();
-    sm->SetModel(cylinderModel_);
+    sm->SetModel(PrimitiveCache::Get(scene->GetContext())->GetCapsule(PLAYER_RADIUS, PLAYER_HEIGHT-2.0*PLAYER_RADIUS));
     sm->SetMaterial(CreateMaterial(scene->GetContext(), Color(0.8, 0.8, 0.8)));
     sm->SetCastShadows(true);
 
@@ -7,7 +7,6 @@
 namespace Urho3D {
 
 class Scene;
-class Model;
 class Node;
 class Vector3;
 class StringHash;
@@ -39,8 +38,6 @@ protected:
     void HandleNodeCollisionStart(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData);
     void GrabLadder(Ladder *ladder);
 
-    static Urho3D::SharedPtr<Urho3D::Model> cylinderModel_;
-
     Urho3D::Node *node_;
     Urho3D::Vector3 walkDir_;
     Urho3D::Vector3 flyDir_;
@@ -0,0 +1,164 @@
+#include "PrimitiveCache.h"
+#include "CreatePrimitives.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Math/Vector3.h>
+
+#include <algorithm> // for std::max()
+#include <cmath> // for std::lround()
+#include <cstdio> // for std::snprintf()
+#include <functional> // for std::hash
+
+using Urho3D::SharedPtr;
+using Urho3D::Context;
+using Urho3D::Model;
+using Urho3D::Vector3;
+
+// sweeping only once the cache has doubled keeps it amortized constant time per miss
+static const std::size_t MIN_SWEEP_SIZE = 64;
+
+static int toSteps(float size)
+{
+    return static_cast<int>(std::lround(size / PrimitiveCache::SIZE_STEP));
+}
+
+static float fromSteps(int steps)
+{
+    return static_cast<float>(steps) * PrimitiveCache::SIZE_STEP;
+}
+
+std::size_t PrimitiveCache::KeyHash::operator()(const Key &key) const
+{
+    std::size_t hash = static_cast<std::size_t>(key.shape_);
+    for (const int size : key.sizes_)
+        hash = hash * 31 + std::hash<int>()(size);
+    for (const int tessellation : key.tessellation_)
+        hash = hash * 31 + std::hash<int>()(tessellation);
+    return hash;
+}
+
+PrimitiveCache::PrimitiveCache(Context *context) :
+    Urho3D::Object(context),
+    sweepSize_(MIN_SWEEP_SIZE),
+    hits_(0),
+    misses_(0),
+    evicted_(0)
+{
+}
+
+PrimitiveCache::~PrimitiveCache()
+{
+}
+
+PrimitiveCache * PrimitiveCache::Get(Context *context)
+{
+    PrimitiveCache *primitiveCache = context->GetSubsystem<PrimitiveCache>();
+    if (!primitiveCache)
+    {
+        primitiveCache = new PrimitiveCache(context);
+        context->RegisterSubsystem(primitiveCache);
+    }
+    return primitiveCache;
+}
+
+SharedPtr<Model> & PrimitiveCache::Find(const Key &key)
+{
+    const auto it = models_.find(key);
+    if (it != models_.end())
+    {
+        ++hits_;
+        return it->second;
+    }
+    ++misses_;
+    if (models_.size() >= sweepSize_)
+    {
+        Sweep();
+        sweepSize_ = std::max(MIN_SWEEP_SIZE, 2 * models_.size());
+    }
+    return models_[key];
+}
+
+void PrimitiveCache::Sweep()
+{
+    for (auto it = models_.begin(); it != models_.end();)
+    {
+        if (it->second->Refs() == 1)
+        {
+            it = models_.erase(it);
+            ++evicted_;
+        }
+        else
+            ++it;
+    }
+}
+
+SharedPtr<Model> PrimitiveCache::GetSphere(float radius, int stacks, int slices)
+{
+    const Key key{SHAPE_SPHERE, {toSteps(radius), 0, 0}, {stacks, slices}};
+    SharedPtr<Model> &model = Find(key);
+    if (!model)
+        model = CreateSphereModel(context_, fromSteps(key.sizes_[0]), stacks, slices);
+    return model;
+}
+
+SharedPtr<Model> PrimitiveCache::GetCapsule(float radius, float height, int rings, int segments)
+{
+    const Key key{SHAPE_CAPSULE, {toSteps(radius), toSteps(height), 0}, {rings, segments}};
+    SharedPtr<Model> &model = Find(key);
+    if (!model)
+        model = CreateCapsuleModel(context_, fromSteps(key.sizes_[0]), fromSteps(key.sizes_[1]), rings, segments);
+    return model;
+}
+
+SharedPtr<Model> PrimitiveCache::GetBox(const Vector3 &size)
+{
+    const Key key{SHAPE_BOX, {toSteps(size.x_), toSteps(size.y_), toSteps(size.z_)}, {0, 0}};
+    SharedPtr<Model> &model = Find(key);
+    if (!model)
+        model = CreateBoxModel(context_, Vector3(fromSteps(key.sizes_[0]), fromSteps(key.sizes_[1]), fromSteps(key.sizes_[2])));
+    return model;
+}
+
+SharedPtr<Model> PrimitiveCache::GetCylinder(float radius, float height, int segments)
+{
+    const Key key{SHAPE_CYLINDER, {toSteps(radius), toSteps(height), 0}, {segments, 0}};
+    SharedPtr<Model> &model = Find(key);
+    if (!model)
+        model = CreateCylinderModel(context_, fromSteps(key.sizes_[0]), fromSteps(key.sizes_[1]), segments);
+    return model;
+}
+
+SharedPtr<Model> PrimitiveCache::GetCone(float radius, float height, int segments)
+{
+    const Key key{SHAPE_CONE, {toSteps(radius), toSteps(height), 0}, {segments, 0}};
+    SharedPtr<Model> &model = Find(key);
+    if (!model)
+        model = CreateConeModel(context_, fromSteps(key.sizes_[0]), fromSteps(key.sizes_[1]), segments);
+    return model;
+}
+
+SharedPtr<Model> PrimitiveCache::GetTorus(float majorRadius, float minorRadius, int rings, int segments)
+{
+    const Key key{SHAPE_TORUS, {toSteps(majorRadius), toSteps(minorRadius), 0}, {rings, segments}};
+    SharedPtr<Model> &model = Find(key);
+    if (!model)
+        model = CreateTorusModel(context_, fromSteps(key.sizes_[0]), fromSteps(key.sizes_[1]), rings, segments);
+    return model;
+}
+
+void PrimitiveCache::Clear()
+{
+    models_.clear();
+    sweepSize_ = MIN_SWEEP_SIZE;
+    hits_ = 0;
+    misses_ = 0;
+    evicted_ = 0;
+}
+
+std::string PrimitiveCache::GetStatsText() const
+{
+    char text[128];
+    std::snprintf(text, sizeof(text), "%u unique, %u hits, %u misses, %u evicted", GetNumModels(), hits_, misses_, evicted_);
+    return text;
+}
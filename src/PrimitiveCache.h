@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Container/Ptr.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+// Urho3D forward declarations
+namespace Urho3D {
+
+class Model;
+class Vector3;
+
+} // namespace Urho3D
+
+// shares one Model per shape and parameters (see CreatePrimitives.h), so repeated
+// objects such as balls or debris pieces of the same size neither generate nor upload
+// their geometry again; one per Context, registered as a subsystem on first use; sizes
+// are rounded to SIZE_STEP, so sizes computed at runtime still share, and models
+// nothing else holds any more are dropped once the cache has grown, so callers that
+// keep making new sizes don't need to Clear() it
+class PrimitiveCache : public Urho3D::Object
+{
+    URHO3D_OBJECT(PrimitiveCache, Urho3D::Object);
+public:
+    explicit PrimitiveCache(Urho3D::Context *context);
+    ~PrimitiveCache() override;
+
+    static PrimitiveCache * Get(Urho3D::Context *context);
+
+    // the sizes of the models, in world units
+    static constexpr float SIZE_STEP = 0.001f;
+
+    // the returned models are shared, so they must not be modified
+    Urho3D::SharedPtr<Urho3D::Model> GetSphere(float radius = 0.25f, int stacks = 16, int slices = 16);
+    Urho3D::SharedPtr<Urho3D::Model> GetCapsule(float radius, float height, int rings = 16, int segments = 16);
+    Urho3D::SharedPtr<Urho3D::Model> GetBox(const Urho3D::Vector3 &size);
+    Urho3D::SharedPtr<Urho3D::Model> GetCylinder(float radius, float height, int segments = 16);
+    Urho3D::SharedPtr<Urho3D::Model> GetCone(float radius, float height, int segments = 16);
+    Urho3D::SharedPtr<Urho3D::Model> GetTorus(float majorRadius, float minorRadius, int rings = 24, int segments = 12);
+    void Clear();
+
+    unsigned GetNumModels() const {return static_cast<unsigned>(models_.size());}
+    unsigned GetNumHits() const {return hits_;}
+    unsigned GetNumMisses() const {return misses_;}
+    unsigned GetNumEvicted() const {return evicted_;}
+    std::string GetStatsText() const;
+protected:
+    enum Shape
+    {
+        SHAPE_SPHERE,
+        SHAPE_CAPSULE,
+        SHAPE_BOX,
+        SHAPE_CYLINDER,
+        SHAPE_CONE,
+        SHAPE_TORUS
+    };
+    struct Key
+    {
+        Shape shape_;
+        int sizes_[3]; // radii, heights or box extents in SIZE_STEPs, unused ones 0
+        int tessellation_[2]; // same
+        bool operator==(const Key &other) const
+        {
+            return shape_ == other.shape_ && sizes_[0] == other.sizes_[0] && sizes_[1] == other.sizes_[1] && sizes_[2] == other.sizes_[2] &&
+                tessellation_[0] == other.tessellation_[0] && tessellation_[1] == other.tessellation_[1];
+        }
+    };
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const;
+    };
+    // the cached model for key, or null after counting a miss, to be filled by the caller
+    Urho3D::SharedPtr<Urho3D::Model> & Find(const Key &key);
+    // drops the models only the cache still holds
+    void Sweep();
+
+    std::unordered_map<Key, Urho3D::SharedPtr<Urho3D::Model>, KeyHash> models_;
+    std::size_t sweepSize_; // Sweep() on the next miss at this many models
+    unsigned hits_;
+    unsigned misses_;
+    unsigned evicted_;
+};
@@ -0,0 +1,362 @@
+#include "SceneCache.h"
+#include "AnimationCompression.h"
+#include "CacheIO.h"
+#include "CookedScene.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <cstring>
+
+using Urho3D::BoundingBox;
+using Urho3D::Color;
+using Urho3D::LightType;
+using Urho3D::Quaternion;
+using Urho3D::Vector3;
+
+// file layout: header, then textures, materials, meshes, nodes, lights and animations
+// in that order; vertex/index and texture blobs are aligned so they can be uploaded
+// straight from the mapping, animation keys so they can be sampled from it
+static const char SCENE_CACHE_MAGIC[4] = {'R', 'B', 'S', 'C'};
+static const uint32_t SCENE_CACHE_VERSION = 12; // bump whenever the layout below changes
+
+static void writeAnimationChannel(CacheWriter &writer, const CookedAnimationChannel &channel)
+{
+    writer.Write<uint32_t>(channel.numKeys_);
+    writer.WriteVector3(channel.min_);
+    writer.WriteVector3(channel.range_);
+    writer.WriteBlob(reinterpret_cast<const unsigned char*>(channel.keys_), channel.numKeys_ * COMPRESSED_KEY_SIZE);
+}
+
+static void readAnimationChannel(CacheReader &reader, CookedAnimationChannel &channel)
+{
+    channel.numKeys_ = reader.ReadCount(COMPRESSED_KEY_SIZE);
+    channel.min_ = reader.ReadVector3();
+    channel.range_ = reader.ReadVector3();
+    channel.keys_ = reinterpret_cast<const uint16_t*>(reader.ReadBlob(channel.numKeys_ * COMPRESSED_KEY_SIZE));
+}
+
+bool LoadSceneCache(const std::string &cacheFilename, uint64_t sourceHash, unsigned postProcessFlags, const CookSettings &cookSettings, CookedScene &scene)
+{
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(cacheFilename))
+        return false;
+
+    CacheReader reader(file->GetData(), file->GetSize());
+    char magic[4];
+    for (char &c : magic)
+        c = reader.Read<char>();
+    if (!reader.IsOk() || std::memcmp(magic, SCENE_CACHE_MAGIC, sizeof(magic)) != 0)
+    {
+        URHO3D_LOGWARNINGF("Ignoring scene cache '%s': not a scene cache file", cacheFilename.c_str());
+        return false;
+    }
+    if (reader.Read<uint32_t>() != SCENE_CACHE_VERSION ||
+        reader.Read<uint64_t>() != sourceHash ||
+        reader.Read<uint32_t>() != postProcessFlags ||
+        reader.Read<uint8_t>() != (cookSettings.nativeGltf_ ? 1 : 0) ||
+        reader.Read<uint8_t>() != (cookSettings.importTextures_ ? 1 : 0) ||
+        reader.Read<uint32_t>() != cookSettings.maxHullVertices_ ||
+        reader.Read<uint8_t>() != (cookSettings.shrinkHulls_ ? 1 : 0) ||
+        reader.Read<uint32_t>() != cookSettings.lodLevels_ ||
+        reader.Read<float>() != cookSettings.lodReduction_ ||
+        reader.Read<float>() != cookSettings.lodDistance_ ||
+        reader.Read<float>() != cookSettings.animationTolerance_ ||
+        reader.Read<uint8_t>() != (cookSettings.flattenStaticNodes_ ? 1 : 0))
+    {
+        URHO3D_LOGINFOF("Scene cache '%s' is stale", cacheFilename.c_str());
+        return false;
+    }
+
+    CookedScene result;
+    result.textures_.resize(reader.ReadCount(1));
+    result.materials_.resize(reader.ReadCount(1));
+    result.meshes_.resize(reader.ReadCount(1));
+    result.nodes_.resize(reader.ReadCount(1));
+    result.lights_.resize(reader.ReadCount(1));
+    result.animations_.resize(reader.ReadCount(1));
+    if (!reader.IsOk())
+        return false;
+
+    for (CookedTexture &texture : result.textures_)
+        if (!ReadCookedTexture(reader, texture))
+            return false;
+
+    for (CookedMaterial &material : result.materials_)
+    {
+        material.diffuseColor_.r_ = reader.Read<float>();
+        material.diffuseColor_.g_ = reader.Read<float>();
+        material.diffuseColor_.b_ = reader.Read<float>();
+        material.diffuseColor_.a_ = reader.Read<float>();
+        material.diffuseTexture_ = reader.Read<uint32_t>();
+        material.normalTexture_ = reader.Read<uint32_t>();
+        material.alphaMode_ = static_cast<CookedMaterial::AlphaMode>(reader.Read<uint8_t>());
+        if (material.diffuseTexture_ != CookedMaterial::NO_TEXTURE && material.diffuseTexture_ >= result.textures_.size())
+            material.diffuseTexture_ = CookedMaterial::NO_TEXTURE;
+        if (material.normalTexture_ != CookedMaterial::NO_TEXTURE && material.normalTexture_ >= result.textures_.size())
+            material.normalTexture_ = CookedMaterial::NO_TEXTURE;
+        if (material.alphaMode_ > CookedMaterial::ALPHA_BLEND)
+            return false;
+    }
+
+    for (CookedMesh &mesh : result.meshes_)
+    {
+        mesh.vertexMask_ = reader.Read<uint32_t>();
+        mesh.vertexSize_ = reader.Read<uint32_t>();
+        mesh.vertexCount_ = reader.Read<uint32_t>();
+        mesh.indexCount_ = reader.Read<uint32_t>();
+        mesh.largeIndices_ = reader.Read<uint8_t>() != 0;
+        mesh.materialIndex_ = reader.Read<uint32_t>();
+        const Vector3 bbMin = reader.ReadVector3();
+        const Vector3 bbMax = reader.ReadVector3();
+        mesh.boundingBox_ = BoundingBox(bbMin, bbMax);
+        mesh.vertexData_ = reader.ReadBlob(static_cast<std::size_t>(mesh.vertexCount_) * mesh.vertexSize_);
+        mesh.indexData_ = reader.ReadBlob(static_cast<std::size_t>(mesh.indexCount_) * (mesh.largeIndices_ ? 4 : 2));
+        mesh.hullVertexCount_ = reader.Read<uint32_t>();
+        mesh.hullVertexData_ = reinterpret_cast<const float*>(reader.ReadBlob(static_cast<std::size_t>(mesh.hullVertexCount_) * 3 * sizeof(float)));
+        mesh.lods_.resize(reader.ReadCount(2 * sizeof(uint32_t)));
+        for (CookedMesh::Lod &lod : mesh.lods_)
+        {
+            lod.distance_ = reader.Read<float>();
+            lod.indexCount_ = reader.Read<uint32_t>();
+            lod.indexData_ = reader.ReadBlob(static_cast<std::size_t>(lod.indexCount_) * (mesh.largeIndices_ ? 4 : 2));
+        }
+        mesh.bones_.resize(reader.ReadCount(18 * sizeof(float)));
+        for (CookedMesh::Bone &bone : mesh.bones_)
+        {
+            bone.name_ = reader.ReadString();
+            bone.parent_ = reader.Read<uint32_t>();
+            bone.offsetMatrix_ = reader.ReadMatrix3x4();
+            const Vector3 boneMin = reader.ReadVector3();
+            const Vector3 boneMax = reader.ReadVector3();
+            bone.boundingBox_ = BoundingBox(boneMin, boneMax);
+        }
+        if (!reader.IsOk())
+            break;
+        if (mesh.bones_.size() > CookedMesh::MAX_BONES)
+            return false;
+        for (const CookedMesh::Bone &bone : mesh.bones_)
+            if (bone.parent_ >= mesh.bones_.size())
+                return false;
+        if (mesh.materialIndex_ != CookedMesh::NO_MATERIAL && mesh.materialIndex_ >= result.materials_.size())
+            mesh.materialIndex_ = CookedMesh::NO_MATERIAL;
+    }
+
+    for (std::size_t i = 0; i < result.nodes_.size() && reader.IsOk(); ++i)
+    {
+        CookedNode &node = result.nodes_[i];
+        node.name_ = reader.ReadString();
+        node.parent_ = reader.Read<int32_t>();
+        node.position_ = reader.ReadVector3();
+        node.rotation_ = reader.ReadQuaternion();
+        node.scale_ = reader.ReadVector3();
+        node.mass_ = reader.Read<float>();
+        node.gameObjectType_ = reader.ReadString();
+        node.streamingCell_ = reader.ReadString();
+        node.meshes_.resize(reader.ReadCount(sizeof(uint32_t)));
+        for (unsigned &meshIndex : node.meshes_)
+            meshIndex = reader.Read<uint32_t>();
+        node.colliders_.resize(reader.ReadCount(sizeof(int32_t)));
+        for (CookedCollider &collider : node.colliders_)
+        {
+            collider.shape_ = static_cast<CookedCollider::Shape>(reader.Read<int32_t>());
+            collider.size_ = reader.ReadVector3();
+            collider.position_ = reader.ReadVector3();
+            collider.rotation_ = reader.ReadQuaternion();
+            if (collider.shape_ < CookedCollider::SHAPE_BOX || collider.shape_ > CookedCollider::SHAPE_CYLINDER)
+                return false;
+        }
+        node.partOfParentBody_ = reader.Read<uint8_t>() != 0;
+        node.instances_.resize(reader.ReadCount(10 * sizeof(float)));
+        for (CookedInstance &instance : node.instances_)
+        {
+            instance.position_ = reader.ReadVector3();
+            instance.rotation_ = reader.ReadQuaternion();
+            instance.scale_ = reader.ReadVector3();
+        }
+        node.animated_ = reader.Read<uint8_t>() != 0;
+        if (!reader.IsOk())
+            break;
+        // parents must precede their children, and meshes must exist
+        if (node.parent_ >= static_cast<int>(i) || node.parent_ < -1)
+            return false;
+        for (const unsigned meshIndex : node.meshes_)
+            if (meshIndex >= result.meshes_.size())
+                return false;
+    }
+    result.staticRoot_ = reader.Read<int32_t>();
+    if (result.staticRoot_ >= static_cast<int>(result.nodes_.size()) || result.staticRoot_ < -1)
+        return false;
+
+    for (CookedLight &light : result.lights_)
+    {
+        light.name_ = reader.ReadString();
+        light.type_ = static_cast<LightType>(reader.Read<int32_t>());
+        light.position_ = reader.ReadVector3();
+        light.fov_ = reader.Read<float>();
+        light.attenuationConstant_ = reader.Read<float>();
+        light.attenuationLinear_ = reader.Read<float>();
+        light.attenuationQuadratic_ = reader.Read<float>();
+        light.range_ = reader.Read<float>();
+    }
+
+    for (CookedAnimation &animation : result.animations_)
+    {
+        animation.name_ = reader.ReadString();
+        animation.duration_ = reader.Read<float>();
+        animation.tracks_.resize(reader.ReadCount(3 * sizeof(uint32_t)));
+        for (CookedAnimationTrack &track : animation.tracks_)
+        {
+            track.nodeName_ = reader.ReadString();
+            readAnimationChannel(reader, track.position_);
+            readAnimationChannel(reader, track.rotation_);
+            readAnimationChannel(reader, track.scale_);
+        }
+        if (!reader.IsOk())
+            break;
+    }
+
+    if (!reader.IsOk() || !reader.AtEnd())
+    {
+        URHO3D_LOGWARNINGF("Ignoring scene cache '%s': truncated or corrupt", cacheFilename.c_str());
+        return false;
+    }
+
+    // the mesh data points into the mapping, so the scene keeps it alive
+    result.mappedFile_ = file;
+    scene = std::move(result);
+    return true;
+}
+
+bool SaveSceneCache(const std::string &cacheFilename, uint64_t sourceHash, unsigned postProcessFlags, const CookSettings &cookSettings, const CookedScene &scene)
+{
+    CacheWriter writer;
+    for (const char c : SCENE_CACHE_MAGIC)
+        writer.Write(c);
+    writer.Write<uint32_t>(SCENE_CACHE_VERSION);
+    writer.Write<uint64_t>(sourceHash);
+    writer.Write<uint32_t>(postProcessFlags);
+    writer.Write<uint8_t>(cookSettings.nativeGltf_ ? 1 : 0);
+    writer.Write<uint8_t>(cookSettings.importTextures_ ? 1 : 0);
+    writer.Write<uint32_t>(cookSettings.maxHullVertices_);
+    writer.Write<uint8_t>(cookSettings.shrinkHulls_ ? 1 : 0);
+    writer.Write<uint32_t>(cookSettings.lodLevels_);
+    writer.Write<float>(cookSettings.lodReduction_);
+    writer.Write<float>(cookSettings.lodDistance_);
+    writer.Write<float>(cookSettings.animationTolerance_);
+    writer.Write<uint8_t>(cookSettings.flattenStaticNodes_ ? 1 : 0);
+    writer.Write<uint32_t>(static_cast<uint32_t>(scene.textures_.size()));
+    writer.Write<uint32_t>(static_cast<uint32_t>(scene.materials_.size()));
+    writer.Write<uint32_t>(static_cast<uint32_t>(scene.meshes_.size()));
+    writer.Write<uint32_t>(static_cast<uint32_t>(scene.nodes_.size()));
+    writer.Write<uint32_t>(static_cast<uint32_t>(scene.lights_.size()));
+    writer.Write<uint32_t>(static_cast<uint32_t>(scene.animations_.size()));
+
+    for (const CookedTexture &texture : scene.textures_)
+        WriteCookedTexture(writer, texture);
+
+    for (const CookedMaterial &material : scene.materials_)
+    {
+        writer.Write(material.diffuseColor_.r_);
+        writer.Write(material.diffuseColor_.g_);
+        writer.Write(material.diffuseColor_.b_);
+        writer.Write(material.diffuseColor_.a_);
+        writer.Write<uint32_t>(material.diffuseTexture_);
+        writer.Write<uint32_t>(material.normalTexture_);
+        writer.Write<uint8_t>(static_cast<uint8_t>(material.alphaMode_));
+    }
+
+    for (const CookedMesh &mesh : scene.meshes_)
+    {
+        writer.Write<uint32_t>(mesh.vertexMask_);
+        writer.Write<uint32_t>(mesh.vertexSize_);
+        writer.Write<uint32_t>(mesh.vertexCount_);
+        writer.Write<uint32_t>(mesh.indexCount_);
+        writer.Write<uint8_t>(mesh.largeIndices_ ? 1 : 0);
+        writer.Write<uint32_t>(mesh.materialIndex_);
+        writer.WriteVector3(mesh.boundingBox_.min_);
+        writer.WriteVector3(mesh.boundingBox_.max_);
+        writer.WriteBlob(mesh.vertexData_, static_cast<std::size_t>(mesh.vertexCount_) * mesh.vertexSize_);
+        writer.WriteBlob(mesh.indexData_, static_cast<std::size_t>(mesh.indexCount_) * (mesh.largeIndices_ ? 4 : 2));
+        writer.Write<uint32_t>(mesh.hullVertexCount_);
+        writer.WriteBlob(reinterpret_cast<const unsigned char*>(mesh.hullVertexData_), static_cast<std::size_t>(mesh.hullVertexCount_) * 3 * sizeof(float));
+        writer.Write<uint32_t>(static_cast<uint32_t>(mesh.lods_.size()));
+        for (const CookedMesh::Lod &lod : mesh.lods_)
+        {
+            writer.Write<float>(lod.distance_);
+            writer.Write<uint32_t>(lod.indexCount_);
+            writer.WriteBlob(lod.indexData_, static_cast<std::size_t>(lod.indexCount_) * (mesh.largeIndices_ ? 4 : 2));
+        }
+        writer.Write<uint32_t>(static_cast<uint32_t>(mesh.bones_.size()));
+        for (const CookedMesh::Bone &bone : mesh.bones_)
+        {
+            writer.WriteString(bone.name_);
+            writer.Write<uint32_t>(bone.parent_);
+            writer.WriteMatrix3x4(bone.offsetMatrix_);
+            writer.WriteVector3(bone.boundingBox_.min_);
+            writer.WriteVector3(bone.boundingBox_.max_);
+        }
+    }
+
+    for (const CookedNode &node : scene.nodes_)
+    {
+        writer.WriteString(node.name_);
+        writer.Write<int32_t>(node.parent_);
+        writer.WriteVector3(node.position_);
+        writer.WriteQuaternion(node.rotation_);
+        writer.WriteVector3(node.scale_);
+        writer.Write<float>(node.mass_);
+        writer.WriteString(node.gameObjectType_);
+        writer.WriteString(node.streamingCell_);
+        writer.Write<uint32_t>(static_cast<uint32_t>(node.meshes_.size()));
+        for (const unsigned meshIndex : node.meshes_)
+            writer.Write<uint32_t>(meshIndex);
+        writer.Write<uint32_t>(static_cast<uint32_t>(node.colliders_.size()));
+        for (const CookedCollider &collider : node.colliders_)
+        {
+            writer.Write<int32_t>(static_cast<int32_t>(collider.shape_));
+            writer.WriteVector3(collider.size_);
+            writer.WriteVector3(collider.position_);
+            writer.WriteQuaternion(collider.rotation_);
+        }
+        writer.Write<uint8_t>(node.partOfParentBody_ ? 1 : 0);
+        writer.Write<uint32_t>(static_cast<uint32_t>(node.instances_.size()));
+        for (const CookedInstance &instance : node.instances_)
+        {
+            writer.WriteVector3(instance.position_);
+            writer.WriteQuaternion(instance.rotation_);
+            writer.WriteVector3(instance.scale_);
+        }
+        writer.Write<uint8_t>(node.animated_ ? 1 : 0);
+    }
+    writer.Write<int32_t>(scene.staticRoot_);
+
+    for (const CookedLight &light : scene.lights_)
+    {
+        writer.WriteString(light.name_);
+        writer.Write<int32_t>(static_cast<int32_t>(light.type_));
+        writer.WriteVector3(light.position_);
+        writer.Write<float>(light.fov_);
+        writer.Write<float>(light.attenuationConstant_);
+        writer.Write<float>(light.attenuationLinear_);
+        writer.Write<float>(light.attenuationQuadratic_);
+        writer.Write<float>(light.range_);
+    }
+
+    for (const CookedAnimation &animation : scene.animations_)
+    {
+        writer.WriteString(animation.name_);
+        writer.Write<float>(animation.duration_);
+        writer.Write<uint32_t>(static_cast<uint32_t>(animation.tracks_.size()));
+        for (const CookedAnimationTrack &track : animation.tracks_)
+        {
+            writer.WriteString(track.nodeName_);
+            writeAnimationChannel(writer, track.position_);
+            writeAnimationChannel(writer, track.rotation_);
+            writeAnimationChannel(writer, track.scale_);
+        }
+    }
+
+    return WriteFileAtomically(cacheFilename, writer.GetData());
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// forward declaration
+struct CookedScene;
+struct CookSettings;
+
+// the cache is only valid for the exact source file contents, Assimp post-processing flags and CookSettings it was cooked with
+bool LoadSceneCache(const std::string &cacheFilename, uint64_t sourceHash, unsigned postProcessFlags, const CookSettings &cookSettings, CookedScene &scene);
+bool SaveSceneCache(const std::string &cacheFilename, uint64_t sourceHash, unsigned postProcessFlags, const CookSettings &cookSettings, const CookedScene &scene);
@@ -0,0 +1,134 @@
+#include "SceneHotReloader.h"
+#include "AsyncSceneLoader.h"
+#include "CookedScene.h"
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Node.h>
+
+#include <chrono>
+#include <system_error>
+
+using Urho3D::HiresTimer;
+using Urho3D::Node;
+using Urho3D::VariantMap;
+using Urho3D::E_UPDATE;
+
+SceneHotReloader::SceneHotReloader(Urho3D::Context *context) :
+    Urho3D::Object(context),
+    changePending_(false),
+    pollInterval_(0.5f),
+    timeToPoll_(0.0f)
+{
+}
+
+SceneHotReloader::~SceneHotReloader()
+{
+    // the background thread writes into newScene_, so it has to finish first
+    if (cookFuture_.valid())
+        cookFuture_.wait();
+}
+
+void SceneHotReloader::Watch(const std::string &filename, Node *parentNode, std::shared_ptr<const CookedScene> scene, const SceneLoaderOptions &options)
+{
+    Stop();
+    std::error_code error;
+    fileTime_ = std::filesystem::last_write_time(filename, error);
+    if (error || !scene)
+    {
+        URHO3D_LOGWARNINGF("Can't watch '%s' for changes", filename.c_str());
+        return;
+    }
+    filename_ = filename;
+    parentNode_ = parentNode;
+    scene_ = std::move(scene);
+    options_ = options;
+    changePending_ = false;
+    timeToPoll_ = pollInterval_;
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(SceneHotReloader, HandleUpdate));
+}
+
+void SceneHotReloader::Stop()
+{
+    UnsubscribeFromEvent(E_UPDATE);
+    if (cookFuture_.valid())
+        cookFuture_.wait();
+    cookFuture_ = std::future<bool>();
+    scene_.reset();
+    newScene_.reset();
+}
+
+void SceneHotReloader::HandleUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData)
+{
+    if (!parentNode_)
+    {
+        Stop();
+        return;
+    }
+
+    if (cookFuture_.valid())
+    {
+        if (cookFuture_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+        if (cookFuture_.get())
+            ApplyReload();
+        else
+            URHO3D_LOGERRORF("Failed to reload scene '%s', keeping the current one", filename_.c_str());
+        newScene_.reset();
+        return;
+    }
+
+    using namespace Urho3D::Update;
+    timeToPoll_ -= eventData[P_TIMESTEP].GetFloat();
+    if (timeToPoll_ > 0.0f)
+        return;
+    timeToPoll_ = pollInterval_;
+
+    std::error_code error;
+    const std::filesystem::file_time_type fileTime = std::filesystem::last_write_time(filename_, error);
+    if (error || fileTime == fileTime_)
+    {
+        changePending_ = false;
+        return;
+    }
+    // exporters tend to write in several steps, so wait until the file stays the same for one poll
+    if (!changePending_ || fileTime != pendingFileTime_)
+    {
+        changePending_ = true;
+        pendingFileTime_ = fileTime;
+        return;
+    }
+    changePending_ = false;
+    fileTime_ = fileTime;
+    StartCooking();
+}
+
+void SceneHotReloader::StartCooking()
+{
+    URHO3D_LOGINFOF("'%s' changed, reloading", filename_.c_str());
+    newScene_ = std::make_shared<CookedScene>();
+    std::shared_ptr<CookedScene> cookedScene = newScene_;
+    const std::string cookFilename = filename_;
+    const SceneLoaderOptions cookOptions = options_;
+    cookFuture_ = std::async(std::launch::async, [cookedScene, cookFilename, cookOptions]()
+    {
+        return cookSceneWithAssimp(cookFilename, cookOptions, *cookedScene);
+    });
+}
+
+void SceneHotReloader::ApplyReload()
+{
+    HiresTimer timer;
+    SceneReloadStats stats;
+    reloadScene(*scene_, newScene_, parentNode_, options_, context_, stats);
+    scene_ = newScene_;
+    URHO3D_LOGINFOF("Reloaded '%s' in %.1f ms: %u nodes unchanged, %u moved, %u rebuilt, %u added, %u removed",
+        filename_.c_str(), timer.GetUSec(false) / 1000.0f, stats.unchanged_, stats.moved_, stats.rebuilt_, stats.added_, stats.removed_);
+
+    using namespace LevelLive;
+    VariantMap &eventData = GetEventDataMap();
+    eventData[P_NODE] = parentNode_.Get();
+    eventData[P_SUCCESS] = true;
+    SendEvent(E_LEVELLIVE, eventData);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Variant.h>
+
+#include "SceneLoader.h"
+
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+
+// forward declarations
+namespace Urho3D {
+
+class Node;
+class StringHash;
+
+} // namespace Urho3D
+
+// watches the source file of a loaded level and, whenever it changes, cooks it again on
+// a background thread and applies only the differences to the live nodes (see
+// reloadScene()); sends E_LEVELLIVE after each reload, like AsyncSceneLoader
+class SceneHotReloader : public Urho3D::Object
+{
+    URHO3D_OBJECT(SceneHotReloader, Urho3D::Object);
+public:
+    explicit SceneHotReloader(Urho3D::Context *context);
+    ~SceneHotReloader();
+
+    // scene is what parentNode was loaded from, see AsyncSceneLoader::GetLoadedScene()
+    void Watch(const std::string &filename, Urho3D::Node *parentNode, std::shared_ptr<const CookedScene> scene, const SceneLoaderOptions &options = SceneLoaderOptions());
+    void Stop();
+    bool IsWatching() const {return scene_ != nullptr;}
+    void SetPollInterval(float seconds) {pollInterval_ = seconds;}
+protected:
+    void HandleUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData);
+    void StartCooking();
+    void ApplyReload();
+
+    std::string filename_;
+    Urho3D::WeakPtr<Urho3D::Node> parentNode_;
+    SceneLoaderOptions options_;
+    std::shared_ptr<const CookedScene> scene_; // what the live nodes were built from
+    std::shared_ptr<CookedScene> newScene_;
+    std::future<bool> cookFuture_;
+    std::filesystem::file_time_type fileTime_; // of the file scene_ was cooked from
+    std::filesystem::file_time_type pendingFileTime_;
+    bool changePending_;
+    float pollInterval_;
+    float timeToPoll_;
+};
@@ -1,17 +1,24 @@
 #include <Urho3D/Math/MathDefs.h>
 #include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/Skeleton.h>
 #include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/StaticModelGroup.h>
 #include <Urho3D/Graphics/VertexBuffer.h>
 #include <Urho3D/Graphics/IndexBuffer.h>
 #include <Urho3D/Graphics/Geometry.h>
 #include <Urho3D/Graphics/Material.h>
 #include <Urho3D/Graphics/Technique.h>
+#include <Urho3D/Graphics/Texture2D.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Resource/Image.h>
 #include <Urho3D/Physics/RigidBody.h>
 #include <Urho3D/Physics/CollisionShape.h>
-#include <Urho3D/UI/Text3D.h>
+#include <Urho3D/Physics/PhysicsWorld.h>
 #include <Urho3D/UI/Font.h>
 #include <Urho3D/IO/Log.h>
 
@@ -20,7 +27,29 @@
 #include <assimp/metadata.h>
 #include <assimp/postprocess.h>
 
+#include "AnimationCompression.h"
+#include "AnimationPlayer.h"
+#include "BvhCache.h"
+#include "CookedScene.h"
 #include "CreateMaterial.h"
+#include "GltfJson.h"
+#include "Hash.h"
+#include "HullReduction.h"
+#include "InstanceGroups.h"
+#include "Json.h"
+#include "LoadProfile.h"
+#include "MappedFile.h"
+#include "MeshOptimize.h"
+#include "MeshSimplify.h"
+#include "NodeLabels.h"
+#include "ParallelFor.h"
+#include "PhysicsMesh.h"
+#include "SceneCache.h"
+#include "SceneLoader.h"
+#include "StaticBatch.h"
+#include "StaticHierarchy.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
 #include "KinematicRigidBody.h"
 #include "JumpPad.h"
 #include "Ladder.h"
@@ -30,7 +59,21 @@
 #include <vector>
 #include <string>
 #include <string_view>
+#include <cctype> // for std::tolower()
+#include <cmath> // for std::sqrt()
+#include <cstdio> // for std::snprintf()
 #include <cstring>
+#include <initializer_list>
+#include <map>
+#include <tuple>
+#include <algorithm> // for std::sort()
+#include <numeric> // for std::iota()
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <memory>
 
 #ifdef USING_RBFX
 typedef ea::string String;
@@ -38,205 +81,486 @@ typedef ea::string String;
 
 using namespace Urho3D;
 
-static void processAssimpLights(const aiScene * const ai_scene, Node * const parentNode)
+// post-processing applied on import, also part of the scene cache key; triangle and
+// vertex order are optimized while cooking instead (see MeshOptimize.h)
+static const unsigned ASSIMP_POSTPROCESS_FLAGS =
+    aiProcess_Triangulate |
+    aiProcess_GenSmoothNormals |
+    aiProcess_JoinIdenticalVertices |
+    aiProcess_RemoveRedundantMaterials |
+    aiProcess_SortByPType// |
+    //aiProcess_PreTransformVertices
+;
+
+// collision margin of the shapes built from meshes, also what shrunk hulls are shrunk by
+static const float MESH_COLLIDER_MARGIN = 0.001f;
+
+// children made for the EXT_mesh_gpu_instancing instances of a node, and the nodes of
+// the instance groups drawing repeated meshes
+static const char * const INSTANCE_NODE_NAME = "GpuInstance";
+static const char * const INSTANCE_GROUP_NODE_NAME = "InstanceGroup";
+// child holding the AnimationPlayer of the scene's animations
+static const char * const ANIMATIONS_NODE_NAME = "Animations";
+
+// a light's range ends where its attenuated intensity drops below this
+static const float LIGHT_RANGE_CUTOFF = 0.01f;
+static const float MIN_LIGHT_RANGE = 1.0f;
+static const float MAX_LIGHT_RANGE = 100.0f;
+
+// intensity is the brightest color channel times the light's intensity
+static float cookLightRange(const CookedLight &light, float intensity)
 {
+    // solve intensity / (constant + linear * d + quadratic * d^2) = cutoff for d
+    const float a = light.attenuationQuadratic_;
+    const float b = light.attenuationLinear_;
+    const float c = light.attenuationConstant_ - intensity / LIGHT_RANGE_CUTOFF;
+    float range = MAX_LIGHT_RANGE; // no falloff at all
+    if (a > 0.0f)
+        range = (-b + std::sqrt(std::max(b * b - 4.0f * a * c, 0.0f))) / (2.0f * a);
+    else if (b > 0.0f)
+        range = -c / b;
+    return Clamp(range, MIN_LIGHT_RANGE, MAX_LIGHT_RANGE);
+}
+
+static void cookAssimpLights(const aiScene * const ai_scene, CookedScene &scene)
+{
+    scene.lights_.reserve(ai_scene->mNumLights);
     for (unsigned int i = 0; i < ai_scene->mNumLights; ++i)
     {
-        aiLight * const ai_light = ai_scene->mLights[i];
-        Node *realParentNode = parentNode->GetChild(ai_light->mName.C_Str(), true);
-        if (!realParentNode)
-            realParentNode = parentNode;
-        Node * const lightNode = realParentNode->CreateChild(ai_light->mName.C_Str());
-        Light * const light = lightNode->CreateComponent<Light>();
-
+        const aiLight * const ai_light = ai_scene->mLights[i];
+        CookedLight light;
+        light.name_ = ai_light->mName.C_Str();
         if (ai_light->mType == aiLightSource_POINT)
+            light.type_ = LIGHT_POINT;
+        else if (ai_light->mType == aiLightSource_DIRECTIONAL)
+            light.type_ = LIGHT_DIRECTIONAL;
+        else if (ai_light->mType == aiLightSource_SPOT)
         {
-            light->SetLightType(LIGHT_POINT);
-            light->SetRange(ai_light->mAttenuationLinear * 10.0f); // Example scaling
-        } else if (ai_light->mType == aiLightSource_DIRECTIONAL)
+            light.type_ = LIGHT_SPOT;
+            light.fov_ = Urho3D::ToDegrees(ai_light->mAngleOuterCone);
+        }
+        light.position_ = Vector3(ai_light->mPosition.x, ai_light->mPosition.y, ai_light->mPosition.z);
+        light.attenuationConstant_ = ai_light->mAttenuationConstant;
+        light.attenuationLinear_ = ai_light->mAttenuationLinear;
+        light.attenuationQuadratic_ = ai_light->mAttenuationQuadratic;
+        // Assimp folds the intensity into the color
+        const aiColor3D &color = ai_light->mColorDiffuse;
+        light.range_ = cookLightRange(light, std::max(color.r, std::max(color.g, color.b)));
+        scene.lights_.push_back(light);
+    }
+}
+
+// the base color or normal map image of a material, either still encoded (PNG, JPEG,
+// ...) as embedded in the file or as raw pixels (Assimp's uncompressed aiTextures)
+struct TextureSource
+{
+    unsigned material_ = 0;
+    bool normalMap_ = false; // linear data, never has alpha
+    const unsigned char *data_ = nullptr;
+    std::size_t size_ = 0;
+    RgbaImage pixels_; // when there is no data_
+};
+
+static CookedMaterial::AlphaMode readAlphaMode(const std::string &alphaMode)
+{
+    if (alphaMode == "MASK")
+        return CookedMaterial::ALPHA_MASK;
+    if (alphaMode == "BLEND")
+        return CookedMaterial::ALPHA_BLEND;
+    return CookedMaterial::ALPHA_OPAQUE;
+}
+
+// decodes the images, generates their mip chains and block-compresses them on worker
+// threads; identical images are cooked once, and those the texture cache next to the
+// source file already has aren't cooked at all; images that can't be decoded leave
+// their materials untextured
+static void cookTextures(const std::vector<TextureSource> &sources, const std::string &filename, bool useTextureCache, CookedScene &scene, unsigned numThreads)
+{
+    if (sources.empty())
+        return;
+    // alpha is only kept for the materials that use it and normal maps aren't averaged
+    // as sRGB, so both are part of the key
+    std::unordered_map<uint64_t, unsigned> textureIndices;
+    std::vector<unsigned> sourceTextures(sources.size());
+    std::vector<unsigned> firstSources;
+    std::vector<uint64_t> hashes;
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        const TextureSource &source = sources[i];
+        const uint8_t usage = source.normalMap_ ? 2 : (scene.materials_[source.material_].alphaMode_ != CookedMaterial::ALPHA_OPAQUE);
+        uint64_t hash = HashBytes(&usage, sizeof(usage));
+        if (source.data_)
+            hash = HashBytes(source.data_, source.size_, hash);
+        else
         {
-            light->SetLightType(LIGHT_DIRECTIONAL);
-        } else if (ai_light->mType == aiLightSource_SPOT)
+            hash = HashBytes(&source.pixels_.width_, sizeof(source.pixels_.width_), hash);
+            hash = HashBytes(source.pixels_.pixels_.data(), source.pixels_.pixels_.size(), hash);
+        }
+        const auto inserted = textureIndices.emplace(hash, static_cast<unsigned>(firstSources.size()));
+        if (inserted.second)
         {
-            light->SetLightType(LIGHT_SPOT);
-            light->SetFov(Urho3D::ToDegrees(ai_light->mAngleOuterCone));
+            firstSources.push_back(static_cast<unsigned>(i));
+            hashes.push_back(hash);
         }
+        sourceTextures[i] = inserted.first->second;
+    }
 
-        // set position
-        if (ai_light->mType != aiLightSource_DIRECTIONAL)
-            lightNode->SetPosition(Vector3(ai_light->mPosition.x, ai_light->mPosition.y, ai_light->mPosition.z));
+    TextureCache cache;
+    const std::string cacheFilename = filename + TEXTURE_CACHE_EXTENSION;
+    if (useTextureCache)
+        cache.Load(cacheFilename);
+    std::vector<CookedTexture> textures(firstSources.size());
+    std::vector<CookedScene::Storage> storage(firstSources.size());
+    std::vector<unsigned> misses;
+    for (std::size_t i = 0; i < textures.size(); ++i)
+        if (!cache.Find(hashes[i], storage[i], textures[i]))
+            misses.push_back(static_cast<unsigned>(i));
+    ParallelFor(misses.size(), [&](std::size_t i)
+    {
+        const unsigned textureIndex = misses[i];
+        const TextureSource &source = sources[firstSources[textureIndex]];
+        RgbaImage image = source.pixels_;
+        if ((source.data_ && !DecodeImage(source.data_, source.size_, image)) || image.pixels_.empty())
+            return;
+        FlipImage(image);
+        const bool keepAlpha = !source.normalMap_ && scene.materials_[source.material_].alphaMode_ != CookedMaterial::ALPHA_OPAQUE && HasAlpha(image);
+        CookTexture(image, keepAlpha ? BLOCK_FORMAT_BC3 : BLOCK_FORMAT_BC1, !source.normalMap_, storage[textureIndex], textures[textureIndex]);
+        textures[textureIndex].hash_ = hashes[textureIndex];
+    }, numThreads);
+    for (CookedScene::Storage &textureStorage : storage)
+        scene.AdoptStorage(textureStorage);
 
-        // TODO set color
-        // std::cout << "COLOR: (" << ai_light->mColorDiffuse.r << "," << ai_light->mColorDiffuse.g << "," << ai_light->mColorDiffuse.b << ")" << std::endl;
-        // light->SetColor(Color(ai_light->mColorDiffuse.r, ai_light->mColorDiffuse.g, ai_light->mColorDiffuse.b));
-        light->SetColor(Color(1.0f, 1.0f, 1.0f));
+    std::vector<unsigned> textureRemap(textures.size(), CookedMaterial::NO_TEXTURE);
+    for (std::size_t i = 0; i < textures.size(); ++i)
+    {
+        if (textures[i].levels_.empty())
+        {
+            URHO3D_LOGWARNINGF("Can't decode the image of material %u of '%s'", sources[firstSources[i]].material_, filename.c_str());
+            continue;
+        }
+        textureRemap[i] = static_cast<unsigned>(scene.textures_.size());
+        scene.textures_.push_back(textures[i]);
+    }
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        CookedMaterial &material = scene.materials_[sources[i].material_];
+        (sources[i].normalMap_ ? material.normalTexture_ : material.diffuseTexture_) = textureRemap[sourceTextures[i]];
+    }
+    URHO3D_LOGINFOF("Cooked %u textures, %u of them from the texture cache", static_cast<unsigned>(scene.textures_.size()),
+        static_cast<unsigned>(textures.size() - misses.size()));
 
-        // TODO set range & brightness
-        light->SetRange(50.0f);
-        light->SetBrightness(1.0f);
+    // rewriting the whole file also drops the entries of images that are gone
+    if (useTextureCache && (!misses.empty() || cache.GetNumEntries() != scene.textures_.size()) &&
+        !TextureCache::Save(cacheFilename, scene.textures_))
+        URHO3D_LOGWARNINGF("Failed to write texture cache '%s'", cacheFilename.c_str());
+}
 
-        // enable shadow casting
-        light->SetCastShadows(true);
-#ifdef USING_RBFX
-        light->SetShadowBias(BiasParameters(0.000025f, 1.0f, 0.001));
-#else // U3D
-        light->SetShadowBias(BiasParameters(0.000025f, 0.5f, 0.001));
-#endif // USING_RBFX
-        light->SetShadowCascade(CascadeParameters(10.0f, 50.0f, 200.0f, 0.0f, 0.8f));
+// false unless the material has an embedded texture of the type on the first UV channel;
+// the glTF importer names them "*<index>" after their aiTexture
+static bool readAssimpTexture(const aiScene * const ai_scene, const aiMaterial * const ai_mat, aiTextureType type, TextureSource &source)
+{
+    aiString path;
+    unsigned uvIndex = 0;
+    if (AI_SUCCESS != aiGetMaterialTexture(ai_mat, type, 0, &path, nullptr, &uvIndex))
+        return false;
+    const aiTexture * const ai_texture = ai_scene->GetEmbeddedTexture(path.C_Str());
+    if (!ai_texture || uvIndex != 0)
+        return false;
+    if (ai_texture->mHeight == 0)
+    {
+        // mWidth is the size of the compressed data
+        source.data_ = reinterpret_cast<const unsigned char*>(ai_texture->pcData);
+        source.size_ = ai_texture->mWidth;
+        return true;
+    }
+    source.pixels_.width_ = ai_texture->mWidth;
+    source.pixels_.height_ = ai_texture->mHeight;
+    source.pixels_.pixels_.reserve(static_cast<std::size_t>(ai_texture->mWidth) * ai_texture->mHeight * 4);
+    for (std::size_t j = 0; j < static_cast<std::size_t>(ai_texture->mWidth) * ai_texture->mHeight; ++j)
+    {
+        const aiTexel &texel = ai_texture->pcData[j];
+        source.pixels_.pixels_.insert(source.pixels_.pixels_.end(), {texel.r, texel.g, texel.b, texel.a});
     }
+    return true;
 }
 
-static SharedPtr<Model> loadModel(const aiMesh * const ai_mesh, Context * const context)
+// embedded base color textures and normal maps go to textureSources
+static void cookAssimpMaterials(const aiScene * const ai_scene, CookedScene &scene, std::vector<TextureSource> &textureSources)
 {
-    SharedPtr<Model> model(new Model(context));
-    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
-    SharedPtr<IndexBuffer> ib(new IndexBuffer(context));
-    SharedPtr<Geometry> geom(new Geometry(context));
-
-    // enable keeping a CPU-side copy of the data, needed later for physics
-    vb->SetShadowed(true);
-    ib->SetShadowed(true);
-
-    // Vertex buffer
-    unsigned vertexCount = ai_mesh->mNumVertices;
-    vb->SetSize(vertexCount, MASK_POSITION | MASK_NORMAL | MASK_TEXCOORD1 | MASK_TANGENT); // Adjust mask as needed
-    std::vector<float> vertexData;
-    vertexData.reserve(vertexCount * 12); // P(3) + N(3) + T(2) + Tangent(4) = 12 floats
-
-    for (unsigned j = 0; j < vertexCount; ++j)
+    scene.materials_.resize(ai_scene->mNumMaterials);
+    for (unsigned int i = 0; i < ai_scene->mNumMaterials; ++i)
     {
-        vertexData.push_back(ai_mesh->mVertices[j].x);
-        vertexData.push_back(ai_mesh->mVertices[j].y);
-        vertexData.push_back(ai_mesh->mVertices[j].z);
-
-        if (ai_mesh->HasNormals())
+        const aiMaterial * const ai_mat = ai_scene->mMaterials[i];
+        aiColor4D diffuseColor(1.0f, 1.0f, 1.0f, 1.0f);
+        if (AI_SUCCESS != aiGetMaterialColor(ai_mat, AI_MATKEY_BASE_COLOR, &diffuseColor))
         {
-            vertexData.push_back(ai_mesh->mNormals[j].x);
-            vertexData.push_back(ai_mesh->mNormals[j].y);
-            vertexData.push_back(ai_mesh->mNormals[j].z);
-        } else {
-            vertexData.push_back(0.0f);
-            vertexData.push_back(1.0f);
-            vertexData.push_back(0.0f);
+            // Fall back to diffuse if base color isn't set
+            aiGetMaterialColor(ai_mat, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor);
         }
+        scene.materials_[i].diffuseColor_ = Color(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+
+        aiString alphaMode;
+        if (AI_SUCCESS == aiGetMaterialString(ai_mat, "$mat.gltf.alphaMode", 0, 0, &alphaMode))
+            scene.materials_[i].alphaMode_ = readAlphaMode(alphaMode.C_Str());
+        TextureSource source;
+        source.material_ = i;
+        if (readAssimpTexture(ai_scene, ai_mat, aiTextureType_BASE_COLOR, source) ||
+            readAssimpTexture(ai_scene, ai_mat, aiTextureType_DIFFUSE, source))
+            textureSources.push_back(std::move(source));
+        TextureSource normalSource;
+        normalSource.material_ = i;
+        normalSource.normalMap_ = true;
+        if (readAssimpTexture(ai_scene, ai_mat, aiTextureType_NORMALS, normalSource))
+            textureSources.push_back(std::move(normalSource));
+    }
+}
+
+template <typename T>
+static void writeVertexValue(unsigned char *&dest, const T &value)
+{
+    std::memcpy(dest, &value, sizeof(T));
+    dest += sizeof(T);
+}
 
-        if (ai_mesh->HasTextureCoords(0))
+// the vertex attributes of a mesh as Assimp imported them, see cookMesh()
+class AssimpVertexSource
+{
+public:
+    explicit AssimpVertexSource(const aiMesh * const ai_mesh) : mesh_(ai_mesh)
+    {
+        if (!ai_mesh->HasBones() || ai_mesh->mNumBones > CookedMesh::MAX_BONES)
+            return;
+        // the 4 largest weights of each vertex, renormalized to add up to 1 again
+        blendWeights_.assign(static_cast<std::size_t>(ai_mesh->mNumVertices) * 4, 0.0f);
+        blendIndices_.assign(static_cast<std::size_t>(ai_mesh->mNumVertices) * 4, 0);
+        for (unsigned b = 0; b < ai_mesh->mNumBones; ++b)
         {
-            vertexData.push_back(ai_mesh->mTextureCoords[0][j].x);
-            vertexData.push_back(ai_mesh->mTextureCoords[0][j].y);
-        } else {
-            vertexData.push_back(0.0f);
-            vertexData.push_back(0.0f);
+            const aiBone * const ai_bone = ai_mesh->mBones[b];
+            for (unsigned j = 0; j < ai_bone->mNumWeights; ++j)
+            {
+                const aiVertexWeight &weight = ai_bone->mWeights[j];
+                if (weight.mVertexId >= ai_mesh->mNumVertices)
+                    continue;
+                float * const weights = &blendWeights_[weight.mVertexId * 4];
+                const unsigned smallest = static_cast<unsigned>(std::min_element(weights, weights + 4) - weights);
+                if (weight.mWeight > weights[smallest])
+                {
+                    weights[smallest] = weight.mWeight;
+                    blendIndices_[weight.mVertexId * 4 + smallest] = static_cast<unsigned char>(b);
+                }
+            }
         }
-
-        if (ai_mesh->HasTangentsAndBitangents())
+        for (std::size_t i = 0; i < blendWeights_.size(); i += 4)
         {
-            vertexData.push_back(ai_mesh->mTangents[j].x);
-            vertexData.push_back(ai_mesh->mTangents[j].y);
-            vertexData.push_back(ai_mesh->mTangents[j].z);
-            vertexData.push_back(1.0f); // W component for tangent
-        } else {
-            vertexData.push_back(1.0f);
-            vertexData.push_back(0.0f);
-            vertexData.push_back(0.0f);
-            vertexData.push_back(1.0f);
+            const float sum = blendWeights_[i] + blendWeights_[i + 1] + blendWeights_[i + 2] + blendWeights_[i + 3];
+            if (sum > 0.0f)
+                for (unsigned k = 0; k < 4; ++k)
+                    blendWeights_[i + k] /= sum;
         }
     }
-    // Changed Lock/Unlock to SetData
-#ifdef USING_RBFX
-    vb->Update(vertexData.data());
-#else // U3D
-    vb->SetData(vertexData.data());
-#endif
-
-    // Index buffer
-    unsigned indexCount = ai_mesh->mNumFaces * 3;
-    ib->SetSize(indexCount, true); // true for 32-bit indices, false for 16-bit indices?
-    std::vector<uint32_t> indexData;
-    indexData.reserve(indexCount);
-    for (unsigned j = 0; j < ai_mesh->mNumFaces; ++j)
+    unsigned GetNumVertices() const {return mesh_->mNumVertices;}
+    bool HasNormals() const {return mesh_->HasNormals();}
+    bool HasTexCoords() const {return mesh_->HasTextureCoords(0);}
+    bool HasTangents() const {return mesh_->HasNormals() && mesh_->HasTangentsAndBitangents();}
+    // meshes with too many bones for one draw call are left unskinned
+    bool HasBlendWeights() const {return !blendWeights_.empty();}
+    Vector3 GetPosition(unsigned i) const {return Vector3(mesh_->mVertices[i].x, mesh_->mVertices[i].y, mesh_->mVertices[i].z);}
+    Vector3 GetNormal(unsigned i) const {return Vector3(mesh_->mNormals[i].x, mesh_->mNormals[i].y, mesh_->mNormals[i].z);}
+    Vector2 GetTexCoord(unsigned i) const {return Vector2(mesh_->mTextureCoords[0][i].x, mesh_->mTextureCoords[0][i].y);}
+    // W is the bitangent handedness
+    Vector4 GetTangent(unsigned i) const
     {
-        const aiFace &face = ai_mesh->mFaces[j];
-        indexData.push_back(face.mIndices[0]);
-        indexData.push_back(face.mIndices[1]);
-        indexData.push_back(face.mIndices[2]);
+        const aiVector3D &normal = mesh_->mNormals[i];
+        const aiVector3D &tangent = mesh_->mTangents[i];
+        const float w = ((normal ^ tangent) * mesh_->mBitangents[i]) < 0.0f ? -1.0f : 1.0f;
+        return Vector4(tangent.x, tangent.y, tangent.z, w);
     }
-    // Changed Lock/Unlock to SetData
-#ifdef USING_RBFX
-    ib->Update(indexData.data());
-#else // U3D
-    ib->SetData(indexData.data());
-#endif
-
-    geom->SetVertexBuffer(0, vb);
-    geom->SetIndexBuffer(ib);
-    geom->SetDrawRange(TRIANGLE_LIST, 0, indexCount);
+    // 4 each, indices into the mesh's bones
+    const float * GetBlendWeights(unsigned i) const {return &blendWeights_[i * 4];}
+    const unsigned char * GetBlendIndices(unsigned i) const {return &blendIndices_[i * 4];}
+protected:
+    const aiMesh * const mesh_;
+    std::vector<float> blendWeights_;
+    std::vector<unsigned char> blendIndices_;
+};
 
-    model->SetNumGeometries(1);
-    model->SetGeometry(0, 0, geom);
+// builds the vertex and index data of a triangle list from any source with the
+// interface of AssimpVertexSource; thread-safe as long as every concurrent call gets
+// its own storage
+template <class VertexSource>
+static void cookMesh(const VertexSource &source, std::vector<unsigned> &indices, CookedScene::Storage &storage, CookedMesh &mesh, MeshOptimizeStats &optimizeStats)
+{
+    // reorder the triangles for the vertex cache and overdraw, and the vertices by first use
+    std::vector<Vector3> positions(source.GetNumVertices());
+    for (unsigned j = 0; j < source.GetNumVertices(); ++j)
+        positions[j] = source.GetPosition(j);
+    std::vector<unsigned> vertexOrder;
+    optimizeStats = OptimizeMesh(positions, indices, vertexOrder);
 
-    // Set bounding box
-    BoundingBox bb;
-    for (unsigned j = 0; j < vertexCount; ++j)
+    // Vertex buffer, only with the attributes the mesh actually has (in Urho3D's vertex mask order)
+    const bool hasNormals = source.HasNormals();
+    const bool hasTexCoords = source.HasTexCoords();
+    const bool hasTangents = hasNormals && source.HasTangents();
+    const bool hasBlendWeights = source.HasBlendWeights();
+    mesh.vertexCount_ = static_cast<unsigned>(vertexOrder.size());
+    mesh.vertexMask_ = MASK_POSITION;
+    mesh.vertexSize_ = 3 * sizeof(float);
+    if (hasNormals)
+    {
+        mesh.vertexMask_ |= MASK_NORMAL;
+        mesh.vertexSize_ += 3 * sizeof(float);
+    }
+    if (hasTexCoords)
+    {
+        mesh.vertexMask_ |= MASK_TEXCOORD1;
+        mesh.vertexSize_ += 2 * sizeof(float);
+    }
+    if (hasTangents)
+    {
+        mesh.vertexMask_ |= MASK_TANGENT;
+        mesh.vertexSize_ += 4 * sizeof(float);
+    }
+    if (hasBlendWeights)
     {
-        Vector3 pos(ai_mesh->mVertices[j].x, ai_mesh->mVertices[j].y, ai_mesh->mVertices[j].z);
-        bb.Merge(pos);
+        mesh.vertexMask_ |= MASK_BLENDWEIGHTS;
+        mesh.vertexMask_ |= MASK_BLENDINDICES;
+        mesh.vertexSize_ += 4 * sizeof(float) + 4;
     }
-    model->SetBoundingBox(bb);
+    unsigned char * const vertexData = CookedScene::Allocate(storage, mesh.vertexCount_ * mesh.vertexSize_);
+    unsigned char *v = vertexData;
 
-    return model;
-}
+    for (unsigned j = 0; j < mesh.vertexCount_; ++j)
+    {
+        const unsigned sourceIndex = vertexOrder[j];
+        const Vector3 &position = positions[sourceIndex];
+        writeVertexValue(v, position.x_);
+        writeVertexValue(v, position.y_);
+        writeVertexValue(v, position.z_);
 
-static Node* AddText3DLabel(Node * const targetNode, const String &text, const Color &color = Color::WHITE, float offsetY = 2.5f, float fontSize = 24.0f)
-{
-    Context * const context = targetNode->GetContext();
-    ResourceCache * const cache = context->GetSubsystem<ResourceCache>();
+        if (hasNormals)
+        {
+            const Vector3 normal = source.GetNormal(sourceIndex);
+            writeVertexValue(v, normal.x_);
+            writeVertexValue(v, normal.y_);
+            writeVertexValue(v, normal.z_);
+        }
 
-    // Create a child node for the label
-    Node * const labelNode = targetNode->CreateChild("Text3DLabel");
+        if (hasTexCoords)
+        {
+            const Vector2 texCoord = source.GetTexCoord(sourceIndex);
+            writeVertexValue(v, texCoord.x_);
+            writeVertexValue(v, texCoord.y_);
+        }
 
-    // Position above the target node
-    Vector3 position = Vector3::ZERO;
-    StaticModel * const sm = targetNode->GetComponent<StaticModel>();
-    if (sm && sm->GetModel())
+        if (hasTangents)
+        {
+            const Vector4 tangent = source.GetTangent(sourceIndex);
+            writeVertexValue(v, tangent.x_);
+            writeVertexValue(v, tangent.y_);
+            writeVertexValue(v, tangent.z_);
+            writeVertexValue(v, tangent.w_);
+        }
+
+        if (hasBlendWeights)
+        {
+            const float * const weights = source.GetBlendWeights(sourceIndex);
+            for (unsigned k = 0; k < 4; ++k)
+                writeVertexValue(v, weights[k]);
+            std::memcpy(v, source.GetBlendIndices(sourceIndex), 4);
+            v += 4;
+        }
+
+        mesh.boundingBox_.Merge(position);
+    }
+    mesh.vertexData_ = vertexData;
+
+    // Index buffer, 16-bit whenever every index fits
+    mesh.indexCount_ = static_cast<unsigned>(indices.size());
+    mesh.largeIndices_ = mesh.vertexCount_ > 0xffff;
+    if (mesh.largeIndices_)
     {
-        BoundingBox bb = sm->GetModel()->GetBoundingBox();
-        position.y_ = bb.max_.y_ * targetNode->GetScale().y_ + offsetY; // Above bounding box // TODO I think this isn't quite right...
+        uint32_t * const indexData = reinterpret_cast<uint32_t*>(CookedScene::Allocate(storage, mesh.indexCount_ * sizeof(uint32_t)));
+        std::copy(indices.begin(), indices.end(), indexData);
+        mesh.indexData_ = reinterpret_cast<const unsigned char*>(indexData);
     }
     else
     {
-        position.y_ = offsetY; // Fallback fixed offset
+        uint16_t * const indexData = reinterpret_cast<uint16_t*>(CookedScene::Allocate(storage, mesh.indexCount_ * sizeof(uint16_t)));
+        for (unsigned j = 0; j < mesh.indexCount_; ++j)
+            indexData[j] = static_cast<uint16_t>(indices[j]);
+        mesh.indexData_ = reinterpret_cast<const unsigned char*>(indexData);
     }
-    labelNode->SetPosition(position);
-    labelNode->SetWorldScale(Vector3::ONE);
+}
 
-    // Create Text3D component
-    Text3D * const text3D = labelNode->CreateComponent<Text3D>();
+static Matrix3x4 toMatrix3x4(const aiMatrix4x4 &m)
+{
+    return Matrix3x4(
+        m.a1, m.a2, m.a3, m.a4,
+        m.b1, m.b2, m.b3, m.b4,
+        m.c1, m.c2, m.c3, m.c4);
+}
 
-    // Load font (use default Urho3D font or custom)
-    Font *font = cache->GetResource<Font>("Fonts/Anonymous Pro.ttf");
-    if (!font)
+// a bone's bounding box covers the vertices it moves at least this much
+static const float BONE_BOX_MIN_WEIGHT = 0.33f;
+
+// thread-safe as long as every concurrent call gets its own storage
+static void cookAssimpMesh(const aiMesh * const ai_mesh, std::size_t numMaterials, CookedScene::Storage &storage, CookedMesh &mesh, MeshOptimizeStats &optimizeStats)
+{
+    std::vector<unsigned> indices(ai_mesh->mNumFaces * 3);
+    for (unsigned j = 0; j < ai_mesh->mNumFaces; ++j)
     {
-        // URHO3D_LOGWARNING("Failed to load font 'Fonts/Anonymous Pro.ttf', using fallback");
-        font = cache->GetResource<Font>("Fonts/BlueHighway.ttf"); // Fallback font
+        const aiFace &face = ai_mesh->mFaces[j];
+        indices[j*3 + 0] = face.mIndices[0];
+        indices[j*3 + 1] = face.mIndices[1];
+        indices[j*3 + 2] = face.mIndices[2];
     }
+    const AssimpVertexSource source(ai_mesh);
+    cookMesh(source, indices, storage, mesh, optimizeStats);
 
-    // Configure Text3D properties
-    text3D->SetText(text);
-    text3D->SetFont(font, fontSize);
-    text3D->SetColor(color);
-    text3D->SetTextAlignment(HA_CENTER); // Center horizontally
-    text3D->SetHorizontalAlignment(HA_CENTER); // Ensure 3D alignment
-    text3D->SetVerticalAlignment(VA_CENTER);
-    text3D->SetFaceCameraMode(FC_ROTATE_XYZ); // Billboard mode
-    text3D->SetFixedScreenSize(true);
-    // text3D->SetRelative(true); // doesn't exist :-(
-    text3D->SetCastShadows(false); // Optional: disable shadows for clarity
+    if (ai_mesh->mMaterialIndex < numMaterials)
+        mesh.materialIndex_ = ai_mesh->mMaterialIndex;
 
-    // URHO3D_LOGINFOF("Added Text3D label '%s' to node '%s' at offset y=%.3f",
-        // text.CString(), targetNode->GetName().CString(), position.y_);
+    if (!source.HasBlendWeights())
+        return;
+    mesh.bones_.resize(ai_mesh->mNumBones);
+    for (unsigned b = 0; b < ai_mesh->mNumBones; ++b)
+    {
+        const aiBone * const ai_bone = ai_mesh->mBones[b];
+        CookedMesh::Bone &bone = mesh.bones_[b];
+        bone.name_ = ai_bone->mName.C_Str();
+        bone.parent_ = b; // see cookAssimpBoneParents()
+        bone.offsetMatrix_ = toMatrix3x4(ai_bone->mOffsetMatrix);
+        for (unsigned j = 0; j < ai_bone->mNumWeights; ++j)
+        {
+            const aiVertexWeight &weight = ai_bone->mWeights[j];
+            if (weight.mWeight >= BONE_BOX_MIN_WEIGHT && weight.mVertexId < ai_mesh->mNumVertices)
+                bone.boundingBox_.Merge(bone.offsetMatrix_ * source.GetPosition(weight.mVertexId));
+        }
+    }
+}
 
-    return labelNode;
+// the bones' hierarchy follows that of their nodes, skipping nodes that aren't bones
+static void cookAssimpBoneParents(const aiScene * const ai_scene, CookedScene &scene)
+{
+    for (CookedMesh &mesh : scene.meshes_)
+    {
+        std::unordered_map<std::string, unsigned> boneIndices;
+        for (unsigned b = 0; b < mesh.bones_.size(); ++b)
+            boneIndices[mesh.bones_[b].name_] = b;
+        for (CookedMesh::Bone &bone : mesh.bones_)
+        {
+            const aiNode * const ai_node = ai_scene->mRootNode->FindNode(bone.name_.c_str());
+            for (const aiNode *parent = ai_node ? ai_node->mParent : nullptr; parent; parent = parent->mParent)
+            {
+                const auto it = boneIndices.find(parent->mName.C_Str());
+                if (it != boneIndices.end())
+                {
+                    bone.parent_ = it->second;
+                    break;
+                }
+            }
+        }
+    }
 }
 
 float ReadNumber(const aiMetadataEntry * const entry, bool *ok = nullptr)
@@ -260,52 +584,19 @@ float ReadNumber(const aiMetadataEntry * const entry, bool *ok = nullptr)
     return result;
 }
 
-static void processAssimpNode(const aiNode * const ai_node, const aiScene * const ai_scene, Node * const parentNode, Context * const context)
+static float readRigidBodyMass(const aiMetadata * const metadata)
 {
-    /*
-    Node* currentNode = parent->CreateChild(ai_node->mName.C_Str());
-
-    // Set transform
-    aiMatrix4x4 t = ai_node->mTransformation;
-    Vector3 pos(t.a4, t.b4, t.c4);
-    Quaternion rot;
-    Vector3 scale;
-    Matrix3x4(mat3x4).Decompose(pos, rot, scale);
-    currentNode->SetPosition(pos);
-    currentNode->SetRotation(rot);
-    currentNode->SetScale(scale);
-    */
-
-    // create the node
-    Node* currentNode = parentNode->CreateChild(ai_node->mName.C_Str());
-
-    // apply the transformation
-    {
-        aiMatrix4x4 transform = ai_node->mTransformation;
-        aiVector3t<float> scaling, position;
-        aiQuaterniont<float> rotation;
-        transform.Decompose(scaling, rotation, position);
-
-        Vector3 scale(scaling.x, scaling.y, scaling.z);
-        Vector3 translate(position.x, position.y, position.z);
-        Quaternion orient(rotation.w, rotation.x, rotation.y, rotation.z);
-
-        currentNode->SetPosition(translate);
-        currentNode->SetRotation(orient);
-        currentNode->SetScale(scale);
-    }
-
     float rigidBodyMass = 0.0f;
-    if (ai_node->mMetaData)
+    if (metadata)
     {
-        for (unsigned int i = 0; i < ai_node->mMetaData->mNumProperties; i++)
+        for (unsigned int i = 0; i < metadata->mNumProperties; i++)
         {
-            // std::cout << "property #" << i << ": \"" << ai_node->mMetaData->mKeys[i].C_Str() << "\": type " << ai_node->mMetaData->mValues[i].mType << "" << std::endl;
+            // std::cout << "property #" << i << ": \"" << metadata->mKeys[i].C_Str() << "\": type " << metadata->mValues[i].mType << "" << std::endl;
             // find extensions entry
-            if (ai_node->mMetaData->mValues[i].mType == AI_AIMETADATA && strcmp(ai_node->mMetaData->mKeys[i].C_Str(), "extensions") == 0)
+            if (metadata->mValues[i].mType == AI_AIMETADATA && strcmp(metadata->mKeys[i].C_Str(), "extensions") == 0)
             {
                 // std::cout << "Found \"extensions\"!" << std::endl;
-                const aiMetadata * const extensions = static_cast<const aiMetadata *>(ai_node->mMetaData->mValues[i].mData);
+                const aiMetadata * const extensions = static_cast<const aiMetadata *>(metadata->mValues[i].mData);
                 for (unsigned int j = 0; j < extensions->mNumProperties; j++)
                 {
                     // std::cout << "\tproperty #" << j << ": \"" << extensions->mKeys[j].C_Str() << "\": type " << extensions->mValues[j].mType << "" << std::endl;
@@ -345,125 +636,2758 @@ static void processAssimpNode(const aiNode * const ai_node, const aiScene * cons
             }
         }
     }
+    return rigidBodyMass;
+}
 
-    // TODO cache models
-    // std::vector<SharedPtr<Model>> models(ai_node->mNumMeshes);
-
-    for (unsigned int i = 0; i < ai_node->mNumMeshes; ++i)
+static std::string readGameObjectType(const aiMetadata * const metadata)
+{
+    if (metadata)
     {
-        const unsigned int meshIndex = ai_node->mMeshes[i];
-        const aiMesh * const ai_mesh = ai_scene->mMeshes[meshIndex];
-
-        // load mesh
-        SharedPtr<Model> model = loadModel(ai_mesh, context);
-        // models[i] = model;
+        for (unsigned int i = 0; i < metadata->mNumProperties; ++i)
+        {
+            const std::string_view key = metadata->mKeys[i].C_Str();
+            const aiMetadataEntry &entry = metadata->mValues[i];
 
-        // apply mesh
-        StaticModel * const sm = currentNode->CreateComponent<StaticModel>();
-        sm->SetModel(model);
-        sm->SetCastShadows(true);
+            if (key == "GameObjectType" && entry.mType == AI_AISTRING)
+                return static_cast<const aiString*>(entry.mData)->C_Str();
+        }
+    }
+    return std::string();
+}
 
-        // apply material
-        if (ai_mesh->mMaterialIndex < ai_scene->mNumMaterials)
+// follows a path of nested metadata keys, e.g. {"extensions", "KHR_physics_rigid_bodies", "motion"}
+static const aiMetadataEntry * findMetadataEntry(const aiMetadata *metadata, std::initializer_list<const char*> path)
+{
+    const aiMetadataEntry *entry = nullptr;
+    for (const char * const key : path)
+    {
+        if (!metadata)
+            return nullptr;
+        entry = nullptr;
+        for (unsigned int i = 0; i < metadata->mNumProperties; ++i)
         {
-            aiMaterial * const ai_mat = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
-            aiColor4D diffuseColor;
-            if (AI_SUCCESS != aiGetMaterialColor(ai_mat, AI_MATKEY_BASE_COLOR, &diffuseColor))
+            if (strcmp(metadata->mKeys[i].C_Str(), key) == 0)
             {
-                // Fall back to diffuse if base color isn't set
-                aiGetMaterialColor(ai_mat, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor);
+                entry = metadata->mValues + i;
+                break;
             }
+        }
+        if (!entry)
+            return nullptr;
+        metadata = (entry->mType == AI_AIMETADATA) ? static_cast<const aiMetadata *>(entry->mData) : nullptr;
+    }
+    return entry;
+}
+
+// strings are taken as they are, numbers (e.g. "StreamingCell": 3) become their decimal text
+static std::string readStreamingCell(const aiMetadata * const metadata)
+{
+    const aiMetadataEntry * const entry = findMetadataEntry(metadata, {"StreamingCell"});
+    if (!entry)
+        return std::string();
+    if (entry->mType == AI_AISTRING)
+        return static_cast<const aiString*>(entry->mData)->C_Str();
+    bool ok = false;
+    const float cell = ReadNumber(entry, &ok);
+    return ok ? std::to_string(static_cast<long long>(cell)) : std::string();
+}
+
+// KHR_physics_rigid_bodies node data needed to build compound colliders after all nodes are cooked
+struct NodePhysics
+{
+    bool hasMotion_ = false;
+    int shape_ = -1; // index into the KHR_implicit_shapes shapes, -1 for none or a mesh collider
+};
+
+static NodePhysics readNodePhysics(const aiMetadata * const metadata)
+{
+    NodePhysics physics;
+    physics.hasMotion_ = findMetadataEntry(metadata, {"extensions", "KHR_physics_rigid_bodies", "motion"}) != nullptr;
+    // current spec: collider.geometry.shape, older drafts: collider.shape
+    const aiMetadataEntry *shape = findMetadataEntry(metadata, {"extensions", "KHR_physics_rigid_bodies", "collider", "geometry", "shape"});
+    if (!shape)
+        shape = findMetadataEntry(metadata, {"extensions", "KHR_physics_rigid_bodies", "collider", "shape"});
+    bool ok = false;
+    const float shapeIndex = shape ? ReadNumber(shape, &ok) : -1.0f;
+    if (ok && shapeIndex >= 0.0f)
+        physics.shape_ = static_cast<int>(shapeIndex);
+    return physics;
+}
+
+// per node LOD settings from the glTF extras, negative where the node doesn't set them
+struct NodeLod
+{
+    int levels_ = -1;
+    float distance_ = -1.0f;
+};
+
+static NodeLod readNodeLod(const aiMetadata * const metadata)
+{
+    NodeLod lod;
+    bool ok = false;
+    const aiMetadataEntry * const levels = findMetadataEntry(metadata, {"LodLevels"});
+    const float numLevels = levels ? ReadNumber(levels, &ok) : -1.0f;
+    if (ok && numLevels >= 0.0f)
+        lod.levels_ = static_cast<int>(numLevels);
+    const aiMetadataEntry * const distance = findMetadataEntry(metadata, {"LodDistance"});
+    const float lodDistance = distance ? ReadNumber(distance, &ok) : -1.0f;
+    if (ok && lodDistance >= 0.0f)
+        lod.distance_ = lodDistance;
+    return lod;
+}
+
+static void cookAssimpNode(const aiNode * const ai_node, int parentIndex, CookedScene &scene, std::vector<NodePhysics> &nodePhysics, std::vector<NodeLod> &nodeLods)
+{
+    const int nodeIndex = static_cast<int>(scene.nodes_.size());
+    scene.nodes_.emplace_back();
+    CookedNode &node = scene.nodes_.back();
+    node.name_ = ai_node->mName.C_Str();
+    node.parent_ = parentIndex;
+
+    // decompose the transformation
+    {
+        aiMatrix4x4 transform = ai_node->mTransformation;
+        aiVector3t<float> scaling, position;
+        aiQuaterniont<float> rotation;
+        transform.Decompose(scaling, rotation, position);
+
+        node.scale_ = Vector3(scaling.x, scaling.y, scaling.z);
+        node.position_ = Vector3(position.x, position.y, position.z);
+        node.rotation_ = Quaternion(rotation.w, rotation.x, rotation.y, rotation.z);
+    }
+
+    node.mass_ = readRigidBodyMass(ai_node->mMetaData);
+    node.gameObjectType_ = readGameObjectType(ai_node->mMetaData);
+    node.streamingCell_ = readStreamingCell(ai_node->mMetaData);
+    node.meshes_.assign(ai_node->mMeshes, ai_node->mMeshes + ai_node->mNumMeshes);
+    nodePhysics.push_back(readNodePhysics(ai_node->mMetaData));
+    nodeLods.push_back(readNodeLod(ai_node->mMetaData));
+
+    // recursively process children, note that "node" may be invalidated from here on
+    for (unsigned int i = 0; i < ai_node->mNumChildren; ++i)
+        cookAssimpNode(ai_node->mChildren[i], nodeIndex, scene, nodePhysics, nodeLods);
+}
+
+static std::vector<VectorKey> readVectorKeys(const aiVectorKey * const ai_keys, unsigned numKeys, double ticksPerSecond)
+{
+    std::vector<VectorKey> keys(numKeys);
+    for (unsigned i = 0; i < numKeys; ++i)
+    {
+        const aiVector3D &value = ai_keys[i].mValue;
+        keys[i].time_ = static_cast<float>(ai_keys[i].mTime / ticksPerSecond);
+        keys[i].value_ = Vector3(value.x, value.y, value.z);
+    }
+    return keys;
+}
+
+static std::vector<RotationKey> readRotationKeys(const aiQuatKey * const ai_keys, unsigned numKeys, double ticksPerSecond)
+{
+    std::vector<RotationKey> keys(numKeys);
+    for (unsigned i = 0; i < numKeys; ++i)
+    {
+        const aiQuaternion &value = ai_keys[i].mValue;
+        keys[i].time_ = static_cast<float>(ai_keys[i].mTime / ticksPerSecond);
+        keys[i].value_ = Quaternion(value.w, value.x, value.y, value.z);
+    }
+    return keys;
+}
+
+// Urho3D's Animation keeps one keyframe with every property per distinct key time of
+// a track, what the compressed tracks are compared against
+static unsigned countRawKeyframes(const aiNodeAnim * const ai_channel)
+{
+    std::vector<double> times;
+    for (unsigned i = 0; i < ai_channel->mNumPositionKeys; ++i)
+        times.push_back(ai_channel->mPositionKeys[i].mTime);
+    for (unsigned i = 0; i < ai_channel->mNumRotationKeys; ++i)
+        times.push_back(ai_channel->mRotationKeys[i].mTime);
+    for (unsigned i = 0; i < ai_channel->mNumScalingKeys; ++i)
+        times.push_back(ai_channel->mScalingKeys[i].mTime);
+    std::sort(times.begin(), times.end());
+    return static_cast<unsigned>(std::unique(times.begin(), times.end()) - times.begin());
+}
 
-            SharedPtr<Material> mat = CreateMaterial(context, Color(diffuseColor.r, diffuseColor.g, diffuseColor.b));
-            sm->SetMaterial(mat);
+static unsigned countKeys(const CookedAnimationTrack &track)
+{
+    return track.position_.numKeys_ + track.rotation_.numKeys_ + track.scale_.numKeys_;
+}
+
+// node animations with reduced and quantized keys (see AnimationCompression.h), one job
+// per animation; the nodes they move are marked as animated
+static void cookAssimpAnimations(const aiScene * const ai_scene, const CookSettings &cookSettings, CookedScene &scene, unsigned numThreads)
+{
+    const unsigned numAnimations = ai_scene->mNumAnimations;
+    scene.animations_.resize(numAnimations);
+    std::vector<CookedScene::Storage> storage(numAnimations);
+    std::vector<unsigned> rawKeyframes(numAnimations, 0);
+    ParallelFor(numAnimations, [&](std::size_t i)
+    {
+        const aiAnimation * const ai_animation = ai_scene->mAnimations[i];
+        CookedAnimation &animation = scene.animations_[i];
+        // Assimp leaves the rate at 0 when the file doesn't give one, 25 is its default
+        const double ticksPerSecond = ai_animation->mTicksPerSecond > 0.0 ? ai_animation->mTicksPerSecond : 25.0;
+        animation.name_ = ai_animation->mName.C_Str();
+        if (animation.name_.empty())
+            animation.name_ = "Animation" + std::to_string(i);
+        double duration = ai_animation->mDuration;
+        for (unsigned c = 0; c < ai_animation->mNumChannels; ++c)
+        {
+            const aiNodeAnim * const ai_channel = ai_animation->mChannels[c];
+            if (ai_channel->mNumPositionKeys)
+                duration = std::max(duration, ai_channel->mPositionKeys[ai_channel->mNumPositionKeys - 1].mTime);
+            if (ai_channel->mNumRotationKeys)
+                duration = std::max(duration, ai_channel->mRotationKeys[ai_channel->mNumRotationKeys - 1].mTime);
+            if (ai_channel->mNumScalingKeys)
+                duration = std::max(duration, ai_channel->mScalingKeys[ai_channel->mNumScalingKeys - 1].mTime);
         }
+        animation.duration_ = static_cast<float>(duration / ticksPerSecond);
 
-        // create physics body
-        RigidBody *body = nullptr;
-        const bool isElevator = strcmp(ai_node->mName.C_Str(), "Elevator") == 0;
-        if (isElevator)
+        const float tolerance = cookSettings.animationTolerance_;
+        animation.tracks_.resize(ai_animation->mNumChannels);
+        for (unsigned c = 0; c < ai_animation->mNumChannels; ++c)
         {
-            // NOTE: we cannot use currentNode->CreateComponent<KinematicRigidBody>()
-            // for two reasons: RigidBody is explicitly sought by PhyicsWorld and
-            // friends, and we are making an imposter RigidBody via KinematicRigidBody
-            // not being registered "properly" with omitting the URHO3D_OBJECT macro
-            body = new KinematicRigidBody(context);
-#ifdef USING_RBFX
-            currentNode->AddComponent(body, 0);
-#else
-            currentNode->AddComponent(body, 0, Urho3D::REPLICATED);
-#endif
+            const aiNodeAnim * const ai_channel = ai_animation->mChannels[c];
+            CookedAnimationTrack &track = animation.tracks_[c];
+            track.nodeName_ = ai_channel->mNodeName.C_Str();
+            CompressVectorChannel(readVectorKeys(ai_channel->mPositionKeys, ai_channel->mNumPositionKeys, ticksPerSecond),
+                animation.duration_, tolerance, storage[i], track.position_);
+            CompressRotationChannel(readRotationKeys(ai_channel->mRotationKeys, ai_channel->mNumRotationKeys, ticksPerSecond),
+                animation.duration_, tolerance, storage[i], track.rotation_);
+            CompressVectorChannel(readVectorKeys(ai_channel->mScalingKeys, ai_channel->mNumScalingKeys, ticksPerSecond),
+                animation.duration_, tolerance, storage[i], track.scale_);
+            rawKeyframes[i] += countRawKeyframes(ai_channel);
         }
-        else
-            body = currentNode->CreateComponent<RigidBody>();
-        body->SetMass(rigidBodyMass); // defaults to 0.0 which means a static body
-
-        // create physics shape
-        CollisionShape * const shape = currentNode->CreateComponent<CollisionShape>();
-        if (rigidBodyMass == 0.0f && !isElevator)
-            shape->SetTriangleMesh(model); // for static bodies, we can use non-convex geometry
-        // else if (isElevator)
-            // shape->SetBox(Vector3(2, 2, 2)); // HACK to test if using a primitive shape improved tunneling behavior
-        else
-            shape->SetConvexHull(model); // for dynamic bodies, the geometry must be convex!
-        shape->SetMargin(0.001);
+    }, numThreads);
+    for (CookedScene::Storage &animationStorage : storage)
+        scene.AdoptStorage(animationStorage);
+
+    std::unordered_set<std::string> animatedNames;
+    std::size_t totalRawBytes = 0;
+    std::size_t totalBytes = 0;
+    for (unsigned i = 0; i < numAnimations; ++i)
+    {
+        const CookedAnimation &animation = scene.animations_[i];
+        unsigned numKeys = 0;
+        for (const CookedAnimationTrack &track : animation.tracks_)
+        {
+            numKeys += countKeys(track);
+            animatedNames.insert(track.nodeName_);
+        }
+        const std::size_t rawBytes = rawKeyframes[i] * RAW_KEY_SIZE;
+        const std::size_t bytes = numKeys * COMPRESSED_KEY_SIZE + animation.tracks_.size() * 3 * sizeof(CookedAnimationChannel);
+        URHO3D_LOGINFOF("Animation '%s': %.2f s, %u tracks, %u keyframes -> %u keys, %u -> %u bytes",
+            animation.name_.c_str(), animation.duration_, static_cast<unsigned>(animation.tracks_.size()), rawKeyframes[i], numKeys,
+            static_cast<unsigned>(rawBytes), static_cast<unsigned>(bytes));
+        totalRawBytes += rawBytes;
+        totalBytes += bytes;
     }
+    if (numAnimations)
+        URHO3D_LOGINFOF("Animations: %u, %u -> %u bytes (%.1f%%)", numAnimations, static_cast<unsigned>(totalRawBytes),
+            static_cast<unsigned>(totalBytes), totalRawBytes ? 100.0f * totalBytes / totalRawBytes : 100.0f);
 
-    // check for custom game object type
-    if (const aiMetadata * const metadata = ai_node->mMetaData)
+    for (CookedNode &node : scene.nodes_)
+        node.animated_ = animatedNames.count(node.name_) != 0;
+}
+
+// a further LOD level is only worth it if it drops at least this share of the triangles
+static const float MIN_LOD_REDUCTION = 0.1f;
+// meshes this small are cheap enough as they are
+static const unsigned MIN_LOD_INDICES = 3 * 64;
+
+// adds simplified index buffers for drawing meshes at a distance
+static void cookLods(CookedScene &scene, const std::vector<NodeLod> &nodeLods, const CookSettings &cookSettings, unsigned numThreads)
+{
+    // a mesh takes the settings of the first node using it that overrides them
+    std::vector<NodeLod> meshLods(scene.meshes_.size());
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
     {
-        for (unsigned int i = 0; i < metadata->mNumProperties; ++i)
+        for (const unsigned meshIndex : scene.nodes_[i].meshes_)
         {
-            const std::string_view key = metadata->mKeys[i].C_Str();
-            const aiMetadataEntry &entry = metadata->mValues[i];
+            NodeLod &meshLod = meshLods[meshIndex];
+            if (meshLod.levels_ < 0)
+                meshLod.levels_ = nodeLods[i].levels_;
+            if (meshLod.distance_ < 0.0f)
+                meshLod.distance_ = nodeLods[i].distance_;
+        }
+    }
 
-            if (key == "GameObjectType" && entry.mType == AI_AISTRING)
+    std::vector<CookedScene::Storage> storage(scene.meshes_.size());
+    ParallelFor(scene.meshes_.size(), [&](std::size_t meshIndex)
+    {
+        CookedMesh &mesh = scene.meshes_[meshIndex];
+        const unsigned numLevels = (meshLods[meshIndex].levels_ >= 0) ? meshLods[meshIndex].levels_ : cookSettings.lodLevels_;
+        if (!numLevels || mesh.indexCount_ < MIN_LOD_INDICES)
+            return;
+
+        std::vector<Vector3> positions(mesh.vertexCount_);
+        for (unsigned i = 0; i < mesh.vertexCount_; ++i)
+            std::memcpy(&positions[i], mesh.vertexData_ + static_cast<std::size_t>(i) * mesh.vertexSize_, 3 * sizeof(float)); // position always comes first
+        std::vector<unsigned> indices(mesh.indexCount_);
+        for (unsigned i = 0; i < mesh.indexCount_; ++i)
+        {
+            if (mesh.largeIndices_)
+                std::memcpy(&indices[i], mesh.indexData_ + i * 4, 4);
+            else
             {
-                const aiString * const val = static_cast<const aiString*>(entry.mData);
-                const char * const type = val->C_Str();
-                // TODO store pointers, we are leaking these object currently!
-                if (strcmp(type, "JumpPad") == 0)
-                {
-                    JumpPad * const jumpPad = new JumpPad(currentNode);
-                }
-                else if (strcmp(type, "Ladder") == 0)
-                {
-                    Ladder * const ladder = new Ladder(currentNode);
-                }
-                else if (strcmp(type, "Elevator") == 0)
-                {
-                    Elevator * const elevator = new Elevator(currentNode);
-                }
+                uint16_t index;
+                std::memcpy(&index, mesh.indexData_ + i * 2, 2);
+                indices[i] = index;
             }
         }
-    }
 
-    AddText3DLabel(currentNode, ai_node->mName.C_Str());
+        float distance = (meshLods[meshIndex].distance_ >= 0.0f) ? meshLods[meshIndex].distance_ : cookSettings.lodDistance_;
+        for (unsigned level = 0; level < numLevels; ++level)
+        {
+            const std::size_t target = static_cast<std::size_t>(indices.size() * cookSettings.lodReduction_) / 3 * 3;
+            std::vector<unsigned> simplified = SimplifyMesh(positions, indices, target);
+            if (simplified.empty() || simplified.size() > indices.size() * (1.0f - MIN_LOD_REDUCTION))
+                break;
+            // the vertices are shared with the full mesh, so only the triangles get reordered
+            std::vector<unsigned> clusters;
+            const std::vector<unsigned> ordered = OptimizeOverdraw(positions, OptimizeVertexCache(simplified, mesh.vertexCount_, &clusters), clusters);
 
-    // recursively process children
-    for (unsigned int i = 0; i < ai_node->mNumChildren; ++i)
-        processAssimpNode(ai_node->mChildren[i], ai_scene, currentNode, context);
-}
+            CookedMesh::Lod lod;
+            lod.distance_ = distance;
+            lod.indexCount_ = static_cast<unsigned>(ordered.size());
+            unsigned char * const indexData = CookedScene::Allocate(storage[meshIndex], ordered.size() * (mesh.largeIndices_ ? 4 : 2));
+            unsigned char *dest = indexData;
+            for (const unsigned index : ordered)
+            {
+                if (mesh.largeIndices_)
+                    writeVertexValue(dest, index);
+                else
+                    writeVertexValue(dest, static_cast<uint16_t>(index));
+            }
+            lod.indexData_ = indexData;
+            mesh.lods_.push_back(lod);
 
-void loadSceneWithAssimp(const std::string &filename, Node *parentNode, Context *context)
-{
-    Assimp::Importer importer;
-    const aiScene * const ai_scene = importer.ReadFile(filename,
-        aiProcess_Triangulate |
-        aiProcess_GenSmoothNormals |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_ImproveCacheLocality |
-        aiProcess_RemoveRedundantMaterials |
-        aiProcess_SortByPType// |
-        //aiProcess_PreTransformVertices
-    );
+            indices.swap(simplified);
+            distance *= 2.0f;
+        }
+    }, numThreads);
+    for (CookedScene::Storage &meshStorage : storage)
+        scene.AdoptStorage(meshStorage);
 
-    if (!ai_scene || !ai_scene->mRootNode)
+    unsigned numLods = 0;
+    std::size_t fullTriangles = 0;
+    std::size_t coarsestTriangles = 0;
+    for (const CookedMesh &mesh : scene.meshes_)
     {
-        // std::cerr << "Error loading scene: " << importer.GetErrorString() << std::endl;
-        return;
+        numLods += static_cast<unsigned>(mesh.lods_.size());
+        fullTriangles += mesh.indexCount_ / 3;
+        coarsestTriangles += (mesh.lods_.empty() ? mesh.indexCount_ : mesh.lods_.back().indexCount_) / 3;
     }
+    if (numLods)
+        URHO3D_LOGINFOF("Cooked %u LOD levels: %u triangles at full detail, %u at the coarsest levels",
+            numLods, static_cast<unsigned>(fullTriangles), static_cast<unsigned>(coarsestTriangles));
+}
+
+static float readShapeRadius(const JsonValue &params, float defaultRadius)
+{
+    // cones and tapered capsules aren't supported by Bullet's primitives, so use the bigger end
+    if (params.Contains("radius"))
+        return params["radius"].GetFloat(defaultRadius);
+    return std::max(params["radiusTop"].GetFloat(defaultRadius), params["radiusBottom"].GetFloat(defaultRadius));
+}
+
+// the top-level KHR_implicit_shapes shape list (KHR_collision_shapes in older drafts), which Assimp
+// doesn't import; unsupported shape types are left empty so nodes using them keep their mesh colliders
+static std::vector<std::unique_ptr<CookedCollider>> cookGltfShapes(const JsonValue &gltf)
+{
+    const JsonValue &extensions = gltf["extensions"];
+    const JsonValue &shapes = extensions.Contains("KHR_implicit_shapes") ?
+        extensions["KHR_implicit_shapes"]["shapes"] : extensions["KHR_collision_shapes"]["shapes"];
+    std::vector<std::unique_ptr<CookedCollider>> result(shapes.Size());
+    for (std::size_t i = 0; i < shapes.Size(); ++i)
+    {
+        const JsonValue &shape = shapes[i];
+        const std::string &type = shape["type"].GetString();
+        const JsonValue &params = shape[type];
+        std::unique_ptr<CookedCollider> collider(new CookedCollider);
+        if (type == "box")
+        {
+            const JsonValue &size = params["size"];
+            collider->shape_ = CookedCollider::SHAPE_BOX;
+            collider->size_ = Vector3(size[0].GetFloat(1.0f), size[1].GetFloat(1.0f), size[2].GetFloat(1.0f));
+        }
+        else if (type == "sphere")
+        {
+            const float diameter = 2.0f * params["radius"].GetFloat(0.5f);
+            collider->shape_ = CookedCollider::SHAPE_SPHERE;
+            collider->size_ = Vector3(diameter, diameter, diameter);
+        }
+        else if (type == "capsule" || type == "cylinder")
+        {
+            const float radius = readShapeRadius(params, 0.25f);
+            const float height = params["height"].GetFloat(0.5f);
+            collider->shape_ = (type == "capsule") ? CookedCollider::SHAPE_CAPSULE : CookedCollider::SHAPE_CYLINDER;
+            // the glTF capsule height excludes the caps, Urho3D's includes them
+            const float totalHeight = (type == "capsule") ? height + 2.0f * radius : height;
+            collider->size_ = Vector3(2.0f * radius, totalHeight, 2.0f * radius);
+        }
+        else
+            continue;
+        result[i] = std::move(collider);
+    }
+    return result;
+}
+
+// nodes with a primitive collider but no motion of their own become part of the
+// closest ancestor's rigid body (a compound shape), or a static body by themselves
+static void cookColliders(const std::vector<std::unique_ptr<CookedCollider>> &shapes, const std::vector<NodePhysics> &nodePhysics, CookedScene &scene)
+{
+    std::vector<Matrix3x4> transforms(scene.nodes_.size());
+    std::vector<int> bodyOwners(scene.nodes_.size(), -1);
+    unsigned numColliders = 0;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        CookedNode &node = scene.nodes_[i];
+        const Matrix3x4 local(node.position_, node.rotation_, node.scale_);
+        transforms[i] = (node.parent_ < 0) ? local : transforms[node.parent_] * local;
+        if (nodePhysics[i].hasMotion_)
+            bodyOwners[i] = static_cast<int>(i);
+        else if (node.parent_ >= 0)
+            bodyOwners[i] = bodyOwners[node.parent_];
+
+        const int shapeIndex = nodePhysics[i].shape_;
+        if (shapeIndex < 0 || static_cast<std::size_t>(shapeIndex) >= shapes.size() || !shapes[shapeIndex])
+            continue;
+        CookedCollider collider = *shapes[shapeIndex];
+        ++numColliders;
+        const int owner = bodyOwners[i];
+        if (owner < 0 || owner == static_cast<int>(i))
+        {
+            node.colliders_.push_back(collider);
+            continue;
+        }
+
+        // express the shape in the owner's local space, Urho3D scales it by the owner's world scale
+        Vector3 position, scale;
+        Quaternion rotation;
+        (transforms[owner].Inverse() * transforms[i]).Decompose(position, rotation, scale);
+        collider.position_ = position;
+        collider.rotation_ = rotation;
+        collider.size_ = collider.size_ * scale;
+        scene.nodes_[owner].colliders_.push_back(collider);
+        node.partOfParentBody_ = true;
+    }
+    if (numColliders)
+        URHO3D_LOGINFOF("Cooked %u primitive colliders", numColliders);
+}
+
+static bool usesTriangleMesh(const CookedNode &node)
+{
+    // static bodies can use non-convex geometry, dynamic ones (and the kinematic elevator) need a convex hull
+    return node.mass_ == 0.0f && node.name_ != "Elevator";
+}
+
+static bool usesMeshCollider(const CookedNode &node)
+{
+    return node.colliders_.empty() && !node.partOfParentBody_;
+}
+
+// replaces the render vertices of convex hull colliders with a few hull points,
+// Bullet's convex collision cost grows with the point count
+static void cookConvexHulls(CookedScene &scene, const CookSettings &cookSettings, unsigned numThreads)
+{
+    std::vector<bool> usedAsHull(scene.meshes_.size(), false);
+    for (const CookedNode &node : scene.nodes_)
+        if (usesMeshCollider(node) && !usesTriangleMesh(node))
+            for (const unsigned meshIndex : node.meshes_)
+                usedAsHull[meshIndex] = true;
+    std::vector<unsigned> meshIndices;
+    for (unsigned i = 0; i < usedAsHull.size(); ++i)
+        if (usedAsHull[i])
+            meshIndices.push_back(i);
+
+    const float shrink = cookSettings.shrinkHulls_ ? MESH_COLLIDER_MARGIN : 0.0f;
+    std::vector<CookedScene::Storage> storage(meshIndices.size());
+    ParallelFor(meshIndices.size(), [&](std::size_t i)
+    {
+        CookedMesh &mesh = scene.meshes_[meshIndices[i]];
+        std::vector<Vector3> positions(mesh.vertexCount_);
+        for (unsigned j = 0; j < mesh.vertexCount_; ++j)
+            std::memcpy(&positions[j], mesh.vertexData_ + static_cast<std::size_t>(j) * mesh.vertexSize_, 3 * sizeof(float)); // position always comes first
+        const std::vector<Vector3> hull = ReduceConvexHull(positions, cookSettings.maxHullVertices_, shrink);
+        float * const hullData = reinterpret_cast<float*>(CookedScene::Allocate(storage[i], hull.size() * 3 * sizeof(float)));
+        for (std::size_t j = 0; j < hull.size(); ++j)
+        {
+            hullData[j * 3 + 0] = hull[j].x_;
+            hullData[j * 3 + 1] = hull[j].y_;
+            hullData[j * 3 + 2] = hull[j].z_;
+        }
+        mesh.hullVertexCount_ = static_cast<unsigned>(hull.size());
+        mesh.hullVertexData_ = hullData;
+    }, numThreads);
+    for (CookedScene::Storage &meshStorage : storage)
+        scene.AdoptStorage(meshStorage);
+    if (!meshIndices.empty())
+        URHO3D_LOGINFOF("Cooked %u convex hulls with at most %u points", static_cast<unsigned>(meshIndices.size()), std::max(cookSettings.maxHullVertices_, MIN_HULL_VERTICES));
+}
+
+// Assimp drops the KHR_lights_punctual "range", which is the distance the light is
+// meant to reach; the lights are named after the nodes that instance them
+static void cookGltfLightRanges(const JsonValue &gltf, CookedScene &scene)
+{
+    const JsonValue &lights = gltf["extensions"]["KHR_lights_punctual"]["lights"];
+    const JsonValue &nodes = gltf["nodes"];
+    for (std::size_t i = 0; i < nodes.Size(); ++i)
+    {
+        const JsonValue &lightIndex = nodes[i]["extensions"]["KHR_lights_punctual"]["light"];
+        if (!lightIndex.IsNumber())
+            continue;
+        const JsonValue &range = lights[static_cast<std::size_t>(lightIndex.GetInt())]["range"];
+        if (!range.IsNumber() || range.GetFloat() <= 0.0f)
+            continue;
+        const std::string &name = nodes[i]["name"].GetString();
+        for (CookedLight &light : scene.lights_)
+            if (light.name_ == name)
+                light.range_ = range.GetFloat();
+    }
+}
+
+// reads one EXT_mesh_gpu_instancing attribute, leaving values empty when it is absent
+static bool readInstanceAttribute(const JsonValue &gltf, const GltfBuffers &buffers, const JsonValue &attributes, const char * const name, unsigned numComponents, std::vector<float> &values)
+{
+    values.clear();
+    const JsonValue &accessor = attributes[name];
+    if (accessor.IsNull())
+        return true;
+    return accessor.IsNumber() && buffers.ReadFloats(gltf, static_cast<std::size_t>(accessor.GetInt()), numComponents, values);
+}
+
+// Assimp ignores EXT_mesh_gpu_instancing, so the instance transforms come from the glTF
+// accessors; the nodes are matched by name like the lights, Assimp names unnamed ones
+// after their index ("nodes_<index>"); the native reader passes the buffers it has
+// already loaded and decoded, otherwise they are loaded when the first node needs them
+static void cookGltfInstances(const JsonValue &gltf, const std::string &filename, CookedScene &scene, const GltfBuffers *loadedBuffers = nullptr)
+{
+    const JsonValue &nodes = gltf["nodes"];
+    GltfBuffers ownBuffers;
+    const GltfBuffers &buffers = loadedBuffers ? *loadedBuffers : ownBuffers;
+    bool haveBuffers = loadedBuffers != nullptr;
+    unsigned numNodes = 0;
+    std::size_t numInstances = 0;
+    for (std::size_t i = 0; i < nodes.Size(); ++i)
+    {
+        const JsonValue &attributes = nodes[i]["extensions"]["EXT_mesh_gpu_instancing"]["attributes"];
+        if (!attributes.IsObject() || !nodes[i].Contains("mesh"))
+            continue;
+        if (!haveBuffers)
+        {
+            ownBuffers.Load(filename, gltf);
+            ownBuffers.DecodeCompressedViews(gltf);
+            haveBuffers = true;
+        }
+        const std::string name = nodes[i]["name"].GetString().empty() ? "nodes_" + std::to_string(i) : nodes[i]["name"].GetString();
+        std::vector<float> translations, rotations, scales;
+        if (!readInstanceAttribute(gltf, buffers, attributes, "TRANSLATION", 3, translations) ||
+            !readInstanceAttribute(gltf, buffers, attributes, "ROTATION", 4, rotations) ||
+            !readInstanceAttribute(gltf, buffers, attributes, "SCALE", 3, scales))
+        {
+            URHO3D_LOGWARNINGF("Can't read the EXT_mesh_gpu_instancing attributes of '%s'", name.c_str());
+            continue;
+        }
+        // every attribute is optional, but those present have one element per instance
+        const std::size_t count = std::max(translations.size() / 3, std::max(rotations.size() / 4, scales.size() / 3));
+        if (!count || (!translations.empty() && translations.size() != count * 3) ||
+            (!rotations.empty() && rotations.size() != count * 4) || (!scales.empty() && scales.size() != count * 3))
+        {
+            URHO3D_LOGWARNINGF("Mismatched EXT_mesh_gpu_instancing attributes on '%s'", name.c_str());
+            continue;
+        }
+
+        std::vector<CookedInstance> instances(count);
+        for (std::size_t j = 0; j < count; ++j)
+        {
+            CookedInstance &instance = instances[j];
+            if (!translations.empty())
+                instance.position_ = Vector3(translations[j * 3], translations[j * 3 + 1], translations[j * 3 + 2]);
+            // glTF stores xyzw, and quantized rotations aren't quite unit length
+            if (!rotations.empty())
+                instance.rotation_ = Quaternion(rotations[j * 4 + 3], rotations[j * 4], rotations[j * 4 + 1], rotations[j * 4 + 2]).Normalized();
+            if (!scales.empty())
+                instance.scale_ = Vector3(scales[j * 3], scales[j * 3 + 1], scales[j * 3 + 2]);
+        }
+        for (CookedNode &node : scene.nodes_)
+        {
+            if (node.name_ != name || node.meshes_.empty())
+                continue;
+            node.instances_ = instances;
+            ++numNodes;
+            numInstances += count;
+        }
+    }
+    if (numNodes)
+        URHO3D_LOGINFOF("Cooked %u EXT_mesh_gpu_instancing nodes with %u instances", numNodes, static_cast<unsigned>(numInstances));
+}
+
+static bool isGltfFile(const std::string &filename)
+{
+    const std::size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+    std::string extension = filename.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {return static_cast<char>(std::tolower(c));});
+    return extension == "glb" || extension == "gltf";
+}
+
+// the log line comparing the cooked geometry against the old fixed format of 12 floats
+// per vertex and 32-bit indices
+static void logCookedGeometry(const CookedScene &scene)
+{
+    std::size_t geometryBytes = 0;
+    std::size_t uncompactedBytes = 0;
+    for (const CookedMesh &mesh : scene.meshes_)
+    {
+        geometryBytes += static_cast<std::size_t>(mesh.vertexCount_) * mesh.vertexSize_ + mesh.indexCount_ * (mesh.largeIndices_ ? 4 : 2);
+        uncompactedBytes += static_cast<std::size_t>(mesh.vertexCount_) * 12 * sizeof(float) + mesh.indexCount_ * 4;
+    }
+    URHO3D_LOGINFOF("Cooked %u meshes: %u KiB of vertex/index data (%u KiB uncompacted)",
+        static_cast<unsigned>(scene.meshes_.size()), static_cast<unsigned>(geometryBytes / 1024), static_cast<unsigned>(uncompactedBytes / 1024));
+}
+
+// glTF extensions the native reader handles or can safely ignore, files that require
+// any other one (e.g. Draco compressed geometry) are left to Assimp
+static bool isNativeGltfExtension(const std::string &extension)
+{
+    static const char * const extensions[] = {
+        "EXT_meshopt_compression",
+        "KHR_lights_punctual",
+        "KHR_physics_rigid_bodies",
+        "KHR_implicit_shapes",
+        "KHR_collision_shapes",
+        "EXT_mesh_gpu_instancing",
+        "KHR_mesh_quantization",
+        "KHR_materials_unlit",
+        "KHR_texture_transform"
+    };
+    for (const char * const known : extensions)
+        if (extension == known)
+            return true;
+    return false;
+}
+
+// one vertex attribute of a glTF primitive, read in place from the mapped (or decoded)
+// buffer; integer components (KHR_mesh_quantization) stay as they are and are only
+// converted while cooking reads them, sparse accessors are converted once up front
+class GltfAttribute
+{
+public:
+    bool Read(const JsonValue &gltf, const GltfBuffers &buffers, const JsonValue &accessor, unsigned numComponents)
+    {
+        if (accessor.IsNull())
+            return true;
+        if (!accessor.IsNumber())
+            return false;
+        const std::size_t accessorIndex = static_cast<std::size_t>(accessor.GetInt());
+        GltfBuffers::View view;
+        if (buffers.GetFloatView(gltf, accessorIndex, numComponents, view))
+        {
+            data_ = view.data_;
+            stride_ = view.stride_;
+            count_ = view.count_;
+            return true;
+        }
+        if (buffers.GetView(gltf, accessorIndex, numComponents, quantized_))
+        {
+            data_ = quantized_.data_;
+            stride_ = quantized_.stride_;
+            count_ = quantized_.count_;
+            return true;
+        }
+        if (!buffers.ReadFloats(gltf, accessorIndex, numComponents, converted_))
+            return false;
+        data_ = converted_.empty() ? nullptr : reinterpret_cast<const unsigned char*>(converted_.data());
+        stride_ = numComponents * sizeof(float);
+        count_ = converted_.size() / numComponents;
+        return true;
+    }
+    bool IsEmpty() const {return !data_;}
+    std::size_t GetCount() const {return count_;}
+    bool IsConverted() const {return !converted_.empty();}
+    bool IsQuantized() const {return quantized_.data_ != nullptr;}
+    float Get(std::size_t element, unsigned component) const
+    {
+        if (quantized_.data_)
+            return quantized_.Get(element, component);
+        float value;
+        std::memcpy(&value, data_ + element * stride_ + component * sizeof(float), sizeof(float));
+        return value;
+    }
+protected:
+    const unsigned char *data_ = nullptr;
+    std::size_t stride_ = 0;
+    std::size_t count_ = 0;
+    GltfBuffers::View quantized_; // only set for integer components
+    std::vector<float> converted_;
+};
+
+// the vertex attributes of a glTF primitive for cookMesh(), giving the same values
+// Assimp's glTF importer and post-processing would
+class GltfVertexSource
+{
+public:
+    bool Read(const JsonValue &gltf, const GltfBuffers &buffers, const JsonValue &attributes)
+    {
+        if (!positions_.Read(gltf, buffers, attributes["POSITION"], 3) || positions_.IsEmpty() ||
+            !normals_.Read(gltf, buffers, attributes["NORMAL"], 3) ||
+            !texCoords_.Read(gltf, buffers, attributes["TEXCOORD_0"], 2) ||
+            !tangents_.Read(gltf, buffers, attributes["TANGENT"], 4))
+            return false;
+        const std::size_t count = positions_.GetCount();
+        return (normals_.IsEmpty() || normals_.GetCount() == count) && (texCoords_.IsEmpty() || texCoords_.GetCount() == count) &&
+            (tangents_.IsEmpty() || tangents_.GetCount() == count);
+    }
+    // smooth normals for primitives without any, averaged over all vertices at the same
+    // position like aiProcess_GenSmoothNormals does after joining identical vertices
+    void GenerateNormals(const std::vector<unsigned> &indices)
+    {
+        if (!normals_.IsEmpty())
+            return;
+        const unsigned numVertices = GetNumVertices();
+        std::vector<Vector3> faceNormals(numVertices, Vector3::ZERO);
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const Vector3 p0 = GetPosition(indices[i]);
+            const Vector3 normal = (GetPosition(indices[i + 1]) - p0).CrossProduct(GetPosition(indices[i + 2]) - p0).Normalized();
+            for (unsigned k = 0; k < 3; ++k)
+                faceNormals[indices[i + k]] += normal;
+        }
+        std::map<std::tuple<float, float, float>, Vector3> sums;
+        for (unsigned i = 0; i < numVertices; ++i)
+        {
+            const Vector3 p = GetPosition(i);
+            sums[std::make_tuple(p.x_, p.y_, p.z_)] += faceNormals[i];
+        }
+        generatedNormals_.resize(numVertices);
+        for (unsigned i = 0; i < numVertices; ++i)
+        {
+            const Vector3 p = GetPosition(i);
+            generatedNormals_[i] = sums[std::make_tuple(p.x_, p.y_, p.z_)].Normalized();
+        }
+    }
+    unsigned GetNumVertices() const {return static_cast<unsigned>(positions_.GetCount());}
+    bool HasNormals() const {return !normals_.IsEmpty() || !generatedNormals_.empty();}
+    bool HasTexCoords() const {return !texCoords_.IsEmpty();}
+    bool HasTangents() const {return !tangents_.IsEmpty();}
+    // files with skins are read with Assimp instead, see cookGltfScene()
+    bool HasBlendWeights() const {return false;}
+    bool IsConverted() const {return positions_.IsConverted() || normals_.IsConverted() || texCoords_.IsConverted() || tangents_.IsConverted();}
+    bool IsQuantized() const {return positions_.IsQuantized() || normals_.IsQuantized() || texCoords_.IsQuantized() || tangents_.IsQuantized();}
+    Vector3 GetPosition(unsigned i) const {return Vector3(positions_.Get(i, 0), positions_.Get(i, 1), positions_.Get(i, 2));}
+    Vector3 GetNormal(unsigned i) const
+    {
+        return generatedNormals_.empty() ? Vector3(normals_.Get(i, 0), normals_.Get(i, 1), normals_.Get(i, 2)) : generatedNormals_[i];
+    }
+    // Assimp flips V on import
+    Vector2 GetTexCoord(unsigned i) const {return Vector2(texCoords_.Get(i, 0), 1.0f - texCoords_.Get(i, 1));}
+    Vector4 GetTangent(unsigned i) const
+    {
+        return Vector4(tangents_.Get(i, 0), tangents_.Get(i, 1), tangents_.Get(i, 2), tangents_.Get(i, 3) < 0.0f ? -1.0f : 1.0f);
+    }
+    const float * GetBlendWeights(unsigned i) const {return nullptr;}
+    const unsigned char * GetBlendIndices(unsigned i) const {return nullptr;}
+protected:
+    GltfAttribute positions_;
+    GltfAttribute normals_;
+    GltfAttribute texCoords_;
+    GltfAttribute tangents_;
+    std::vector<Vector3> generatedNormals_;
+};
+
+// glTF primitive modes
+enum GltfPrimitiveMode
+{
+    MODE_TRIANGLES = 4,
+    MODE_TRIANGLE_STRIP = 5,
+    MODE_TRIANGLE_FAN = 6
+};
+
+// the triangles of a primitive as a list, as aiProcess_Triangulate leaves them; false
+// for points and lines, which the loader has no use for, and for bad indices
+static bool readGltfTriangles(const JsonValue &gltf, const GltfBuffers &buffers, const JsonValue &primitive, unsigned numVertices, std::vector<unsigned> &triangles)
+{
+    const int mode = primitive["mode"].GetInt(MODE_TRIANGLES);
+    if (mode != MODE_TRIANGLES && mode != MODE_TRIANGLE_STRIP && mode != MODE_TRIANGLE_FAN)
+        return false;
+    std::vector<unsigned> indices;
+    if (primitive["indices"].IsNumber())
+    {
+        if (!buffers.ReadIndices(gltf, static_cast<std::size_t>(primitive["indices"].GetInt()), indices))
+            return false;
+    }
+    else
+    {
+        indices.resize(numVertices);
+        std::iota(indices.begin(), indices.end(), 0);
+    }
+    for (const unsigned index : indices)
+        if (index >= numVertices)
+            return false;
+
+    triangles.clear();
+    if (mode == MODE_TRIANGLES)
+    {
+        indices.resize(indices.size() / 3 * 3);
+        triangles.swap(indices);
+        return true;
+    }
+    for (std::size_t i = 2; i < indices.size(); ++i)
+    {
+        if (mode == MODE_TRIANGLE_FAN)
+            triangles.insert(triangles.end(), {indices[0], indices[i - 1], indices[i]});
+        else if (i % 2 == 0)
+            triangles.insert(triangles.end(), {indices[i - 2], indices[i - 1], indices[i]});
+        else
+            triangles.insert(triangles.end(), {indices[i - 2], indices[i], indices[i - 1]});
+    }
+    return true;
+}
+
+// a triangle primitive ready to be cooked, Assimp makes one mesh of each
+struct GltfPrimitive
+{
+    std::string name_;
+    GltfVertexSource vertices_;
+    std::vector<unsigned> indices_;
+    unsigned materialIndex_ = CookedMesh::NO_MATERIAL;
+};
+
+// reads every primitive up front, so the cooking jobs only do the heavy part; fills in
+// the cooked mesh indices of each glTF mesh, leaving out primitives it can't use
+static std::vector<GltfPrimitive> readGltfPrimitives(const JsonValue &gltf, const GltfBuffers &buffers, std::vector<std::vector<unsigned>> &meshPrimitives)
+{
+    const JsonValue &meshes = gltf["meshes"];
+    const std::size_t numMaterials = gltf["materials"].Size();
+    std::vector<GltfPrimitive> result;
+    meshPrimitives.assign(meshes.Size(), std::vector<unsigned>());
+    unsigned numConverted = 0;
+    unsigned numQuantized = 0;
+    for (std::size_t i = 0; i < meshes.Size(); ++i)
+    {
+        const JsonValue &primitives = meshes[i]["primitives"];
+        const std::string meshName = meshes[i]["name"].GetString().empty() ? "meshes_" + std::to_string(i) : meshes[i]["name"].GetString();
+        for (std::size_t j = 0; j < primitives.Size(); ++j)
+        {
+            const JsonValue &primitive = primitives[j];
+            GltfPrimitive cooked;
+            cooked.name_ = (primitives.Size() > 1) ? meshName + "-" + std::to_string(j) : meshName;
+            if (!cooked.vertices_.Read(gltf, buffers, primitive["attributes"]) ||
+                !readGltfTriangles(gltf, buffers, primitive, cooked.vertices_.GetNumVertices(), cooked.indices_) || cooked.indices_.empty())
+            {
+                URHO3D_LOGWARNINGF("Skipping primitive '%s', it isn't a readable triangle mesh", cooked.name_.c_str());
+                continue;
+            }
+            // primitives without a material get Assimp's default one, which is added after the others
+            const JsonValue &material = primitive["material"];
+            cooked.materialIndex_ = (material.IsNumber() && static_cast<std::size_t>(material.GetInt()) < numMaterials) ?
+                static_cast<unsigned>(material.GetInt()) : static_cast<unsigned>(numMaterials);
+            numConverted += cooked.vertices_.IsConverted() ? 1 : 0;
+            numQuantized += cooked.vertices_.IsQuantized() ? 1 : 0;
+            meshPrimitives[i].push_back(static_cast<unsigned>(result.size()));
+            result.push_back(std::move(cooked));
+        }
+    }
+    if (numConverted)
+        URHO3D_LOGINFOF("Converted the vertex data of %u of %u primitives, the rest was read in place", numConverted, static_cast<unsigned>(result.size()));
+    if (numQuantized)
+        URHO3D_LOGINFOF("%u of %u primitives have quantized vertex data, read in place", numQuantized, static_cast<unsigned>(result.size()));
+    return result;
+}
+
+// false unless the glTF textureInfo uses TEXCOORD_0 and its image is in a buffer view;
+// external image files and extension-only sources (KHR_texture_basisu, ...) are left out
+static bool readGltfTexture(const JsonValue &gltf, const GltfBuffers &buffers, const JsonValue &textureInfo, TextureSource &source)
+{
+    if (!textureInfo.IsObject() || textureInfo["texCoord"].GetInt(0) != 0)
+        return false;
+    const JsonValue &texture = gltf["textures"][static_cast<std::size_t>(textureInfo["index"].GetInt(-1))];
+    const JsonValue &image = gltf["images"][static_cast<std::size_t>(texture["source"].GetInt(-1))];
+    return image["bufferView"].IsNumber() && buffers.GetBufferView(gltf, static_cast<std::size_t>(image["bufferView"].GetInt()), source.data_, source.size_);
+}
+
+// base color textures and normal maps go to textureSources
+static void cookGltfMaterials(const JsonValue &gltf, const GltfBuffers &buffers, const std::vector<GltfPrimitive> &primitives, CookedScene &scene,
+    std::vector<TextureSource> &textureSources)
+{
+    const JsonValue &materials = gltf["materials"];
+    scene.materials_.resize(materials.Size());
+    for (std::size_t i = 0; i < materials.Size(); ++i)
+    {
+        const JsonValue &pbr = materials[i]["pbrMetallicRoughness"];
+        const JsonValue &factor = pbr["baseColorFactor"];
+        if (factor.Size() >= 3)
+            scene.materials_[i].diffuseColor_ = Color(factor[0].GetFloat(1.0f), factor[1].GetFloat(1.0f), factor[2].GetFloat(1.0f));
+        scene.materials_[i].alphaMode_ = readAlphaMode(materials[i]["alphaMode"].GetString());
+
+        TextureSource source;
+        source.material_ = static_cast<unsigned>(i);
+        if (readGltfTexture(gltf, buffers, pbr["baseColorTexture"], source))
+            textureSources.push_back(std::move(source));
+        TextureSource normalSource;
+        normalSource.material_ = static_cast<unsigned>(i);
+        normalSource.normalMap_ = true;
+        if (readGltfTexture(gltf, buffers, materials[i]["normalTexture"], normalSource))
+            textureSources.push_back(std::move(normalSource));
+    }
+    for (const GltfPrimitive &primitive : primitives)
+    {
+        if (primitive.materialIndex_ >= materials.Size())
+        {
+            scene.materials_.emplace_back(); // white, like the glTF default material
+            break;
+        }
+    }
+}
+
+// glTF nodes become the same CookedNodes as through Assimp, which keeps the extras as
+// the top-level metadata and the extensions under "extensions"; lightNames gets the
+// name of the node instancing each light, which Assimp renames the light to
+static void cookGltfNode(const JsonValue &gltf, std::size_t gltfIndex, int parentIndex, const std::vector<std::vector<unsigned>> &meshPrimitives,
+    CookedScene &scene, std::vector<NodePhysics> &nodePhysics, std::vector<NodeLod> &nodeLods, std::vector<std::string> &lightNames)
+{
+    const JsonValue &gltfNode = gltf["nodes"][gltfIndex];
+    const int nodeIndex = static_cast<int>(scene.nodes_.size());
+    scene.nodes_.emplace_back();
+    CookedNode &node = scene.nodes_.back();
+    node.name_ = gltfNode["name"].GetString().empty() ? "nodes_" + std::to_string(gltfIndex) : gltfNode["name"].GetString();
+    node.parent_ = parentIndex;
+
+    const JsonValue &matrix = gltfNode["matrix"];
+    if (matrix.Size() == 16)
+    {
+        // column major
+        const Matrix3x4 transform(
+            matrix[0].GetFloat(), matrix[4].GetFloat(), matrix[8].GetFloat(), matrix[12].GetFloat(),
+            matrix[1].GetFloat(), matrix[5].GetFloat(), matrix[9].GetFloat(), matrix[13].GetFloat(),
+            matrix[2].GetFloat(), matrix[6].GetFloat(), matrix[10].GetFloat(), matrix[14].GetFloat());
+        transform.Decompose(node.position_, node.rotation_, node.scale_);
+    }
+    else
+    {
+        const JsonValue &translation = gltfNode["translation"];
+        const JsonValue &rotation = gltfNode["rotation"];
+        const JsonValue &scale = gltfNode["scale"];
+        if (translation.Size() == 3)
+            node.position_ = Vector3(translation[0].GetFloat(), translation[1].GetFloat(), translation[2].GetFloat());
+        if (rotation.Size() == 4)
+            node.rotation_ = Quaternion(rotation[3].GetFloat(1.0f), rotation[0].GetFloat(), rotation[1].GetFloat(), rotation[2].GetFloat());
+        if (scale.Size() == 3)
+            node.scale_ = Vector3(scale[0].GetFloat(1.0f), scale[1].GetFloat(1.0f), scale[2].GetFloat(1.0f));
+    }
+
+    const JsonValue &extras = gltfNode["extras"];
+    const JsonValue &rigidBody = gltfNode["extensions"]["KHR_physics_rigid_bodies"];
+    node.mass_ = rigidBody["motion"]["mass"].GetFloat(0.0f);
+    node.gameObjectType_ = extras["GameObjectType"].GetString();
+    const JsonValue &streamingCell = extras["StreamingCell"];
+    node.streamingCell_ = streamingCell.IsNumber() ? std::to_string(static_cast<long long>(streamingCell.GetFloat())) : streamingCell.GetString();
+    const JsonValue &meshIndex = gltfNode["mesh"];
+    if (meshIndex.IsNumber() && static_cast<std::size_t>(meshIndex.GetInt()) < meshPrimitives.size())
+        node.meshes_ = meshPrimitives[static_cast<std::size_t>(meshIndex.GetInt())];
+    const JsonValue &lightIndex = gltfNode["extensions"]["KHR_lights_punctual"]["light"];
+    if (lightIndex.IsNumber() && static_cast<std::size_t>(lightIndex.GetInt()) < lightNames.size())
+        lightNames[static_cast<std::size_t>(lightIndex.GetInt())] = node.name_;
+
+    NodePhysics physics;
+    physics.hasMotion_ = rigidBody.Contains("motion");
+    // current spec: collider.geometry.shape, older drafts: collider.shape
+    const JsonValue &collider = rigidBody["collider"];
+    const JsonValue &shape = collider["geometry"].Contains("shape") ? collider["geometry"]["shape"] : collider["shape"];
+    if (shape.IsNumber() && shape.GetFloat() >= 0.0f)
+        physics.shape_ = shape.GetInt();
+    nodePhysics.push_back(physics);
+    NodeLod lod;
+    if (extras["LodLevels"].IsNumber() && extras["LodLevels"].GetFloat() >= 0.0f)
+        lod.levels_ = extras["LodLevels"].GetInt();
+    if (extras["LodDistance"].IsNumber() && extras["LodDistance"].GetFloat() >= 0.0f)
+        lod.distance_ = extras["LodDistance"].GetFloat();
+    nodeLods.push_back(lod);
+
+    // recursively process children, note that "node" may be invalidated from here on
+    const JsonValue &children = gltfNode["children"];
+    for (std::size_t i = 0; i < children.Size(); ++i)
+    {
+        const std::size_t child = static_cast<std::size_t>(children[i].GetInt(-1));
+        if (child < gltf["nodes"].Size())
+            cookGltfNode(gltf, child, nodeIndex, meshPrimitives, scene, nodePhysics, nodeLods, lightNames);
+    }
+}
+
+// Assimp gives every light an inverse square falloff and folds the intensity into the color
+static void cookGltfLights(const JsonValue &gltf, const std::vector<std::string> &lightNames, CookedScene &scene)
+{
+    const JsonValue &lights = gltf["extensions"]["KHR_lights_punctual"]["lights"];
+    scene.lights_.reserve(lights.Size());
+    for (std::size_t i = 0; i < lights.Size(); ++i)
+    {
+        const JsonValue &gltfLight = lights[i];
+        const std::string &type = gltfLight["type"].GetString();
+        CookedLight light;
+        light.name_ = lightNames[i].empty() ? gltfLight["name"].GetString() : lightNames[i];
+        if (type == "directional")
+            light.type_ = LIGHT_DIRECTIONAL;
+        else if (type == "spot")
+        {
+            light.type_ = LIGHT_SPOT;
+            light.fov_ = Urho3D::ToDegrees(gltfLight["spot"]["outerConeAngle"].GetFloat(0.7853982f)); // spec default of pi / 4
+        }
+        light.attenuationQuadratic_ = 1.0f;
+        const JsonValue &color = gltfLight["color"];
+        const float brightest = (color.Size() == 3) ? std::max(color[0].GetFloat(), std::max(color[1].GetFloat(), color[2].GetFloat())) : 1.0f;
+        light.range_ = cookLightRange(light, brightest * gltfLight["intensity"].GetFloat(1.0f));
+        scene.lights_.push_back(light);
+    }
+    cookGltfLightRanges(gltf, scene);
+}
+
+// the glTF counterpart of cookAssimpScene(): vertex data goes from the mapped file
+// straight into the cooked buffers without an aiScene in between; returns false
+// (leaving scene untouched) when the file has to go through Assimp after all
+static bool cookGltfScene(const std::string &filename, CookedScene &scene, const CookSettings &cookSettings, bool useTextureCache, unsigned numThreads, LoadProfile * const profile)
+{
+    std::unique_ptr<LoadProfileScope> stage(new LoadProfileScope(profile, "gltf_read"));
+    JsonValue gltf;
+    if (!ReadGltfJson(filename, gltf))
+        return false;
+    bool compressed = false;
+    for (const JsonValue &extension : gltf["extensionsRequired"].GetElements())
+    {
+        if (!isNativeGltfExtension(extension.GetString()))
+        {
+            URHO3D_LOGINFOF("'%s' requires %s, reading it with Assimp", filename.c_str(), extension.GetString().c_str());
+            return false;
+        }
+        compressed = compressed || extension.GetString() == "EXT_meshopt_compression";
+    }
+    // the skinned meshes and animations are only imported through Assimp so far, which
+    // can't decode compressed buffers though; those files lose them instead
+    if (gltf["skins"].Size() || gltf["animations"].Size())
+    {
+        if (!compressed)
+        {
+            URHO3D_LOGINFOF("'%s' has skins or animations, reading it with Assimp", filename.c_str());
+            return false;
+        }
+        URHO3D_LOGWARNINGF("'%s' has skins or animations, which need Assimp, but Assimp can't read its EXT_meshopt_compression data; "
+            "importing it without them", filename.c_str());
+    }
+    GltfBuffers buffers;
+    buffers.Load(filename, gltf);
+    {
+        LoadProfileScope decodeStage(profile, "gltf_read/meshopt_decode");
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const GltfBuffers::DecodeStats decodeStats = buffers.DecodeCompressedViews(gltf, numThreads);
+        decodeStage.SetBytes(decodeStats.decodedBytes_);
+        if (decodeStats.numViews_)
+        {
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            URHO3D_LOGINFOF("Decoded %u EXT_meshopt_compression buffer views: %u KiB -> %u KiB in %.2f ms (%.0f MB/s)", decodeStats.numViews_,
+                static_cast<unsigned>(decodeStats.compressedBytes_ / 1024), static_cast<unsigned>(decodeStats.decodedBytes_ / 1024),
+                elapsed.count(), decodeStats.decodedBytes_ / std::max(elapsed.count(), 0.001) / 1000.0);
+        }
+    }
+    std::vector<std::vector<unsigned>> meshPrimitives;
+    std::vector<GltfPrimitive> primitives = readGltfPrimitives(gltf, buffers, meshPrimitives);
+
+    stage.reset(new LoadProfileScope(profile, "cook/meshes"));
+    std::vector<TextureSource> textureSources;
+    cookGltfMaterials(gltf, buffers, primitives, scene, textureSources);
+    // one job per primitive, biggest first so the longest jobs don't end up last
+    std::vector<unsigned> order(primitives.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&primitives](unsigned a, unsigned b)
+    {
+        return primitives[a].vertices_.GetNumVertices() > primitives[b].vertices_.GetNumVertices();
+    });
+    scene.meshes_.resize(primitives.size());
+    std::vector<CookedScene::Storage> storage(primitives.size());
+    std::vector<MeshOptimizeStats> optimizeStats(primitives.size());
+    ParallelFor(order.size(), [&](std::size_t i)
+    {
+        const unsigned meshIndex = order[i];
+        GltfPrimitive &primitive = primitives[meshIndex];
+        primitive.vertices_.GenerateNormals(primitive.indices_);
+        cookMesh(primitive.vertices_, primitive.indices_, storage[meshIndex], scene.meshes_[meshIndex], optimizeStats[meshIndex]);
+        scene.meshes_[meshIndex].materialIndex_ = primitive.materialIndex_;
+    }, numThreads);
+    for (CookedScene::Storage &meshStorage : storage)
+        scene.AdoptStorage(meshStorage);
+    for (std::size_t i = 0; i < primitives.size(); ++i)
+        URHO3D_LOGINFOF("Mesh '%s': %u triangles, ACMR %.3f -> %.3f", primitives[i].name_.c_str(),
+            scene.meshes_[i].indexCount_ / 3, optimizeStats[i].acmrBefore_, optimizeStats[i].acmrAfter_);
+    logCookedGeometry(scene);
+    stage.reset(new LoadProfileScope(profile, "cook/textures"));
+    if (cookSettings.importTextures_)
+        cookTextures(textureSources, filename, useTextureCache, scene, numThreads);
+
+    // like Assimp, a scene with several root nodes gets a "ROOT" node above them
+    stage.reset(new LoadProfileScope(profile, "cook/nodes"));
+    const JsonValue &sceneRoots = gltf["scenes"][static_cast<std::size_t>(gltf["scene"].GetInt(0))]["nodes"];
+    std::vector<NodePhysics> nodePhysics;
+    std::vector<NodeLod> nodeLods;
+    std::vector<std::string> lightNames(gltf["extensions"]["KHR_lights_punctual"]["lights"].Size());
+    int rootIndex = -1;
+    if (sceneRoots.Size() != 1)
+    {
+        scene.nodes_.emplace_back();
+        scene.nodes_.back().name_ = "ROOT";
+        nodePhysics.emplace_back();
+        nodeLods.emplace_back();
+        rootIndex = 0;
+    }
+    for (std::size_t i = 0; i < sceneRoots.Size(); ++i)
+    {
+        const std::size_t gltfIndex = static_cast<std::size_t>(sceneRoots[i].GetInt(-1));
+        if (gltfIndex < gltf["nodes"].Size())
+            cookGltfNode(gltf, gltfIndex, rootIndex, meshPrimitives, scene, nodePhysics, nodeLods, lightNames);
+    }
+    cookColliders(cookGltfShapes(gltf), nodePhysics, scene);
+    cookGltfInstances(gltf, filename, scene, &buffers);
+    stage.reset(new LoadProfileScope(profile, "cook/lods"));
+    cookLods(scene, nodeLods, cookSettings, numThreads);
+    stage.reset(new LoadProfileScope(profile, "cook/convex_hulls"));
+    if (cookSettings.maxHullVertices_)
+        cookConvexHulls(scene, cookSettings, numThreads);
+    stage.reset(new LoadProfileScope(profile, "cook/lights"));
+    cookGltfLights(gltf, lightNames, scene);
+    return true;
+}
+
+static void cookAssimpScene(const aiScene * const ai_scene, const std::string &filename, CookedScene &scene, const CookSettings &cookSettings, bool useTextureCache, unsigned numThreads, LoadProfile * const profile)
+{
+    std::unique_ptr<LoadProfileScope> stage(new LoadProfileScope(profile, "cook/meshes"));
+    std::vector<TextureSource> textureSources;
+    cookAssimpMaterials(ai_scene, scene, textureSources);
+
+    // one job per mesh, biggest first so the longest jobs don't end up last
+    std::vector<unsigned> order(ai_scene->mNumMeshes);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [ai_scene](unsigned a, unsigned b)
+    {
+        return ai_scene->mMeshes[a]->mNumVertices > ai_scene->mMeshes[b]->mNumVertices;
+    });
+    scene.meshes_.resize(ai_scene->mNumMeshes);
+    std::vector<CookedScene::Storage> storage(ai_scene->mNumMeshes);
+    std::vector<MeshOptimizeStats> optimizeStats(ai_scene->mNumMeshes);
+    ParallelFor(order.size(), [&](std::size_t i)
+    {
+        const unsigned meshIndex = order[i];
+        cookAssimpMesh(ai_scene->mMeshes[meshIndex], scene.materials_.size(), storage[meshIndex], scene.meshes_[meshIndex], optimizeStats[meshIndex]);
+    }, numThreads);
+    for (CookedScene::Storage &meshStorage : storage)
+        scene.AdoptStorage(meshStorage);
+    for (unsigned i = 0; i < ai_scene->mNumMeshes; ++i)
+        URHO3D_LOGINFOF("Mesh '%s': %u triangles, ACMR %.3f -> %.3f", ai_scene->mMeshes[i]->mName.C_Str(),
+            scene.meshes_[i].indexCount_ / 3, optimizeStats[i].acmrBefore_, optimizeStats[i].acmrAfter_);
+    logCookedGeometry(scene);
+    stage.reset(new LoadProfileScope(profile, "cook/textures"));
+    if (cookSettings.importTextures_)
+        cookTextures(textureSources, filename, useTextureCache, scene, numThreads);
+
+    stage.reset(new LoadProfileScope(profile, "cook/nodes"));
+    std::vector<NodePhysics> nodePhysics;
+    std::vector<NodeLod> nodeLods;
+    cookAssimpNode(ai_scene->mRootNode, -1, scene, nodePhysics, nodeLods);
+    cookAssimpBoneParents(ai_scene, scene);
+    JsonValue gltf;
+    const bool haveGltf = isGltfFile(filename) && ReadGltfJson(filename, gltf);
+    if (haveGltf)
+    {
+        cookColliders(cookGltfShapes(gltf), nodePhysics, scene);
+        cookGltfInstances(gltf, filename, scene);
+    }
+    stage.reset(new LoadProfileScope(profile, "cook/animations"));
+    cookAssimpAnimations(ai_scene, cookSettings, scene, numThreads);
+    stage.reset(new LoadProfileScope(profile, "cook/lods"));
+    cookLods(scene, nodeLods, cookSettings, numThreads);
+    stage.reset(new LoadProfileScope(profile, "cook/convex_hulls"));
+    if (cookSettings.maxHullVertices_)
+        cookConvexHulls(scene, cookSettings, numThreads);
+    stage.reset(new LoadProfileScope(profile, "cook/lights"));
+    cookAssimpLights(ai_scene, scene);
+    if (haveGltf)
+        cookGltfLightRanges(gltf, scene);
+}
+
+static void instantiateCookedLights(const CookedScene &scene, Node * const parentNode)
+{
+    for (const CookedLight &cookedLight : scene.lights_)
+    {
+        Node *realParentNode = parentNode->GetChild(cookedLight.name_.c_str(), true);
+        if (!realParentNode)
+            realParentNode = parentNode;
+        Node * const lightNode = realParentNode->CreateChild(cookedLight.name_.c_str());
+        Light * const light = lightNode->CreateComponent<Light>();
+
+        light->SetLightType(cookedLight.type_);
+        light->SetRange(cookedLight.range_);
+        if (cookedLight.type_ == LIGHT_SPOT)
+            light->SetFov(cookedLight.fov_);
+
+        // set position
+        if (cookedLight.type_ != LIGHT_DIRECTIONAL)
+            lightNode->SetPosition(cookedLight.position_);
+
+        // TODO set color
+        light->SetColor(Color(1.0f, 1.0f, 1.0f));
+
+        // TODO set brightness
+        light->SetBrightness(1.0f);
+
+        // enable shadow casting, a ShadowBudget takes it away from the less important lights
+        light->SetCastShadows(true);
+#ifdef USING_RBFX
+        light->SetShadowBias(BiasParameters(0.000025f, 1.0f, 0.001));
+#else // U3D
+        light->SetShadowBias(BiasParameters(0.000025f, 0.5f, 0.001));
+#endif // USING_RBFX
+        light->SetShadowCascade(CascadeParameters(10.0f, 50.0f, 200.0f, 0.0f, 0.8f));
+    }
+}
+
+static SharedPtr<Model> loadModel(const CookedMesh &mesh, Context * const context, bool shadowed = true)
+{
+    SharedPtr<Model> model(new Model(context));
+    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
+    SharedPtr<IndexBuffer> ib(new IndexBuffer(context));
+    SharedPtr<Geometry> geom(new Geometry(context));
+
+    // enable keeping a CPU-side copy of the data, needed later for physics
+    vb->SetShadowed(shadowed);
+    ib->SetShadowed(shadowed);
+
+#ifdef USING_RBFX
+    vb->SetSize(mesh.vertexCount_, VertexMaskFlags(mesh.vertexMask_));
+    vb->Update(mesh.vertexData_);
+#else // U3D
+    vb->SetSize(mesh.vertexCount_, mesh.vertexMask_);
+    vb->SetData(mesh.vertexData_);
+#endif
+
+    ib->SetSize(mesh.indexCount_, mesh.largeIndices_);
+#ifdef USING_RBFX
+    ib->Update(mesh.indexData_);
+#else // U3D
+    ib->SetData(mesh.indexData_);
+#endif
+
+    geom->SetVertexBuffer(0, vb);
+    geom->SetIndexBuffer(ib);
+    geom->SetDrawRange(TRIANGLE_LIST, 0, mesh.indexCount_);
+
+    model->SetNumGeometries(1);
+    model->SetNumGeometryLodLevels(0, 1 + static_cast<unsigned>(mesh.lods_.size()));
+    model->SetGeometry(0, 0, geom);
+
+    // simplified levels share the vertex buffer, physics only ever uses the full mesh
+    for (std::size_t i = 0; i < mesh.lods_.size(); ++i)
+    {
+        const CookedMesh::Lod &lod = mesh.lods_[i];
+        SharedPtr<IndexBuffer> lodIb(new IndexBuffer(context));
+        lodIb->SetSize(lod.indexCount_, mesh.largeIndices_);
+#ifdef USING_RBFX
+        lodIb->Update(lod.indexData_);
+#else // U3D
+        lodIb->SetData(lod.indexData_);
+#endif
+        SharedPtr<Geometry> lodGeom(new Geometry(context));
+        lodGeom->SetVertexBuffer(0, vb);
+        lodGeom->SetIndexBuffer(lodIb);
+        lodGeom->SetDrawRange(TRIANGLE_LIST, 0, lod.indexCount_);
+        lodGeom->SetLodDistance(lod.distance_);
+        model->SetGeometry(0, static_cast<unsigned>(i + 1), lodGeom);
+    }
+    model->SetBoundingBox(mesh.boundingBox_);
+
+    // the bones get their nodes when an AnimatedModel uses the Model, see instantiateSkinnedMeshes()
+    if (!mesh.bones_.empty())
+    {
+        Skeleton skeleton;
+        auto &bones = skeleton.GetModifiableBones();
+        bool haveRoot = false;
+        for (unsigned i = 0; i < mesh.bones_.size(); ++i)
+        {
+            const CookedMesh::Bone &cookedBone = mesh.bones_[i];
+            Bone bone;
+            bone.name_ = cookedBone.name_.c_str();
+            bone.nameHash_ = StringHash(bone.name_);
+            bone.parentIndex_ = cookedBone.parent_;
+            bone.offsetMatrix_ = cookedBone.offsetMatrix_;
+            bone.boundingBox_ = cookedBone.boundingBox_;
+            // the AnimatedModel's bounds are merged from the bones' boxes
+#ifdef USING_RBFX
+            bone.collisionMask_ = cookedBone.boundingBox_.Defined() ? BoneCollisionShape::Box : BoneCollisionShape::None;
+#else // U3D
+            bone.collisionMask_ = cookedBone.boundingBox_.Defined() ? BONECOLLISION_BOX : BONECOLLISION_NONE;
+#endif // USING_RBFX
+            bones.push_back(bone);
+            if (cookedBone.parent_ == i && !haveRoot)
+            {
+                skeleton.SetRootBoneIndex(i);
+                haveRoot = true;
+            }
+        }
+        model->SetSkeleton(skeleton);
+    }
+
+    return model;
+}
+
+// uploads every level of a cooked texture as is, no decoding or mip generation left to do
+static SharedPtr<Texture2D> loadTexture(const CookedTexture &cookedTexture, Context * const context)
+{
+    SharedPtr<Texture2D> texture(new Texture2D(context));
+    texture->SetNumLevels(static_cast<unsigned>(cookedTexture.levels_.size()));
+#ifdef USING_RBFX
+    const TextureFormat format = (cookedTexture.format_ == BLOCK_FORMAT_BC3) ? TextureFormat::TEX_FORMAT_BC3_UNORM : TextureFormat::TEX_FORMAT_BC1_UNORM;
+#else // U3D
+    const unsigned format = Graphics::GetFormat(cookedTexture.format_ == BLOCK_FORMAT_BC3 ? CF_DXT5 : CF_DXT1);
+#endif // USING_RBFX
+    if (!texture->SetSize(cookedTexture.width_, cookedTexture.height_, format))
+        return SharedPtr<Texture2D>();
+    for (std::size_t i = 0; i < cookedTexture.levels_.size(); ++i)
+    {
+        const CookedTexture::Level &level = cookedTexture.levels_[i];
+        texture->SetData(static_cast<unsigned>(i), 0, 0, level.width_, level.height_, level.data_);
+    }
+    return texture;
+}
+
+// textures are shared through the ResourceCache by the hash of their image, so the
+// streaming cells, reloads and instantiations of a level upload each image only once;
+// null without a GPU that reads block-compressed textures (or any GPU, when headless)
+static Texture2D * getOrLoadTexture(const CookedTexture &cookedTexture, Context * const context)
+{
+    Graphics * const graphics = context->GetSubsystem<Graphics>();
+#ifdef USING_RBFX
+    if (!graphics)
+#else // U3D
+    if (!graphics || !graphics->GetDXTTextureSupport())
+#endif // USING_RBFX
+        return nullptr;
+
+    ResourceCache * const cache = context->GetSubsystem<ResourceCache>();
+    char name[64];
+    std::snprintf(name, sizeof(name), "CookedTextures/%016llx.dds", static_cast<unsigned long long>(cookedTexture.hash_));
+    Texture2D *texture = cache->GetExistingResource<Texture2D>(name);
+    if (texture)
+        return texture;
+    SharedPtr<Texture2D> newTexture = loadTexture(cookedTexture, context);
+    if (!newTexture)
+        return nullptr;
+    newTexture->SetName(name);
+    cache->AddManualResource(newTexture);
+    return newTexture;
+}
+
+// textured only when the mesh has the texture coordinates for it, and normal mapped only
+// when it also has tangents and a base color texture, since the engine's normal mapped
+// techniques all sample a diffuse map
+static SharedPtr<Material> createCookedMaterial(const CookedScene &scene, const CookedMesh &mesh, Context * const context)
+{
+    const CookedMaterial &material = scene.materials_[mesh.materialIndex_];
+    Texture2D * const texture = (material.diffuseTexture_ != CookedMaterial::NO_TEXTURE && (mesh.vertexMask_ & MASK_TEXCOORD1)) ?
+        getOrLoadTexture(scene.textures_[material.diffuseTexture_], context) : nullptr;
+    if (!texture)
+        return CreateMaterial(context, material.diffuseColor_);
+    Texture2D * const normalTexture = (material.normalTexture_ != CookedMaterial::NO_TEXTURE && (mesh.vertexMask_ & MASK_TANGENT)) ?
+        getOrLoadTexture(scene.textures_[material.normalTexture_], context) : nullptr;
+    const char *technique = normalTexture ? "Techniques/DiffNormal.xml" : "Techniques/Diff.xml";
+    if (material.alphaMode_ == CookedMaterial::ALPHA_MASK)
+        technique = normalTexture ? "Techniques/DiffNormalAlphaMask.xml" : "Techniques/DiffAlphaMask.xml";
+    else if (material.alphaMode_ == CookedMaterial::ALPHA_BLEND)
+        technique = normalTexture ? "Techniques/DiffNormalAlpha.xml" : "Techniques/DiffAlpha.xml";
+    return CreateMaterial(context, material.diffuseColor_, texture, normalTexture, technique);
+}
+
+// position-only Model of the reduced hull points, only ever read by ConvexData
+static SharedPtr<Model> loadHullModel(const CookedMesh &mesh, Context * const context)
+{
+    SharedPtr<Model> model(new Model(context));
+    SharedPtr<VertexBuffer> vb(new VertexBuffer(context));
+    SharedPtr<Geometry> geom(new Geometry(context));
+
+    vb->SetShadowed(true);
+    vb->SetSize(mesh.hullVertexCount_, MASK_POSITION);
+#ifdef USING_RBFX
+    vb->Update(mesh.hullVertexData_);
+#else // U3D
+    vb->SetData(mesh.hullVertexData_);
+#endif
+
+    geom->SetVertexBuffer(0, vb);
+    geom->SetDrawRange(POINT_LIST, 0, 0, 0, mesh.hullVertexCount_);
+
+    model->SetNumGeometries(1);
+    model->SetGeometry(0, 0, geom);
+    model->SetBoundingBox(mesh.boundingBox_);
+
+    return model;
+}
+
+#ifdef ENABLE_NODE_LABELS
+// one label set for the whole level, instead of a Text3D (and a child node) per node
+static NodeLabels * CreateNodeLabels(Node * const parentNode, float fontSize = 24.0f)
+{
+    Context * const context = parentNode->GetContext();
+    ResourceCache * const cache = context->GetSubsystem<ResourceCache>();
+
+    // Load font (use default Urho3D font or custom)
+    Font *font = cache->GetResource<Font>("Fonts/Anonymous Pro.ttf");
+    if (!font)
+    {
+        // URHO3D_LOGWARNING("Failed to load font 'Fonts/Anonymous Pro.ttf', using fallback");
+        font = cache->GetResource<Font>("Fonts/BlueHighway.ttf"); // Fallback font
+    }
+
+    Node * const labelsNode = parentNode->CreateChild("NodeLabels");
+    NodeLabels * const labels = new NodeLabels(context);
+#ifdef USING_RBFX
+    labelsNode->AddComponent(labels, 0);
+#else
+    labelsNode->AddComponent(labels, 0, Urho3D::REPLICATED);
+#endif
+    labels->SetFont(font, fontSize);
+    return labels;
+}
+
+static void AddNodeLabel(NodeLabels * const labels, Node * const targetNode, const std::string &text, const BoundingBox *modelBox, const Color &color = Color::WHITE, float offsetY = 2.5f)
+{
+    // Position above the target node
+    Vector3 position = Vector3::ZERO;
+    if (modelBox) // passed in, since batched static nodes have no StaticModel of their own
+    {
+        const BoundingBox &bb = *modelBox;
+        position.y_ = bb.max_.y_ * targetNode->GetScale().y_ + offsetY; // Above bounding box // TODO I think this isn't quite right...
+    }
+    else
+    {
+        position.y_ = offsetY; // Fallback fixed offset
+    }
+
+    labels->AddLabel(targetNode, text, position, color);
+}
+#endif // ENABLE_NODE_LABELS
+
+// which kinds of collision geometry the nodes build from each mesh
+enum ShapeUsage
+{
+    USES_TRIANGLE_MESH = 1,
+    USES_CONVEX_HULL = 2,
+    USES_MODEL = 4 // referenced by any node at all
+};
+
+static std::vector<unsigned char> getShapeUsage(const CookedScene &scene)
+{
+    std::vector<unsigned char> usage(scene.meshes_.size(), 0);
+    for (const CookedNode &node : scene.nodes_)
+    {
+        for (const unsigned meshIndex : node.meshes_)
+        {
+            usage[meshIndex] |= USES_MODEL;
+            // skinned meshes get no collider, it would be stuck in the bind pose
+            if (usesMeshCollider(node) && scene.meshes_[meshIndex].bones_.empty())
+                usage[meshIndex] |= usesTriangleMesh(node) ? USES_TRIANGLE_MESH : USES_CONVEX_HULL;
+        }
+    }
+    return usage;
+}
+
+// import-scoped state shared by all nodes of one instantiation
+struct InstantiateState
+{
+    explicit InstantiateState(const CookedScene &scene) :
+        models_(scene.meshes_.size()),
+        hullModels_(scene.meshes_.size()),
+        shapeUsage_(getShapeUsage(scene)),
+        batched_(scene.nodes_.size(), false),
+        instanced_(scene.nodes_.size(), false),
+        labels_(nullptr),
+        profile_(nullptr),
+        sharedModels_(nullptr),
+        modelShared_(scene.meshes_.size(), false),
+        hullModelShared_(scene.meshes_.size(), false),
+        compactPhysics_(false),
+        physicsWeldDistance_(0.0f),
+        physicsMeshBytes_(0),
+        droppedShadowBytes_(0),
+        meshReferences_(0),
+        uniqueModels_(0)
+    {
+    }
+    // one Model per cooked mesh, shared by every node referencing it; since
+    // PhysicsWorld caches cooked triangle meshes and convex hulls per Model,
+    // this also shares the Bullet collision geometry between those nodes
+    std::vector<SharedPtr<Model>> models_;
+    // Models of the reduced convex hulls, the convex collision shapes use these instead when set
+    std::vector<SharedPtr<Model>> hullModels_;
+    std::vector<unsigned char> shapeUsage_;
+    // nodes whose meshes are drawn by a static batch instead of their own StaticModels
+    std::vector<bool> batched_;
+    // same for the instance groups
+    std::vector<bool> instanced_;
+    // keeps the pre-cooked collision geometry alive until the shapes using it exist,
+    // otherwise PhysicsWorld::CleanupGeometryCache() drops it when the first shape is set up
+    std::vector<SharedPtr<CollisionGeometryData>> precookedShapes_;
+    NodeLabels *labels_; // null when labels are disabled
+    LoadProfile *profile_;
+    // the models of the other parts of the level, null when scene stands alone; the flags
+    // tell the models_ and hullModels_ taken from there
+    SharedSceneModels *sharedModels_;
+    std::vector<bool> modelShared_;
+    std::vector<bool> hullModelShared_;
+    // triangle-mesh colliders use PhysicsMeshes, see SceneLoaderOptions::compactPhysicsMeshes_
+    bool compactPhysics_;
+    float physicsWeldDistance_;
+    std::size_t physicsMeshBytes_;
+    std::size_t droppedShadowBytes_; // CPU-side Model copies not kept or released
+    unsigned meshReferences_; // one per mesh of every created node
+    unsigned uniqueModels_;
+};
+
+static RigidBody * createRigidBody(const CookedNode &cookedNode, Node * const currentNode, Context * const context)
+{
+    // several meshes/colliders share one body, which also survives a hot reload rebuilding the node
+    RigidBody *body = currentNode->GetComponent<RigidBody>();
+    const bool isElevator = cookedNode.name_ == "Elevator";
+    if (body)
+    {
+        body->SetMass(cookedNode.mass_);
+        if (!isElevator)
+            body->SetKinematic(cookedNode.animated_ && cookedNode.mass_ <= 0.0f);
+        return body;
+    }
+    if (isElevator)
+    {
+        // NOTE: we cannot use currentNode->CreateComponent<KinematicRigidBody>()
+        // for two reasons: RigidBody is explicitly sought by PhyicsWorld and
+        // friends, and we are making an imposter RigidBody via KinematicRigidBody
+        // not being registered "properly" with omitting the URHO3D_OBJECT macro
+        body = new KinematicRigidBody(context);
+#ifdef USING_RBFX
+        currentNode->AddComponent(body, 0);
+#else
+        currentNode->AddComponent(body, 0, Urho3D::REPLICATED);
+#endif
+    }
+    else
+        body = currentNode->CreateComponent<RigidBody>();
+    body->SetMass(cookedNode.mass_); // defaults to 0.0 which means a static body
+    // moved by an animation, so it pushes dynamic bodies along instead of teleporting through them
+    if (cookedNode.animated_ && cookedNode.mass_ <= 0.0f)
+        body->SetKinematic(true);
+    return body;
+}
+
+// Urho3D reads the CPU-side copy of a Model's buffers when building collision geometry
+// from it, with compact physics meshes that's only left for unreduced convex hulls
+static bool needsShadowData(const CookedScene &scene, unsigned meshIndex, const InstantiateState &state)
+{
+    if (!state.compactPhysics_)
+        return true;
+    return (state.shapeUsage_[meshIndex] & USES_CONVEX_HULL) && !scene.meshes_[meshIndex].hullVertexCount_;
+}
+
+// the slot of meshIndex in models shared by the parts of a level, null for a scene of its own
+static WeakPtr<Model> * getSharedSlot(std::vector<WeakPtr<Model>> &sharedModels, const CookedScene &scene, unsigned meshIndex)
+{
+    if (meshIndex >= scene.sourceMeshes_.size())
+        return nullptr;
+    const unsigned sourceIndex = scene.sourceMeshes_[meshIndex];
+    if (sourceIndex >= sharedModels.size())
+        sharedModels.resize(sourceIndex + 1);
+    return &sharedModels[sourceIndex];
+}
+
+static SharedPtr<Model> loadSceneModel(const CookedScene &scene, unsigned meshIndex, InstantiateState &state, Context * const context)
+{
+    WeakPtr<Model> * const shared = state.sharedModels_ ? getSharedSlot(state.sharedModels_->models_, scene, meshIndex) : nullptr;
+    if (shared && shared->Get())
+    {
+        // a missing CPU-side copy for the collision shapes is made up for in reuseSharedShapes()
+        state.modelShared_[meshIndex] = true;
+        return SharedPtr<Model>(shared->Get());
+    }
+    const CookedMesh &mesh = scene.meshes_[meshIndex];
+    const bool shadowed = needsShadowData(scene, meshIndex, state);
+    if (!shadowed)
+        state.droppedShadowBytes_ += static_cast<std::size_t>(mesh.vertexCount_) * mesh.vertexSize_ + mesh.indexCount_ * (mesh.largeIndices_ ? 4 : 2);
+    ++state.uniqueModels_;
+    SharedPtr<Model> model = loadModel(mesh, context, shadowed);
+    if (shared)
+        *shared = model;
+    return model;
+}
+
+static SharedPtr<Model> loadSceneHullModel(const CookedScene &scene, unsigned meshIndex, InstantiateState &state, Context * const context)
+{
+    WeakPtr<Model> * const shared = state.sharedModels_ ? getSharedSlot(state.sharedModels_->hullModels_, scene, meshIndex) : nullptr;
+    if (shared && shared->Get())
+    {
+        state.hullModelShared_[meshIndex] = true;
+        return SharedPtr<Model>(shared->Get());
+    }
+    SharedPtr<Model> model = loadHullModel(scene.meshes_[meshIndex], context);
+    if (shared)
+        *shared = model;
+    return model;
+}
+
+static Model * getOrLoadModel(const CookedScene &scene, unsigned meshIndex, InstantiateState &state, Context * const context)
+{
+    SharedPtr<Model> &model = state.models_[meshIndex];
+    if (!model)
+        model = loadSceneModel(scene, meshIndex, state, context);
+    return model;
+}
+
+static Model * getOrLoadHullModel(const CookedScene &scene, unsigned meshIndex, InstantiateState &state, Context * const context)
+{
+    const CookedMesh &mesh = scene.meshes_[meshIndex];
+    if (!mesh.hullVertexCount_)
+        return getOrLoadModel(scene, meshIndex, state, context);
+    SharedPtr<Model> &model = state.hullModels_[meshIndex];
+    if (!model)
+        model = loadSceneHullModel(scene, meshIndex, state, context);
+    return model;
+}
+
+// Bullet collision geometry for one Model, cooked on a worker thread
+struct ShapeJob
+{
+    unsigned meshIndex_;
+    bool triangleMesh_;
+    SharedPtr<CollisionGeometryData> result_;
+    std::size_t physicsMeshBytes_;
+    // made on the main thread, for the BVH cache or a compact physics mesh
+    SharedPtr<CustomTriangleMeshData> customData_;
+};
+
+static Model * getConvexModel(const InstantiateState &state, unsigned meshIndex)
+{
+    return state.hullModels_[meshIndex] ? state.hullModels_[meshIndex] : state.models_[meshIndex];
+}
+
+static bool hasShadowData(Model * const model)
+{
+    Geometry * const geometry = model->GetGeometry(0, 0);
+    VertexBuffer * const vb = geometry->GetVertexBuffer(0);
+    IndexBuffer * const ib = geometry->GetIndexBuffer();
+    return vb && vb->IsShadowed() && (!ib || ib->IsShadowed());
+}
+
+// the collision geometry of Models shared with another part of the level (see
+// SharedSceneModels) may be in the PhysicsWorld caches already, then their jobs are
+// dropped and the geometry is kept alive like a cooked one; the other part may have
+// released the CPU-side copy of a Model too, then this one loads its own to cook from
+static void reuseSharedShapes(const CookedScene &scene, PhysicsWorld * const physicsWorld, std::vector<ShapeJob> &jobs, InstantiateState &state, Context * const context)
+{
+    // first, so a job never finds the geometry of a Model that is replaced afterwards
+    for (const ShapeJob &job : jobs)
+    {
+        const unsigned i = job.meshIndex_;
+        const bool hull = !job.triangleMesh_ && state.hullModels_[i];
+        const bool needsShadow = !job.triangleMesh_ || !state.compactPhysics_;
+        if (!(hull ? state.hullModelShared_[i] : state.modelShared_[i]) || !needsShadow)
+            continue;
+        SharedPtr<Model> &model = hull ? state.hullModels_[i] : state.models_[i];
+        if (hasShadowData(model))
+            continue;
+        if (hull)
+        {
+            model = loadHullModel(scene.meshes_[i], context);
+            *getSharedSlot(state.sharedModels_->hullModels_, scene, i) = model;
+            state.hullModelShared_[i] = false;
+        }
+        else
+        {
+            model = loadModel(scene.meshes_[i], context, true);
+            *getSharedSlot(state.sharedModels_->models_, scene, i) = model;
+            state.modelShared_[i] = false;
+            ++state.uniqueModels_;
+        }
+    }
+
+    std::vector<ShapeJob> remaining;
+    for (ShapeJob &job : jobs)
+    {
+        const unsigned i = job.meshIndex_;
+        const bool hull = !job.triangleMesh_ && state.hullModels_[i];
+        if (hull ? state.hullModelShared_[i] : state.modelShared_[i])
+        {
+            Model * const model = hull ? state.hullModels_[i].Get() : state.models_[i].Get();
+            auto &cache = job.triangleMesh_ ? physicsWorld->GetTriMeshCache() : physicsWorld->GetConvexCache();
+#ifdef USING_RBFX
+            const auto it = cache.find(ea::pair<Model*, unsigned>(model, 0));
+            if (it != cache.end())
+                job.result_ = it->second;
+#else // U3D
+            const auto it = cache.Find(Pair<Model*, unsigned>(model, 0));
+            if (it != cache.End())
+                job.result_ = it->second_;
+#endif // USING_RBFX
+            if (job.result_)
+            {
+                state.precookedShapes_.push_back(job.result_);
+                continue;
+            }
+        }
+        remaining.push_back(std::move(job));
+    }
+    jobs.swap(remaining);
+}
+
+// cooks the triangle-mesh BVHs and convex hulls for already loaded Models on worker threads,
+// optionally reading and writing the BVH cache next to the source file; the triangle jobs
+// need their customData_ for the cache or compact physics meshes
+static void cookShapes(const CookedScene &scene, const InstantiateState &state, std::vector<ShapeJob> &jobs, bool useBvhCache, unsigned numThreads)
+{
+    // biggest first so the longest jobs don't end up last
+    std::sort(jobs.begin(), jobs.end(), [&scene](const ShapeJob &a, const ShapeJob &b)
+    {
+        return scene.meshes_[a.meshIndex_].indexCount_ > scene.meshes_[b.meshIndex_].indexCount_;
+    });
+
+    BvhCache bvhCache;
+    const std::string bvhCacheFilename = scene.sourceFilename_ + BVH_CACHE_EXTENSION;
+    if (useBvhCache)
+        bvhCache.Load(bvhCacheFilename);
+    std::vector<uint64_t> meshHashes(jobs.size(), 0);
+    std::atomic<unsigned> numBuilt(0);
+    ParallelFor(jobs.size(), [&](std::size_t i)
+    {
+        ShapeJob &job = jobs[i];
+        if (!job.triangleMesh_)
+        {
+            job.result_ = new ConvexData(getConvexModel(state, job.meshIndex_), 0);
+            return;
+        }
+        if (state.compactPhysics_)
+        {
+            std::shared_ptr<PhysicsMesh> physicsMesh = CreatePhysicsMesh(scene.meshes_[job.meshIndex_], state.physicsWeldDistance_);
+            job.physicsMeshBytes_ = physicsMesh->GetMemoryUse();
+            job.result_ = job.customData_;
+            if (useBvhCache)
+            {
+                meshHashes[i] = HashPhysicsMesh(*physicsMesh);
+                if (bvhCache.CreateTriangleMesh(*job.customData_, meshHashes[i], physicsMesh))
+                    return;
+            }
+            CreatePhysicsTriangleMesh(*job.customData_, physicsMesh);
+            ++numBuilt;
+            return;
+        }
+        if (useBvhCache)
+        {
+            meshHashes[i] = HashTriangleMesh(scene.meshes_[job.meshIndex_]);
+            if (bvhCache.CreateTriangleMesh(*job.customData_, meshHashes[i], scene.meshes_[job.meshIndex_], state.models_[job.meshIndex_]))
+            {
+                job.result_ = job.customData_;
+                return;
+            }
+        }
+        job.result_ = new TriangleMeshData(state.models_[job.meshIndex_], 0);
+        ++numBuilt;
+    }, numThreads);
+
+    if (!useBvhCache)
+        return;
+    std::vector<std::pair<uint64_t, TriangleMeshData*>> triangleMeshes;
+    for (std::size_t i = 0; i < jobs.size(); ++i)
+        if (jobs[i].triangleMesh_)
+            triangleMeshes.emplace_back(meshHashes[i], static_cast<TriangleMeshData*>(jobs[i].result_.Get()));
+    URHO3D_LOGINFOF("Triangle mesh BVHs: %u from cache '%s', %u built",
+        static_cast<unsigned>(triangleMeshes.size()) - numBuilt.load(), bvhCacheFilename.c_str(), numBuilt.load());
+    // NOTE: Windows won't replace the file while the old one is still mapped; a part of
+    // the level keeps the BVHs of the other parts
+    const BvhCache * const keep = scene.source_ ? &bvhCache : nullptr;
+    if (numBuilt && !BvhCache::Save(bvhCacheFilename, triangleMeshes, keep))
+        URHO3D_LOGWARNINGF("Failed to write BVH cache '%s'", bvhCacheFilename.c_str());
+}
+
+// seeds the PhysicsWorld caches, so setting up the CollisionShapes afterwards is just a cache lookup
+static void addCookedShapes(PhysicsWorld * const physicsWorld, const std::vector<ShapeJob> &jobs, InstantiateState &state)
+{
+    state.precookedShapes_.reserve(jobs.size());
+    for (const ShapeJob &job : jobs)
+    {
+        Model * const model = job.triangleMesh_ ? state.models_[job.meshIndex_].Get() : getConvexModel(state, job.meshIndex_);
+#ifdef USING_RBFX
+        const ea::pair<Model*, unsigned> key(model, 0);
+#else // U3D
+        const Pair<Model*, unsigned> key(model, 0);
+#endif // USING_RBFX
+        if (job.triangleMesh_)
+            physicsWorld->GetTriMeshCache()[key] = job.result_;
+        else
+            physicsWorld->GetConvexCache()[key] = job.result_;
+        state.precookedShapes_.push_back(job.result_);
+        state.physicsMeshBytes_ += job.physicsMeshBytes_;
+    }
+}
+
+// lets the buffers of a Model drop their CPU-side copies once the collision geometry built
+// from them exists, returns the bytes freed
+static std::size_t releaseShadowData(Model * const model)
+{
+    std::size_t bytes = 0;
+    for (unsigned i = 0; i < model->GetNumGeometries(); ++i)
+    {
+        for (unsigned lod = 0; lod < model->GetNumGeometryLodLevels(i); ++lod)
+        {
+            Geometry * const geometry = model->GetGeometry(i, lod);
+            // the LOD levels share their vertex buffer, and without graphics the copy is all there is
+            for (unsigned j = 0; j < geometry->GetNumVertexBuffers(); ++j)
+            {
+                VertexBuffer * const vb = geometry->GetVertexBuffer(j);
+                if (!vb || !vb->IsShadowed())
+                    continue;
+                vb->SetShadowed(false);
+                if (!vb->IsShadowed())
+                    bytes += static_cast<std::size_t>(vb->GetVertexCount()) * vb->GetVertexSize();
+            }
+            IndexBuffer * const ib = geometry->GetIndexBuffer();
+            if (ib && ib->IsShadowed())
+            {
+                ib->SetShadowed(false);
+                if (!ib->IsShadowed())
+                    bytes += static_cast<std::size_t>(ib->GetIndexCount()) * ib->GetIndexSize();
+            }
+        }
+    }
+    return bytes;
+}
+
+static void releaseShapeShadowData(InstantiateState &state)
+{
+    for (const SharedPtr<Model> &model : state.models_)
+        if (model)
+            state.droppedShadowBytes_ += releaseShadowData(model);
+    for (const SharedPtr<Model> &model : state.hullModels_)
+        if (model)
+            state.droppedShadowBytes_ += releaseShadowData(model);
+    URHO3D_LOGINFOF("Compact physics meshes: %u KiB, CPU-side render buffer copies dropped: %u KiB (%d KiB saved)",
+        static_cast<unsigned>(state.physicsMeshBytes_ / 1024), static_cast<unsigned>(state.droppedShadowBytes_ / 1024),
+        static_cast<int>((static_cast<long long>(state.droppedShadowBytes_) - static_cast<long long>(state.physicsMeshBytes_)) / 1024));
+}
+
+// EXT_mesh_gpu_instancing: a StaticModelGroup per mesh draws it at a child node per
+// instance, and one body gets a compound shape with a shape per instance, all of them
+// sharing the collision geometry of the mesh
+static void instantiateNodeInstances(const CookedScene &scene, const CookedNode &cookedNode, Node * const currentNode, InstantiateState &state, Context * const context)
+{
+    std::vector<Node*> instanceNodes;
+    instanceNodes.reserve(cookedNode.instances_.size());
+    for (const CookedInstance &instance : cookedNode.instances_)
+    {
+        Node * const instanceNode = currentNode->CreateChild(INSTANCE_NODE_NAME);
+        instanceNode->SetPosition(instance.position_);
+        instanceNode->SetRotation(instance.rotation_);
+        instanceNode->SetScale(instance.scale_);
+        instanceNodes.push_back(instanceNode);
+    }
+
+    const bool meshCollider = usesMeshCollider(cookedNode);
+    for (const unsigned meshIndex : cookedNode.meshes_)
+    {
+        const CookedMesh &mesh = scene.meshes_[meshIndex];
+        ++state.meshReferences_;
+        Model * const model = getOrLoadModel(scene, meshIndex, state, context);
+        StaticModelGroup * const group = currentNode->CreateComponent<StaticModelGroup>();
+        group->SetModel(model);
+        group->SetCastShadows(true);
+        if (mesh.materialIndex_ != CookedMesh::NO_MATERIAL)
+        {
+            LoadProfileScope stage(state.profile_, "instantiate/nodes/materials");
+            group->SetMaterial(createCookedMaterial(scene, mesh, context));
+        }
+        for (Node * const instanceNode : instanceNodes)
+            group->AddInstanceNode(instanceNode);
+
+        if (!meshCollider)
+            continue;
+        const bool triangleMesh = usesTriangleMesh(cookedNode);
+        Model * const shapeModel = triangleMesh ? model : getOrLoadHullModel(scene, meshIndex, state, context);
+        for (const CookedInstance &instance : cookedNode.instances_)
+        {
+            CollisionShape * const shape = currentNode->CreateComponent<CollisionShape>();
+            if (triangleMesh)
+                shape->SetTriangleMesh(shapeModel, 0, instance.scale_, instance.position_, instance.rotation_);
+            else
+                shape->SetConvexHull(shapeModel, 0, instance.scale_, instance.position_, instance.rotation_);
+            shape->SetMargin(MESH_COLLIDER_MARGIN);
+        }
+    }
+
+    // a new body picks up the existing shapes all at once, instead of recomputing its
+    // mass and inertia for every added shape
+    if (meshCollider && !cookedNode.meshes_.empty())
+        createRigidBody(cookedNode, currentNode, context);
+}
+
+// a rebuild only replaces the components made from the meshes and colliders, the node
+// keeps its body, game object and label
+static void instantiateCookedNode(const CookedScene &scene, std::size_t nodeIndex, Node * const currentNode, InstantiateState &state, Context * const context, bool rebuild = false)
+{
+    const CookedNode &cookedNode = scene.nodes_[nodeIndex];
+    currentNode->SetPosition(cookedNode.position_);
+    currentNode->SetRotation(cookedNode.rotation_);
+    currentNode->SetScale(cookedNode.scale_);
+
+    // EXT_mesh_gpu_instancing nodes draw their meshes at each instance instead
+    if (!cookedNode.instances_.empty())
+        instantiateNodeInstances(scene, cookedNode, currentNode, state, context);
+    else
+    {
+        for (const unsigned meshIndex : cookedNode.meshes_)
+        {
+            const CookedMesh &mesh = scene.meshes_[meshIndex];
+            // once per node mesh, however many components (shapes, instance groups) share its model
+            ++state.meshReferences_;
+            // drawn by an AnimatedModel once the bones' nodes exist, see instantiateSkinnedMeshes()
+            if (!mesh.bones_.empty())
+                continue;
+
+            // load mesh, or reuse it if another node already did
+            Model * const model = getOrLoadModel(scene, meshIndex, state, context);
+
+            // apply mesh, unless a static batch or an instance group draws it
+            if (!state.batched_[nodeIndex] && !state.instanced_[nodeIndex])
+            {
+                StaticModel * const sm = currentNode->CreateComponent<StaticModel>();
+                sm->SetModel(model);
+                sm->SetCastShadows(true);
+
+                // apply material
+                if (mesh.materialIndex_ != CookedMesh::NO_MATERIAL)
+                {
+                    LoadProfileScope stage(state.profile_, "instantiate/nodes/materials");
+                    SharedPtr<Material> mat = createCookedMaterial(scene, mesh, context);
+                    sm->SetMaterial(mat);
+                }
+            }
+
+            // create physics body and shape, unless primitive colliders replace the mesh
+            if (!usesMeshCollider(cookedNode))
+                continue;
+            createRigidBody(cookedNode, currentNode, context);
+            CollisionShape * const shape = currentNode->CreateComponent<CollisionShape>();
+            if (usesTriangleMesh(cookedNode))
+                shape->SetTriangleMesh(model); // for static bodies, we can use non-convex geometry
+            // else if (isElevator)
+                // shape->SetBox(Vector3(2, 2, 2)); // HACK to test if using a primitive shape improved tunneling behavior
+            else
+            {
+                shape->SetConvexHull(getOrLoadHullModel(scene, meshIndex, state, context)); // for dynamic bodies, the geometry must be convex!
+                if (mesh.hullVertexCount_)
+                    URHO3D_LOGINFOF("Convex hull of '%s': %u -> %u points", cookedNode.name_.c_str(), mesh.vertexCount_, mesh.hullVertexCount_);
+                else
+                    URHO3D_LOGINFOF("Convex hull of '%s': %u points (not reduced)", cookedNode.name_.c_str(), mesh.vertexCount_);
+            }
+            shape->SetMargin(MESH_COLLIDER_MARGIN);
+        }
+    }
+
+    // primitive colliders, several of them make a compound shape
+    if (!cookedNode.colliders_.empty())
+    {
+        createRigidBody(cookedNode, currentNode, context);
+        for (const CookedCollider &collider : cookedNode.colliders_)
+        {
+            CollisionShape * const shape = currentNode->CreateComponent<CollisionShape>();
+            switch (collider.shape_)
+            {
+            case CookedCollider::SHAPE_BOX:
+                shape->SetBox(collider.size_, collider.position_, collider.rotation_);
+                break;
+            case CookedCollider::SHAPE_SPHERE:
+                shape->SetSphere(collider.size_.x_, collider.position_, collider.rotation_);
+                break;
+            case CookedCollider::SHAPE_CAPSULE:
+                shape->SetCapsule(collider.size_.x_, collider.size_.y_, collider.position_, collider.rotation_);
+                break;
+            case CookedCollider::SHAPE_CYLINDER:
+                shape->SetCylinder(collider.size_.x_, collider.size_.y_, collider.position_, collider.rotation_);
+                break;
+            }
+        }
+    }
+
+    if (rebuild)
+        return;
+
+    // check for custom game object type
+    if (!cookedNode.gameObjectType_.empty())
+    {
+        const std::string &type = cookedNode.gameObjectType_;
+        // TODO store pointers, we are leaking these object currently!
+        if (type == "JumpPad")
+        {
+            JumpPad * const jumpPad = new JumpPad(currentNode);
+        }
+        else if (type == "Ladder")
+        {
+            Ladder * const ladder = new Ladder(currentNode);
+        }
+        else if (type == "Elevator")
+        {
+            Elevator * const elevator = new Elevator(currentNode);
+        }
+    }
+
+#ifdef ENABLE_NODE_LABELS
+    if (state.labels_)
+    {
+        LoadProfileScope stage(state.profile_, "instantiate/nodes/labels");
+        const BoundingBox * const labelBox = cookedNode.meshes_.empty() ? nullptr : &scene.meshes_[cookedNode.meshes_.front()].boundingBox_;
+        AddNodeLabel(state.labels_, currentNode, cookedNode.name_, labelBox);
+    }
+#endif // ENABLE_NODE_LABELS
+}
+
+// a node is static if neither it nor any of its ancestors has a moving body or is animated
+static std::vector<bool> findStaticNodes(const CookedScene &scene)
+{
+    std::vector<bool> isStatic(scene.nodes_.size(), false);
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        const CookedNode &cookedNode = scene.nodes_[i];
+        const bool parentStatic = cookedNode.parent_ < 0 || isStatic[cookedNode.parent_];
+        isStatic[i] = parentStatic && !cookedNode.animated_ && usesTriangleMesh(cookedNode) && cookedNode.gameObjectType_ != "Elevator";
+    }
+    return isStatic;
+}
+
+static bool hasSkinnedMeshes(const CookedScene &scene, const CookedNode &cookedNode)
+{
+    for (const unsigned meshIndex : cookedNode.meshes_)
+        if (!scene.meshes_[meshIndex].bones_.empty())
+            return true;
+    return false;
+}
+
+static std::vector<Matrix3x4> getWorldTransforms(const CookedScene &scene)
+{
+    std::vector<Matrix3x4> transforms(scene.nodes_.size());
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        const CookedNode &cookedNode = scene.nodes_[i];
+        const Matrix3x4 local(cookedNode.position_, cookedNode.rotation_, cookedNode.scale_);
+        transforms[i] = (cookedNode.parent_ < 0) ? local : transforms[cookedNode.parent_] * local;
+    }
+    return transforms;
+}
+
+// static nodes whose meshes a batch or an instance group can draw for them, nodes with
+// EXT_mesh_gpu_instancing instances or skinned meshes draw their own
+static std::vector<bool> findMergeableNodes(const CookedScene &scene)
+{
+    std::vector<bool> mergeable = findStaticNodes(scene);
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+        if (!scene.nodes_[i].instances_.empty() || hasSkinnedMeshes(scene, scene.nodes_[i]))
+            mergeable[i] = false;
+    return mergeable;
+}
+
+static std::vector<bool> findInstancedNodes(const CookedScene &scene, const SceneLoaderOptions &options)
+{
+    if (!options.instanceRepeatedMeshes_)
+        return std::vector<bool>(scene.nodes_.size(), false);
+    return FindInstancedNodes(scene, findMergeableNodes(scene), options.minInstances_);
+}
+
+// the static batches take whatever the instance groups leave
+static std::vector<bool> findBatchedNodes(const CookedScene &scene, const std::vector<bool> &instanced)
+{
+    std::vector<bool> batched = findMergeableNodes(scene);
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+        if (instanced[i])
+            batched[i] = false;
+    return batched;
+}
+
+// merges the meshes of all nodes that can never move into a few combined
+// StaticModels, the nodes themselves keep their own collision shapes
+static void instantiateStaticBatches(const CookedScene &scene, Node * const parentNode, InstantiateState &state, unsigned cellsPerAxis, Context * const context)
+{
+    state.batched_ = findBatchedNodes(scene, state.instanced_);
+    CookedScene::Storage storage;
+    const std::vector<CookedMesh> batches = BatchStaticMeshes(scene, state.batched_, getWorldTransforms(scene), cellsPerAxis, storage);
+    for (const CookedMesh &batch : batches)
+    {
+        Node * const batchNode = parentNode->CreateChild("StaticBatch");
+        StaticModel * const sm = batchNode->CreateComponent<StaticModel>();
+        sm->SetModel(loadModel(batch, context, false));
+        sm->SetCastShadows(true);
+        if (batch.materialIndex_ != CookedMesh::NO_MATERIAL)
+            sm->SetMaterial(createCookedMaterial(scene, batch, context));
+    }
+}
+
+// one instanced StaticModelGroup per group over the already created nodes, which keep
+// their own collision shapes like the batched ones
+static void instantiateInstanceGroups(const CookedScene &scene, const std::vector<Node*> &nodes, Node * const parentNode, InstantiateState &state, unsigned cellsPerAxis, Context * const context)
+{
+    const std::vector<InstanceGroup> groups = FindInstanceGroups(scene, state.instanced_, getWorldTransforms(scene), cellsPerAxis);
+    for (const InstanceGroup &group : groups)
+    {
+        const CookedMesh &mesh = scene.meshes_[group.meshIndex_];
+        Node * const groupNode = parentNode->CreateChild(INSTANCE_GROUP_NODE_NAME);
+        StaticModelGroup * const smg = groupNode->CreateComponent<StaticModelGroup>();
+        smg->SetModel(getOrLoadModel(scene, group.meshIndex_, state, context));
+        smg->SetCastShadows(true);
+        if (mesh.materialIndex_ != CookedMesh::NO_MATERIAL)
+            smg->SetMaterial(createCookedMaterial(scene, mesh, context));
+        for (const unsigned nodeIndex : group.nodes_)
+            if (nodes[nodeIndex])
+                smg->AddInstanceNode(nodes[nodeIndex]);
+    }
+}
+
+// one AnimatedModel per skinned mesh, made once every node exists: the bones are bound
+// to the nodes of the same name (the first one in node order), which the animations
+// move; these are usually not below the skinned mesh's own node, so the AnimatedModel
+// can't find them by itself
+static void instantiateSkinnedMeshes(const CookedScene &scene, const std::vector<Node*> &nodes, InstantiateState &state, Context * const context)
+{
+    std::unordered_map<std::string, Node*> nodesByName;
+    for (std::size_t i = nodes.size(); i-- > 0;)
+        if (nodes[i])
+            nodesByName[scene.nodes_[i].name_] = nodes[i];
+
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        const CookedNode &cookedNode = scene.nodes_[i];
+        if (!nodes[i])
+            continue;
+        for (const unsigned meshIndex : cookedNode.meshes_)
+        {
+            const CookedMesh &mesh = scene.meshes_[meshIndex];
+            if (mesh.bones_.empty())
+                continue;
+            AnimatedModel * const animatedModel = nodes[i]->CreateComponent<AnimatedModel>();
+            animatedModel->SetModel(getOrLoadModel(scene, meshIndex, state, context), false);
+            animatedModel->SetCastShadows(true);
+            if (mesh.materialIndex_ != CookedMesh::NO_MATERIAL)
+                animatedModel->SetMaterial(createCookedMaterial(scene, mesh, context));
+
+            Skeleton &skeleton = animatedModel->GetSkeleton();
+            unsigned numMissing = 0;
+            for (unsigned b = 0; b < skeleton.GetNumBones() && b < mesh.bones_.size(); ++b)
+            {
+                const auto it = nodesByName.find(mesh.bones_[b].name_);
+                if (it == nodesByName.end())
+                {
+                    ++numMissing;
+                    continue;
+                }
+                skeleton.GetBone(b)->node_ = it->second;
+                // the skinning is updated whenever a bone's node moves
+                it->second->AddListener(animatedModel);
+            }
+            if (numMissing)
+                URHO3D_LOGWARNINGF("Skinned mesh of '%s': %u of %u bones have no node", cookedNode.name_.c_str(), numMissing, static_cast<unsigned>(mesh.bones_.size()));
+        }
+    }
+}
+
+// one AnimationPlayer for all the animations of the scene, on a child of its own
+static void instantiateAnimations(const std::shared_ptr<const CookedScene> &scene, Node * const parentNode, const SceneLoaderOptions &options, Context * const context)
+{
+    if (scene->animations_.empty())
+        return;
+    Node * const playerNode = parentNode->CreateChild(ANIMATIONS_NODE_NAME);
+    AnimationPlayer * const player = new AnimationPlayer(context);
+#ifdef USING_RBFX
+    playerNode->AddComponent(player, 0);
+#else
+    playerNode->AddComponent(player, 0, Urho3D::REPLICATED);
+#endif
+    player->SetAnimations(scene, parentNode);
+    if (options.playAnimations_)
+        player->PlayAll(true);
+}
+
+struct SceneInstantiator::Impl
+{
+    enum Phase
+    {
+        PHASE_MODELS, // uploading Models on the main thread
+        PHASE_SHAPES, // cooking collision geometry on worker threads
+        PHASE_BATCHES,
+        PHASE_NODES,
+        PHASE_ANIMATIONS, // skinned meshes need all their bones' nodes
+        PHASE_INSTANCES,
+        PHASE_LIGHTS,
+        PHASE_DONE
+    };
+    Impl(std::shared_ptr<const CookedScene> scene, Node *parentNode, const SceneLoaderOptions &options, Context *context, SharedSceneModels *sharedModels) :
+        scene_(std::move(scene)),
+        parentNode_(parentNode),
+        options_(options),
+        context_(context),
+        state_(*scene_),
+        nodes_(scene_->nodes_.size(), nullptr),
+        phase_(PHASE_MODELS),
+        nextMesh_(0),
+        nextNode_(0)
+    {
+        state_.profile_ = options_.profile_;
+        state_.sharedModels_ = sharedModels;
+        // without a PhysicsWorld the CollisionShapes build their geometry from the Models themselves
+        Scene * const scene3d = parentNode_->GetScene();
+        state_.compactPhysics_ = options_.compactPhysicsMeshes_ && scene3d && scene3d->GetComponent<PhysicsWorld>();
+        state_.physicsWeldDistance_ = options_.physicsWeldDistance_;
+    }
+    ~Impl()
+    {
+        // the worker threads use the Models, so they have to finish first
+        if (shapesFuture_.valid())
+            shapesFuture_.wait();
+    }
+    void LoadNextModel()
+    {
+        const unsigned i = nextMesh_++;
+        const unsigned char usage = state_.shapeUsage_[i];
+        if (!usage)
+            return;
+        LoadProfileScope stage(options_.profile_, "instantiate/models");
+        state_.models_[i] = loadSceneModel(*scene_, i, state_, context_);
+        if (usage & USES_TRIANGLE_MESH)
+            shapeJobs_.push_back(ShapeJob{i, true, nullptr, 0, nullptr});
+        if (usage & USES_CONVEX_HULL)
+        {
+            if (scene_->meshes_[i].hullVertexCount_)
+                state_.hullModels_[i] = loadSceneHullModel(*scene_, i, state_, context_);
+            shapeJobs_.push_back(ShapeJob{i, false, nullptr, 0, nullptr});
+        }
+    }
+    void StartShapes()
+    {
+        Scene * const scene3d = parentNode_->GetScene();
+        physicsWorld_ = scene3d ? scene3d->GetComponent<PhysicsWorld>() : nullptr;
+        if (!physicsWorld_ || shapeJobs_.empty())
+            return;
+        if (state_.sharedModels_)
+            reuseSharedShapes(*scene_, physicsWorld_, shapeJobs_, state_, context_);
+        if (shapeJobs_.empty())
+            return;
+        // GPU objects have to be created on the main thread
+        const bool useBvhCache = options_.useBvhCache_ && !scene_->sourceFilename_.empty();
+        if (useBvhCache || state_.compactPhysics_)
+        {
+            // as does the placeholder's TriangleMeshData, which the workers fill in
+            const SharedPtr<Model> placeholder = BvhCache::CreatePlaceholderModel(context_);
+            for (ShapeJob &job : shapeJobs_)
+                if (job.triangleMesh_)
+                    job.customData_ = new CustomTriangleMeshData(placeholder);
+        }
+        shapesFuture_ = std::async(std::launch::async, [this, useBvhCache]()
+        {
+            LoadProfileScope stage(options_.profile_, "instantiate/collision_shapes");
+            cookShapes(*scene_, state_, shapeJobs_, useBvhCache, options_.numThreads_);
+        });
+    }
+    void CreateNextNode()
+    {
+        const std::size_t i = nextNode_++;
+        LoadProfileScope stage(options_.profile_, "instantiate/nodes");
+        const CookedNode &cookedNode = scene_->nodes_[i];
+        Node * const realParentNode = (cookedNode.parent_ < 0) ? parentNode_.Get() : nodes_[cookedNode.parent_];
+        nodes_[i] = realParentNode->CreateChild(cookedNode.name_.c_str());
+        instantiateCookedNode(*scene_, i, nodes_[i], state_, context_);
+    }
+
+    std::shared_ptr<const CookedScene> scene_;
+    WeakPtr<Node> parentNode_;
+    SceneLoaderOptions options_;
+    Context *context_;
+    InstantiateState state_;
+    std::vector<ShapeJob> shapeJobs_;
+    std::future<void> shapesFuture_;
+    WeakPtr<PhysicsWorld> physicsWorld_;
+    // parents always precede their children, so a single pass creates the whole tree
+    std::vector<Node*> nodes_;
+    Phase phase_;
+    unsigned nextMesh_;
+    std::size_t nextNode_;
+};
+
+SceneInstantiator::SceneInstantiator(std::shared_ptr<const CookedScene> scene, Node *parentNode, const SceneLoaderOptions &options, Context *context, SharedSceneModels *sharedModels) :
+    impl_(new Impl(std::move(scene), parentNode, options, context, sharedModels))
+{
+}
+
+SceneInstantiator::~SceneInstantiator()
+{
+}
+
+bool SceneInstantiator::Step(unsigned maxItems, float maxMilliseconds)
+{
+    Impl &impl = *impl_;
+    const bool unlimited = maxItems == 0 && maxMilliseconds <= 0.0f;
+    const long long maxMicroseconds = static_cast<long long>(maxMilliseconds * 1000.0f);
+    HiresTimer timer;
+    unsigned numItems = 0;
+    while (impl.phase_ != Impl::PHASE_DONE)
+    {
+        // the target might have been removed while loading
+        if (!impl.parentNode_)
+        {
+            impl.phase_ = Impl::PHASE_DONE;
+            break;
+        }
+        if ((maxItems && numItems >= maxItems) || (maxMicroseconds > 0 && timer.GetUSec(false) >= maxMicroseconds))
+            return false;
+
+        switch (impl.phase_)
+        {
+        case Impl::PHASE_MODELS:
+            if (impl.nextMesh_ < impl.scene_->meshes_.size())
+            {
+                impl.LoadNextModel();
+                ++numItems;
+            }
+            else
+            {
+                impl.StartShapes();
+                impl.phase_ = Impl::PHASE_SHAPES;
+            }
+            break;
+        case Impl::PHASE_SHAPES:
+            if (impl.shapesFuture_.valid())
+            {
+                // only block when asked to finish in one go
+                if (!unlimited && impl.shapesFuture_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    return false;
+                impl.shapesFuture_.get();
+                LoadProfileScope stage(impl.options_.profile_, "instantiate/collision_shapes");
+                if (impl.physicsWorld_)
+                    addCookedShapes(impl.physicsWorld_, impl.shapeJobs_, impl.state_);
+            }
+            impl.phase_ = Impl::PHASE_BATCHES;
+            break;
+        case Impl::PHASE_BATCHES:
+            // decided first, the nodes an instance group draws are left out of the batches
+            impl.state_.instanced_ = findInstancedNodes(*impl.scene_, impl.options_);
+            if (impl.options_.batchStaticGeometry_)
+            {
+                LoadProfileScope stage(impl.options_.profile_, "instantiate/static_batches");
+                instantiateStaticBatches(*impl.scene_, impl.parentNode_, impl.state_, impl.options_.staticBatchCells_, impl.context_);
+            }
+#ifdef ENABLE_NODE_LABELS
+            if (impl.options_.nodeLabels_)
+            {
+                LoadProfileScope stage(impl.options_.profile_, "instantiate/labels");
+                impl.state_.labels_ = CreateNodeLabels(impl.parentNode_);
+            }
+#endif // ENABLE_NODE_LABELS
+            impl.phase_ = Impl::PHASE_NODES;
+            break;
+        case Impl::PHASE_NODES:
+            if (impl.nextNode_ < impl.scene_->nodes_.size())
+            {
+                impl.CreateNextNode();
+                ++numItems;
+            }
+            else
+                impl.phase_ = Impl::PHASE_ANIMATIONS;
+            break;
+        case Impl::PHASE_ANIMATIONS:
+            {
+                LoadProfileScope stage(impl.options_.profile_, "instantiate/animations");
+                instantiateSkinnedMeshes(*impl.scene_, impl.nodes_, impl.state_, impl.context_);
+                instantiateAnimations(impl.scene_, impl.parentNode_, impl.options_, impl.context_);
+            }
+            impl.phase_ = Impl::PHASE_INSTANCES;
+            break;
+        case Impl::PHASE_INSTANCES:
+            {
+                LoadProfileScope stage(impl.options_.profile_, "instantiate/instance_groups");
+                instantiateInstanceGroups(*impl.scene_, impl.nodes_, impl.parentNode_, impl.state_, impl.options_.staticBatchCells_, impl.context_);
+            }
+            impl.phase_ = Impl::PHASE_LIGHTS;
+            break;
+        case Impl::PHASE_LIGHTS:
+            {
+                LoadProfileScope stage(impl.options_.profile_, "instantiate/lights");
+                instantiateCookedLights(*impl.scene_, impl.parentNode_);
+            }
+            URHO3D_LOGINFOF("Created %u models for %u mesh references (%u duplicates collapsed)",
+                impl.state_.uniqueModels_, impl.state_.meshReferences_, impl.state_.meshReferences_ - impl.state_.uniqueModels_);
+            // every collision shape is set up by now
+            if (impl.state_.compactPhysics_ && impl.physicsWorld_)
+                releaseShapeShadowData(impl.state_);
+            impl.phase_ = Impl::PHASE_DONE;
+            break;
+        case Impl::PHASE_DONE:
+            break;
+        }
+    }
+    return true;
+}
+
+bool SceneInstantiator::IsFinished() const
+{
+    return impl_->phase_ == Impl::PHASE_DONE;
+}
+
+float SceneInstantiator::GetProgress() const
+{
+    if (impl_->phase_ == Impl::PHASE_DONE)
+        return 1.0f;
+    const std::size_t total = impl_->scene_->meshes_.size() + impl_->scene_->nodes_.size() + 1;
+    return static_cast<float>(impl_->nextMesh_ + impl_->nextNode_) / total;
+}
+
+// identifies a node across reloads: the names from the root down, plus the position
+// among same-named siblings where names repeat
+static std::vector<std::string> getNodePaths(const CookedScene &scene, std::vector<unsigned> &occurrences)
+{
+    std::vector<std::string> paths(scene.nodes_.size());
+    occurrences.assign(scene.nodes_.size(), 0);
+    std::unordered_map<std::string, unsigned> counts;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        const CookedNode &node = scene.nodes_[i];
+        const std::string path = ((node.parent_ < 0) ? std::string() : paths[node.parent_]) + '/' + node.name_;
+        occurrences[i] = counts[path]++;
+        paths[i] = occurrences[i] ? path + '#' + std::to_string(occurrences[i]) : path;
+    }
+    return paths;
+}
+
+// the occurrence-th child called name, since SceneInstantiator creates siblings in order
+static Node * findChild(Node * const parent, const std::string &name, unsigned occurrence)
+{
+    for (const SharedPtr<Node> &child : parent->GetChildren())
+        if (child->GetName() == name.c_str() && occurrence-- == 0)
+            return child;
+    return nullptr;
+}
+
+// the live node created for each cooked node, null where it is gone
+static std::vector<Node*> findLiveNodes(const CookedScene &scene, const std::vector<unsigned> &occurrences, Node * const parentNode)
+{
+    std::vector<Node*> nodes(scene.nodes_.size(), nullptr);
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        const CookedNode &cookedNode = scene.nodes_[i];
+        Node * const realParentNode = (cookedNode.parent_ < 0) ? parentNode : nodes[cookedNode.parent_];
+        if (realParentNode)
+            nodes[i] = findChild(realParentNode, cookedNode.name_, occurrences[i]);
+    }
+    return nodes;
+}
+
+// everything a node is built from except its transform and children: meshes, materials, physics and metadata
+static std::vector<uint64_t> hashNodeContents(const CookedScene &scene)
+{
+    std::vector<uint64_t> meshHashes(scene.meshes_.size());
+    for (std::size_t i = 0; i < scene.meshes_.size(); ++i)
+    {
+        const CookedMesh &mesh = scene.meshes_[i];
+        uint64_t hash = HashTriangleMesh(mesh);
+        hash = HashBytes(mesh.hullVertexData_, static_cast<std::size_t>(mesh.hullVertexCount_) * 3 * sizeof(float), hash);
+        if (mesh.materialIndex_ != CookedMesh::NO_MATERIAL)
+        {
+            const CookedMaterial &material = scene.materials_[mesh.materialIndex_];
+            hash = HashBytes(&material.diffuseColor_, sizeof(Color), hash);
+            hash = HashBytes(&material.alphaMode_, sizeof(material.alphaMode_), hash);
+            if (material.diffuseTexture_ != CookedMaterial::NO_TEXTURE)
+                hash = HashBytes(&scene.textures_[material.diffuseTexture_].hash_, sizeof(uint64_t), hash);
+            if (material.normalTexture_ != CookedMaterial::NO_TEXTURE)
+                hash = HashBytes(&scene.textures_[material.normalTexture_].hash_, sizeof(uint64_t), hash);
+        }
+        meshHashes[i] = hash;
+    }
+
+    std::vector<uint64_t> hashes(scene.nodes_.size());
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        const CookedNode &node = scene.nodes_[i];
+        uint64_t hash = HashBytes(node.gameObjectType_.data(), node.gameObjectType_.size());
+        hash = HashBytes(&node.mass_, sizeof(node.mass_), hash);
+        const uint8_t partOfParentBody = node.partOfParentBody_ ? 1 : 0;
+        hash = HashBytes(&partOfParentBody, sizeof(partOfParentBody), hash);
+        const uint8_t animated = node.animated_ ? 1 : 0;
+        hash = HashBytes(&animated, sizeof(animated), hash);
+        for (const unsigned meshIndex : node.meshes_)
+            hash = HashBytes(&meshHashes[meshIndex], sizeof(uint64_t), hash);
+        for (const CookedCollider &collider : node.colliders_)
+        {
+            hash = HashBytes(&collider.shape_, sizeof(collider.shape_), hash);
+            hash = HashBytes(&collider.size_, sizeof(Vector3), hash);
+            hash = HashBytes(&collider.position_, sizeof(Vector3), hash);
+            hash = HashBytes(&collider.rotation_, sizeof(Quaternion), hash);
+        }
+        for (const CookedInstance &instance : node.instances_)
+        {
+            hash = HashBytes(&instance.position_, sizeof(Vector3), hash);
+            hash = HashBytes(&instance.rotation_, sizeof(Quaternion), hash);
+            hash = HashBytes(&instance.scale_, sizeof(Vector3), hash);
+        }
+        hashes[i] = hash;
+    }
+    return hashes;
+}
+
+// the game objects remove their node themselves when deleted
+static void removeCookedNode(const CookedNode &cookedNode, Node * const node)
+{
+    void * const gameObject = node->GetVar("GameObjectPtr").GetVoidPtr();
+    const std::string &type = cookedNode.gameObjectType_;
+    if (gameObject && type == "JumpPad")
+        delete static_cast<JumpPad*>(gameObject);
+    else if (gameObject && type == "Ladder")
+        delete static_cast<Ladder*>(gameObject);
+    else if (gameObject && type == "Elevator")
+        delete static_cast<Elevator*>(gameObject);
+    else
+        node->Remove();
+}
+
+static void removeChildren(Node * const parentNode, const char * const name)
+{
+    std::vector<Node*> children;
+    for (const SharedPtr<Node> &child : parentNode->GetChildren())
+        if (child->GetName() == name)
+            children.push_back(child);
+    for (Node * const child : children)
+        child->Remove();
+}
+
+// instantiateCookedLights() puts each light on a child node of the same name
+static void removeCookedLights(const CookedScene &scene, Node * const parentNode)
+{
+    ea::vector<Light*> lights;
+#ifdef USING_RBFX
+    parentNode->FindComponents<Light>(lights, Urho3D::ComponentSearchFlag::SelfOrChildrenRecursive);
+#else
+    parentNode->GetComponents<Light>(lights, true);
+#endif // USING_RBFX
+    for (Light * const light : lights)
+    {
+        Node * const lightNode = light->GetNode();
+        for (const CookedLight &cookedLight : scene.lights_)
+        {
+            if (lightNode != parentNode && lightNode->GetName() == cookedLight.name_.c_str())
+            {
+                lightNode->Remove();
+                break;
+            }
+        }
+    }
+}
+
+void reloadScene(const CookedScene &oldScene, const std::shared_ptr<const CookedScene> &sharedNewScene, Node *parentNode, const SceneLoaderOptions &options, Context *context, SceneReloadStats &stats)
+{
+    const CookedScene &newScene = *sharedNewScene;
+    std::vector<unsigned> oldOccurrences;
+    std::vector<unsigned> newOccurrences;
+    const std::vector<std::string> oldPaths = getNodePaths(oldScene, oldOccurrences);
+    const std::vector<std::string> newPaths = getNodePaths(newScene, newOccurrences);
+    const std::vector<Node*> oldNodes = findLiveNodes(oldScene, oldOccurrences, parentNode);
+    const std::vector<uint64_t> oldHashes = hashNodeContents(oldScene);
+    const std::vector<uint64_t> newHashes = hashNodeContents(newScene);
+    std::unordered_map<std::string, std::size_t> oldIndices;
+    for (std::size_t i = 0; i < oldPaths.size(); ++i)
+        oldIndices[oldPaths[i]] = i;
+
+    // a node is kept if it is still there under a kept parent with the same kind of game
+    // object, everything else is removed and created again
+    std::vector<int> matches(newScene.nodes_.size(), -1);
+    std::vector<bool> oldKept(oldScene.nodes_.size(), false);
+    for (std::size_t j = 0; j < newScene.nodes_.size(); ++j)
+    {
+        const auto it = oldIndices.find(newPaths[j]);
+        if (it == oldIndices.end())
+            continue;
+        const std::size_t i = it->second;
+        const CookedNode &newNode = newScene.nodes_[j];
+        const bool parentKept = newNode.parent_ < 0 || matches[newNode.parent_] >= 0;
+        if (parentKept && oldNodes[i] && oldScene.nodes_[i].gameObjectType_ == newNode.gameObjectType_)
+        {
+            matches[j] = static_cast<int>(i);
+            oldKept[i] = true;
+        }
+    }
+
+    // children first, so a game object deleting its node never takes a pending one with it
+    removeCookedLights(oldScene, parentNode);
+    for (std::size_t i = oldScene.nodes_.size(); i-- > 0;)
+    {
+        if (oldKept[i] || !oldNodes[i])
+            continue;
+        removeCookedNode(oldScene.nodes_[i], oldNodes[i]);
+        ++stats.removed_;
+    }
+
+    InstantiateState state(newScene);
+    const std::vector<bool> oldInstanced = findInstancedNodes(oldScene, options);
+    const std::vector<bool> oldBatched = options.batchStaticGeometry_ ? findBatchedNodes(oldScene, oldInstanced) : std::vector<bool>(oldScene.nodes_.size(), false);
+    state.instanced_ = findInstancedNodes(newScene, options);
+    // the instance groups and batches span many nodes, so they are all made again
+    removeChildren(parentNode, INSTANCE_GROUP_NODE_NAME);
+    if (options.batchStaticGeometry_)
+    {
+        removeChildren(parentNode, "StaticBatch");
+        instantiateStaticBatches(newScene, parentNode, state, options.staticBatchCells_, context);
+    }
+#ifdef ENABLE_NODE_LABELS
+    Node * const labelsNode = parentNode->GetChild("NodeLabels");
+    state.labels_ = labelsNode ? labelsNode->GetComponent<NodeLabels>() : nullptr;
+#endif // ENABLE_NODE_LABELS
+    state.profile_ = options.profile_;
+
+    std::vector<Node*> newNodes(newScene.nodes_.size(), nullptr);
+    for (std::size_t j = 0; j < newScene.nodes_.size(); ++j)
+    {
+        const CookedNode &cookedNode = newScene.nodes_[j];
+        if (matches[j] < 0)
+        {
+            Node * const realParentNode = (cookedNode.parent_ < 0) ? parentNode : newNodes[cookedNode.parent_];
+            newNodes[j] = realParentNode->CreateChild(cookedNode.name_.c_str());
+            instantiateCookedNode(newScene, j, newNodes[j], state, context);
+            ++stats.added_;
+            continue;
+        }
+
+        const std::size_t i = static_cast<std::size_t>(matches[j]);
+        const CookedNode &oldNode = oldScene.nodes_[i];
+        Node * const node = oldNodes[i];
+        newNodes[j] = node;
+        if (oldHashes[i] != newHashes[j] || oldBatched[i] != state.batched_[j] || oldInstanced[i] != state.instanced_[j])
+        {
+            node->RemoveComponents<StaticModel>();
+            node->RemoveComponents<AnimatedModel>();
+            node->RemoveComponents<StaticModelGroup>();
+            node->RemoveComponents<CollisionShape>();
+            removeChildren(node, INSTANCE_NODE_NAME);
+            // the game objects hold on to their body
+            const bool needsBody = (usesMeshCollider(cookedNode) && !cookedNode.meshes_.empty()) || !cookedNode.colliders_.empty();
+            if (!needsBody && cookedNode.gameObjectType_.empty())
+                node->RemoveComponents<RigidBody>();
+            instantiateCookedNode(newScene, j, node, state, context, true);
+            ++stats.rebuilt_;
+        }
+        else if (cookedNode.position_ != oldNode.position_ || cookedNode.rotation_ != oldNode.rotation_ || cookedNode.scale_ != oldNode.scale_)
+        {
+            node->SetPosition(cookedNode.position_);
+            node->SetRotation(cookedNode.rotation_);
+            node->SetScale(cookedNode.scale_);
+            ++stats.moved_;
+        }
+        else
+            ++stats.unchanged_;
+    }
+
+    instantiateInstanceGroups(newScene, newNodes, parentNode, state, options.staticBatchCells_, context);
+    // the skins depend on their bones' nodes, and the animations on the nodes they move,
+    // so like the lights they are all created again
+    for (std::size_t j = 0; j < newScene.nodes_.size(); ++j)
+        if (hasSkinnedMeshes(newScene, newScene.nodes_[j]))
+            newNodes[j]->RemoveComponents<AnimatedModel>();
+    instantiateSkinnedMeshes(newScene, newNodes, state, context);
+    removeChildren(parentNode, ANIMATIONS_NODE_NAME);
+    instantiateAnimations(sharedNewScene, parentNode, options, context);
+    // there are few lights, so they are simply all created again
+    instantiateCookedLights(newScene, parentNode);
+}
+
+void removeCookedScene(const CookedScene &scene, Node *parentNode)
+{
+    std::vector<unsigned> occurrences;
+    getNodePaths(scene, occurrences);
+    const std::vector<Node*> nodes = findLiveNodes(scene, occurrences, parentNode);
+    removeCookedLights(scene, parentNode);
+    // children first, a game object takes its whole subtree with it
+    for (std::size_t i = scene.nodes_.size(); i-- > 0;)
+    {
+        const CookedNode &cookedNode = scene.nodes_[i];
+        if (nodes[i] && (cookedNode.parent_ < 0 || !cookedNode.gameObjectType_.empty()))
+            removeCookedNode(cookedNode, nodes[i]);
+    }
+    removeChildren(parentNode, INSTANCE_GROUP_NODE_NAME);
+    removeChildren(parentNode, "StaticBatch");
+    removeChildren(parentNode, "NodeLabels");
+    removeChildren(parentNode, ANIMATIONS_NODE_NAME);
+}
+
+static uint64_t hashSourceFile(const std::string &filename, bool &ok)
+{
+    MappedFile source;
+    ok = source.Open(filename);
+    return ok ? HashBytes(source.GetData(), source.GetSize()) : 0;
+}
+
+bool cookSceneWithAssimp(const std::string &filename, const SceneLoaderOptions &options, CookedScene &scene)
+{
+    LoadProfile * const cacheProfile = options.useSceneCache_ ? options.profile_ : nullptr;
+    std::unique_ptr<LoadProfileScope> stage(new LoadProfileScope(cacheProfile, "scene_cache/load"));
+    // try the cooked binary cache first, Assimp is only needed when it is missing or stale
+    bool haveSourceHash = false;
+    const uint64_t sourceHash = options.useSceneCache_ ? hashSourceFile(filename, haveSourceHash) : 0;
+    const std::string cacheFilename = filename + SCENE_CACHE_EXTENSION;
+    CookSettings cookSettings;
+    cookSettings.nativeGltf_ = options.nativeGltf_ && isGltfFile(filename);
+    cookSettings.importTextures_ = options.importTextures_;
+    cookSettings.maxHullVertices_ = options.maxHullVertices_;
+    cookSettings.shrinkHulls_ = options.shrinkHulls_;
+    cookSettings.lodLevels_ = options.lodLevels_;
+    cookSettings.lodReduction_ = options.lodReduction_;
+    cookSettings.lodDistance_ = options.lodDistance_;
+    cookSettings.animationTolerance_ = options.animationTolerance_;
+    cookSettings.flattenStaticNodes_ = options.flattenStaticNodes_;
+    if (haveSourceHash && LoadSceneCache(cacheFilename, sourceHash, ASSIMP_POSTPROCESS_FLAGS, cookSettings, scene))
+    {
+        scene.sourceFilename_ = filename;
+        URHO3D_LOGINFOF("Loaded scene '%s' from cache '%s'", filename.c_str(), cacheFilename.c_str());
+        return true;
+    }
+
+    stage.reset();
+    if (!cookSettings.nativeGltf_ || !cookGltfScene(filename, scene, cookSettings, options.useTextureCache_, options.numThreads_, options.profile_))
+    {
+        // includes the post-processing steps, the benchmark times them one by one from Assimp's log
+        stage.reset(new LoadProfileScope(options.profile_, "assimp_read"));
+        Assimp::Importer importer;
+        const aiScene * const ai_scene = importer.ReadFile(filename, ASSIMP_POSTPROCESS_FLAGS);
+        stage.reset();
+
+        if (!ai_scene || !ai_scene->mRootNode)
+        {
+            // std::cerr << "Error loading scene: " << importer.GetErrorString() << std::endl;
+            URHO3D_LOGERRORF("Failed to load scene '%s': %s", filename.c_str(), importer.GetErrorString());
+            return false;
+        }
+
+        cookAssimpScene(ai_scene, filename, scene, cookSettings, options.useTextureCache_, options.numThreads_, options.profile_);
+    }
+    scene.sourceFilename_ = filename;
+    if (cookSettings.flattenStaticNodes_)
+    {
+        // last, the cooking stages above refer to the nodes by index
+        LoadProfileScope flattenStage(options.profile_, "cook/flatten");
+        const FlattenStats flattenStats = FlattenStaticNodes(scene);
+        URHO3D_LOGINFOF("Flattened static nodes: %u -> %u nodes, %u re-parented, %u empty ones removed",
+            flattenStats.nodesBefore_, flattenStats.nodesAfter_, flattenStats.reparented_, flattenStats.removed_);
+    }
+
+    LoadProfileScope saveStage(cacheProfile, "scene_cache/save");
+    if (haveSourceHash && !SaveSceneCache(cacheFilename, sourceHash, ASSIMP_POSTPROCESS_FLAGS, cookSettings, scene))
+        URHO3D_LOGWARNINGF("Failed to write scene cache '%s'", cacheFilename.c_str());
+    return true;
+}
+
+void loadSceneWithAssimp(const std::string &filename, Node *parentNode, Context *context, const SceneLoaderOptions &options)
+{
+    std::shared_ptr<CookedScene> scene = std::make_shared<CookedScene>();
+    if (!cookSceneWithAssimp(filename, options, *scene))
+        return;
 
-    processAssimpNode(ai_scene->mRootNode, ai_scene, parentNode, context);
-    processAssimpLights(ai_scene, parentNode);
+    SceneInstantiator instantiator(scene, parentNode, options, context);
+    instantiator.Step(0, 0.0f);
 }
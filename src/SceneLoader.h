@@ -1,15 +1,144 @@
 #ifndef SCENELOADER_H
 #define SCENELOADER_H
 
+#include <Urho3D/Container/Ptr.h>
+
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Urho3D {
 
 class Scene;
+class Node;
 class Context;
+class Model;
 
 } // namespace Urho3D
 
-void loadSceneWithAssimp(const std::string &filename, Urho3D::Node *sceneMgr, Urho3D::Context *context);
+// forward declarations
+class LoadProfile;
+struct CookedScene;
+
+// appended to the source filename to get the cooked scene cache filename
+static const char * const SCENE_CACHE_EXTENSION = ".cooked";
+
+struct SceneLoaderOptions
+{
+    bool useSceneCache_ = true; // read/write the cooked binary cache next to the source file
+    bool useBvhCache_ = true; // same for the Bullet BVHs of the triangle-mesh colliders
+    unsigned numThreads_ = 0; // for mesh conversion and collision shape cooking, 0 for one per hardware thread
+    // read .glb/.gltf files directly from the mapped file instead of through Assimp, which
+    // stays the fallback for other formats and for glTF extensions the reader doesn't know
+    bool nativeGltf_ = true;
+    // embedded base color images and normal maps become block-compressed textures (DXT1,
+    // or DXT5 for blended and masked materials with alpha) with their mip chains, encoded
+    // on the cooking threads; normal maps are filtered as linear data and only used by
+    // meshes with tangents; the results are also kept in a texture cache next to the source
+    // file by image hash, so changing the rest of the level doesn't encode them again
+    bool importTextures_ = true;
+    bool useTextureCache_ = true;
+    // merge the meshes of static nodes by material and grid cell to save draw calls,
+    // the grid has staticBatchCells_ cells along the longer horizontal side of the scene
+    bool batchStaticGeometry_ = false;
+    unsigned staticBatchCells_ = 8;
+    // draw the meshes that at least minInstances_ static nodes share with one instanced
+    // StaticModelGroup per mesh and cell of the same grid, instead of a StaticModel per
+    // node; these nodes are left out of the static batches, which would copy the mesh
+    // once per node; nodes with EXT_mesh_gpu_instancing are always drawn this way
+    bool instanceRepeatedMeshes_ = true;
+    unsigned minInstances_ = 8;
+    // dynamic bodies get their convex hull from at most this many points instead of every
+    // render vertex (0 for no limit), optionally shrunk by the collision margin
+    unsigned maxHullVertices_ = 32;
+    bool shrinkHulls_ = false;
+    // simplified versions of every mesh for drawing at a distance, each with lodReduction_
+    // of the triangles of the previous level; the first one is used from lodDistance_ on
+    // and every further one from twice the previous distance; glTF extras "LodLevels"
+    // and "LodDistance" override the first and last per node (and its meshes)
+    unsigned lodLevels_ = 3;
+    float lodReduction_ = 0.5f;
+    float lodDistance_ = 25.0f;
+    // triangle-mesh colliders get their own welded, position-only copy of the mesh (see
+    // PhysicsMesh), so the render buffers can drop their CPU-side copies once the collision
+    // shapes exist; vertices closer than physicsWeldDistance_ are merged, 0 only merges
+    // exact duplicates; shapes rebuilt by reloadScene() still use the render buffers
+    bool compactPhysicsMeshes_ = true;
+    float physicsWeldDistance_ = 0.0f;
+    // skinned meshes become AnimatedModels bound to the nodes of their bones, and the
+    // node animations are kept with only the keys interpolation can't reproduce within
+    // animationTolerance_ (in units for translations and scales, in radians for
+    // rotations), quantized to 16 bits per component; an AnimationPlayer on the
+    // "Animations" child plays them, all of them looped from the start when
+    // playAnimations_ is set
+    float animationTolerance_ = 0.001f;
+    bool playAnimations_ = true;
+    // move the static nodes (no mass or GameObjectType, not the Elevator) directly under
+    // one "StaticRoot" node with their world transforms baked in, dropping the empty
+    // transform-only nodes between them, so fewer nodes exist and transform changes
+    // propagate through fewer levels; the other nodes and their ancestors keep their
+    // place, and nodes' names stay the same (see FlattenStaticNodes())
+    bool flattenStaticNodes_ = false;
+    // draw each node's name above it, only available when built with ENABLE_NODE_LABELS
+    bool nodeLabels_ = true;
+    // collects the time and allocations of each loading stage when set, must outlive the
+    // loading (see ImportBenchmark.cpp)
+    LoadProfile *profile_ = nullptr;
+};
+
+void loadSceneWithAssimp(const std::string &filename, Urho3D::Node *sceneMgr, Urho3D::Context *context, const SceneLoaderOptions &options = SceneLoaderOptions());
+
+// the two halves of loadSceneWithAssimp(): cooking touches no Urho3D objects, so it
+// can run on a background thread, and the instantiator creates the nodes on the main
+// thread a bit at a time (see AsyncSceneLoader)
+bool cookSceneWithAssimp(const std::string &filename, const SceneLoaderOptions &options, CookedScene &scene);
+
+// what reloadScene() did with each node
+struct SceneReloadStats
+{
+    unsigned unchanged_ = 0;
+    unsigned moved_ = 0; // only the transform changed
+    unsigned rebuilt_ = 0; // meshes, materials, physics or metadata changed
+    unsigned added_ = 0;
+    unsigned removed_ = 0;
+};
+
+// brings the nodes created from oldScene up to date with newScene, matching them by
+// name path: unchanged nodes keep everything including their bodies and game objects,
+// changed ones get their components rebuilt in place (see SceneHotReloader)
+void reloadScene(const CookedScene &oldScene, const std::shared_ptr<const CookedScene> &newScene, Urho3D::Node *parentNode, const SceneLoaderOptions &options, Urho3D::Context *context, SceneReloadStats &stats);
+
+// removes what was instantiated from scene under parentNode, deleting the game objects
+// on the way so none of them is left with a dangling node (see SceneStreamer)
+void removeCookedScene(const CookedScene &scene, Urho3D::Node *parentNode);
+
+// the Models of the scenes cut from one level (see PartitionStreamingCells()), by the
+// level's mesh indices (CookedScene::sourceMeshes_): a mesh in several of them is
+// uploaded once, and since PhysicsWorld caches collision geometry per Model, that is
+// shared too; weak, so a Model goes away with the last scene using it
+struct SharedSceneModels
+{
+    std::vector<Urho3D::WeakPtr<Urho3D::Model>> models_;
+    std::vector<Urho3D::WeakPtr<Urho3D::Model>> hullModels_;
+};
+
+class SceneInstantiator
+{
+public:
+    // sharedModels has to outlive the instantiator, null for a scene of its own
+    SceneInstantiator(std::shared_ptr<const CookedScene> scene, Urho3D::Node *parentNode, const SceneLoaderOptions &options, Urho3D::Context *context, SharedSceneModels *sharedModels = nullptr);
+    ~SceneInstantiator();
+    SceneInstantiator(const SceneInstantiator &) = delete;
+    SceneInstantiator & operator=(const SceneInstantiator &) = delete;
+
+    // loads at most maxItems models/nodes, or for about maxMilliseconds (0 for no
+    // limit, which also waits for the background work); returns true once finished
+    bool Step(unsigned maxItems, float maxMilliseconds);
+    bool IsFinished() const;
+    float GetProgress() const; // 0.0 to 1.0
+protected:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
 
 #endif // SCENELOADER_H
@@ -0,0 +1,205 @@
+#include "SceneStreamer.h"
+#include "CookedScene.h"
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/Vector3.h>
+#include <Urho3D/Scene/Node.h>
+
+#include <algorithm> // for std::max()
+#include <chrono>
+#include <cmath> // for std::sqrt()
+
+using Urho3D::Node;
+using Urho3D::Vector3;
+using Urho3D::VariantMap;
+using Urho3D::E_UPDATE;
+
+static const std::size_t NO_CELL = static_cast<std::size_t>(-1);
+
+SceneStreamer::SceneStreamer(Urho3D::Context *context) :
+    Urho3D::Object(context),
+    loadingCell_(NO_CELL),
+    cellSize_(32.0f),
+    loadRadius_(64.0f),
+    unloadRadius_(96.0f),
+    maxNodesPerFrame_(0),
+    maxMillisecondsPerFrame_(2.0f)
+{
+}
+
+SceneStreamer::~SceneStreamer()
+{
+    // the background thread writes into cookedCells_, so it has to finish first
+    if (cookFuture_.valid())
+        cookFuture_.wait();
+}
+
+void SceneStreamer::Load(const std::string &filename, Node *parentNode, Node *focusNode, const SceneLoaderOptions &options)
+{
+    Stop();
+    filename_ = filename;
+    parentNode_ = parentNode;
+    focusNode_ = focusNode;
+    options_ = options;
+
+    cookedCells_ = std::make_shared<std::vector<StreamingCell>>();
+    std::shared_ptr<std::vector<StreamingCell>> cookedCells = cookedCells_;
+    const std::string cookFilename = filename_;
+    const SceneLoaderOptions cookOptions = options_;
+    const float cellSize = cellSize_;
+    cookFuture_ = std::async(std::launch::async, [cookedCells, cookFilename, cookOptions, cellSize]()
+    {
+        std::shared_ptr<CookedScene> scene = std::make_shared<CookedScene>();
+        if (!cookSceneWithAssimp(cookFilename, cookOptions, *scene))
+            return false;
+        *cookedCells = PartitionStreamingCells(scene, cellSize);
+        return true;
+    });
+
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(SceneStreamer, HandleUpdate));
+}
+
+void SceneStreamer::Stop()
+{
+    UnsubscribeFromEvent(E_UPDATE);
+    if (cookFuture_.valid())
+        cookFuture_.wait();
+    cookFuture_ = std::future<bool>();
+    cookedCells_.reset();
+    for (std::size_t i = 0; i < cells_.size(); ++i)
+        RemoveCell(i);
+    cells_.clear();
+    sharedModels_ = SharedSceneModels();
+}
+
+void SceneStreamer::SetRadius(float loadRadius, float unloadRadius)
+{
+    loadRadius_ = loadRadius;
+    unloadRadius_ = std::max(unloadRadius, loadRadius);
+}
+
+void SceneStreamer::SetBudget(unsigned maxNodesPerFrame, float maxMillisecondsPerFrame)
+{
+    maxNodesPerFrame_ = maxNodesPerFrame;
+    maxMillisecondsPerFrame_ = maxMillisecondsPerFrame;
+}
+
+unsigned SceneStreamer::GetNumLoadedCells() const
+{
+    unsigned numLoaded = 0;
+    for (const Cell &cell : cells_)
+        numLoaded += cell.loaded_ ? 1 : 0;
+    return numLoaded;
+}
+
+void SceneStreamer::HandleUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData)
+{
+    if (!parentNode_)
+    {
+        URHO3D_LOGWARNINGF("Target node of '%s' was removed while streaming", filename_.c_str());
+        Stop();
+        return;
+    }
+
+    if (cookFuture_.valid())
+    {
+        if (cookFuture_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+        if (!cookFuture_.get())
+        {
+            URHO3D_LOGERRORF("Failed to load scene '%s'", filename_.c_str());
+            Stop();
+            return;
+        }
+        cells_.resize(cookedCells_->size());
+        for (std::size_t i = 0; i < cells_.size(); ++i)
+            cells_[i].cell_ = std::move((*cookedCells_)[i]);
+        cookedCells_.reset();
+        URHO3D_LOGINFOF("Streaming '%s' in %u cells", filename_.c_str(), GetNumCells());
+    }
+
+    // far cells go first, including one that is still being created
+    const Vector3 focus = focusNode_ ? parentNode_->GetWorldTransform().Inverse() * focusNode_->GetWorldPosition() : Vector3::ZERO;
+    for (std::size_t i = 0; i < cells_.size(); ++i)
+        if (cells_[i].node_ && GetDistance(cells_[i], focus) > unloadRadius_)
+            RemoveCell(i);
+
+    if (loadingCell_ == NO_CELL)
+    {
+        std::size_t nearest = NO_CELL;
+        float nearestDistance = loadRadius_;
+        for (std::size_t i = 0; i < cells_.size(); ++i)
+        {
+            const float distance = GetDistance(cells_[i], focus);
+            if (!cells_[i].node_ && distance <= nearestDistance)
+            {
+                nearest = i;
+                nearestDistance = distance;
+            }
+        }
+        if (nearest == NO_CELL)
+            return;
+        StartCell(nearest);
+    }
+
+    // a budget of 0 for both would block, so fall back to one node per frame
+    const unsigned maxNodes = (maxNodesPerFrame_ == 0 && maxMillisecondsPerFrame_ <= 0.0f) ? 1 : maxNodesPerFrame_;
+    if (instantiator_->Step(maxNodes, maxMillisecondsPerFrame_))
+        FinishCell(loadingCell_);
+}
+
+float SceneStreamer::GetDistance(const Cell &cell, const Vector3 &focus) const
+{
+    const Urho3D::BoundingBox &bounds = cell.cell_.bounds_;
+    if (!focusNode_ || !bounds.Defined())
+        return 0.0f;
+    const float dx = std::max(std::max(bounds.min_.x_ - focus.x_, focus.x_ - bounds.max_.x_), 0.0f);
+    const float dz = std::max(std::max(bounds.min_.z_ - focus.z_, focus.z_ - bounds.max_.z_), 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+void SceneStreamer::StartCell(std::size_t index)
+{
+    Cell &cell = cells_[index];
+    cell.node_ = parentNode_->CreateChild(cell.cell_.name_.empty() ? "StreamingCell" : ("StreamingCell_" + cell.cell_.name_).c_str());
+    instantiator_.reset(new SceneInstantiator(cell.cell_.scene_, cell.node_, options_, context_, &sharedModels_));
+    loadingCell_ = index;
+}
+
+void SceneStreamer::FinishCell(std::size_t index)
+{
+    instantiator_.reset();
+    loadingCell_ = NO_CELL;
+    cells_[index].loaded_ = true;
+    SendCellEvent(cells_[index].node_, true);
+}
+
+void SceneStreamer::RemoveCell(std::size_t index)
+{
+    Cell &cell = cells_[index];
+    if (index == loadingCell_)
+    {
+        instantiator_.reset();
+        loadingCell_ = NO_CELL;
+    }
+    const bool wasLoaded = cell.loaded_;
+    cell.loaded_ = false;
+    if (!cell.node_)
+        return;
+    // listeners get to drop their references first
+    if (wasLoaded)
+        SendCellEvent(cell.node_, false);
+    removeCookedScene(*cell.cell_.scene_, cell.node_);
+    cell.node_->Remove();
+    cell.node_.Reset();
+}
+
+void SceneStreamer::SendCellEvent(Node *node, bool loaded)
+{
+    using namespace StreamingCellChanged;
+    VariantMap &eventData = GetEventDataMap();
+    eventData[P_NODE] = node;
+    eventData[P_LOADED] = loaded;
+    SendEvent(E_STREAMINGCELL, eventData);
+}
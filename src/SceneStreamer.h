@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Variant.h>
+
+#include "SceneLoader.h"
+#include "StreamingCells.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// forward declarations
+namespace Urho3D {
+
+class Node;
+class StringHash;
+class Vector3;
+
+} // namespace Urho3D
+
+// sent whenever a SceneStreamer has finished loading a cell or has removed one
+URHO3D_EVENT(E_STREAMINGCELL, StreamingCellChanged)
+{
+    URHO3D_PARAM(P_NODE, Node); // Node pointer of the cell, a child of the level's parent node
+    URHO3D_PARAM(P_LOADED, Loaded); // bool, false when the cell is being removed
+}
+
+// keeps only the part of a level around a focus node (e.g. the player) in the scene:
+// the level is cooked once on a background thread and split into streaming cells (see
+// PartitionStreamingCells()), then the cells within the load radius are created a bit
+// per frame like AsyncSceneLoader does, nearest first, and those beyond the unload
+// radius are removed again along with their bodies; physics keeps running throughout;
+// the cells share the Models (and so the collision geometry) of the meshes they have
+// in common and the level's BVH cache
+class SceneStreamer : public Urho3D::Object
+{
+    URHO3D_OBJECT(SceneStreamer, Urho3D::Object);
+public:
+    explicit SceneStreamer(Urho3D::Context *context);
+    ~SceneStreamer();
+
+    // without a focus node every cell counts as near
+    void Load(const std::string &filename, Urho3D::Node *parentNode, Urho3D::Node *focusNode, const SceneLoaderOptions &options = SceneLoaderOptions());
+    // removes all cells
+    void Stop();
+    void SetFocus(Urho3D::Node *focusNode) {focusNode_ = focusNode;}
+    // grid size for nodes without a "StreamingCell" extra, only used by the next Load()
+    void SetCellSize(float cellSize) {cellSize_ = cellSize;}
+    // horizontal distances from the focus to the cell bounds, the gap between the two
+    // keeps cells on the border from being loaded and removed over and over
+    void SetRadius(float loadRadius, float unloadRadius);
+    // per frame limits for creating nodes, 0 for no limit
+    void SetBudget(unsigned maxNodesPerFrame, float maxMillisecondsPerFrame);
+    bool IsCooking() const {return cookFuture_.valid();}
+    unsigned GetNumCells() const {return static_cast<unsigned>(cells_.size());}
+    unsigned GetNumLoadedCells() const;
+protected:
+    struct Cell
+    {
+        StreamingCell cell_;
+        Urho3D::WeakPtr<Urho3D::Node> node_; // null while not loaded
+        bool loaded_ = false; // the instantiator has finished
+    };
+
+    void HandleUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData);
+    float GetDistance(const Cell &cell, const Urho3D::Vector3 &focus) const;
+    void StartCell(std::size_t index);
+    void FinishCell(std::size_t index);
+    void RemoveCell(std::size_t index);
+    void SendCellEvent(Urho3D::Node *node, bool loaded);
+
+    std::string filename_;
+    Urho3D::WeakPtr<Urho3D::Node> parentNode_;
+    Urho3D::WeakPtr<Urho3D::Node> focusNode_;
+    SceneLoaderOptions options_;
+    std::shared_ptr<std::vector<StreamingCell>> cookedCells_; // written by the background thread
+    std::future<bool> cookFuture_;
+    std::vector<Cell> cells_;
+    SharedSceneModels sharedModels_; // of all cells
+    std::unique_ptr<SceneInstantiator> instantiator_; // of loadingCell_
+    std::size_t loadingCell_;
+    float cellSize_;
+    float loadRadius_;
+    float unloadRadius_;
+    unsigned maxNodesPerFrame_;
+    float maxMillisecondsPerFrame_;
+};
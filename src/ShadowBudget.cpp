@@ -0,0 +1,166 @@
+#include "ShadowBudget.h"
+#include "VectorShim.h"
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Math/Frustum.h>
+#include <Urho3D/Math/Sphere.h>
+#include <Urho3D/Scene/Node.h>
+
+#include <algorithm> // for std::sort(), std::remove_if(), std::min(), std::max()
+#include <cstdio> // for std::snprintf()
+
+using Urho3D::Camera;
+using Urho3D::Frustum;
+using Urho3D::Light;
+using Urho3D::Node;
+using Urho3D::Sphere;
+using Urho3D::Vector3;
+using Urho3D::Vector4;
+using Urho3D::VariantMap;
+using Urho3D::E_POSTUPDATE;
+
+// lights that already cast shadows keep them against slightly better ranked ones, so shadows don't flicker
+static const float SHADOW_HYSTERESIS = 1.25f;
+
+// only touches lights whose state changes
+static void setCastShadows(Light * const light, bool castShadows)
+{
+    if (light->GetCastShadows() != castShadows)
+        light->SetCastShadows(castShadows);
+}
+
+static unsigned getNumShadowMaps(const Light *light)
+{
+    switch (light->GetLightType())
+    {
+    case Urho3D::LIGHT_DIRECTIONAL:
+    {
+        const Vector4 &splits = light->GetShadowCascade().splits_;
+        const unsigned numSplits = (splits.x_ > 0.0f) + (splits.y_ > 0.0f) + (splits.z_ > 0.0f) + (splits.w_ > 0.0f);
+        return std::max(numSplits, 1u);
+    }
+    case Urho3D::LIGHT_SPOT:
+        return 1;
+    default:
+        return 6; // cube map
+    }
+}
+
+ShadowBudget::ShadowBudget(Urho3D::Context *context) :
+    Urho3D::Object(context),
+    maxShadowedLights_(4),
+    shadowsEnabled_(true),
+    numVisibleLights_(0),
+    numShadowedLights_(0),
+    numShadowMaps_(0)
+{
+    SubscribeToEvent(E_POSTUPDATE, URHO3D_HANDLER(ShadowBudget, HandlePostUpdate));
+}
+
+ShadowBudget::~ShadowBudget()
+{
+}
+
+void ShadowBudget::SetRoot(Node *root)
+{
+    root_ = root;
+    Refresh();
+}
+
+void ShadowBudget::Refresh()
+{
+    lights_.clear();
+    if (!root_)
+        return;
+    ea::vector<Light*> lights;
+#ifdef USING_RBFX
+    root_->FindComponents<Light>(lights, Urho3D::ComponentSearchFlag::SelfOrChildrenRecursive);
+#else
+    root_->GetComponents<Light>(lights, true);
+#endif // USING_RBFX
+    for (Light * const light : lights)
+        lights_.push_back(Urho3D::WeakPtr<Light>(light));
+}
+
+std::string ShadowBudget::GetStatsText() const
+{
+    char text[96];
+    std::snprintf(text, sizeof(text), "%u/%u visible lights shadowed, %u shadow maps",
+        numShadowedLights_, numVisibleLights_, numShadowMaps_);
+    return text;
+}
+
+void ShadowBudget::HandlePostUpdate(Urho3D::StringHash eventType, VariantMap &eventData)
+{
+    Update();
+}
+
+void ShadowBudget::Update()
+{
+    numVisibleLights_ = 0;
+    numShadowedLights_ = 0;
+    numShadowMaps_ = 0;
+    if (!camera_ || !camera_->GetNode())
+        return;
+
+    const Frustum &frustum = camera_->GetFrustum();
+    const Vector3 cameraPosition = camera_->GetNode()->GetWorldPosition();
+    const float halfViewSize = camera_->GetHalfViewSize();
+    candidates_.clear();
+    bool haveExpired = false;
+    for (const Urho3D::WeakPtr<Light> &weakLight : lights_)
+    {
+        Light * const light = weakLight.Get();
+        if (!light)
+        {
+            haveExpired = true;
+            continue;
+        }
+        if (!light->IsEnabledEffective())
+            continue;
+        if (light->GetLightType() == Urho3D::LIGHT_DIRECTIONAL)
+        {
+            ++numVisibleLights_;
+            setCastShadows(light, shadowsEnabled_);
+            if (shadowsEnabled_)
+            {
+                ++numShadowedLights_;
+                numShadowMaps_ += getNumShadowMaps(light);
+            }
+            continue;
+        }
+
+        const Vector3 position = light->GetNode()->GetWorldPosition();
+        const float range = light->GetRange();
+        if (frustum.IsInsideFast(Sphere(position, range)) == Urho3D::OUTSIDE)
+        {
+            setCastShadows(light, false);
+            continue;
+        }
+        ++numVisibleLights_;
+        const float distance = (position - cameraPosition).Length();
+        // rough share of the screen height the light's range covers, all of it once the camera is inside
+        const float coverage = (distance <= range) ? 1.0f : std::min(1.0f, range / (distance * halfViewSize));
+        float score = coverage * light->GetBrightness() / (1.0f + distance);
+        if (light->GetCastShadows())
+            score *= SHADOW_HYSTERESIS;
+        candidates_.push_back(Candidate{light, score});
+    }
+    if (haveExpired)
+        lights_.erase(std::remove_if(lights_.begin(), lights_.end(), [](const Urho3D::WeakPtr<Light> &light) {return !light;}), lights_.end());
+
+    std::sort(candidates_.begin(), candidates_.end(), [](const Candidate &a, const Candidate &b) {return a.score_ > b.score_;});
+    for (std::size_t i = 0; i < candidates_.size(); ++i)
+    {
+        Light * const light = candidates_[i].light_;
+        const bool castShadows = shadowsEnabled_ && i < maxShadowedLights_;
+        setCastShadows(light, castShadows);
+        if (castShadows)
+        {
+            ++numShadowedLights_;
+            numShadowMaps_ += getNumShadowMaps(light);
+        }
+    }
+}
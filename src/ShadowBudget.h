@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Variant.h>
+
+#include <string>
+#include <vector>
+
+// forward declarations
+namespace Urho3D {
+
+class Camera;
+class Light;
+class Node;
+class StringHash;
+
+} // namespace Urho3D
+
+// lets only the lights that matter most for the current view cast shadows: every
+// frame the lights below the root node are ranked by how much of the screen their
+// range covers and by their distance to the camera, and only the best few keep
+// shadow casting; a shadowed point light alone renders six shadow map faces
+class ShadowBudget : public Urho3D::Object
+{
+    URHO3D_OBJECT(ShadowBudget, Urho3D::Object);
+public:
+    explicit ShadowBudget(Urho3D::Context *context);
+    ~ShadowBudget() override;
+
+    void SetRoot(Urho3D::Node *root);
+    // collects the lights below the root again, needed after adding lights to it
+    void Refresh();
+    void SetCamera(Urho3D::Camera *camera) {camera_ = camera;}
+    // directional lights always get their shadows and don't count against the budget
+    void SetMaxShadowedLights(unsigned maxShadowedLights) {maxShadowedLights_ = maxShadowedLights;}
+    void SetShadowsEnabled(bool enabled) {shadowsEnabled_ = enabled;} // false turns them off on every light
+    bool GetShadowsEnabled() const {return shadowsEnabled_;}
+
+    // counters of the last frame
+    unsigned GetNumLights() const {return static_cast<unsigned>(lights_.size());}
+    unsigned GetNumVisibleLights() const {return numVisibleLights_;}
+    unsigned GetNumShadowedLights() const {return numShadowedLights_;}
+    unsigned GetNumShadowMaps() const {return numShadowMaps_;} // cube faces and cascade splits count separately
+    std::string GetStatsText() const;
+protected:
+    void HandlePostUpdate(Urho3D::StringHash eventType, Urho3D::VariantMap &eventData);
+    void Update();
+
+    struct Candidate
+    {
+        Urho3D::Light *light_;
+        float score_;
+    };
+    Urho3D::WeakPtr<Urho3D::Node> root_;
+    Urho3D::WeakPtr<Urho3D::Camera> camera_;
+    std::vector<Urho3D::WeakPtr<Urho3D::Light>> lights_;
+    std::vector<Candidate> candidates_; // reused every frame
+    unsigned maxShadowedLights_;
+    bool shadowsEnabled_;
+    unsigned numVisibleLights_;
+    unsigned numShadowedLights_;
+    unsigned numShadowMaps_;
+};
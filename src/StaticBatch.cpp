@@ -0,0 +1,210 @@
+#include "StaticBatch.h"
+
+#include <Urho3D/Graphics/GraphicsDefs.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Math/Matrix3.h>
+
+#include <algorithm> // for std::min()
+#include <cmath> // for std::floor()
+#include <cstring>
+#include <map>
+#include <tuple>
+
+using Urho3D::BoundingBox;
+using Urho3D::Matrix3;
+using Urho3D::Matrix3x4;
+using Urho3D::Vector3;
+using Urho3D::MASK_NORMAL;
+using Urho3D::MASK_TEXCOORD1;
+using Urho3D::MASK_TANGENT;
+
+namespace {
+
+// where the transformable attributes live inside one vertex, see cookAssimpMesh()
+struct VertexLayout
+{
+    explicit VertexLayout(const CookedMesh &mesh)
+    {
+        unsigned offset = 3 * sizeof(float); // position always comes first
+        normalOffset_ = offset;
+        if (mesh.vertexMask_ & MASK_NORMAL)
+            offset += 3 * sizeof(float);
+        if (mesh.vertexMask_ & MASK_TEXCOORD1)
+            offset += 2 * sizeof(float);
+        tangentOffset_ = offset;
+        hasNormal_ = (mesh.vertexMask_ & MASK_NORMAL) != 0;
+        hasTangent_ = (mesh.vertexMask_ & MASK_TANGENT) != 0;
+    }
+    unsigned normalOffset_;
+    unsigned tangentOffset_;
+    bool hasNormal_;
+    bool hasTangent_;
+};
+
+struct BatchKey
+{
+    unsigned cell_;
+    unsigned materialIndex_;
+    unsigned vertexMask_;
+    bool operator<(const BatchKey &other) const
+    {
+        return std::tie(cell_, materialIndex_, vertexMask_) <
+            std::tie(other.cell_, other.materialIndex_, other.vertexMask_);
+    }
+};
+
+struct Batch
+{
+    unsigned vertexSize_ = 0;
+    std::vector<unsigned char> vertices_;
+    std::vector<uint32_t> indices_;
+    BoundingBox boundingBox_;
+};
+
+} // namespace
+
+static Vector3 readVector3(const unsigned char *src)
+{
+    float v[3];
+    std::memcpy(v, src, sizeof(v));
+    return Vector3(v[0], v[1], v[2]);
+}
+
+static void writeVector3(unsigned char *dest, const Vector3 &v)
+{
+    const float components[3] = {v.x_, v.y_, v.z_};
+    std::memcpy(dest, components, sizeof(components));
+}
+
+static float determinant(const Matrix3 &m)
+{
+    return m.m00_ * (m.m11_ * m.m22_ - m.m12_ * m.m21_) -
+           m.m01_ * (m.m10_ * m.m22_ - m.m12_ * m.m20_) +
+           m.m02_ * (m.m10_ * m.m21_ - m.m11_ * m.m20_);
+}
+
+static void appendMesh(const CookedMesh &mesh, const Matrix3x4 &transform, Batch &batch)
+{
+    const VertexLayout layout(mesh);
+    const Matrix3 rotation = transform.ToMatrix3();
+    const Matrix3 normalMatrix = rotation.Inverse().Transpose();
+    // a mirroring transform flips the triangle winding and the tangent handedness
+    const bool mirrored = determinant(rotation) < 0.0f;
+
+    const std::size_t firstVertex = batch.vertices_.size() / mesh.vertexSize_;
+    batch.vertexSize_ = mesh.vertexSize_;
+    batch.vertices_.insert(batch.vertices_.end(), mesh.vertexData_, mesh.vertexData_ + static_cast<std::size_t>(mesh.vertexCount_) * mesh.vertexSize_);
+    for (unsigned i = 0; i < mesh.vertexCount_; ++i)
+    {
+        unsigned char * const vertex = &batch.vertices_[(firstVertex + i) * mesh.vertexSize_];
+        const Vector3 position = transform * readVector3(vertex);
+        writeVector3(vertex, position);
+        batch.boundingBox_.Merge(position);
+        if (layout.hasNormal_)
+            writeVector3(vertex + layout.normalOffset_, (normalMatrix * readVector3(vertex + layout.normalOffset_)).Normalized());
+        if (layout.hasTangent_)
+        {
+            unsigned char * const tangent = vertex + layout.tangentOffset_;
+            writeVector3(tangent, (rotation * readVector3(tangent)).Normalized());
+            if (mirrored)
+            {
+                float w;
+                std::memcpy(&w, tangent + 3 * sizeof(float), sizeof(w));
+                w = -w;
+                std::memcpy(tangent + 3 * sizeof(float), &w, sizeof(w));
+            }
+        }
+    }
+
+    const std::size_t firstIndex = batch.indices_.size();
+    batch.indices_.resize(firstIndex + mesh.indexCount_);
+    for (unsigned i = 0; i < mesh.indexCount_; ++i)
+    {
+        uint32_t index;
+        if (mesh.largeIndices_)
+            std::memcpy(&index, mesh.indexData_ + i * sizeof(uint32_t), sizeof(uint32_t));
+        else
+        {
+            uint16_t smallIndex;
+            std::memcpy(&smallIndex, mesh.indexData_ + i * sizeof(uint16_t), sizeof(uint16_t));
+            index = smallIndex;
+        }
+        batch.indices_[firstIndex + i] = static_cast<uint32_t>(firstVertex) + index;
+    }
+    if (mirrored)
+        for (std::size_t i = firstIndex; i + 2 < batch.indices_.size(); i += 3)
+            std::swap(batch.indices_[i + 1], batch.indices_[i + 2]);
+}
+
+std::vector<CookedMesh> BatchStaticMeshes(const CookedScene &scene, const std::vector<bool> &batchNodes, const std::vector<Matrix3x4> &nodeTransforms, unsigned cellsPerAxis, CookedScene::Storage &storage)
+{
+    // size the grid from the bounds of everything that gets batched
+    BoundingBox sceneBox;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+        if (batchNodes[i])
+            for (const unsigned meshIndex : scene.nodes_[i].meshes_)
+                sceneBox.Merge(scene.meshes_[meshIndex].boundingBox_.Transformed(nodeTransforms[i]));
+    if (!sceneBox.Defined())
+        return std::vector<CookedMesh>();
+    cellsPerAxis = std::max(cellsPerAxis, 1u);
+    const Vector3 sceneSize = sceneBox.Size();
+    const float cellSize = std::max(std::max(sceneSize.x_, sceneSize.z_) / cellsPerAxis, 1e-3f);
+    const auto cellCoordinate = [cellsPerAxis, cellSize](float offset)
+    {
+        return std::min(static_cast<unsigned>(std::max(std::floor(offset / cellSize), 0.0f)), cellsPerAxis - 1);
+    };
+
+    std::map<BatchKey, Batch> batches;
+    unsigned numInstances = 0;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        if (!batchNodes[i])
+            continue;
+        for (const unsigned meshIndex : scene.nodes_[i].meshes_)
+        {
+            const CookedMesh &mesh = scene.meshes_[meshIndex];
+            const Vector3 center = mesh.boundingBox_.Transformed(nodeTransforms[i]).Center();
+            const unsigned cell = cellCoordinate(center.z_ - sceneBox.min_.z_) * cellsPerAxis + cellCoordinate(center.x_ - sceneBox.min_.x_);
+            appendMesh(mesh, nodeTransforms[i], batches[BatchKey{cell, mesh.materialIndex_, mesh.vertexMask_}]);
+            ++numInstances;
+        }
+    }
+
+    std::vector<CookedMesh> result;
+    result.reserve(batches.size());
+    for (const std::pair<const BatchKey, Batch> &entry : batches)
+    {
+        const BatchKey &key = entry.first;
+        const Batch &batch = entry.second;
+        CookedMesh mesh;
+        mesh.vertexMask_ = key.vertexMask_;
+        mesh.vertexSize_ = batch.vertexSize_;
+        mesh.vertexCount_ = static_cast<unsigned>(batch.vertices_.size() / batch.vertexSize_);
+        mesh.indexCount_ = static_cast<unsigned>(batch.indices_.size());
+        mesh.largeIndices_ = mesh.vertexCount_ > 0xffff;
+        mesh.materialIndex_ = key.materialIndex_;
+        mesh.boundingBox_ = batch.boundingBox_;
+
+        unsigned char * const vertexData = CookedScene::Allocate(storage, batch.vertices_.size());
+        std::memcpy(vertexData, batch.vertices_.data(), batch.vertices_.size());
+        mesh.vertexData_ = vertexData;
+        if (mesh.largeIndices_)
+        {
+            unsigned char * const indexData = CookedScene::Allocate(storage, batch.indices_.size() * sizeof(uint32_t));
+            std::memcpy(indexData, batch.indices_.data(), batch.indices_.size() * sizeof(uint32_t));
+            mesh.indexData_ = indexData;
+        }
+        else
+        {
+            uint16_t * const indexData = reinterpret_cast<uint16_t*>(CookedScene::Allocate(storage, batch.indices_.size() * sizeof(uint16_t)));
+            for (std::size_t i = 0; i < batch.indices_.size(); ++i)
+                indexData[i] = static_cast<uint16_t>(batch.indices_[i]);
+            mesh.indexData_ = reinterpret_cast<const unsigned char*>(indexData);
+        }
+        result.push_back(mesh);
+    }
+
+    URHO3D_LOGINFOF("Batched %u static mesh instances into %u meshes (%ux%u cells of %.1f units)",
+        numInstances, static_cast<unsigned>(result.size()), cellsPerAxis, cellsPerAxis, cellSize);
+    return result;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "CookedScene.h"
+
+#include <Urho3D/Math/Matrix3x4.h>
+
+#include <vector>
+
+// merges the meshes of the flagged nodes into one mesh per material and grid
+// cell, with vertices moved into the space nodeTransforms are relative to; the
+// grid divides the longer horizontal side of the merged bounds into cellsPerAxis
+// cells, and the returned meshes point into storage
+std::vector<CookedMesh> BatchStaticMeshes(const CookedScene &scene, const std::vector<bool> &batchNodes, const std::vector<Urho3D::Matrix3x4> &nodeTransforms, unsigned cellsPerAxis, CookedScene::Storage &storage);
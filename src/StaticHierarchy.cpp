@@ -0,0 +1,129 @@
+#include "StaticHierarchy.h"
+
+#include <Urho3D/Math/Matrix3x4.h>
+
+#include <unordered_set>
+
+using Urho3D::Matrix3x4;
+using Urho3D::Quaternion;
+using Urho3D::Vector3;
+
+static const char * const STATIC_ROOT_NAME = "StaticRoot";
+static const float SHEAR_TOLERANCE = 1e-4f;
+
+namespace {
+
+struct WorldTransform
+{
+    Vector3 position_;
+    Quaternion rotation_;
+    Vector3 scale_;
+};
+
+} // namespace
+
+// same rules as findStaticNodes() in SceneLoader.cpp, plus no GameObjectType at all,
+// since game objects are looked up under their own node
+static bool isStaticNode(const CookedScene &scene, const CookedNode &node)
+{
+    if (node.mass_ != 0.0f || node.name_ == "Elevator" || !node.gameObjectType_.empty() || node.animated_)
+        return false;
+    for (const unsigned meshIndex : node.meshes_)
+        if (!scene.meshes_[meshIndex].bones_.empty())
+            return false;
+    return true;
+}
+
+// false if the transform has shear (from a non-uniformly scaled parent of a rotated
+// child), which no single node transform can reproduce
+static bool decomposeExactly(const Matrix3x4 &transform, WorldTransform &world)
+{
+    transform.Decompose(world.position_, world.rotation_, world.scale_);
+    return Matrix3x4(world.position_, world.rotation_, world.scale_).Equals(transform, SHEAR_TOLERANCE);
+}
+
+FlattenStats FlattenStaticNodes(CookedScene &scene)
+{
+    const std::size_t numNodes = scene.nodes_.size();
+    FlattenStats stats;
+    stats.nodesBefore_ = static_cast<unsigned>(numNodes);
+
+    // skinned meshes bind their bones to nodes by name, and keep the hierarchy they were made for
+    std::unordered_set<std::string> boneNames;
+    for (const CookedMesh &mesh : scene.meshes_)
+        for (const CookedMesh::Bone &bone : mesh.bones_)
+            boneNames.insert(bone.name_);
+    std::unordered_set<std::string> lightNames;
+    for (const CookedLight &light : scene.lights_)
+        lightNames.insert(light.name_);
+
+    std::vector<Matrix3x4> transforms(numNodes);
+    std::vector<WorldTransform> worlds(numNodes);
+    std::vector<bool> isStatic(numNodes, false);
+    std::vector<int> cellNodes(numNodes, -1); // the node whose "StreamingCell" extra applies
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        const CookedNode &node = scene.nodes_[i];
+        const Matrix3x4 local(node.position_, node.rotation_, node.scale_);
+        transforms[i] = (node.parent_ < 0) ? local : transforms[node.parent_] * local;
+        const bool parentStatic = node.parent_ < 0 || isStatic[node.parent_];
+        isStatic[i] = parentStatic && isStaticNode(scene, node) && !boneNames.count(node.name_);
+        if (!node.streamingCell_.empty())
+            cellNodes[i] = static_cast<int>(i);
+        else if (node.parent_ >= 0)
+            cellNodes[i] = cellNodes[node.parent_];
+    }
+
+    // kept nodes stay where they are, and so do all their ancestors
+    std::vector<bool> keep(numNodes, false);
+    for (std::size_t i = 0; i < numNodes; ++i)
+        keep[i] = !isStatic[i] || !decomposeExactly(transforms[i], worlds[i]);
+    for (std::size_t i = numNodes; i-- > 0;)
+        if (keep[i] && scene.nodes_[i].parent_ >= 0)
+            keep[scene.nodes_[i].parent_] = true;
+
+    // the kept nodes first, in their order, then the static root and the flattened nodes,
+    // so the result is still depth-first
+    std::vector<CookedNode> nodes;
+    nodes.reserve(numNodes + 1);
+    std::vector<int> nodeRemap(numNodes, -1);
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        if (!keep[i])
+            continue;
+        nodeRemap[i] = static_cast<int>(nodes.size());
+        nodes.push_back(scene.nodes_[i]);
+        if (nodes.back().parent_ >= 0)
+            nodes.back().parent_ = nodeRemap[nodes.back().parent_];
+    }
+    const int staticRoot = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+    nodes.back().name_ = STATIC_ROOT_NAME;
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        if (keep[i])
+            continue;
+        const CookedNode &node = scene.nodes_[i];
+        if (node.meshes_.empty() && node.colliders_.empty() && node.instances_.empty() && !lightNames.count(node.name_))
+        {
+            ++stats.removed_;
+            continue;
+        }
+        nodes.push_back(node);
+        CookedNode &flattened = nodes.back();
+        flattened.parent_ = staticRoot;
+        flattened.position_ = worlds[i].position_;
+        flattened.rotation_ = worlds[i].rotation_;
+        flattened.scale_ = worlds[i].scale_;
+        if (cellNodes[i] >= 0)
+            flattened.streamingCell_ = scene.nodes_[cellNodes[i]].streamingCell_;
+        ++stats.reparented_;
+    }
+    if (!stats.reparented_)
+        nodes.pop_back();
+
+    scene.nodes_.swap(nodes);
+    scene.staticRoot_ = stats.reparented_ ? staticRoot : -1;
+    stats.nodesAfter_ = static_cast<unsigned>(scene.nodes_.size());
+    return stats;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CookedScene.h"
+
+struct FlattenStats
+{
+    unsigned nodesBefore_ = 0;
+    unsigned nodesAfter_ = 0; // including the static root
+    unsigned reparented_ = 0;
+    unsigned removed_ = 0; // empty static nodes
+};
+
+// moves the static nodes (no mass, GameObjectType, animation or skinned meshes, not the
+// Elevator and not a bone, nor below any such node) directly under one new top-level
+// "StaticRoot" node with their world transforms baked in, and drops those left with
+// nothing to draw, collide or light; the other nodes keep their place, and so do their
+// ancestors and nodes whose world transform has shear; a flattened node takes the
+// nearest "StreamingCell" extra above it, and CookedScene::staticRoot_ is set when
+// anything ended up under the static root
+// node indices change, so this has to run once everything indexed by them is cooked
+FlattenStats FlattenStaticNodes(CookedScene &scene);
@@ -0,0 +1,176 @@
+#include "StreamingCells.h"
+
+#include <Urho3D/Math/Matrix3x4.h>
+
+#include <algorithm> // for std::max()
+#include <cmath> // for std::floor()
+#include <unordered_map>
+
+using Urho3D::BoundingBox;
+using Urho3D::Matrix3x4;
+using Urho3D::Vector3;
+
+static const int NO_ROOT = -1;
+
+// the single top-level node besides the static root, if it holds nothing but the level
+static int findLevelRoot(const CookedScene &scene)
+{
+    int root = NO_ROOT;
+    for (std::size_t i = 0; i < scene.nodes_.size(); ++i)
+    {
+        if (scene.nodes_[i].parent_ >= 0 || static_cast<int>(i) == scene.staticRoot_)
+            continue;
+        if (root != NO_ROOT)
+            return NO_ROOT;
+        root = static_cast<int>(i);
+    }
+    if (root == NO_ROOT)
+        return NO_ROOT;
+    const CookedNode &node = scene.nodes_[root];
+    const bool empty = node.meshes_.empty() && node.colliders_.empty() && node.instances_.empty() && node.gameObjectType_.empty();
+    return empty ? root : NO_ROOT;
+}
+
+std::vector<StreamingCell> PartitionStreamingCells(const std::shared_ptr<const CookedScene> &scene, float cellSize)
+{
+    const std::size_t numNodes = scene->nodes_.size();
+    // the level root and the static root only hold units, every cell gets a copy of them
+    std::vector<bool> isContainer(numNodes, false);
+    std::vector<int> containers;
+    for (const int root : {findLevelRoot(*scene), scene->staticRoot_})
+    {
+        if (root == NO_ROOT)
+            continue;
+        isContainer[root] = true;
+        containers.push_back(root);
+    }
+    cellSize = std::max(cellSize, 1e-3f);
+
+    // every node belongs to the unit (top-level node or child of a container) above it,
+    // the units' bounds decide their grid square
+    std::vector<unsigned> units(numNodes, 0);
+    std::vector<Matrix3x4> transforms(numNodes);
+    std::vector<BoundingBox> unitBounds(numNodes);
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        const CookedNode &node = scene->nodes_[i];
+        const Matrix3x4 local(node.position_, node.rotation_, node.scale_);
+        transforms[i] = (node.parent_ < 0) ? local : transforms[node.parent_] * local;
+        if (isContainer[i])
+            continue;
+        const bool isUnit = node.parent_ < 0 || isContainer[node.parent_];
+        units[i] = isUnit ? static_cast<unsigned>(i) : units[node.parent_];
+
+        BoundingBox &bounds = unitBounds[units[i]];
+        bounds.Merge(transforms[i].Translation());
+        for (const unsigned meshIndex : node.meshes_)
+        {
+            const BoundingBox &meshBox = scene->meshes_[meshIndex].boundingBox_;
+            if (node.instances_.empty())
+                bounds.Merge(meshBox.Transformed(transforms[i]));
+            for (const CookedInstance &instance : node.instances_)
+                bounds.Merge(meshBox.Transformed(transforms[i] * Matrix3x4(instance.position_, instance.rotation_, instance.scale_)));
+        }
+    }
+
+    // one cell per name, in the order they are first seen
+    std::unordered_map<std::string, unsigned> cellIndices;
+    std::vector<StreamingCell> cells;
+    std::vector<std::shared_ptr<CookedScene>> cellScenes;
+    const auto getCell = [&](const std::string &name)
+    {
+        const auto inserted = cellIndices.emplace(name, static_cast<unsigned>(cells.size()));
+        if (inserted.second)
+        {
+            cells.emplace_back();
+            cells.back().name_ = name;
+            cellScenes.push_back(std::make_shared<CookedScene>());
+        }
+        return inserted.first->second;
+    };
+    std::vector<unsigned> nodeCells(numNodes, 0);
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        if (isContainer[i] || units[i] != i)
+            continue;
+        const BoundingBox &bounds = unitBounds[i];
+        std::string name = scene->nodes_[i].streamingCell_;
+        if (name.empty())
+        {
+            const Vector3 center = bounds.Center();
+            name = "grid_" + std::to_string(static_cast<long long>(std::floor(center.x_ / cellSize))) +
+                "_" + std::to_string(static_cast<long long>(std::floor(center.z_ / cellSize)));
+        }
+        nodeCells[i] = getCell(name);
+        cells[nodeCells[i]].bounds_.Merge(bounds);
+    }
+
+    // the nodes keep their order, so parents still precede their children; the containers
+    // come first in every cell, at the same indices
+    std::vector<int> nodeRemap(numNodes, -1);
+    std::vector<std::vector<int>> meshRemaps(cells.size(), std::vector<int>(scene->meshes_.size(), -1));
+    for (std::size_t c = 0; c < containers.size(); ++c)
+    {
+        const int root = containers[c];
+        nodeRemap[root] = static_cast<int>(c);
+        for (const std::shared_ptr<CookedScene> &cellScene : cellScenes)
+        {
+            if (root == scene->staticRoot_)
+                cellScene->staticRoot_ = nodeRemap[root];
+            cellScene->nodes_.push_back(scene->nodes_[root]);
+        }
+    }
+    for (std::size_t i = 0; i < numNodes; ++i)
+    {
+        if (isContainer[i])
+            continue;
+        const unsigned cell = nodeCells[units[i]];
+        CookedScene &cellScene = *cellScenes[cell];
+        std::vector<int> &meshRemap = meshRemaps[cell];
+        nodeRemap[i] = static_cast<int>(cellScene.nodes_.size());
+        cellScene.nodes_.push_back(scene->nodes_[i]);
+        CookedNode &node = cellScene.nodes_.back();
+        if (node.parent_ >= 0)
+            node.parent_ = nodeRemap[node.parent_];
+        for (unsigned &meshIndex : node.meshes_)
+        {
+            if (meshRemap[meshIndex] < 0)
+            {
+                meshRemap[meshIndex] = static_cast<int>(cellScene.meshes_.size());
+                cellScene.meshes_.push_back(scene->meshes_[meshIndex]);
+                cellScene.sourceMeshes_.push_back(meshIndex);
+            }
+            meshIndex = static_cast<unsigned>(meshRemap[meshIndex]);
+        }
+    }
+
+    // lights are created under the node of the same name (see instantiateCookedLights())
+    std::unordered_map<std::string, unsigned> nodesByName;
+    for (std::size_t i = numNodes; i-- > 0;)
+        if (!isContainer[i])
+            nodesByName[scene->nodes_[i].name_] = static_cast<unsigned>(i);
+    for (const CookedLight &light : scene->lights_)
+    {
+        const auto it = nodesByName.find(light.name_);
+        const unsigned cell = (it != nodesByName.end()) ? nodeCells[units[it->second]] : getCell(std::string());
+        cellScenes[cell]->lights_.push_back(light);
+    }
+    // an animation goes with the node of its first track, its AnimationPlayer only finds
+    // the nodes of the same cell
+    for (const CookedAnimation &animation : scene->animations_)
+    {
+        const auto it = animation.tracks_.empty() ? nodesByName.end() : nodesByName.find(animation.tracks_.front().nodeName_);
+        const unsigned cell = (it != nodesByName.end()) ? nodeCells[units[it->second]] : getCell(std::string());
+        cellScenes[cell]->animations_.push_back(animation);
+    }
+
+    for (std::size_t c = 0; c < cells.size(); ++c)
+    {
+        cellScenes[c]->materials_ = scene->materials_;
+        cellScenes[c]->textures_ = scene->textures_;
+        cellScenes[c]->sourceFilename_ = scene->sourceFilename_;
+        cellScenes[c]->source_ = scene;
+        cells[c].scene_ = cellScenes[c];
+    }
+    return cells;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CookedScene.h"
+
+#include <Urho3D/Math/BoundingBox.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// a part of a level that is loaded and unloaded as a whole (see SceneStreamer)
+struct StreamingCell
+{
+    std::string name_; // the "StreamingCell" extra, "grid_<x>_<z>" or empty for the resident cell
+    Urho3D::BoundingBox bounds_; // relative to the level's parent node, undefined for the resident cell
+    std::shared_ptr<const CookedScene> scene_; // the cell's nodes, meshes, lights and animations
+};
+
+// splits a level by its top-level nodes (or the children of a lone empty root node, as
+// Assimp puts one above the glTF scene, and of the static root, which are then repeated
+// in every cell): nodes
+// with a "StreamingCell" extra go to the cell of that name, the rest to the square of a
+// cellSize grid their bounds are centred in; lights go with the node of their name and
+// animations with the node of their first track, those without one end up in a
+// resident cell that is meant to stay loaded
+// the cells point into scene's mesh and texture data and keep it alive, and share the
+// level's BVH cache; instantiate them with one SharedSceneModels, so meshes used in
+// several cells get one Model
+std::vector<StreamingCell> PartitionStreamingCells(const std::shared_ptr<const CookedScene> &scene, float cellSize);
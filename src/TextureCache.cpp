@@ -0,0 +1,136 @@
+#include "TextureCache.h"
+#include "CacheIO.h"
+#include "MappedFile.h"
+#include "TextureCompression.h"
+
+#include <Urho3D/IO/Log.h>
+
+#include <cstring>
+
+// file layout: header, then the textures as written by WriteCookedTexture(); the
+// version also covers the encoder, whose output the entries are
+static const char TEXTURE_CACHE_MAGIC[4] = {'R', 'T', 'E', 'X'};
+static const uint32_t TEXTURE_CACHE_VERSION = 1; // bump whenever the layout below or the encoder changes
+// per level: width, height and size
+static const std::size_t LEVEL_HEADER_SIZE = 3 * sizeof(uint32_t);
+
+void WriteCookedTexture(CacheWriter &writer, const CookedTexture &texture)
+{
+    writer.Write<uint64_t>(texture.hash_);
+    writer.Write<uint32_t>(texture.format_);
+    writer.Write<uint32_t>(texture.width_);
+    writer.Write<uint32_t>(texture.height_);
+    writer.Write<uint32_t>(static_cast<uint32_t>(texture.levels_.size()));
+    for (const CookedTexture::Level &level : texture.levels_)
+    {
+        writer.Write<uint32_t>(level.width_);
+        writer.Write<uint32_t>(level.height_);
+        writer.Write<uint32_t>(static_cast<uint32_t>(level.size_));
+        writer.WriteBlob(level.data_, level.size_);
+    }
+}
+
+bool ReadCookedTexture(CacheReader &reader, CookedTexture &texture)
+{
+    texture.hash_ = reader.Read<uint64_t>();
+    texture.format_ = reader.Read<uint32_t>();
+    texture.width_ = reader.Read<uint32_t>();
+    texture.height_ = reader.Read<uint32_t>();
+    texture.levels_.resize(reader.ReadCount(LEVEL_HEADER_SIZE));
+    if (texture.format_ > BLOCK_FORMAT_BC3 || texture.levels_.empty())
+        return false;
+    for (CookedTexture::Level &level : texture.levels_)
+    {
+        level.width_ = reader.Read<uint32_t>();
+        level.height_ = reader.Read<uint32_t>();
+        level.size_ = reader.Read<uint32_t>();
+        level.data_ = reader.ReadBlob(level.size_);
+        // the level is uploaded as is, so its size has to match exactly
+        if (level.size_ != GetCompressedSize(level.width_, level.height_, static_cast<TextureBlockFormat>(texture.format_)))
+            return false;
+    }
+    return reader.IsOk();
+}
+
+TextureCache::TextureCache()
+{
+}
+
+TextureCache::~TextureCache()
+{
+}
+
+bool TextureCache::Load(const std::string &filename)
+{
+    entries_.clear();
+    file_.reset();
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->Open(filename))
+        return false;
+
+    CacheReader reader(file->GetData(), file->GetSize());
+    char magic[4];
+    for (char &c : magic)
+        c = reader.Read<char>();
+    const uint32_t version = reader.Read<uint32_t>();
+    if (!reader.IsOk() || std::memcmp(magic, TEXTURE_CACHE_MAGIC, sizeof(magic)) != 0)
+    {
+        URHO3D_LOGWARNINGF("Ignoring texture cache '%s': not a texture cache file", filename.c_str());
+        return false;
+    }
+    if (version != TEXTURE_CACHE_VERSION)
+    {
+        URHO3D_LOGINFOF("Texture cache '%s' is from a different version", filename.c_str());
+        return false;
+    }
+
+    const uint32_t count = reader.ReadCount(sizeof(uint64_t) + 4 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count && reader.IsOk(); ++i)
+    {
+        CookedTexture texture;
+        if (!ReadCookedTexture(reader, texture))
+        {
+            URHO3D_LOGWARNINGF("Ignoring texture cache '%s': corrupt texture", filename.c_str());
+            entries_.clear();
+            return false;
+        }
+        entries_[texture.hash_] = texture;
+    }
+    if (!reader.IsOk() || !reader.AtEnd())
+    {
+        URHO3D_LOGWARNINGF("Ignoring texture cache '%s': truncated or corrupt", filename.c_str());
+        entries_.clear();
+        return false;
+    }
+
+    file_ = file;
+    return true;
+}
+
+bool TextureCache::Find(uint64_t hash, CookedScene::Storage &storage, CookedTexture &texture) const
+{
+    const auto it = entries_.find(hash);
+    if (it == entries_.end())
+        return false;
+    texture = it->second;
+    for (CookedTexture::Level &level : texture.levels_)
+    {
+        unsigned char * const data = CookedScene::Allocate(storage, level.size_);
+        std::memcpy(data, level.data_, level.size_);
+        level.data_ = data;
+    }
+    return true;
+}
+
+bool TextureCache::Save(const std::string &filename, const std::vector<CookedTexture> &textures)
+{
+    CacheWriter writer;
+    for (const char c : TEXTURE_CACHE_MAGIC)
+        writer.Write(c);
+    writer.Write<uint32_t>(TEXTURE_CACHE_VERSION);
+    writer.Write<uint32_t>(static_cast<uint32_t>(textures.size()));
+    for (const CookedTexture &texture : textures)
+        WriteCookedTexture(writer, texture);
+    return WriteFileAtomically(filename, writer.GetData());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CookedScene.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// forward declarations
+class CacheReader;
+class CacheWriter;
+class MappedFile;
+
+// appended to the source filename to get the block-compressed texture cache filename
+static const char * const TEXTURE_CACHE_EXTENSION = ".textures";
+
+// a cooked texture as stored in the texture and scene caches; the read levels point
+// into the reader's data
+void WriteCookedTexture(CacheWriter &writer, const CookedTexture &texture);
+bool ReadCookedTexture(CacheReader &reader, CookedTexture &texture);
+
+// encoded textures by the hash of their source image, so editing a level only
+// re-encodes the images that actually changed; unlike the scene cache it survives
+// any change to the rest of the file
+class TextureCache
+{
+public:
+    TextureCache();
+    ~TextureCache();
+
+    // files written by a different cache version are ignored
+    bool Load(const std::string &filename);
+    unsigned GetNumEntries() const {return static_cast<unsigned>(entries_.size());}
+    // copies the levels of the entry into storage, false if there is none for hash
+    bool Find(uint64_t hash, CookedScene::Storage &storage, CookedTexture &texture) const;
+
+    static bool Save(const std::string &filename, const std::vector<CookedTexture> &textures);
+protected:
+    std::shared_ptr<MappedFile> file_;
+    std::unordered_map<uint64_t, CookedTexture> entries_; // pointing into the mapping
+};
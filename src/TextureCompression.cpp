@@ -0,0 +1,323 @@
+#include "TextureCompression.h"
+
+#include <Urho3D/ThirdParty/STB/stb_image.h>
+
+#include <algorithm> // for std::swap()
+#include <cmath> // for std::pow()
+#include <cstdlib> // for std::abs()
+#include <cstdint>
+#include <cstring>
+
+static const unsigned BLOCK_SIZE = 4;
+
+bool DecodeImage(const unsigned char *data, std::size_t size, RgbaImage &image)
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char * const pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 4);
+    if (!pixels)
+        return false;
+    image.width_ = static_cast<unsigned>(width);
+    image.height_ = static_cast<unsigned>(height);
+    image.pixels_.assign(pixels, pixels + static_cast<std::size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+void FlipImage(RgbaImage &image)
+{
+    const std::size_t rowSize = static_cast<std::size_t>(image.width_) * 4;
+    for (unsigned y = 0; y < image.height_ / 2; ++y)
+    {
+        unsigned char * const top = &image.pixels_[y * rowSize];
+        unsigned char * const bottom = &image.pixels_[(image.height_ - 1 - y) * rowSize];
+        std::swap_ranges(top, top + rowSize, bottom);
+    }
+}
+
+bool HasAlpha(const RgbaImage &image)
+{
+    for (std::size_t i = 3; i < image.pixels_.size(); i += 4)
+        if (image.pixels_[i] != 255)
+            return true;
+    return false;
+}
+
+// 8-bit sRGB to linear, and back with rounding
+static const float *getSrgbToLinear()
+{
+    static const struct Table
+    {
+        Table()
+        {
+            for (unsigned i = 0; i < 256; ++i)
+            {
+                const float c = i / 255.0f;
+                values_[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+        float values_[256];
+    } table;
+    return table.values_;
+}
+
+static unsigned char linearToSrgb(float value)
+{
+    const float c = (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<unsigned char>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+RgbaImage DownsampleImage(const RgbaImage &image, bool srgb)
+{
+    RgbaImage result;
+    result.width_ = std::max(image.width_ / 2, 1u);
+    result.height_ = std::max(image.height_ / 2, 1u);
+    result.pixels_.resize(static_cast<std::size_t>(result.width_) * result.height_ * 4);
+    const float * const toLinear = getSrgbToLinear();
+    for (unsigned y = 0; y < result.height_; ++y)
+    {
+        // a side of 1 has nothing to average along it
+        const unsigned y0 = std::min(y * 2, image.height_ - 1);
+        const unsigned y1 = std::min(y * 2 + 1, image.height_ - 1);
+        for (unsigned x = 0; x < result.width_; ++x)
+        {
+            const unsigned x0 = std::min(x * 2, image.width_ - 1);
+            const unsigned x1 = std::min(x * 2 + 1, image.width_ - 1);
+            const unsigned char * const samples[4] =
+            {
+                &image.pixels_[(static_cast<std::size_t>(y0) * image.width_ + x0) * 4],
+                &image.pixels_[(static_cast<std::size_t>(y0) * image.width_ + x1) * 4],
+                &image.pixels_[(static_cast<std::size_t>(y1) * image.width_ + x0) * 4],
+                &image.pixels_[(static_cast<std::size_t>(y1) * image.width_ + x1) * 4]
+            };
+            unsigned char * const dest = &result.pixels_[(static_cast<std::size_t>(y) * result.width_ + x) * 4];
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                // alpha is always linear
+                if (srgb && c < 3)
+                {
+                    const float sum = toLinear[samples[0][c]] + toLinear[samples[1][c]] + toLinear[samples[2][c]] + toLinear[samples[3][c]];
+                    dest[c] = linearToSrgb(sum * 0.25f);
+                }
+                else
+                    dest[c] = static_cast<unsigned char>((samples[0][c] + samples[1][c] + samples[2][c] + samples[3][c] + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+std::size_t GetCompressedSize(unsigned width, unsigned height, TextureBlockFormat format)
+{
+    const std::size_t blocksX = (std::max(width, 1u) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const std::size_t blocksY = (std::max(height, 1u) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return blocksX * blocksY * (format == BLOCK_FORMAT_BC3 ? 16 : 8);
+}
+
+static uint16_t packColor565(const float *color)
+{
+    const unsigned r = static_cast<unsigned>(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    const unsigned g = static_cast<unsigned>(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    const unsigned b = static_cast<unsigned>(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor565(uint16_t packed, int *color)
+{
+    const int r = (packed >> 11) & 31;
+    const int g = (packed >> 5) & 63;
+    const int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+template <typename T>
+static void writeBlockValue(unsigned char *&dest, T value)
+{
+    // little endian, as the GPU reads it
+    for (unsigned i = 0; i < sizeof(T); ++i)
+        *dest++ = static_cast<unsigned char>(value >> (8 * i));
+}
+
+// four-color BC1 block: the two endpoints are the block's extremes along the principal
+// axis of its colors, every pixel takes the nearest of them and the two in between
+static void compressColorBlock(const unsigned char (&pixels)[16][4], unsigned char *&dest)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (const auto &pixel : pixels)
+        for (unsigned c = 0; c < 3; ++c)
+            mean[c] += pixel[c] / 16.0f;
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}; // rr rg rb gg gb bb
+    for (const auto &pixel : pixels)
+    {
+        const float d[3] = {pixel[0] - mean[0], pixel[1] - mean[1], pixel[2] - mean[2]};
+        covariance[0] += d[0] * d[0];
+        covariance[1] += d[0] * d[1];
+        covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1];
+        covariance[4] += d[1] * d[2];
+        covariance[5] += d[2] * d[2];
+    }
+    // a few power iterations are plenty for a 3x3 matrix
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (unsigned iteration = 0; iteration < 4; ++iteration)
+    {
+        const float next[3] =
+        {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+        };
+        const float length = std::max(std::max(std::abs(next[0]), std::abs(next[1])), std::abs(next[2]));
+        if (length < 1e-6f)
+            break;
+        for (unsigned c = 0; c < 3; ++c)
+            axis[c] = next[c] / length;
+    }
+
+    unsigned minPixel = 0;
+    unsigned maxPixel = 0;
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        const float projection = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] + pixels[i][2] * axis[2];
+        if (i == 0 || projection < minProjection)
+        {
+            minProjection = projection;
+            minPixel = i;
+        }
+        if (i == 0 || projection > maxProjection)
+        {
+            maxProjection = projection;
+            maxPixel = i;
+        }
+    }
+    const float maxColor[3] = {static_cast<float>(pixels[maxPixel][0]), static_cast<float>(pixels[maxPixel][1]), static_cast<float>(pixels[maxPixel][2])};
+    const float minColor[3] = {static_cast<float>(pixels[minPixel][0]), static_cast<float>(pixels[minPixel][1]), static_cast<float>(pixels[minPixel][2])};
+    uint16_t color0 = packColor565(maxColor);
+    uint16_t color1 = packColor565(minColor);
+    // color0 > color1 selects the four-color mode
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackColor565(color0, palette[0]);
+        unpackColor565(color1, palette[1]);
+        for (unsigned c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            unsigned best = 0;
+            int bestDistance = 0;
+            for (unsigned j = 0; j < 4; ++j)
+            {
+                int distance = 0;
+                for (unsigned c = 0; c < 3; ++c)
+                    distance += (pixels[i][c] - palette[j][c]) * (pixels[i][c] - palette[j][c]);
+                if (j == 0 || distance < bestDistance)
+                {
+                    best = j;
+                    bestDistance = distance;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    writeBlockValue(dest, color0);
+    writeBlockValue(dest, color1);
+    writeBlockValue(dest, indices);
+}
+
+// eight-value BC3 alpha block between the block's lowest and highest alpha
+static void compressAlphaBlock(const unsigned char (&pixels)[16][4], unsigned char *&dest)
+{
+    unsigned char alpha0 = 0;
+    unsigned char alpha1 = 255;
+    for (const auto &pixel : pixels)
+    {
+        alpha0 = std::max(alpha0, pixel[3]);
+        alpha1 = std::min(alpha1, pixel[3]);
+    }
+    uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        // alpha0 > alpha1: index 0 and 1 are the endpoints, 2 to 7 go from alpha0 to alpha1
+        int palette[8] = {alpha0, alpha1};
+        for (int j = 2; j < 8; ++j)
+            palette[j] = ((8 - j) * alpha0 + (j - 1) * alpha1) / 7;
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            unsigned best = 0;
+            int bestDistance = 256;
+            for (unsigned j = 0; j < 8; ++j)
+            {
+                const int distance = std::abs(pixels[i][3] - palette[j]);
+                if (distance < bestDistance)
+                {
+                    best = j;
+                    bestDistance = distance;
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+    *dest++ = alpha0;
+    *dest++ = alpha1;
+    for (unsigned i = 0; i < 6; ++i)
+        *dest++ = static_cast<unsigned char>(indices >> (8 * i));
+}
+
+void CompressImage(const RgbaImage &image, TextureBlockFormat format, unsigned char *dest)
+{
+    for (unsigned blockY = 0; blockY < image.height_; blockY += BLOCK_SIZE)
+    {
+        for (unsigned blockX = 0; blockX < image.width_; blockX += BLOCK_SIZE)
+        {
+            unsigned char pixels[16][4];
+            for (unsigned y = 0; y < BLOCK_SIZE; ++y)
+            {
+                const std::size_t row = std::min(blockY + y, image.height_ - 1);
+                for (unsigned x = 0; x < BLOCK_SIZE; ++x)
+                {
+                    const std::size_t column = std::min(blockX + x, image.width_ - 1);
+                    std::memcpy(pixels[y * BLOCK_SIZE + x], &image.pixels_[(row * image.width_ + column) * 4], 4);
+                }
+            }
+            if (format == BLOCK_FORMAT_BC3)
+                compressAlphaBlock(pixels, dest);
+            compressColorBlock(pixels, dest);
+        }
+    }
+}
+
+void CookTexture(const RgbaImage &image, TextureBlockFormat format, bool srgb, CookedScene::Storage &storage, CookedTexture &texture)
+{
+    texture.format_ = format;
+    texture.width_ = image.width_;
+    texture.height_ = image.height_;
+    texture.levels_.clear();
+    RgbaImage level = image;
+    for (;;)
+    {
+        CookedTexture::Level cookedLevel;
+        cookedLevel.width_ = level.width_;
+        cookedLevel.height_ = level.height_;
+        cookedLevel.size_ = GetCompressedSize(level.width_, level.height_, format);
+        unsigned char * const data = CookedScene::Allocate(storage, cookedLevel.size_);
+        CompressImage(level, format, data);
+        cookedLevel.data_ = data;
+        texture.levels_.push_back(cookedLevel);
+        if (level.width_ == 1 && level.height_ == 1)
+            break;
+        level = DownsampleImage(level, srgb);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CookedScene.h"
+
+#include <cstddef>
+#include <vector>
+
+// block compression formats of cooked textures, both are supported by the Direct3D and
+// desktop OpenGL backends of Urho3D and rbfx
+enum TextureBlockFormat
+{
+    BLOCK_FORMAT_BC1, // DXT1, 8 bytes per 4x4 block, opaque
+    BLOCK_FORMAT_BC3 // DXT5, 16 bytes per block with a separately encoded alpha
+};
+
+// 8-bit RGBA pixels, rows from top to bottom
+struct RgbaImage
+{
+    unsigned width_ = 0;
+    unsigned height_ = 0;
+    std::vector<unsigned char> pixels_;
+};
+
+// any format stb_image reads (PNG, JPEG, ...), as embedded in glb files
+bool DecodeImage(const unsigned char *data, std::size_t size, RgbaImage &image);
+// the loader flips texture coordinates vertically like Assimp does, so the images are
+// flipped to match
+void FlipImage(RgbaImage &image);
+bool HasAlpha(const RgbaImage &image);
+// half the size (rounded down, at least 1) with a 2x2 box filter; sRGB images are
+// averaged in linear space so the smaller levels don't darken
+RgbaImage DownsampleImage(const RgbaImage &image, bool srgb);
+
+std::size_t GetCompressedSize(unsigned width, unsigned height, TextureBlockFormat format);
+// encodes the image block by block (edge blocks repeat the last row and column),
+// dest needs GetCompressedSize() bytes; endpoints come from the principal axis of
+// each block's colors, which is fast and good enough for albedo maps
+void CompressImage(const RgbaImage &image, TextureBlockFormat format, unsigned char *dest);
+
+// the full mip chain of the image in format, pointing into storage; thread-safe as
+// long as every concurrent call gets its own storage
+void CookTexture(const RgbaImage &image, TextureBlockFormat format, bool srgb, CookedScene::Storage &storage, CookedTexture &texture);
@@ -1,4 +1,5 @@
 #include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
 #include <Urho3D/Engine/Application.h>
 #include <Urho3D/Engine/EngineDefs.h>
 #include <Urho3D/Graphics/Camera.h>
@@ -26,7 +27,13 @@
 #include <Urho3D/IO/Log.h>
 
 #include "VectorShim.h"
+#include "MaterialCache.h"
+#include "PrimitiveCache.h"
 #include "SceneLoader.h"
+#include "AsyncSceneLoader.h"
+#include "SceneHotReloader.h"
+#include "SceneStreamer.h"
+#include "ShadowBudget.h"
 #include "Player.h"
 #include "Ball.h"
 #include "globals.h"
@@ -84,7 +91,9 @@ public:
         drawDebug_(false),
         drawPhysicsDebug_(false),
         shadowsEnabled_(true),
-        ssaoEnabled_(true)
+        ssaoEnabled_(true),
+        streamLevel_(false),
+        hotReload_(false)
     {
     }
 
@@ -101,6 +110,11 @@ public:
     virtual void Start() override
     {
         ResourceCache * const cache = GetSubsystem<ResourceCache>();
+        for (const auto &argument : GetArguments())
+        {
+            streamLevel_ |= (argument == "--stream");
+            hotReload_ |= (argument == "--hot-reload");
+        }
 
         // Create scene
         scene_ = new Scene(context_);
@@ -159,11 +173,37 @@ public:
         }
 #endif // USING_RBFX
 
-        loadSceneWithAssimp("../assets/test_scene_torus.glb", scene_, context_);
-
         // TODO store pointers, we are leaking these object currently!
         player_ = new Player(scene_, Vector3(6, PLAYER_HEIGHT/2.0+0.01, 0));
 
+        if (streamLevel_)
+        {
+            // only the cells around the player are loaded, physics waits for the first one
+            physicsWorld_->SetUpdateEnabled(false);
+            streamer_ = new SceneStreamer(context_);
+            SubscribeToEvent(streamer_, E_STREAMINGCELL, URHO3D_HANDLER(MyApp, HandleStreamingCell));
+            streamer_->Load("../assets/test_scene_torus.glb", scene_, player_->GetNode());
+        }
+        else
+        {
+            // load the level in the background, nodes appear over the next frames
+            sceneLoader_ = new AsyncSceneLoader(context_);
+            sceneLoader_->SetProgressCallback([this](float progress)
+            {
+                if (debugHud_)
+                    debugHud_->SetAppStats("Loading", static_cast<int>(progress * 100.0f));
+            });
+            SubscribeToEvent(sceneLoader_, E_LEVELLIVE, URHO3D_HANDLER(MyApp, HandleLevelLive));
+            sceneLoader_->Load("../assets/test_scene_torus.glb", scene_);
+
+            // once live, edits to the level file show up without restarting
+            if (hotReload_)
+            {
+                hotReloader_ = new SceneHotReloader(context_);
+                SubscribeToEvent(hotReloader_, E_LEVELLIVE, URHO3D_HANDLER(MyApp, HandleLevelReloaded));
+            }
+        }
+
         // Camera
         cameraNode_ = scene_->CreateChild("Camera");
         cameraPos_ = Vector3(0.0f, 5.0f, -20.0f);
@@ -178,6 +218,11 @@ public:
         camera_->SetFarClip(300.0f);
         UpdateCamera();
 
+        // only the lights closest to / most visible from the camera cast shadows
+        shadowBudget_ = new ShadowBudget(context_);
+        shadowBudget_->SetRoot(scene_);
+        shadowBudget_->SetCamera(camera_);
+
         // Viewport
         Renderer * const renderer = GetSubsystem<Renderer>();
         SharedPtr<Viewport> viewport(new Viewport(context_, scene_, camera_));
@@ -292,14 +337,7 @@ public:
         if (input->GetKeyPress(KEY_M))
         {
             shadowsEnabled_ = !shadowsEnabled_;
-            ea::vector<Light*> lights;
-#ifdef USING_RBFX
-            scene_->FindComponents<Light>(lights, ComponentSearchFlag::SelfOrChildrenRecursive);
-#else
-            scene_->GetComponents<Light>(lights, true);
-#endif // USING_RBFX
-            for (Light * const light : lights)
-                light->SetCastShadows(shadowsEnabled_);
+            shadowBudget_->SetShadowsEnabled(shadowsEnabled_);
         }
 
 #ifdef USING_RBFX
@@ -332,6 +370,41 @@ public:
 
         // Update debug HUD (shows FPS)
         debugHud_->SetMode(DEBUGHUD_SHOW_ALL);
+        const std::string materialStats = MaterialCache::Get(context_)->GetStatsText();
+        const std::string primitiveStats = PrimitiveCache::Get(context_)->GetStatsText();
+        const std::string shadowStats = shadowBudget_->GetStatsText();
+#ifdef USING_RBFX
+        debugHud_->SetAppStats("Materials", ea::string(materialStats.c_str()));
+        debugHud_->SetAppStats("Primitives", ea::string(primitiveStats.c_str()));
+        debugHud_->SetAppStats("Shadows", ea::string(shadowStats.c_str()));
+#else // USING_RBFX
+        debugHud_->SetAppStats("Materials", String(materialStats.c_str()));
+        debugHud_->SetAppStats("Primitives", String(primitiveStats.c_str()));
+        debugHud_->SetAppStats("Shadows", String(shadowStats.c_str()));
+#endif // USING_RBFX
+    }
+
+    void HandleLevelLive(StringHash eventType, VariantMap &eventData)
+    {
+        const bool success = eventData[LevelLive::P_SUCCESS].GetBool();
+        debugHud_->SetAppStats("Loading", success ? 100 : -1);
+        shadowBudget_->Refresh(); // pick up the level's lights
+        if (success && hotReloader_)
+            hotReloader_->Watch(sceneLoader_->GetFilename(), scene_, sceneLoader_->GetLoadedScene());
+    }
+
+    void HandleLevelReloaded(StringHash eventType, VariantMap &eventData)
+    {
+        shadowBudget_->Refresh(); // the lights were created again
+    }
+
+    void HandleStreamingCell(StringHash eventType, VariantMap &eventData)
+    {
+        debugHud_->SetAppStats("Cells", static_cast<int>(streamer_->GetNumLoadedCells()));
+        if (!eventData[StreamingCellChanged::P_LOADED].GetBool())
+            return;
+        physicsWorld_->SetUpdateEnabled(true);
+        shadowBudget_->Refresh(); // pick up the cell's lights
     }
 
     void HandlePostRenderUpdate(StringHash eventType, VariantMap &eventData)
@@ -384,6 +457,10 @@ protected:
     SharedPtr<Scene> scene_;
     SharedPtr<Node> cameraNode_;
     SharedPtr<DebugHud> debugHud_;
+    SharedPtr<AsyncSceneLoader> sceneLoader_;
+    SharedPtr<SceneHotReloader> hotReloader_;
+    SharedPtr<SceneStreamer> streamer_;
+    SharedPtr<ShadowBudget> shadowBudget_;
     SharedPtr<PhysicsWorld> physicsWorld_;
     SharedPtr<Octree> octree_;
     SharedPtr<Zone> zone_;
@@ -397,6 +474,8 @@ protected:
     bool drawPhysicsDebug_;
     bool shadowsEnabled_;
     bool ssaoEnabled_;
+    bool streamLevel_; // --stream on the command line
+    bool hotReload_; // --hot-reload on the command line
 };
 
 URHO3D_DEFINE_APPLICATION_MAIN(MyApp);